@@ -0,0 +1,169 @@
+#include "AssetCache.h"
+
+#include <filesystem>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+static const bool VERBOSE = false;
+
+// Root of the cooked asset cache
+// (Static variables must be defined outside the declaration)
+std::string AssetCache::cacheDirectory = "CookedAssets";
+
+//********************* MappedFile *****************************************
+
+bool MappedFile::open(const std::string& fileName)
+{
+	close();
+
+#ifdef _WIN32
+
+	HANDLE file = CreateFileA(fileName.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+							  OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+
+	if (file == INVALID_HANDLE_VALUE) {
+		return false;
+	}
+
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0) {
+		CloseHandle(file);
+		return false;
+	}
+
+	HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (mapping == nullptr) {
+		CloseHandle(file);
+		return false;
+	}
+
+	void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	if (view == nullptr) {
+		CloseHandle(mapping);
+		CloseHandle(file);
+		return false;
+	}
+
+	fileHandle = file;
+	mappingHandle = mapping;
+	data = static_cast<const unsigned char*>(view);
+	size = static_cast<size_t>(fileSize.QuadPart);
+
+#else
+
+	int file = ::open(fileName.c_str(), O_RDONLY);
+	if (file < 0) {
+		return false;
+	}
+
+	struct stat fileStats;
+	if (fstat(file, &fileStats) != 0 || fileStats.st_size == 0) {
+		::close(file);
+		return false;
+	}
+
+	void* view = mmap(nullptr, static_cast<size_t>(fileStats.st_size), PROT_READ, MAP_PRIVATE, file, 0);
+
+	// The mapping remains valid after the descriptor is closed
+	::close(file);
+
+	if (view == MAP_FAILED) {
+		return false;
+	}
+
+	data = static_cast<const unsigned char*>(view);
+	size = static_cast<size_t>(fileStats.st_size);
+
+#endif
+
+	if (VERBOSE) cout << "Mapped " << fileName << " (" << size << " bytes)" << endl;
+
+	return true;
+
+} // end open
+
+
+void MappedFile::close()
+{
+	if (data == nullptr) {
+		return;
+	}
+
+#ifdef _WIN32
+	UnmapViewOfFile(data);
+	CloseHandle(mappingHandle);
+	CloseHandle(fileHandle);
+	mappingHandle = nullptr;
+	fileHandle = nullptr;
+#else
+	munmap(const_cast<unsigned char*>(data), size);
+#endif
+
+	data = nullptr;
+	size = 0;
+
+} // end close
+
+//********************* AssetCache *****************************************
+
+std::string AssetCache::getCookedPath(const std::string& sourceFile, const std::string& category, const std::string& extension)
+{
+	// Flatten the relative path of the source so that every source file
+	// maps to a unique file in a single directory.
+	std::string flatName = sourceFile;
+
+	for (char& c : flatName) {
+
+		if (c == '/' || c == '\\' || c == ':' || c == ' ') {
+			c = '_';
+		}
+		else {
+			c = static_cast<char>(tolower(static_cast<unsigned char>(c)));
+		}
+	}
+
+	std::filesystem::path directory = std::filesystem::path(cacheDirectory) / category;
+
+	std::error_code error;
+	std::filesystem::create_directories(directory, error);
+
+	if (error) {
+		std::cerr << "ERROR: Unable to create cache directory " << directory.string() << std::endl;
+	}
+
+	return (directory / (flatName + extension)).string();
+
+} // end getCookedPath
+
+
+bool AssetCache::isCookedFileCurrent(const std::string& sourceFile, const std::string& cookedFile)
+{
+	std::error_code error;
+
+	if (!std::filesystem::exists(cookedFile, error)) {
+		return false;
+	}
+
+	if (!std::filesystem::exists(sourceFile, error)) {
+		return true;
+	}
+
+	auto sourceTime = std::filesystem::last_write_time(sourceFile, error);
+	auto cookedTime = std::filesystem::last_write_time(cookedFile, error);
+
+	if (error) {
+		return false;
+	}
+
+	return cookedTime >= sourceTime;
+
+} // end isCookedFileCurrent
@@ -0,0 +1,153 @@
+#pragma once
+
+#include <string>
+
+#include "MathLibsConstsFuncs.h"
+
+/**
+ * @class	MappedFile
+ *
+ * @brief	Read only memory mapping of a file. The contents of the file can be
+ * 			handed directly to OpenGL (or parsed in place) without first being
+ * 			copied into a heap allocated buffer. The mapping is released when
+ * 			the object is destroyed.
+ */
+class MappedFile
+{
+public:
+
+	MappedFile() {}
+
+	/**
+	 * @fn	MappedFile::~MappedFile()
+	 *
+	 * @brief	Destructor. Unmaps the file if it is mapped.
+	 */
+	~MappedFile() { close(); }
+
+	// Mappings own operating system handles and can not be copied
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	/**
+	 * @fn	bool MappedFile::open(const std::string& fileName);
+	 *
+	 * @brief	Maps the entire file into the address space of the process.
+	 *
+	 * @param	fileName	Relative path and name of the file.
+	 *
+	 * @returns	True if it succeeds, false if it fails.
+	 */
+	bool open(const std::string& fileName);
+
+	/**
+	 * @fn	void MappedFile::close();
+	 *
+	 * @brief	Unmaps the file. Pointers returned by getData are no longer valid.
+	 */
+	void close();
+
+	/**
+	 * @fn	const unsigned char* MappedFile::getData() const
+	 *
+	 * @brief	Gets a pointer to the first byte of the mapped file.
+	 *
+	 * @returns	Null if no file is mapped, else the contents of the file.
+	 */
+	const unsigned char* getData() const { return data; }
+
+	/**
+	 * @fn	size_t MappedFile::getSize() const
+	 *
+	 * @brief	Gets the size in bytes of the mapped file.
+	 *
+	 * @returns	The size.
+	 */
+	size_t getSize() const { return size; }
+
+protected:
+
+	/** @brief	First byte of the mapped view of the file */
+	const unsigned char* data = nullptr;
+
+	/** @brief	Size of the mapping in bytes */
+	size_t size = 0;
+
+#ifdef _WIN32
+	/** @brief	Windows file and file mapping handles */
+	void* fileHandle = nullptr;
+	void* mappingHandle = nullptr;
+#endif
+
+}; // end MappedFile
+
+
+/**
+ * @class	AssetCache
+ *
+ * @brief	Static class that manages the cooked asset cache. Source assets
+ * 			(textures, models, shaders, etc.) are processed ("cooked") into
+ * 			formats that can be loaded quickly. Cooked files are stored under
+ * 			a single root directory and are rebuilt whenever the source file
+ * 			is newer than the cooked copy.
+ */
+class AssetCache
+{
+public:
+
+	/**
+	 * @fn	static std::string AssetCache::getCookedPath(const std::string& sourceFile, const std::string& category, const std::string& extension);
+	 *
+	 * @brief	Builds the name of the cooked file for a source asset. The source path
+	 * 			is flattened so that assets with the same name in different
+	 * 			directories do not collide. The category directory is created if it
+	 * 			does not exist.
+	 *
+	 * @param	sourceFile	Relative path and name of the source asset.
+	 * @param	category  	Sub-directory of the cache (e.g. "Textures").
+	 * @param	extension 	Extension, including any variant suffix, of the cooked file.
+	 *
+	 * @returns	The relative path and name of the cooked file.
+	 */
+	static std::string getCookedPath(const std::string& sourceFile, const std::string& category, const std::string& extension);
+
+	/**
+	 * @fn	static bool AssetCache::isCookedFileCurrent(const std::string& sourceFile, const std::string& cookedFile);
+	 *
+	 * @brief	Determines if a cooked file exists and is at least as new as the
+	 * 			source file it was built from. If the source file is missing, an
+	 * 			existing cooked file is considered current so that cooked assets
+	 * 			can be shipped without the source.
+	 *
+	 * @param	sourceFile	Relative path and name of the source asset.
+	 * @param	cookedFile	Relative path and name of the cooked file.
+	 *
+	 * @returns	True if the cooked file can be used, false if it must be rebuilt.
+	 */
+	static bool isCookedFileCurrent(const std::string& sourceFile, const std::string& cookedFile);
+
+	/**
+	 * @fn	static void AssetCache::setCacheDirectory(const std::string& directory)
+	 *
+	 * @brief	Sets the root directory of the cooked asset cache.
+	 *
+	 * @param	directory	Relative path of the root directory.
+	 */
+	static void setCacheDirectory(const std::string& directory) { cacheDirectory = directory; }
+
+	/**
+	 * @fn	static const std::string& AssetCache::getCacheDirectory()
+	 *
+	 * @brief	Gets the root directory of the cooked asset cache.
+	 *
+	 * @returns	The cache directory.
+	 */
+	static const std::string& getCacheDirectory() { return cacheDirectory; }
+
+protected:
+
+	/** @brief	Root directory of the cooked asset cache */
+	static std::string cacheDirectory;
+
+}; // end AssetCache
+
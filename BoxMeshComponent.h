@@ -1,18 +1,19 @@
 #pragma once
-#include "MeshComponent.h"
+#include "ProceduralMeshComponent.h"
 
-class BoxMeshComponent : public MeshComponent
+class BoxMeshComponent : public ProceduralMeshComponent
 {
 public:
 	BoxMeshComponent(GLuint shaderProgram, Material material, float width = 1.0f, float height = 1.0f, float depth = 1.0f, int updateOrder = 100);
 
-	virtual void buildMesh() override;
-
 protected:
 
-	float halfWidth, halfHeight, halfDepth;
+	virtual size_t getGeometryKey() const override;
 
-	Material boxMat;
+	virtual void generateGeometry(int subMeshIndex, std::vector<pntVertexData>& vertexData, std::vector<unsigned int>& indices) const override;
 
-}; // end BoxMeshComponent class
+	virtual std::shared_ptr<btCollisionShape> createCollisionShape() const override;
 
+	float halfWidth, halfHeight, halfDepth;
+
+}; // end BoxMeshComponent class
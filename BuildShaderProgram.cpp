@@ -1,14 +1,61 @@
 #include "BuildShaderProgram.h"
+#include "AssetCache.h"
+#include "ShaderHotReload.h"
+#include "SharedMaterials.h"
+#include "SharedTransformations.h"
+#include "SharedLighting.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
 #include <cstdlib>
+#include <cstring>
+#include <unordered_map>
 
 static const bool VERBOSE = false;
 
+// Tag and version written at the start of every cached program binary.
+// Incrementing the version causes all programs to be compiled again.
+static const uint32_t PROGRAM_BINARY_TAG = 0x50474E45; // "ENGP"
+static const uint32_t PROGRAM_BINARY_VERSION = 1;
+
+// Header of a cached program binary. The binary returned by
+// glGetProgramBinary follows the header.
+struct ProgramBinaryHeader {
+	uint32_t tag;
+	uint32_t version;
+	uint64_t sourceHash;
+	uint64_t driverHash;
+	uint32_t binaryFormat;
+	uint32_t binaryLength;
+	double compileSeconds;
+};
+
+// A program built during this run and the time it took to compile
+struct BuiltProgram {
+	GLuint program;
+	double compileSeconds;
+};
+
 // Static variable definition. Holds all shader programs created usig
-// BuildShaderProgram. Allows all the shader programs to be 
+// BuildShaderProgram. Allows all the shader programs to be
 // deleted when the game ends.
 static std::vector<GLuint> shaderProgramsCreated;
 
-// Reads in the source code of a shader program.  
+// Programs built during this run indexed by the hash of their shader types and
+// source code. Identical ShaderInfo arrays share a single program.
+static std::unordered_map<uint64_t, BuiltProgram> programsBySource;
+
+// Shader types and source files of the programs created by BuildShaderProgram
+static std::unordered_map<GLuint, std::vector<std::pair<GLenum, std::string>>> programShaderFiles;
+
+// Indicates compiled programs are saved to and loaded from the asset cache
+static bool programBinaryCacheEnabled = true;
+
+// Work done and avoided by the program cache
+static ShaderCacheStats shaderCacheStats;
+
+// Reads in the source code of a shader program.
 const GLchar* ReadShader(const char* filename)
 {
 	FILE* infile;
@@ -41,56 +88,235 @@ const GLchar* ReadShader(const char* filename)
 } // end ReadShader
 
 
-GLuint BuildShaderProgram(ShaderInfo* shaders)
+// 64 bit FNV-1a hash. Pass the result of a previous call as the hash
+// to combine several blocks of data.
+static uint64_t hashBytes(const void* data, size_t size, uint64_t hash = 0xcbf29ce484222325ULL)
 {
-	if (shaders == nullptr) { return 0; }
+	const unsigned char* bytes = static_cast<const unsigned char*>(data);
+
+	for (size_t i = 0; i < size; i++) {
+
+		hash ^= bytes[i];
+		hash *= 0x100000001b3ULL;
+	}
+
+	return hash;
+
+} // end hashBytes
+
+
+// Hashes the strings that identify the driver. Binaries saved by a different
+// vendor, renderer or driver version are not loaded.
+static uint64_t hashDriver()
+{
+	uint64_t hash = hashBytes(nullptr, 0);
+
+	for (GLenum name : { GL_VENDOR, GL_RENDERER, GL_VERSION }) {
+
+		const char* value = reinterpret_cast<const char*>(glGetString(name));
+
+		if (value != nullptr) {
+			hash = hashBytes(value, strlen(value) + 1, hash);
+		}
+	}
+
+	return hash;
+
+} // end hashDriver
+
+
+// Determines if the driver can return program binaries at all
+static bool programBinariesSupported()
+{
+	GLint formatCount = 0;
+	glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formatCount);
+
+	return formatCount > 0;
+
+} // end programBinariesSupported
+
+
+// Seconds elapsed since start
+static double secondsSince(std::chrono::steady_clock::time_point start)
+{
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+} // end secondsSince
 
+
+// Creates a program from a cached binary. Returns 0 if the file is missing,
+// was saved for other sources or another driver, or is rejected by the driver.
+static GLuint loadProgramBinary(const std::string& cacheFile, uint64_t sourceHash, uint64_t driverHash, double& compileSeconds)
+{
+	MappedFile file;
+
+	if (!file.open(cacheFile)) {
+		return 0;
+	}
+
+	ProgramBinaryHeader header;
+
+	if (file.getSize() < sizeof(header)) {
+		return 0;
+	}
+
+	memcpy(&header, file.getData(), sizeof(header));
+
+	if (header.tag != PROGRAM_BINARY_TAG || header.version != PROGRAM_BINARY_VERSION ||
+		header.sourceHash != sourceHash || header.driverHash != driverHash ||
+		sizeof(header) + header.binaryLength > file.getSize()) {
+
+		return 0;
+	}
+
+	GLuint program = glCreateProgram();
+
+	// Allow the binary to be retrieved again if the driver decides to recompile
+	glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+	glProgramBinary(program, header.binaryFormat, file.getData() + sizeof(header), header.binaryLength);
+
+	// The driver can reject a binary at any time (e.g. after an update that did
+	// not change the version string). The program is then built from source.
+	GLint linked;
+	glGetProgramiv(program, GL_LINK_STATUS, &linked);
+
+	if (!linked) {
+
+		if (VERBOSE) cout << "Program binary " << cacheFile << " was rejected by the driver." << endl;
+
+		glDeleteProgram(program);
+		return 0;
+	}
+
+	compileSeconds = header.compileSeconds;
+
+	return program;
+
+} // end loadProgramBinary
+
+
+// Saves the binary of a linked program to the asset cache
+static void saveProgramBinary(const std::string& cacheFile, GLuint program, uint64_t sourceHash, uint64_t driverHash, double compileSeconds)
+{
+	GLint length = 0;
+	glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+
+	if (length <= 0) {
+		return;
+	}
+
+	std::vector<unsigned char> binary(length);
+	GLenum binaryFormat = 0;
+	glGetProgramBinary(program, length, &length, &binaryFormat, binary.data());
+
+	ProgramBinaryHeader header = {};
+	header.tag = PROGRAM_BINARY_TAG;
+	header.version = PROGRAM_BINARY_VERSION;
+	header.sourceHash = sourceHash;
+	header.driverHash = driverHash;
+	header.binaryFormat = binaryFormat;
+	header.binaryLength = static_cast<uint32_t>(length);
+	header.compileSeconds = compileSeconds;
+
+	FILE* file = nullptr;
+	fopen_s(&file, cacheFile.c_str(), "wb");
+
+	if (file == nullptr) {
+		std::cerr << "ERROR: Unable to write " << cacheFile << "!" << std::endl;
+		return;
+	}
+
+	bool written = fwrite(&header, sizeof(header), 1, file) == 1 &&
+				   fwrite(binary.data(), 1, length, file) == static_cast<size_t>(length);
+
+	fclose(file);
+
+	if (!written) {
+		std::cerr << "ERROR: Unable to write " << cacheFile << "!" << std::endl;
+		std::remove(cacheFile.c_str());
+	}
+
+} // end saveProgramBinary
+
+
+// Reads the source code of every shader in the ShaderInfo array. Returns false
+// if a file could not be read.
+static bool readShaderSources(ShaderInfo* shaders, std::vector<std::string>& sources, const std::string& defines)
+{
+	for (ShaderInfo* entry = shaders; entry->type != GL_NONE; ++entry) {
+
+		entry->shader = 0;
+
+		const GLchar* source = ReadShader(entry->filename);
+		if (source == nullptr) {
+			return false;
+		}
+
+		sources.push_back(source);
+
+		// Release the memory holding the character array into which
+		// the shader source was read
+		delete[] source;
+
+		// The #version directive must come first so the defines are inserted
+		// on the line after it
+		if (!defines.empty()) {
+
+			std::string& text = sources.back();
+			size_t version = text.find("#version");
+			size_t lineEnd = version == std::string::npos ? std::string::npos : text.find('\n', version);
+
+			if (lineEnd == std::string::npos) {
+				text.insert(0, defines);
+			}
+			else {
+				text.insert(lineEnd + 1, defines);
+			}
+		}
+	}
+
+	return true;
+
+} // end readShaderSources
+
+
+// Compiles and links the shaders in the ShaderInfo array. Returns 0 and the
+// compiler or linker output in errorLog if there are errors.
+static GLuint compileProgram(ShaderInfo* shaders, const std::vector<std::string>& sources, std::string& errorLog)
+{
 	// Creates an empty Shader Program object and returns an unsigned int by which
 	// it can be referenced. Shader objects will be attached to the program
 	// object.
 	GLuint program = glCreateProgram();
 
+	// Allow the linked program to be saved to the program binary cache
+	glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+
 	// Declare and array of structures to hold information particular shaders.
 	ShaderInfo* entry = shaders;
 
 	// Loop though all shaders specified in entry array until a GL_NONE
 	// is encountered in the type field. All shaders will be attached
 	// to the shader program.
-	while (entry->type != GL_NONE) {
+	for (size_t i = 0; entry->type != GL_NONE; ++i, ++entry) {
 
 		// Creates an empty Shader object and returns an unsigned int by which
-		// it can be referenced.  A shader object is used to maintain the 
+		// it can be referenced.  A shader object is used to maintain the
 		// source code strings that define a shader.
 		GLuint shader = glCreateShader(entry->type);
 
 		// Store the int ID for the shader in a ShaderInfo structure
 		entry->shader = shader;
 
-		// Read in the source code for a shader
-		const GLchar* source = ReadShader(entry->filename);
-		if (source == nullptr) {
-			for (entry = shaders; entry->type != GL_NONE; ++entry) {
-
-				// Release the name (ID) that was allocated.
-				glDeleteShader(entry->shader);
-				entry->shader = 0;
-			}
-
-			return 0;
-		}
-
 		// Associate the shader source code with the Shader object
+		const GLchar* source = sources[i].c_str();
 		glShaderSource(shader, 1, &source, nullptr);
 
-		// Release the memory holding the character array into which
-		// the shader source was read
-		delete[] source;
-
 		// Complie the shader source code
 		glCompileShader(shader);
 
 		// Determine if the shader compiled without errors.
-		// "complied" will be set to GL_TRUE if compile operation 
+		// "complied" will be set to GL_TRUE if compile operation
 		// is a success.
 		GLint compiled;
 		glGetShaderiv(shader, GL_COMPILE_STATUS, &compiled);
@@ -101,9 +327,16 @@ GLuint BuildShaderProgram(ShaderInfo* shaders)
 
 			GLchar* log = new GLchar[len + (__int64)1];
 			glGetShaderInfoLog(shader, len, &len, log);
-			std::cerr << "\nShader compilation failed: \n" << log << "\n" << std::endl;
+			errorLog = std::string("Shader compilation failed: ") + entry->filename + "\n" + log;
 			delete[] log;
-			exit(EXIT_FAILURE);
+
+			for (ShaderInfo* entryToDelete = shaders; entryToDelete != entry + 1; ++entryToDelete) {
+				glDeleteShader(entryToDelete->shader);
+				entryToDelete->shader = 0;
+			}
+
+			glDeleteProgram(program);
+			return 0;
 		}
 		else {
 
@@ -114,8 +347,6 @@ GLuint BuildShaderProgram(ShaderInfo* shaders)
 		// Associate the compiled shader with the shader program.
 		// Shader functionality will not be available until it has be linked.
 		glAttachShader(program, shader);
-
-		++entry;
 	}
 
 	// Generates a complete shader program. All required shader objects
@@ -127,13 +358,13 @@ GLuint BuildShaderProgram(ShaderInfo* shaders)
 	GLint linked;
 	glGetProgramiv(program, GL_LINK_STATUS, &linked);
 	if (!linked) {
-	
+
 		GLsizei len;
 		glGetProgramiv(program, GL_INFO_LOG_LENGTH, &len);
 
 		GLchar* log = new GLchar[len + (__int64)1];
 		glGetProgramInfoLog(program, len, &len, log);
-		std::cerr << "\nShader linking failed: \n" << log << "\n" << std::endl;
+		errorLog = std::string("Shader linking failed: \n") + log;
 		delete[] log;
 
 
@@ -142,13 +373,106 @@ GLuint BuildShaderProgram(ShaderInfo* shaders)
 			entry->shader = 0;
 		}
 
-		exit(EXIT_FAILURE);
+		glDeleteProgram(program);
+		return 0;
 	}
 	else {
 
 		if (VERBOSE) std::cout << std::endl << "Shader Program " << program << " successfully linked";
 
 	}
+
+	// The linked program does not need the shader objects. Flag them
+	// for deletion once they are no longer attached.
+	for (entry = shaders; entry->type != GL_NONE; ++entry) {
+		glDetachShader(program, entry->shader);
+		glDeleteShader(entry->shader);
+	}
+
+	return program;
+
+} // end compileProgram
+
+
+GLuint BuildShaderProgram(ShaderInfo* shaders, const std::string& defines)
+{
+	if (shaders == nullptr) { return 0; }
+
+	// Read the source code of every shader and hash it together with the
+	// shader types. The hash identifies the program in this run and in the
+	// program binary cache.
+	std::vector<std::string> sources;
+	if (!readShaderSources(shaders, sources, defines)) {
+		return 0;
+	}
+
+	uint64_t sourceHash = hashBytes(nullptr, 0);
+
+	for (size_t i = 0; shaders[i].type != GL_NONE; i++) {
+
+		sourceHash = hashBytes(&shaders[i].type, sizeof(shaders[i].type), sourceHash);
+		sourceHash = hashBytes(sources[i].c_str(), sources[i].size() + 1, sourceHash);
+	}
+
+	// Reuse the program if the same shaders have already been built
+	auto built = programsBySource.find(sourceHash);
+	if (built != programsBySource.end()) {
+
+		shaderCacheStats.programsReused++;
+		shaderCacheStats.secondsSaved += built->second.compileSeconds;
+
+		return built->second.program;
+	}
+
+	GLuint program = 0;
+	double compileSeconds = 0.0;
+	std::string cacheFile;
+	uint64_t driverHash = 0;
+
+	// Try to load a binary saved by a previous run
+	if (programBinaryCacheEnabled && programBinariesSupported()) {
+
+		driverHash = hashDriver();
+
+		char name[40];
+		snprintf(name, sizeof(name), "program_%016llx", static_cast<unsigned long long>(sourceHash ^ driverHash));
+		cacheFile = AssetCache::getCookedPath(name, "Shaders", ".bin");
+
+		auto start = std::chrono::steady_clock::now();
+		program = loadProgramBinary(cacheFile, sourceHash, driverHash, compileSeconds);
+
+		if (program != 0) {
+
+			double loadSeconds = secondsSince(start);
+
+			shaderCacheStats.programsLoaded++;
+			shaderCacheStats.loadSeconds += loadSeconds;
+			shaderCacheStats.secondsSaved += std::max(0.0, compileSeconds - loadSeconds);
+		}
+	}
+
+	// Build the program from source if there is no usable binary
+	if (program == 0) {
+
+		auto start = std::chrono::steady_clock::now();
+		std::string errorLog;
+		program = compileProgram(shaders, sources, errorLog);
+		compileSeconds = secondsSince(start);
+
+		if (program == 0) {
+
+			std::cerr << "\n" << errorLog << "\n" << std::endl;
+			exit(EXIT_FAILURE);
+		}
+
+		shaderCacheStats.programsCompiled++;
+		shaderCacheStats.compileSeconds += compileSeconds;
+
+		if (!cacheFile.empty()) {
+			saveProgramBinary(cacheFile, program, sourceHash, driverHash, compileSeconds);
+		}
+	}
+
 	// Check whether the program can execute given the current pipeline state.
 	glValidateProgram(program);
 	GLint valid;
@@ -172,12 +496,153 @@ GLuint BuildShaderProgram(ShaderInfo* shaders)
 	// Save a reference to the shader program so that is can
 	// later be deleted.
 	shaderProgramsCreated.push_back(program);
+	programsBySource[sourceHash] = { program, compileSeconds };
+
+	for (ShaderInfo* entry = shaders; entry->type != GL_NONE; ++entry) {
+		programShaderFiles[program].push_back({ entry->type, entry->filename });
+	}
+
+	// Rebuild the program whenever one of its source files changes
+	ShaderHotReload::watchProgram(program, shaders, defines);
 
 	return program;
 
 } // end BuildShaderProgram
 
 
+GLuint TryBuildShaderProgram(ShaderInfo* shaders, std::string& errorLog, const std::string& defines)
+{
+	if (shaders == nullptr) { return 0; }
+
+	std::vector<std::string> sources;
+	if (!readShaderSources(shaders, sources, defines)) {
+
+		errorLog = "Unable to read shader source code.";
+		return 0;
+	}
+
+	return compileProgram(shaders, sources, errorLog);
+
+} // end TryBuildShaderProgram
+
+
+void swapShaderProgram(GLuint oldProgram, GLuint newProgram)
+{
+	for (GLuint& program : shaderProgramsCreated) {
+
+		if (program == oldProgram) {
+			program = newProgram;
+		}
+	}
+
+	auto files = programShaderFiles.find(oldProgram);
+	if (files != programShaderFiles.end()) {
+
+		programShaderFiles[newProgram] = files->second;
+		programShaderFiles.erase(oldProgram);
+	}
+
+	// The sources of the old program have changed so it can no longer be shared
+	for (auto iter = programsBySource.begin(); iter != programsBySource.end();) {
+
+		if (iter->second.program == oldProgram) {
+			iter = programsBySource.erase(iter);
+		}
+		else {
+			++iter;
+		}
+	}
+
+	glDeleteProgram(oldProgram);
+
+} // end swapShaderProgram
+
+
+bool getShaderProgramFiles(GLuint shaderProgram, std::vector<GLenum>& types, std::vector<std::string>& filenames)
+{
+	auto files = programShaderFiles.find(shaderProgram);
+
+	if (files == programShaderFiles.end()) {
+		return false;
+	}
+
+	for (auto& file : files->second) {
+
+		types.push_back(file.first);
+		filenames.push_back(file.second);
+	}
+
+	return true;
+
+} // end getShaderProgramFiles
+
+
+// Determines if a program has a uniform block assigned to a binding point
+static bool usesBindingPoint(GLuint shaderProgram, GLuint bindingPoint)
+{
+	GLint blockCount = 0;
+	glGetProgramiv(shaderProgram, GL_ACTIVE_UNIFORM_BLOCKS, &blockCount);
+
+	for (GLint block = 0; block < blockCount; block++) {
+
+		GLint binding = -1;
+		glGetActiveUniformBlockiv(shaderProgram, block, GL_UNIFORM_BLOCK_BINDING, &binding);
+
+		if (binding == static_cast<GLint>(bindingPoint)) {
+			return true;
+		}
+	}
+
+	return false;
+
+} // end usesBindingPoint
+
+
+void setSharedUniformBlocksLike(GLuint shaderProgram, GLuint templateProgram)
+{
+	// GPU driven variants read their materials from a storage buffer instead
+	if (usesBindingPoint(templateProgram, materialBlockBindingPoint) &&
+		glGetUniformBlockIndex(shaderProgram, "MaterialBlock") != GL_INVALID_INDEX) {
+		SharedMaterials::setUniformBlockForShader(shaderProgram);
+	}
+
+	if (usesBindingPoint(templateProgram, projectionViewBlockBindingPoint)) {
+		SharedTransformations::setUniformBlockForShader(shaderProgram);
+	}
+
+	if (usesBindingPoint(templateProgram, generalLightBlockBindingPoint)) {
+		SharedLighting::setUniformBlockForShader(shaderProgram);
+	}
+
+} // end setSharedUniformBlocksLike
+
+
+void setProgramBinaryCacheEnabled(bool enabled)
+{
+	programBinaryCacheEnabled = enabled;
+
+} // end setProgramBinaryCacheEnabled
+
+
+const ShaderCacheStats& getShaderCacheStats()
+{
+	return shaderCacheStats;
+
+} // end getShaderCacheStats
+
+
+void printShaderCacheStats()
+{
+	cout << "Shader programs: " << shaderCacheStats.programsCompiled << " compiled ("
+		<< shaderCacheStats.compileSeconds * 1000.0 << " ms), "
+		<< shaderCacheStats.programsLoaded << " loaded from the binary cache ("
+		<< shaderCacheStats.loadSeconds * 1000.0 << " ms), "
+		<< shaderCacheStats.programsReused << " reused. Compile time saved: "
+		<< shaderCacheStats.secondsSaved * 1000.0 << " ms" << endl;
+
+} // end printShaderCacheStats
+
+
 void deleteAllShaderPrograms()
 {
 	for (auto& shaderProgram : shaderProgramsCreated) {
@@ -186,7 +651,8 @@ void deleteAllShaderPrograms()
 
 	}
 
-} // end deleteAllShaderPrograms
-
-
+	shaderProgramsCreated.clear();
+	programsBySource.clear();
+	programShaderFiles.clear();
 
+} // end deleteAllShaderPrograms
@@ -18,7 +18,35 @@ typedef struct {
 } ShaderInfo;
 
 /**
- * @fn	GLuint BuildShaderProgram(ShaderInfo* shaders);
+ * @struct	ShaderCacheStats
+ *
+ * @brief	Statistics on the shader programs built by BuildShaderProgram
+ * 			and the compile time avoided by the program binary cache.
+ */
+struct ShaderCacheStats {
+
+	/** @brief	Number of programs compiled and linked from source */
+	int programsCompiled = 0;
+
+	/** @brief	Number of programs created from binaries saved by a previous run */
+	int programsLoaded = 0;
+
+	/** @brief	Number of calls that returned a program already built during this run */
+	int programsReused = 0;
+
+	/** @brief	Time spent compiling and linking programs */
+	double compileSeconds = 0.0;
+
+	/** @brief	Time spent creating programs from cached binaries */
+	double loadSeconds = 0.0;
+
+	/** @brief	Estimated compile time avoided by loading and reusing programs */
+	double secondsSaved = 0.0;
+
+}; // end ShaderCacheStats
+
+/**
+ * @fn	GLuint BuildShaderProgram(ShaderInfo* shaders, const std::string& defines = "");
  *
  * @brief	Builds shader program composed of multiple shaders
  * 			and returns an integer reference to the shader 
@@ -26,13 +54,110 @@ typedef struct {
  * 			names of the shaders that will be used to build 
  * 			the program.
  *
+ * 			Programs are keyed by a hash of the shader types and
+ * 			source code. Building the same shaders a second time
+ * 			returns the existing program. Linked programs are saved
+ * 			to the asset cache with glGetProgramBinary and loaded
+ * 			with glProgramBinary in later runs as long as the
+ * 			sources, vendor, renderer and driver version match.
+ * 			Binaries that are rejected by the driver are replaced
+ * 			by compiling from source.
+ *
  * @param [in,out]	shaders	If non-null, array containing the
  * 					names of the shaders that will be used to 
  * 					build the shader program.
+ * @param 		  	defines	(Optional) Preprocessor definitions that
+ * 					are inserted after the #version directive of
+ * 					every shader. Used to build specialized variants.
  *
  * @returns	A GLuint.
  */
-GLuint BuildShaderProgram(ShaderInfo* shaders);
+GLuint BuildShaderProgram(ShaderInfo* shaders, const std::string& defines = "");
+
+/**
+ * @fn	GLuint TryBuildShaderProgram(ShaderInfo* shaders, std::string& errorLog, const std::string& defines = "");
+ *
+ * @brief	Compiles and links a shader program without exiting on
+ * 			errors. The program is not shared, cached or deleted by
+ * 			deleteAllShaderPrograms. Used to rebuild programs whose
+ * 			source files have changed while the game is running.
+ *
+ * @param [in,out]	shaders 	Array containing the names of the shaders
+ * 								that will be used to build the shader program.
+ * @param [out]   	errorLog	Compiler or linker output if there are errors.
+ * @param 		  	defines 	(Optional) Preprocessor definitions inserted
+ * 								after the #version directive of every shader.
+ *
+ * @returns	Zero if it fails, else the shader program.
+ */
+GLuint TryBuildShaderProgram(ShaderInfo* shaders, std::string& errorLog, const std::string& defines = "");
+
+/**
+ * @fn	bool getShaderProgramFiles(GLuint shaderProgram, std::vector<GLenum>& types, std::vector<std::string>& filenames);
+ *
+ * @brief	Gets the shader types and source files a program created
+ * 			by BuildShaderProgram was built from.
+ *
+ * @param 		  	shaderProgram	The shader program.
+ * @param [out]   	types		 	The type of each shader.
+ * @param [out]   	filenames	 	The source file of each shader.
+ *
+ * @returns	False if the program was not created by BuildShaderProgram.
+ */
+bool getShaderProgramFiles(GLuint shaderProgram, std::vector<GLenum>& types, std::vector<std::string>& filenames);
+
+/**
+ * @fn	void setSharedUniformBlocksLike(GLuint shaderProgram, GLuint templateProgram);
+ *
+ * @brief	Calls setUniformBlockForShader of each of SharedMaterials,
+ * 			SharedTransformations and SharedLighting whose uniform
+ * 			block is used by the template program. Used to set up
+ * 			programs that replace or specialize another program.
+ *
+ * @param	shaderProgram  	The program to set up.
+ * @param	templateProgram	A program that has already been set up.
+ */
+void setSharedUniformBlocksLike(GLuint shaderProgram, GLuint templateProgram);
+
+/**
+ * @fn	void swapShaderProgram(GLuint oldProgram, GLuint newProgram);
+ *
+ * @brief	Replaces a program created by BuildShaderProgram with
+ * 			a rebuilt one and deletes the old program. Everything
+ * 			that renders with the old program must have been switched
+ * 			to the new one first.
+ *
+ * @param	oldProgram	The program created by BuildShaderProgram.
+ * @param	newProgram	The program that replaces it.
+ */
+void swapShaderProgram(GLuint oldProgram, GLuint newProgram);
+
+/**
+ * @fn	void setProgramBinaryCacheEnabled(bool enabled);
+ *
+ * @brief	Enables or disables saving and loading of program
+ * 			binaries. Programs are still shared within a run.
+ *
+ * @param	enabled	True to use the program binary cache.
+ */
+void setProgramBinaryCacheEnabled(bool enabled);
+
+/**
+ * @fn	const ShaderCacheStats& getShaderCacheStats();
+ *
+ * @brief	Gets statistics on the shader programs that have been built.
+ *
+ * @returns	The statistics.
+ */
+const ShaderCacheStats& getShaderCacheStats();
+
+/**
+ * @fn	void printShaderCacheStats();
+ *
+ * @brief	Prints the number of programs compiled, loaded and
+ * 			reused and the compile time saved to the console.
+ */
+void printShaderCacheStats();
 
 /**
  * @fn	void deleteAllShaderPrograms();
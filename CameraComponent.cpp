@@ -31,22 +31,107 @@ void CameraComponent::setCameraTransformations()
 	// Get the current width and height of the rendering window
 	glm::ivec2 dimensions = owningGameObject->getOwningGame()->getWindowDimensions();
 
+	updateMatrices(dimensions);
+
+	// Render into the texture instead of the window
+	if (renderTarget) {
+		renderTarget->begin();
+	}
+
 	// Clear only the portion of the window associated with the camera viewport to the camera clear color
-	// using the scissor test
-	// TODO
+	// using the scissor test. The clear color of the window is left as it is.
+	const GLfloat farDepth = 1.0f;
+
+	glEnable(GL_SCISSOR_TEST);
+	glScissor(viewportPixels.x, viewportPixels.y, viewportPixels.z, viewportPixels.w);
+	glClearBufferfv(GL_COLOR, 0, glm::value_ptr(cameraClearColor));
+	glClearBufferfv(GL_DEPTH, 0, &farDepth);
+	glDisable(GL_SCISSOR_TEST);
 
 	// Set up the viewport transformation for the camera
-	// TODO
+	glViewport(viewportPixels.x, viewportPixels.y, viewportPixels.z, viewportPixels.w);
 
 	// Set the projection transformation for the camera
-	// TODO
+	SharedTransformations::setProjectionMatrix(projectionMatrix);
 
 	// Set the viewing transformation for the camera
-	// TODO
+	SharedTransformations::setViewMatrix(viewMatrix);
 
 } // end setCameraTransformations
 
 
+void CameraComponent::updateMatrices(glm::ivec2 windowDimensions)
+{
+	if (renderTarget) {
+		windowDimensions = renderTarget->getSize();
+	}
+
+	// Edges are rounded so that cameras sharing an edge leave no gap between them
+	glm::ivec4 viewport;
+	viewport.x = static_cast<int>(std::round(xLowerLeft * windowDimensions.x));
+	viewport.y = static_cast<int>(std::round(yLowerLeft * windowDimensions.y));
+	viewport.z = std::max(static_cast<int>(std::round((xLowerLeft + viewPortWidth) * windowDimensions.x)) - viewport.x, 1);
+	viewport.w = std::max(static_cast<int>(std::round((yLowerLeft + viewPortHeight) * windowDimensions.y)) - viewport.y, 1);
+
+	if (viewport.z != viewportPixels.z || viewport.w != viewportPixels.w) {
+		projectionDirty = true;
+	}
+
+	viewportPixels = viewport;
+
+	bool changed = false;
+
+	if (projectionDirty) {
+
+		// The aspect ratio of the viewport keeps the scene from being distorted
+		projectionMatrix = glm::perspective(vertFovRadians, static_cast<float>(viewport.z) / viewport.w, nearClip, farClip);
+
+		projectionDirty = false;
+		changed = true;
+	}
+
+	glm::mat4 modeling = owningGameObject->getModelingTransformation();
+
+	if (modeling != modelingTransformation) {
+
+		modelingTransformation = modeling;
+		viewMatrix = glm::inverse(modeling);
+
+		changed = true;
+	}
+
+	if (changed) {
+		viewProjectionMatrix = projectionMatrix * viewMatrix;
+	}
+
+} // end updateMatrices
+
+
+bool CameraComponent::coversWindow() const
+{
+	return !renderTarget && xLowerLeft <= 0.0f && yLowerLeft <= 0.0f &&
+		   xLowerLeft + viewPortWidth >= 1.0f && yLowerLeft + viewPortHeight >= 1.0f;
+
+} // end coversWindow
+
+
+void CameraComponent::setFieldOfView(float vertFovDegrees)
+{
+	vertFovRadians = glm::radians(vertFovDegrees);
+	projectionDirty = true;
+
+} // end setFieldOfView
+
+
+void CameraComponent::setClipPlanes(float nearClip, float farClip)
+{
+	this->nearClip = nearClip;
+	this->farClip = farClip;
+	projectionDirty = true;
+
+} // end setClipPlanes
+
+
 /**
 * Sets the rendering area for the camera. In normalized coordinate the width and height
 * of the viewport are 1.0.
@@ -79,11 +164,9 @@ void CameraComponent::removeCamera(std::shared_ptr<class CameraComponent> camera
 {
 	auto iter = std::find(activeCameras.begin(), activeCameras.end(), cameraComponent);
 
+	// Erased rather than swapped with the last camera so the cameras stay in depth order
 	if (iter != activeCameras.end()) {
-
-		// Swap to end of vector and pop off (avoid erase copies)
-		std::iter_swap(iter, activeCameras.end() - 1);
-		activeCameras.pop_back();
+		activeCameras.erase(iter);
 	}
 
 } // end removeCamera
@@ -101,4 +184,12 @@ void CameraComponent::setCameraClearColor(vec4 clearColor)
 	cameraClearColor = clearColor; 
 
 } // end setCameraClearColor
+
+
+void CameraComponent::setRenderTarget(std::shared_ptr<RenderTarget> renderTarget)
+{
+	this->renderTarget = renderTarget;
+	projectionDirty = true;
+
+} // end setRenderTarget
   
\ No newline at end of file
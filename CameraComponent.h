@@ -1,6 +1,7 @@
 #pragma once
 #include "Component.h"
 #include "memory.h"
+#include "RenderTarget.h"
 
 class CameraComponent : public Component
 {
@@ -26,27 +27,96 @@ public:
 		const float& nearClip = 1.0f, const float& farClip = 1000.0f);
 
 	/**
-	 * @fn	void CameraComponent::setViewingTransformation();
+	 * @fn	void CameraComponent::setCameraTransformations();
 	 *
 	 * @brief	Called before the scene is rendered from the perspective of this
 	 * 			camera. Sets the view port (using glViewport), projection matrix,
 	 * 			and viewing transformation based upon this properties of the Camera
 	 * 			and the GameObject that holds it. The scene is rendered in the
-	 * 			specified view port without distortion. Use the scissor test and a 
+	 * 			specified view port without distortion. Uses the scissor test and a 
 	 * 			scissor rectangle to clear only the viewport of the camera to the
-	 * 			camear clear color.
+	 * 			camera clear color.
 	 *
 	 *			Calls:
 	 *				Game::getWindowDimensions()
-	 *				SceneGraphNode::getModelingTransformation
+	 *				CameraComponent::updateMatrices
+	 *				RenderTarget::begin
 	 *				SharedTransformations::setViewMatrix
 	 * 				SharedTransformations::setProjectionMatrix
 	 * 			Called by:
 	 * 				Game::renderScene
+	 */
+	void setCameraTransformations();
+
+	/**
+	 * @fn	void CameraComponent::updateMatrices(glm::ivec2 windowDimensions);
 	 *
+	 * @brief	Brings the cached matrices and the viewport in pixels up to date. The
+	 * 			projection is only recomputed when the field of view, the clipping
+	 * 			planes or the size of the viewport have changed and the viewing
+	 * 			transformation only when the game object has moved.
 	 *
+	 * @param 	windowDimensions	Size of the window in pixels. The size of the render
+	 * 								target is used instead if the camera has one.
 	 */
-	void setCameraTransformations();
+	void updateMatrices(glm::ivec2 windowDimensions);
+
+	/**
+	 * @fn	const glm::mat4& CameraComponent::getViewMatrix() const
+	 *
+	 * @brief	Gets the viewing transformation as of the last call to updateMatrices.
+	 */
+	const glm::mat4& getViewMatrix() const { return viewMatrix; }
+
+	/**
+	 * @fn	const glm::mat4& CameraComponent::getProjectionMatrix() const
+	 *
+	 * @brief	Gets the projection transformation as of the last call to updateMatrices.
+	 */
+	const glm::mat4& getProjectionMatrix() const { return projectionMatrix; }
+
+	/**
+	 * @fn	const glm::mat4& CameraComponent::getViewProjectionMatrix() const
+	 *
+	 * @brief	Gets the product of the projection and viewing transformations.
+	 */
+	const glm::mat4& getViewProjectionMatrix() const { return viewProjectionMatrix; }
+
+	/**
+	 * @fn	glm::ivec4 CameraComponent::getViewportPixels() const
+	 *
+	 * @brief	Gets the lower left corner (xy) and size (zw) of the viewport in pixels.
+	 */
+	glm::ivec4 getViewportPixels() const { return viewportPixels; }
+
+	/**
+	 * @fn	vec3 CameraComponent::getEyePosition() const
+	 *
+	 * @brief	Gets the position of the camera in World coordinates.
+	 */
+	vec3 getEyePosition() const { return vec3(modelingTransformation[3]); }
+
+	/**
+	 * @fn	bool CameraComponent::coversWindow() const;
+	 *
+	 * @brief	Determines if the viewport covers the whole window. Never true for a
+	 * 			camera that renders into a render target.
+	 */
+	bool coversWindow() const;
+
+	/**
+	 * @fn	void CameraComponent::setFieldOfView(float vertFovDegrees);
+	 *
+	 * @brief	Sets the vertical field of view in degrees.
+	 */
+	void setFieldOfView(float vertFovDegrees);
+
+	/**
+	 * @fn	void CameraComponent::setClipPlanes(float nearClip, float farClip);
+	 *
+	 * @brief	Sets the distances to the near and far clipping planes.
+	 */
+	void setClipPlanes(float nearClip, float farClip);
 
 	/**
 	 * @fn	void CameraComponent::setViewPort( GLfloat xLowerLeft, GLfloat yLowerLeft,
@@ -131,6 +201,32 @@ public:
 	 */
 	void setCameraClearColor(vec4 clearColor);
 
+	/**
+	 * @fn	void CameraComponent::setRenderTarget(std::shared_ptr<RenderTarget> renderTarget);
+	 *
+	 * @brief	Renders the camera into a texture instead of the window. The viewport
+	 * 			is then relative to the render target. Cameras with render targets
+	 * 			are rendered before the cameras of the window, so that what they
+	 * 			see is shown in the same frame.
+	 *
+	 * @param 	renderTarget	The render target. Null to render into the window.
+	 */
+	void setRenderTarget(std::shared_ptr<RenderTarget> renderTarget);
+
+	/**
+	 * @fn	std::shared_ptr<RenderTarget> CameraComponent::getRenderTarget() const
+	 *
+	 * @brief	Gets the render target. Null if the camera renders into the window.
+	 */
+	std::shared_ptr<RenderTarget> getRenderTarget() const { return renderTarget; }
+
+	/**
+	 * @fn	vec4 CameraComponent::getCameraClearColor() const
+	 *
+	 * @brief	Gets the color the viewport is cleared to.
+	 */
+	vec4 getCameraClearColor() const { return cameraClearColor; }
+
 protected:
 
 	// Normalized viewport settings
@@ -162,6 +258,23 @@ protected:
 	/** @brief	The camera clear color Color to which the viewport will be cleared.*/
 	vec4 cameraClearColor = 0.5f * WHITE_RGBA;
 
+	/** @brief	Cached transformations. Recomputed by updateMatrices when they are out of date. */
+	glm::mat4 viewMatrix = glm::mat4(1.0f);
+	glm::mat4 projectionMatrix = glm::mat4(1.0f);
+	glm::mat4 viewProjectionMatrix = glm::mat4(1.0f);
+
+	/** @brief	Modeling transformation of the game object the view matrix was computed from */
+	glm::mat4 modelingTransformation = glm::mat4(0.0f);
+
+	/** @brief	The viewport in pixels as of the last call to updateMatrices */
+	glm::ivec4 viewportPixels = glm::ivec4(0);
+
+	/** @brief	True if the projection must be recomputed */
+	bool projectionDirty = true;
+
+	/** @brief	Texture the camera renders into. Null for the window. */
+	std::shared_ptr<RenderTarget> renderTarget;
+
 	/**
 	 * @brief	Vector containing the Cameras that are active. The vector should be sorted based
 	 * 			upon the depth values of the cameras. 
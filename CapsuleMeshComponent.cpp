@@ -0,0 +1,28 @@
+#include "CapsuleMeshComponent.h"
+
+#include "ProceduralGeometry.h"
+
+
+CapsuleMeshComponent::CapsuleMeshComponent(GLuint shaderProgram, Material mat, float radius, float height, int stacks, int slices, int updateOrder)
+	: ProceduralMeshComponent(shaderProgram, mat, updateOrder), radius(radius), height(height), stacks(stacks), slices(slices)
+{
+}
+
+
+size_t CapsuleMeshComponent::getGeometryKey() const
+{
+	return hashGeometry("Capsule", { radius, height, static_cast<float>(stacks), static_cast<float>(slices) });
+}
+
+
+void CapsuleMeshComponent::generateGeometry(int subMeshIndex, std::vector<pntVertexData>& vertexData, std::vector<unsigned int>& indices) const
+{
+	ProceduralGeometry::capsule(radius, height, stacks, slices, vertexData, indices);
+}
+
+
+std::shared_ptr<btCollisionShape> CapsuleMeshComponent::createCollisionShape() const
+{
+	// Bullet capsules are aligned with the Y axis and measured the same way
+	return std::shared_ptr<btCollisionShape>(new btCapsuleShape(radius, height));
+}
@@ -0,0 +1,30 @@
+#pragma once
+#include "ProceduralMeshComponent.h"
+
+/**
+ * @class	CapsuleMeshComponent
+ *
+ * @brief	Cylinder closed by two hemispheres, aligned with the Y axis. The usual
+ * 			shape for characters because it slides smoothly over edges.
+ */
+class CapsuleMeshComponent : public ProceduralMeshComponent
+{
+public:
+	CapsuleMeshComponent(GLuint shaderProgram, Material mat, float radius = 0.5f, float height = 1.0f,
+						 int stacks = 6, int slices = 16, int updateOrder = 100);
+
+protected:
+
+	virtual size_t getGeometryKey() const override;
+
+	virtual void generateGeometry(int subMeshIndex, std::vector<pntVertexData>& vertexData, std::vector<unsigned int>& indices) const override;
+
+	virtual std::shared_ptr<btCollisionShape> createCollisionShape() const override;
+
+	// Height is the length of the cylinder between the centers of the hemispheres
+	float radius, height;
+
+	// Stacks are the divisions of each hemisphere
+	int stacks, slices;
+
+}; // end CapsuleMeshComponent
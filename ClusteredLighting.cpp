@@ -0,0 +1,447 @@
+#include "ClusteredLighting.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "BuildShaderProgram.h"
+#include "ShaderHotReload.h"
+
+static const bool VERBOSE = false;
+
+// Static variable definitions (Static variables must be defined outside the declaration)
+std::vector<ClusteredLight> ClusteredLighting::lights;
+std::vector<bool> ClusteredLighting::lightInUse;
+std::vector<bool> ClusteredLighting::rangeSet;
+bool ClusteredLighting::lightsChanged = true;
+bool ClusteredLighting::cpuBinning = false;
+ClusteredLighting::ClusterGridHeader ClusteredLighting::gridHeader;
+GLuint ClusteredLighting::lightBuffer = 0;
+GLuint ClusteredLighting::clusterGridBuffer = 0;
+GLuint ClusteredLighting::clusterLightIndexBuffer = 0;
+GLuint ClusteredLighting::cullingProgram = 0;
+size_t ClusteredLighting::lightBufferCapacity = 0;
+
+// Light indices and bounds used when binning on the CPU
+static std::vector<GLuint> cpuClusterLightIndices;
+static std::vector<glm::uvec2> cpuClusters;
+static std::vector<glm::vec3> cpuClusterMin;
+static std::vector<glm::vec3> cpuClusterMax;
+static glm::vec4 cpuBoundsParameters;
+static glm::vec4 cpuBoundsTileSize;
+
+
+int ClusteredLighting::addLight()
+{
+	// Reuse the identifier of a removed light if there is one
+	auto freeSlot = std::find(lightInUse.begin(), lightInUse.end(), false);
+	int lightID = static_cast<int>(freeSlot - lightInUse.begin());
+
+	if (freeSlot == lightInUse.end()) {
+
+		lights.push_back(ClusteredLight());
+		lightInUse.push_back(true);
+		rangeSet.push_back(false);
+	}
+	else {
+
+		lights[lightID] = ClusteredLight();
+		lightInUse[lightID] = true;
+		rangeSet[lightID] = false;
+	}
+
+	// Enabled white light that fades out over roughly fifty units
+	lights[lightID].attenuationEnabled = glm::vec4(1.0f, 0.09f, 0.032f, 1.0f);
+	updateRange(lightID);
+
+	lightsChanged = true;
+
+	return lightID;
+
+} // end addLight
+
+
+void ClusteredLighting::removeLight(int lightID)
+{
+	lights[lightID].attenuationEnabled.w = 0.0f;
+	lightInUse[lightID] = false;
+	lightsChanged = true;
+
+} // end removeLight
+
+
+int ClusteredLighting::getLightCount()
+{
+	return static_cast<int>(std::count(lightInUse.begin(), lightInUse.end(), true));
+
+} // end getLightCount
+
+
+void ClusteredLighting::setEnabled(int lightID, bool on)
+{
+	lights[lightID].attenuationEnabled.w = on ? 1.0f : 0.0f;
+	lightsChanged = true;
+
+} // end setEnabled
+
+
+void ClusteredLighting::setPosition(int lightID, glm::vec3 position)
+{
+	lights[lightID].positionRange = glm::vec4(position, lights[lightID].positionRange.w);
+	lightsChanged = true;
+
+} // end setPosition
+
+
+void ClusteredLighting::setAmbientColor(int lightID, glm::vec3 color)
+{
+	lights[lightID].ambientColor = glm::vec4(color, 0.0f);
+	updateRange(lightID);
+	lightsChanged = true;
+
+} // end setAmbientColor
+
+
+void ClusteredLighting::setDiffuseColor(int lightID, glm::vec3 color)
+{
+	lights[lightID].diffuseColorSpotCutoff = glm::vec4(color, lights[lightID].diffuseColorSpotCutoff.w);
+	updateRange(lightID);
+	lightsChanged = true;
+
+} // end setDiffuseColor
+
+
+void ClusteredLighting::setSpecularColor(int lightID, glm::vec3 color)
+{
+	lights[lightID].specularColorSpotExponent = glm::vec4(color, lights[lightID].specularColorSpotExponent.w);
+	updateRange(lightID);
+	lightsChanged = true;
+
+} // end setSpecularColor
+
+
+void ClusteredLighting::setAttenuationFactors(int lightID, glm::vec3 factors)
+{
+	lights[lightID].attenuationEnabled = glm::vec4(factors, lights[lightID].attenuationEnabled.w);
+	updateRange(lightID);
+	lightsChanged = true;
+
+} // end setAttenuationFactors
+
+
+void ClusteredLighting::setSpot(int lightID, glm::vec3 spotDirection, float spotCutoffCos, float spotExponent)
+{
+	lights[lightID].spotDirectionIsSpot = glm::vec4(glm::normalize(spotDirection), 1.0f);
+	lights[lightID].diffuseColorSpotCutoff.w = spotCutoffCos;
+	lights[lightID].specularColorSpotExponent.w = spotExponent;
+	lightsChanged = true;
+
+} // end setSpot
+
+
+void ClusteredLighting::setIsSpot(int lightID, bool spotOn)
+{
+	lights[lightID].spotDirectionIsSpot.w = spotOn ? 1.0f : 0.0f;
+	lightsChanged = true;
+
+} // end setIsSpot
+
+
+void ClusteredLighting::setRange(int lightID, float range)
+{
+	rangeSet[lightID] = range > 0.0f;
+
+	if (rangeSet[lightID]) {
+		lights[lightID].positionRange.w = range;
+	}
+	else {
+		updateRange(lightID);
+	}
+
+	lightsChanged = true;
+
+} // end setRange
+
+
+void ClusteredLighting::updateRange(int lightID)
+{
+	if (rangeSet[lightID]) {
+		return;
+	}
+
+	ClusteredLight& light = lights[lightID];
+
+	// Brightest channel of the light
+	float intensity = 0.0f;
+
+	for (int i = 0; i < 3; i++) {
+		intensity = std::max({ intensity, light.ambientColor[i], light.diffuseColorSpotCutoff[i], light.specularColorSpotExponent[i] });
+	}
+
+	// Solve quadratic * d^2 + linear * d + constant = intensity / cutoff for the distance d
+	float constant = light.attenuationEnabled.x;
+	float linear = light.attenuationEnabled.y;
+	float quadratic = light.attenuationEnabled.z;
+	float limit = intensity / CLUSTERED_LIGHT_CUTOFF;
+
+	if (constant >= limit) {
+		light.positionRange.w = 0.0f;
+	}
+	else if (quadratic > 0.0f) {
+		light.positionRange.w = (-linear + std::sqrt(linear * linear - 4.0f * quadratic * (constant - limit))) / (2.0f * quadratic);
+	}
+	else if (linear > 0.0f) {
+		light.positionRange.w = (limit - constant) / linear;
+	}
+	else {
+		// No falloff so the light reaches every cluster
+		light.positionRange.w = POS_INFINITY;
+	}
+
+} // end updateRange
+
+
+void ClusteredLighting::initialize()
+{
+	glGenBuffers(1, &lightBuffer);
+	glGenBuffers(1, &clusterGridBuffer);
+	glGenBuffers(1, &clusterLightIndexBuffer);
+
+	// The grid holds the header followed by the offset and count of each cluster
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, clusterGridBuffer);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(ClusterGridHeader) + CLUSTER_COUNT * sizeof(glm::uvec2), nullptr, GL_DYNAMIC_DRAW);
+
+	// Each cluster has room for MAX_LIGHTS_PER_CLUSTER light indices
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, clusterLightIndexBuffer);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, CLUSTER_COUNT * MAX_LIGHTS_PER_CLUSTER * sizeof(GLuint), nullptr, GL_DYNAMIC_DRAW);
+
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+	ShaderInfo shaders[] = {
+		{ GL_COMPUTE_SHADER, "Shaders/clusterLightCullingShader.glsl" },
+		{ GL_NONE, NULL } // signals that there are no more shaders
+	};
+
+	cullingProgram = BuildShaderProgram(shaders);
+
+	// Follow the culling program when it is rebuilt after a source change
+	ShaderHotReload::addSwapCallback([](GLuint oldProgram, GLuint newProgram) {
+
+		if (cullingProgram == oldProgram) {
+			cullingProgram = newProgram;
+		}
+	});
+
+} // end initialize
+
+
+void ClusteredLighting::update(const glm::mat4& viewMatrix, const glm::mat4& projectionMatrix, glm::ivec4 viewport)
+{
+	if (lightBuffer == 0) {
+		initialize();
+	}
+
+	// Upload the lights if any have changed. The buffer always holds at least
+	// one light so that it can be bound.
+	if (lightsChanged) {
+
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, lightBuffer);
+
+		if (lights.size() > lightBufferCapacity || lightBufferCapacity == 0) {
+
+			lightBufferCapacity = std::max<size_t>({ 1, lights.size(), 2 * lightBufferCapacity });
+			glBufferData(GL_SHADER_STORAGE_BUFFER, lightBufferCapacity * sizeof(ClusteredLight), nullptr, GL_DYNAMIC_DRAW);
+		}
+
+		if (!lights.empty()) {
+			glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, lights.size() * sizeof(ClusteredLight), lights.data());
+		}
+
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+		lightsChanged = false;
+	}
+
+	// Recover the near and far distances from the perspective projection
+	float nearPlane = projectionMatrix[3][2] / (projectionMatrix[2][2] - 1.0f);
+	float farPlane = projectionMatrix[3][2] / (projectionMatrix[2][2] + 1.0f);
+	float logDepthRange = std::log(farPlane / nearPlane);
+
+	glm::ivec2 dimensions = glm::max(glm::ivec2(viewport.z, viewport.w), glm::ivec2(1, 1));
+
+	gridHeader.gridSize = glm::uvec4(CLUSTER_GRID_X, CLUSTER_GRID_Y, CLUSTER_GRID_Z, 0);
+	gridHeader.depthParameters = glm::vec4(nearPlane, farPlane,
+		CLUSTER_GRID_Z / logDepthRange, CLUSTER_GRID_Z * std::log(nearPlane) / logDepthRange);
+	gridHeader.tileSize = glm::vec4(
+		static_cast<float>((dimensions.x + CLUSTER_GRID_X - 1) / CLUSTER_GRID_X),
+		static_cast<float>((dimensions.y + CLUSTER_GRID_Y - 1) / CLUSTER_GRID_Y),
+		static_cast<float>(dimensions.x), static_cast<float>(dimensions.y));
+	gridHeader.viewportOrigin = glm::vec4(static_cast<float>(viewport.x), static_cast<float>(viewport.y), 0.0f, 0.0f);
+
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, clusterGridBuffer);
+	glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(ClusterGridHeader), &gridHeader);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+	// Make the buffers available to the shaders
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, clusteredLightBufferBindingPoint, lightBuffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, clusterGridBufferBindingPoint, clusterGridBuffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, clusterLightIndexBufferBindingPoint, clusterLightIndexBuffer);
+
+	if (cpuBinning || cullingProgram == 0) {
+
+		binLightsOnCPU(viewMatrix, projectionMatrix);
+	}
+	else {
+
+		// One invocation per cluster. Each work group covers one depth slice.
+		glUseProgram(cullingProgram);
+		glUniformMatrix4fv(clusterViewMatrixLocation, 1, GL_FALSE, glm::value_ptr(viewMatrix));
+		glUniformMatrix4fv(clusterInverseProjectionLocation, 1, GL_FALSE, glm::value_ptr(glm::inverse(projectionMatrix)));
+		glUniform1ui(clusterLightCountLocation, static_cast<GLuint>(lights.size()));
+
+		glDispatchCompute(1, 1, CLUSTER_GRID_Z);
+
+		// Make the light lists visible to the fragment shaders
+		glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+	}
+
+} // end update
+
+
+void ClusteredLighting::getClusterBounds(int x, int y, int z, const glm::mat4& inverseProjection, glm::vec3& boundsMin, glm::vec3& boundsMax)
+{
+	float nearPlane = gridHeader.depthParameters.x;
+	float farPlane = gridHeader.depthParameters.y;
+
+	// Exponentially spaced depth slices
+	float sliceNear = nearPlane * std::pow(farPlane / nearPlane, static_cast<float>(z) / CLUSTER_GRID_Z);
+	float sliceFar = nearPlane * std::pow(farPlane / nearPlane, static_cast<float>(z + 1) / CLUSTER_GRID_Z);
+
+	// Normalized device coordinates of the tile corners
+	glm::vec2 tileScale(2.0f * gridHeader.tileSize.x / gridHeader.tileSize.z, 2.0f * gridHeader.tileSize.y / gridHeader.tileSize.w);
+	glm::vec2 tileMin = glm::vec2(static_cast<float>(x), static_cast<float>(y)) * tileScale - 1.0f;
+	glm::vec2 tileMax = glm::vec2(static_cast<float>(x + 1), static_cast<float>(y + 1)) * tileScale - 1.0f;
+
+	boundsMin = glm::vec3(POS_INFINITY);
+	boundsMax = glm::vec3(NEG_INFINITY);
+
+	for (int corner = 0; corner < 4; corner++) {
+
+		glm::vec2 ndc((corner & 1) ? tileMax.x : tileMin.x, (corner & 2) ? tileMax.y : tileMin.y);
+
+		// Point on the near plane in view space
+		glm::vec4 point = inverseProjection * glm::vec4(ndc, -1.0f, 1.0f);
+		glm::vec3 onNearPlane = glm::vec3(point) / point.w;
+
+		// Extend the ray from the eye through the point to both slice depths
+		for (float depth : { sliceNear, sliceFar }) {
+
+			glm::vec3 atDepth = onNearPlane * (depth / -onNearPlane.z);
+
+			boundsMin = glm::min(boundsMin, atDepth);
+			boundsMax = glm::max(boundsMax, atDepth);
+		}
+	}
+
+} // end getClusterBounds
+
+
+void ClusteredLighting::binLightsOnCPU(const glm::mat4& viewMatrix, const glm::mat4& projectionMatrix)
+{
+	// The cluster bounds only change with the projection and window size
+	if (cpuClusterMin.empty() || cpuBoundsParameters != gridHeader.depthParameters || cpuBoundsTileSize != gridHeader.tileSize) {
+
+		glm::mat4 inverseProjection = glm::inverse(projectionMatrix);
+
+		cpuClusterMin.resize(CLUSTER_COUNT);
+		cpuClusterMax.resize(CLUSTER_COUNT);
+
+		for (int z = 0; z < CLUSTER_GRID_Z; z++) {
+			for (int y = 0; y < CLUSTER_GRID_Y; y++) {
+				for (int x = 0; x < CLUSTER_GRID_X; x++) {
+
+					int cluster = x + CLUSTER_GRID_X * (y + CLUSTER_GRID_Y * z);
+					getClusterBounds(x, y, z, inverseProjection, cpuClusterMin[cluster], cpuClusterMax[cluster]);
+				}
+			}
+		}
+
+		cpuBoundsParameters = gridHeader.depthParameters;
+		cpuBoundsTileSize = gridHeader.tileSize;
+	}
+
+	cpuClusters.assign(CLUSTER_COUNT, glm::uvec2(0, 0));
+	cpuClusterLightIndices.resize(CLUSTER_COUNT * MAX_LIGHTS_PER_CLUSTER);
+
+	for (int cluster = 0; cluster < CLUSTER_COUNT; cluster++) {
+		cpuClusters[cluster].x = cluster * MAX_LIGHTS_PER_CLUSTER;
+	}
+
+	float nearPlane = gridHeader.depthParameters.x;
+	float scale = gridHeader.depthParameters.z;
+	float bias = gridHeader.depthParameters.w;
+
+	// Visit each light once and only test the depth slices its sphere overlaps
+	for (size_t i = 0; i < lights.size(); i++) {
+
+		const ClusteredLight& light = lights[i];
+
+		if (light.attenuationEnabled.w == 0.0f) {
+			continue;
+		}
+
+		glm::vec3 center = glm::vec3(viewMatrix * glm::vec4(glm::vec3(light.positionRange), 1.0f));
+		float range = light.positionRange.w;
+
+		float depthMin = std::max(-center.z - range, nearPlane);
+		float depthMax = -center.z + range;
+
+		if (depthMax < nearPlane) {
+			continue;
+		}
+
+		int sliceMin = glm::clamp(static_cast<int>(std::floor(std::log(depthMin) * scale - bias)), 0, CLUSTER_GRID_Z - 1);
+		int sliceMax = std::isinf(range) ? CLUSTER_GRID_Z - 1 : glm::clamp(static_cast<int>(std::floor(std::log(depthMax) * scale - bias)), 0, CLUSTER_GRID_Z - 1);
+
+		for (int z = sliceMin; z <= sliceMax; z++) {
+			for (int cluster = z * CLUSTER_GRID_X * CLUSTER_GRID_Y; cluster < (z + 1) * CLUSTER_GRID_X * CLUSTER_GRID_Y; cluster++) {
+
+				// Squared distance from the sphere center to the cluster bounds
+				glm::vec3 closest = glm::clamp(center, cpuClusterMin[cluster], cpuClusterMax[cluster]);
+				glm::vec3 offset = closest - center;
+
+				if (glm::dot(offset, offset) <= range * range && cpuClusters[cluster].y < MAX_LIGHTS_PER_CLUSTER) {
+
+					cpuClusterLightIndices[cpuClusters[cluster].x + cpuClusters[cluster].y] = static_cast<GLuint>(i);
+					cpuClusters[cluster].y++;
+				}
+			}
+		}
+	}
+
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, clusterGridBuffer);
+	glBufferSubData(GL_SHADER_STORAGE_BUFFER, sizeof(ClusterGridHeader), cpuClusters.size() * sizeof(glm::uvec2), cpuClusters.data());
+
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, clusterLightIndexBuffer);
+	glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, cpuClusterLightIndices.size() * sizeof(GLuint), cpuClusterLightIndices.data());
+
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+} // end binLightsOnCPU
+
+
+void ClusteredLighting::unload()
+{
+	glDeleteBuffers(1, &lightBuffer);
+	glDeleteBuffers(1, &clusterGridBuffer);
+	glDeleteBuffers(1, &clusterLightIndexBuffer);
+
+	lightBuffer = clusterGridBuffer = clusterLightIndexBuffer = 0;
+	lightBufferCapacity = 0;
+	lightsChanged = true;
+
+	cpuClusterMin.clear();
+	cpuClusterMax.clear();
+
+	if (VERBOSE) cout << "Clustered lighting buffers deleted" << endl;
+
+} // end unload
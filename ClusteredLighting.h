@@ -0,0 +1,243 @@
+#pragma once
+
+#include "MathLibsConstsFuncs.h"
+
+using namespace constants_and_types;
+
+// Number of clusters across, down and into the view volume. Must match the
+// constants in the light culling compute shader and the fragment shader.
+static const int CLUSTER_GRID_X = 16;
+static const int CLUSTER_GRID_Y = 9;
+static const int CLUSTER_GRID_Z = 24;
+static const int CLUSTER_COUNT = CLUSTER_GRID_X * CLUSTER_GRID_Y * CLUSTER_GRID_Z;
+
+// Largest number of lights that can affect a single cluster. Lights beyond
+// this number are ignored in that cluster.
+static const int MAX_LIGHTS_PER_CLUSTER = 128;
+
+// Shader storage buffer binding points of the light list, the cluster grid
+// and the per cluster light indices
+static const GLuint clusteredLightBufferBindingPoint = 5;
+static const GLuint clusterGridBufferBindingPoint = 6;
+static const GLuint clusterLightIndexBufferBindingPoint = 7;
+
+// Uniform locations in the light culling compute shader
+static const GLuint clusterViewMatrixLocation = 0;
+static const GLuint clusterInverseProjectionLocation = 1;
+static const GLuint clusterLightCountLocation = 2;
+
+// A light is considered out of range once its attenuation drops below this fraction
+static const float CLUSTERED_LIGHT_CUTOFF = 1.0f / 256.0f;
+
+/**
+ * @struct	ClusteredLight
+ *
+ * @brief	A point or spot light as it is stored in the light shader storage buffer
+ * 			(std430 layout). Several scalar attributes are packed into the fourth
+ * 			component of the vectors.
+ */
+struct ClusteredLight {
+
+	/** @brief	World position of the light (xyz) and the distance at which it stops
+	 * 			having an effect (w) */
+	glm::vec4 positionRange = glm::vec4(0.0f, 0.0f, 0.0f, 0.0f);
+
+	/** @brief	Ambient color (rgb) */
+	glm::vec4 ambientColor = glm::vec4(0.0f, 0.0f, 0.0f, 0.0f);
+
+	/** @brief	Diffuse color (rgb) and the cosine of the spot cutoff angle (w) */
+	glm::vec4 diffuseColorSpotCutoff = glm::vec4(1.0f, 1.0f, 1.0f, -1.0f);
+
+	/** @brief	Specular color (rgb) and the spot exponent (w) */
+	glm::vec4 specularColorSpotExponent = glm::vec4(1.0f, 1.0f, 1.0f, 0.0f);
+
+	/** @brief	Direction the spot light shines in (xyz). w is 1 for spot lights. */
+	glm::vec4 spotDirectionIsSpot = glm::vec4(0.0f, 0.0f, -1.0f, 0.0f);
+
+	/** @brief	Constant, linear and quadratic attenuation (xyz). w is 1 if enabled. */
+	glm::vec4 attenuationEnabled = glm::vec4(1.0f, 0.0f, 1.0f, 0.0f);
+
+}; // end ClusteredLight
+
+static_assert(sizeof(ClusteredLight) == 96, "ClusteredLight must match the std430 layout in the shaders");
+
+/**
+ * @class	ClusteredLighting
+ *
+ * @brief	Clustered forward lighting for any number of point and spot lights.
+ *
+ * 			The view volume is divided into a grid of CLUSTER_GRID_X x CLUSTER_GRID_Y
+ * 			screen tiles and CLUSTER_GRID_Z exponentially spaced depth slices. Each
+ * 			frame every enabled light is tested against the bounding box of every
+ * 			cluster, and the indices of the lights that reach a cluster are written to
+ * 			a list for that cluster. The fragment shader finds the cluster that
+ * 			contains the fragment and only evaluates the lights in its list.
+ *
+ * 			Binning runs in a compute shader. A CPU implementation of the same test is
+ * 			available for debugging and for comparing results.
+ *
+ * 			Directional lights reach every cluster and are left to SharedLighting.
+ */
+class ClusteredLighting
+{
+public:
+
+	/**
+	 * @fn	static int ClusteredLighting::addLight();
+	 *
+	 * @brief	Adds an enabled white point light at the origin.
+	 *
+	 * @returns	The identifier of the light.
+	 */
+	static int addLight();
+
+	/**
+	 * @fn	static void ClusteredLighting::removeLight(int lightID);
+	 *
+	 * @brief	Removes a light. The identifier may be reused by addLight.
+	 */
+	static void removeLight(int lightID);
+
+	/**
+	 * @fn	static int ClusteredLighting::getLightCount();
+	 *
+	 * @brief	Gets the number of lights that have been added and not removed.
+	 */
+	static int getLightCount();
+
+	static void setEnabled(int lightID, bool on);
+	static void setPosition(int lightID, glm::vec3 position);
+	static void setAmbientColor(int lightID, glm::vec3 color);
+	static void setDiffuseColor(int lightID, glm::vec3 color);
+	static void setSpecularColor(int lightID, glm::vec3 color);
+	static void setAttenuationFactors(int lightID, glm::vec3 factors);
+	static void setSpot(int lightID, glm::vec3 spotDirection, float spotCutoffCos, float spotExponent);
+	static void setIsSpot(int lightID, bool spotOn);
+
+	/**
+	 * @fn	static void ClusteredLighting::setRange(int lightID, float range);
+	 *
+	 * @brief	Sets the distance beyond which a light has no effect. Lights with no
+	 * 			range set use the distance at which their attenuation drops below
+	 * 			CLUSTERED_LIGHT_CUTOFF.
+	 *
+	 * @param	lightID	Identifier of the light.
+	 * @param	range  	The range. Zero to compute it from the attenuation.
+	 */
+	static void setRange(int lightID, float range);
+
+	static const ClusteredLight& getLight(int lightID) { return lights[lightID]; }
+
+	/**
+	 * @fn	static void ClusteredLighting::setCPUBinning(bool enabled)
+	 *
+	 * @brief	Bins lights on the CPU instead of in the compute shader.
+	 *
+	 * @param	enabled	True to bin lights on the CPU.
+	 */
+	static void setCPUBinning(bool enabled) { cpuBinning = enabled; }
+
+	/**
+	 * @fn	static void ClusteredLighting::update(const glm::mat4& viewMatrix, const glm::mat4& projectionMatrix, glm::ivec4 viewport);
+	 *
+	 * @brief	Uploads the lights if they have changed and bins them into the cluster
+	 * 			grid. Should be called before the scene is rendered from each camera,
+	 * 			even if there are no lights, so that the buffers read by the fragment
+	 * 			shader exist.
+	 *
+	 * @param	viewMatrix			The viewing transformation.
+	 * @param	projectionMatrix	The perspective projection.
+	 * @param	viewport			Lower left corner (xy) and size (zw) of the viewport
+	 * 								in pixels.
+	 */
+	static void update(const glm::mat4& viewMatrix, const glm::mat4& projectionMatrix, glm::ivec4 viewport);
+
+	/**
+	 * @fn	static void ClusteredLighting::unload();
+	 *
+	 * @brief	Deletes the light and cluster buffers.
+	 */
+	static void unload();
+
+protected:
+
+	/**
+	 * @struct	ClusterGridHeader
+	 *
+	 * @brief	Values at the start of the cluster grid buffer that are needed to
+	 * 			locate the cluster of a fragment (std430 layout).
+	 */
+	struct ClusterGridHeader {
+
+		/** @brief	Number of clusters in each direction (xyz) */
+		glm::uvec4 gridSize;
+
+		/** @brief	Near and far distance, and the scale and bias that convert the
+		 * 			log of a view space depth to a depth slice */
+		glm::vec4 depthParameters;
+
+		/** @brief	Width and height of a screen tile (xy) and of the viewport (zw)
+		 * 			in pixels */
+		glm::vec4 tileSize;
+
+		/** @brief	Lower left corner of the viewport in pixels (xy) */
+		glm::vec4 viewportOrigin;
+	};
+
+	/**
+	 * @fn	static void ClusteredLighting::initialize();
+	 *
+	 * @brief	Creates the buffers and builds the light culling compute shader.
+	 */
+	static void initialize();
+
+	/**
+	 * @fn	static void ClusteredLighting::updateRange(int lightID);
+	 *
+	 * @brief	Computes the range of a light from its attenuation and colors unless
+	 * 			it was set explicitly.
+	 */
+	static void updateRange(int lightID);
+
+	/**
+	 * @fn	static void ClusteredLighting::binLightsOnCPU(const glm::mat4& viewMatrix, const glm::mat4& projectionMatrix);
+	 *
+	 * @brief	Bins the lights into clusters on the CPU and uploads the result.
+	 */
+	static void binLightsOnCPU(const glm::mat4& viewMatrix, const glm::mat4& projectionMatrix);
+
+	/**
+	 * @fn	static void ClusteredLighting::getClusterBounds(int x, int y, int z, const glm::mat4& inverseProjection, glm::vec3& boundsMin, glm::vec3& boundsMax);
+	 *
+	 * @brief	Computes the view space axis aligned bounding box of a cluster.
+	 */
+	static void getClusterBounds(int x, int y, int z, const glm::mat4& inverseProjection, glm::vec3& boundsMin, glm::vec3& boundsMax);
+
+	/** @brief	All lights in the layout of the light buffer */
+	static std::vector<ClusteredLight> lights;
+
+	/** @brief	Indicates the identifier is in use */
+	static std::vector<bool> lightInUse;
+
+	/** @brief	Indicates the range of the light was set explicitly */
+	static std::vector<bool> rangeSet;
+
+	/** @brief	Indicates the lights must be uploaded */
+	static bool lightsChanged;
+
+	/** @brief	Indicates lights are binned on the CPU */
+	static bool cpuBinning;
+
+	/** @brief	Header of the cluster grid buffer for the current projection */
+	static ClusterGridHeader gridHeader;
+
+	/** @brief	Shader storage buffers and the light culling compute shader */
+	static GLuint lightBuffer;
+	static GLuint clusterGridBuffer;
+	static GLuint clusterLightIndexBuffer;
+	static GLuint cullingProgram;
+
+	/** @brief	Number of lights the light buffer has room for */
+	static size_t lightBufferCapacity;
+
+}; // end ClusteredLighting
@@ -0,0 +1,159 @@
+#include "ContactManager.h"
+
+#include <algorithm>
+
+#include "RigidBodyComponent.h"
+#include "GameObject.h"
+
+static const bool VERBOSE = false;
+
+
+size_t ContactManager::ContactPairHash::operator()(const ContactPair& pair) const
+{
+	// Bodies are allocated at least 16 bytes apart, so the low bits carry nothing
+	size_t a = reinterpret_cast<size_t>(pair.bodyA) >> 4;
+	size_t b = reinterpret_cast<size_t>(pair.bodyB) >> 4;
+
+	return (a * 0x9E3779B97F4A7C15ull) ^ (b + 0x7F4A7C15ull + (a << 6) + (a >> 2));
+
+} // end operator()
+
+
+void ContactManager::processStep(btDispatcher* dispatcher)
+{
+	step++;
+
+	int manifoldCount = dispatcher->getNumManifolds();
+
+	for (int i = 0; i < manifoldCount; i++) {
+
+		btPersistentManifold* manifold = dispatcher->getManifoldByIndexInternal(i);
+
+		// Manifolds are kept while the bounding boxes overlap, even without contacts
+		if (manifold->getNumContacts() == 0) {
+			continue;
+		}
+
+		RigidBodyComponent* bodyA = static_cast<RigidBodyComponent*>(manifold->getBody0()->getUserPointer());
+		RigidBodyComponent* bodyB = static_cast<RigidBodyComponent*>(manifold->getBody1()->getUserPointer());
+
+		if (bodyA == nullptr || bodyB == nullptr) {
+			continue;
+		}
+
+		if (bodyB < bodyA) {
+			std::swap(bodyA, bodyB);
+		}
+
+		// Compound shapes have a manifold for each pair of children, so a pair may
+		// be seen more than once in a step
+		auto result = contacts.emplace(ContactPair{ bodyA, bodyB }, CachedContact{ step, true });
+
+		if (result.second) {
+			events.push_back(ContactEvent{ bodyA, bodyB, CONTACT_ENTER });
+		}
+		else {
+			result.first->second.lastStep = step;
+		}
+	}
+
+	for (auto contact = contacts.begin(); contact != contacts.end(); ) {
+
+		if (contact->second.lastStep != step) {
+
+			events.push_back(ContactEvent{ contact->first.bodyA, contact->first.bodyB, CONTACT_EXIT });
+			contact = contacts.erase(contact);
+		}
+		else {
+			++contact;
+		}
+	}
+
+} // end processStep
+
+
+void ContactManager::endFrame()
+{
+	for (auto& contact : contacts) {
+
+		if (contact.second.entered) {
+			contact.second.entered = false;
+		}
+		else {
+			events.push_back(ContactEvent{ contact.first.bodyA, contact.first.bodyB, CONTACT_STAY });
+		}
+	}
+
+	if (VERBOSE) cout << contacts.size() << " contacts, " << events.size() << " contact events" << endl;
+
+} // end endFrame
+
+
+void ContactManager::dispatchEvents()
+{
+	static void (Component::* const handlers[])(const RigidBodyComponent*) = {
+		&Component::collisionEnter, &Component::collisionStay, &Component::collisionExit };
+
+	// Copy the components so that event handlers may add or remove components
+	auto sendEvent = [](RigidBodyComponent* receiver, RigidBodyComponent* other, CONTACT_EVENT type) {
+
+		for (ComponentPtr& component : receiver->owningGameObject->getComponents()) {
+			(component.get()->*handlers[type])(other);
+		}
+	};
+
+	// Indexed because handlers that remove bodies clear the events of those bodies
+	for (size_t i = 0; i < events.size(); i++) {
+
+		if (events[i].sendToA) {
+			sendEvent(events[i].bodyA, events[i].bodyB, events[i].type);
+		}
+
+		if (events[i].sendToB) {
+			sendEvent(events[i].bodyB, events[i].bodyA, events[i].type);
+		}
+	}
+
+	events.clear();
+
+} // end dispatchEvents
+
+
+void ContactManager::removeBody(const RigidBodyComponent* rigidBody)
+{
+	// Events already recorded still reach the other body
+	for (ContactEvent& event : events) {
+
+		if (event.bodyA == rigidBody) {
+			event.sendToA = false;
+		}
+
+		if (event.bodyB == rigidBody) {
+			event.sendToB = false;
+		}
+	}
+
+	// The bodies it was touching see the contact end
+	for (auto contact = contacts.begin(); contact != contacts.end(); ) {
+
+		const ContactPair& pair = contact->first;
+
+		if (pair.bodyA == rigidBody || pair.bodyB == rigidBody) {
+
+			events.push_back(ContactEvent{ pair.bodyA, pair.bodyB, CONTACT_EXIT, pair.bodyA != rigidBody, pair.bodyB != rigidBody });
+			contact = contacts.erase(contact);
+		}
+		else {
+			++contact;
+		}
+	}
+
+} // end removeBody
+
+
+void ContactManager::clear()
+{
+	contacts.clear();
+	events.clear();
+
+} // end clear
@@ -0,0 +1,144 @@
+#pragma once
+
+#include <unordered_map>
+#include <vector>
+
+#include "MathLibsConstsFuncs.h"
+
+#include "Bullet/btBulletDynamicsCommon.h"
+
+using namespace constants_and_types;
+
+// Kinds of collision event, one for each collision function of Component
+enum CONTACT_EVENT { CONTACT_ENTER = 0, CONTACT_STAY, CONTACT_EXIT };
+
+/**
+ * @struct	ContactEvent
+ *
+ * @brief	A collision event waiting to be sent to the components of both bodies.
+ */
+struct ContactEvent {
+
+	class RigidBodyComponent* bodyA;
+	class RigidBodyComponent* bodyB;
+
+	CONTACT_EVENT type;
+
+	// Cleared for a body that left the world before the event was sent. The other
+	// body still gets the event, with a pointer it may compare but not dereference.
+	bool sendToA = true;
+	bool sendToB = true;
+};
+
+/**
+ * @class	ContactManager
+ *
+ * @brief	Keeps track of the pairs of rigid bodies that are touching and turns the
+ * 			changes into collision events.
+ *
+ * 			After every step the persistent manifolds of the dispatcher are looked
+ * 			up in a hashed cache of the pairs touching after the previous step.
+ * 			New pairs are entered and pairs that were not seen again are exited.
+ * 			Enter and exit events are appended to an array as they are found and a
+ * 			stay event is added for every other cached pair once the steps of a
+ * 			frame are done, so a pair that touches for less than a frame still gets
+ * 			its enter and exit. The array is sent in one pass on the main thread,
+ * 			never from inside the solver.
+ */
+class ContactManager
+{
+public:
+
+	/**
+	 * @fn	void ContactManager::processStep(btDispatcher* dispatcher);
+	 *
+	 * @brief	Compares the manifolds of a step that was just taken with the cached
+	 * 			pairs and records the enter and exit events. Called on the physics
+	 * 			thread after each step.
+	 *
+	 * @param 	dispatcher	The dispatcher of the world.
+	 */
+	void processStep(btDispatcher* dispatcher);
+
+	/**
+	 * @fn	void ContactManager::endFrame();
+	 *
+	 * @brief	Records a stay event for each pair that was touching before this
+	 * 			frame's steps and still is. Called after the last step of a frame.
+	 */
+	void endFrame();
+
+	/**
+	 * @fn	void ContactManager::dispatchEvents();
+	 *
+	 * @brief	Sends the recorded events to the components of both game objects of
+	 * 			each pair, in the order they were recorded, and clears them. Called
+	 * 			on the main thread while the physics thread is idle.
+	 */
+	void dispatchEvents();
+
+	/**
+	 * @fn	void ContactManager::removeBody(const class RigidBodyComponent* rigidBody);
+	 *
+	 * @brief	Forgets the pairs of a body that is leaving the world. The bodies
+	 * 			it was touching get an exit event and its own events are no longer
+	 * 			sent to it. Safe to call while events are being dispatched.
+	 */
+	void removeBody(const class RigidBodyComponent* rigidBody);
+
+	/**
+	 * @fn	void ContactManager::clear();
+	 *
+	 * @brief	Forgets all pairs and events.
+	 */
+	void clear();
+
+	/**
+	 * @fn	int ContactManager::getContactCount() const
+	 *
+	 * @brief	Gets the number of pairs touching after the last step.
+	 */
+	int getContactCount() const { return static_cast<int>(contacts.size()); }
+
+	/**
+	 * @fn	int ContactManager::getEventCount() const
+	 *
+	 * @brief	Gets the number of events waiting to be dispatched.
+	 */
+	int getEventCount() const { return static_cast<int>(events.size()); }
+
+protected:
+
+	// Pair of touching bodies. The body with the lower address is first.
+	struct ContactPair {
+
+		class RigidBodyComponent* bodyA;
+		class RigidBodyComponent* bodyB;
+
+		bool operator==(const ContactPair& other) const { return bodyA == other.bodyA && bodyB == other.bodyB; }
+	};
+
+	struct ContactPairHash {
+
+		size_t operator()(const ContactPair& pair) const;
+	};
+
+	struct CachedContact {
+
+		// Step the pair was last seen touching
+		unsigned int lastStep;
+
+		// Entered during the steps of the current frame, so no stay event is due
+		bool entered;
+	};
+
+	/** @brief	Pairs touching after the last step */
+	std::unordered_map<ContactPair, CachedContact, ContactPairHash> contacts;
+
+	/** @brief	Events of the current frame in the order they happened */
+	std::vector<ContactEvent> events;
+
+	/** @brief	Steps processed so far */
+	unsigned int step = 0;
+
+}; // end ContactManager
@@ -0,0 +1,593 @@
+#include "CookedCollision.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+
+#include "Bullet/LinearMath/btConvexHullComputer.h"
+
+#include "AssetCache.h"
+#include "MeshComponent.h"
+#include "ThreadPool.h"
+
+static const bool VERBOSE = false;
+
+// "GECL" and version of the cooked file format
+static const uint32_t COLLISION_FILE_MAGIC = 0x4C434547;
+static const uint32_t COLLISION_FILE_VERSION = 1;
+
+struct CollisionFileHeader {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t cooking;
+	uint32_t hullCount;
+	uint32_t vertexCount;
+	uint32_t indexCount;
+	uint32_t hierarchyBytes;
+	uint32_t reserved;
+};
+
+/**
+ * @struct	DecompositionPart
+ *
+ * @brief	Triangles of a model that are approximated by one hull, and the best
+ * 			way found to split them in two.
+ */
+struct DecompositionPart {
+
+	std::vector<unsigned int> triangles;
+
+	float volume = 0.0f;
+
+	bool evaluated = false;
+
+	// Fraction of the volume removed by the best split
+	float gain = 0.0f;
+
+	std::vector<unsigned int> front;
+	std::vector<unsigned int> back;
+	float frontVolume = 0.0f;
+	float backVolume = 0.0f;
+};
+
+
+//********************* Cooking *****************************************
+
+const char* CookedCollision::getExtension(COLLISION_COOKING cooking)
+{
+	switch (cooking) {
+
+	case CONVEX_DECOMPOSITION:
+		return ".decomposed.col";
+
+	case TRIANGLE_MESH:
+		return ".bvh.col";
+
+	default:
+		return ".hulls.col";
+	}
+
+} // end getExtension
+
+
+static std::vector<glm::vec3> getPartPoints(const CollisionGeometry& geometry, const std::vector<unsigned int>& triangles)
+{
+	std::vector<glm::vec3> points;
+	points.reserve(triangles.size() * 3);
+
+	for (unsigned int triangle : triangles) {
+
+		for (int corner = 0; corner < 3; corner++) {
+			points.push_back(geometry.positions[geometry.indices[triangle * 3 + corner]]);
+		}
+	}
+
+	return points;
+
+} // end getPartPoints
+
+
+float CookedCollision::getHullVolume(const std::vector<glm::vec3>& points)
+{
+	if (points.size() < 4) {
+		return 0.0f;
+	}
+
+	btConvexHullComputer hull;
+	hull.compute(&points[0].x, sizeof(glm::vec3), static_cast<int>(points.size()), 0.0f, 0.0f);
+
+	// Sum the tetrahedra between the first vertex and the triangles of each face
+	btVector3 apex = hull.vertices.size() > 0 ? hull.vertices[0] : btVector3(0.0f, 0.0f, 0.0f);
+	float volume = 0.0f;
+
+	for (int face = 0; face < hull.faces.size(); face++) {
+
+		const btConvexHullComputer::Edge* firstEdge = &hull.edges[hull.faces[face]];
+		const btConvexHullComputer::Edge* edge = firstEdge->getNextEdgeOfFace();
+
+		btVector3 corner = hull.vertices[firstEdge->getSourceVertex()] - apex;
+
+		while (edge->getTargetVertex() != firstEdge->getSourceVertex()) {
+
+			btVector3 b = hull.vertices[edge->getSourceVertex()] - apex;
+			btVector3 c = hull.vertices[edge->getTargetVertex()] - apex;
+
+			volume += corner.dot(b.cross(c));
+
+			edge = edge->getNextEdgeOfFace();
+		}
+	}
+
+	return std::abs(volume) / 6.0f;
+
+} // end getHullVolume
+
+
+std::vector<glm::vec3> CookedCollision::simplifyHull(const std::vector<glm::vec3>& points, int maxVertices)
+{
+	if (points.size() < 4) {
+		return points;
+	}
+
+	btConvexHullComputer hull;
+	hull.compute(&points[0].x, sizeof(glm::vec3), static_cast<int>(points.size()), 0.0f, 0.0f);
+
+	std::vector<glm::vec3> hullVertices;
+	hullVertices.reserve(hull.vertices.size());
+
+	for (int i = 0; i < hull.vertices.size(); i++) {
+		hullVertices.push_back(vec3(hull.vertices[i].x(), hull.vertices[i].y(), hull.vertices[i].z()));
+	}
+
+	if (static_cast<int>(hullVertices.size()) <= maxVertices) {
+		return hullVertices;
+	}
+
+	// Keep the vertices furthest along directions spread over the sphere by the
+	// golden angle
+	const float GOLDEN_ANGLE = PI * (3.0f - std::sqrt(5.0f));
+
+	std::vector<bool> kept(hullVertices.size(), false);
+
+	for (int direction = 0; direction < maxVertices; direction++) {
+
+		float y = 1.0f - 2.0f * (direction + 0.5f) / maxVertices;
+		float radius = std::sqrt(1.0f - y * y);
+		float angle = GOLDEN_ANGLE * direction;
+
+		vec3 axis(radius * std::cos(angle), y, radius * std::sin(angle));
+
+		size_t furthest = 0;
+
+		for (size_t i = 1; i < hullVertices.size(); i++) {
+
+			if (glm::dot(hullVertices[i], axis) > glm::dot(hullVertices[furthest], axis)) {
+				furthest = i;
+			}
+		}
+
+		kept[furthest] = true;
+	}
+
+	std::vector<glm::vec3> simplified;
+
+	for (size_t i = 0; i < hullVertices.size(); i++) {
+
+		if (kept[i]) {
+			simplified.push_back(hullVertices[i]);
+		}
+	}
+
+	return simplified;
+
+} // end simplifyHull
+
+
+static void evaluateSplit(const CollisionGeometry& geometry, const std::vector<glm::vec3>& centroids, DecompositionPart& part)
+{
+	part.evaluated = true;
+	part.gain = 0.0f;
+
+	if (part.triangles.size() < 2 * DECOMPOSITION_MIN_TRIANGLES || part.volume <= 0.0f) {
+		return;
+	}
+
+	vec3 boundsMin = INFINITY_V3;
+	vec3 boundsMax = NEG_INFINITY_V3;
+
+	for (unsigned int triangle : part.triangles) {
+
+		boundsMin = glm::min(boundsMin, centroids[triangle]);
+		boundsMax = glm::max(boundsMax, centroids[triangle]);
+	}
+
+	// Planes at a quarter, half and three quarters of the way across each axis
+	const int PLANES_PER_AXIS = 3;
+	const int CANDIDATES = 3 * PLANES_PER_AXIS;
+
+	std::vector<DecompositionPart> candidates(CANDIDATES);
+
+	ThreadPool::parallelFor(CANDIDATES, 1, [&](size_t begin, size_t end) {
+
+		for (size_t c = begin; c < end; c++) {
+
+			int axis = static_cast<int>(c) / PLANES_PER_AXIS;
+			float fraction = (c % PLANES_PER_AXIS + 1.0f) / (PLANES_PER_AXIS + 1.0f);
+			float plane = boundsMin[axis] + fraction * (boundsMax[axis] - boundsMin[axis]);
+
+			DecompositionPart& candidate = candidates[c];
+
+			for (unsigned int triangle : part.triangles) {
+
+				if (centroids[triangle][axis] < plane) {
+					candidate.back.push_back(triangle);
+				}
+				else {
+					candidate.front.push_back(triangle);
+				}
+			}
+
+			if (candidate.front.size() < DECOMPOSITION_MIN_TRIANGLES || candidate.back.size() < DECOMPOSITION_MIN_TRIANGLES) {
+				continue;
+			}
+
+			candidate.frontVolume = CookedCollision::getHullVolume(getPartPoints(geometry, candidate.front));
+			candidate.backVolume = CookedCollision::getHullVolume(getPartPoints(geometry, candidate.back));
+			candidate.gain = 1.0f - (candidate.frontVolume + candidate.backVolume) / part.volume;
+		}
+	});
+
+	for (DecompositionPart& candidate : candidates) {
+
+		if (candidate.gain > part.gain) {
+
+			part.gain = candidate.gain;
+			part.front = std::move(candidate.front);
+			part.back = std::move(candidate.back);
+			part.frontVolume = candidate.frontVolume;
+			part.backVolume = candidate.backVolume;
+		}
+	}
+
+} // end evaluateSplit
+
+
+std::vector<std::vector<glm::vec3>> CookedCollision::decompose(const CollisionGeometry& geometry, int maxHulls)
+{
+	size_t triangleCount = geometry.indices.size() / 3;
+
+	std::vector<glm::vec3> centroids(triangleCount);
+
+	for (size_t triangle = 0; triangle < triangleCount; triangle++) {
+
+		centroids[triangle] = (geometry.positions[geometry.indices[triangle * 3]] +
+							   geometry.positions[geometry.indices[triangle * 3 + 1]] +
+							   geometry.positions[geometry.indices[triangle * 3 + 2]]) / 3.0f;
+	}
+
+	std::vector<DecompositionPart> parts(1);
+
+	for (unsigned int triangle = 0; triangle < triangleCount; triangle++) {
+		parts[0].triangles.push_back(triangle);
+	}
+
+	parts[0].volume = getHullVolume(getPartPoints(geometry, parts[0].triangles));
+
+	// Split the part whose split removes the most volume until no split removes enough
+	while (static_cast<int>(parts.size()) < maxHulls) {
+
+		for (DecompositionPart& part : parts) {
+
+			if (!part.evaluated) {
+				evaluateSplit(geometry, centroids, part);
+			}
+		}
+
+		auto best = std::max_element(parts.begin(), parts.end(),
+			[](const DecompositionPart& left, const DecompositionPart& right) { return left.gain < right.gain; });
+
+		if (best->gain < DECOMPOSITION_MIN_VOLUME_GAIN) {
+			break;
+		}
+
+		DecompositionPart front;
+		front.triangles = std::move(best->front);
+		front.volume = best->frontVolume;
+
+		DecompositionPart back;
+		back.triangles = std::move(best->back);
+		back.volume = best->backVolume;
+
+		*best = std::move(front);
+		parts.push_back(std::move(back));
+	}
+
+	std::vector<std::vector<glm::vec3>> partPoints;
+
+	for (DecompositionPart& part : parts) {
+		partPoints.push_back(getPartPoints(geometry, part.triangles));
+	}
+
+	if (VERBOSE) cout << "Decomposed " << triangleCount << " triangles into " << parts.size() << " parts" << endl;
+
+	return partPoints;
+
+} // end decompose
+
+
+bool CookedCollision::build(const std::vector<CollisionGeometry>& meshes, COLLISION_COOKING cooking)
+{
+	this->cooking = cooking;
+
+	hulls.clear();
+	vertices.clear();
+	indices.clear();
+	hierarchy.clear();
+
+	// Every sub-mesh together, for the kinds that treat the model as a whole
+	CollisionGeometry model;
+
+	for (const CollisionGeometry& mesh : meshes) {
+
+		unsigned int firstVertex = static_cast<unsigned int>(model.positions.size());
+
+		model.positions.insert(model.positions.end(), mesh.positions.begin(), mesh.positions.end());
+
+		for (unsigned int index : mesh.indices) {
+			model.indices.push_back(firstVertex + index);
+		}
+	}
+
+	if (model.indices.empty()) {
+		return false;
+	}
+
+	if (cooking == TRIANGLE_MESH) {
+
+		vertices = model.positions;
+		indices.assign(model.indices.begin(), model.indices.end());
+
+		btTriangleIndexVertexArray meshInterface(static_cast<int>(indices.size() / 3), indices.data(), 3 * sizeof(int),
+												 static_cast<int>(vertices.size()), &vertices[0].x, sizeof(glm::vec3));
+
+		btBvhTriangleMeshShape shape(&meshInterface, true, true);
+
+		// Serialize the hierarchy the shape built
+		btOptimizedBvh* bvh = shape.getOptimizedBvh();
+		unsigned int bytes = bvh->calculateSerializeBufferSize();
+
+		void* buffer = btAlignedAlloc(bytes, 16);
+
+		if (bvh->serializeInPlace(buffer, bytes, false)) {
+
+			hierarchy.resize(bytes);
+			memcpy(hierarchy.data(), buffer, bytes);
+		}
+
+		btAlignedFree(buffer);
+
+		return true;
+	}
+
+	std::vector<std::vector<glm::vec3>> points;
+
+	if (cooking == CONVEX_DECOMPOSITION) {
+
+		points = decompose(model);
+	}
+	else {
+
+		for (const CollisionGeometry& mesh : meshes) {
+			points.push_back(mesh.positions);
+		}
+	}
+
+	// Hulls are independent of each other
+	hulls.resize(points.size());
+
+	ThreadPool::parallelFor(points.size(), 1, [&](size_t begin, size_t end) {
+
+		for (size_t i = begin; i < end; i++) {
+			hulls[i] = simplifyHull(points[i]);
+		}
+	});
+
+	hulls.erase(std::remove_if(hulls.begin(), hulls.end(), [](const std::vector<glm::vec3>& hull) { return hull.empty(); }), hulls.end());
+
+	return true;
+
+} // end build
+
+
+bool CookedCollision::write(const std::string& cookedFile) const
+{
+	CollisionFileHeader header = {};
+	header.magic = COLLISION_FILE_MAGIC;
+	header.version = COLLISION_FILE_VERSION;
+	header.cooking = static_cast<uint32_t>(cooking);
+	header.hullCount = static_cast<uint32_t>(hulls.size());
+	header.vertexCount = static_cast<uint32_t>(vertices.size());
+	header.indexCount = static_cast<uint32_t>(indices.size());
+	header.hierarchyBytes = static_cast<uint32_t>(hierarchy.size());
+
+	FILE* file = nullptr;
+	fopen_s(&file, cookedFile.c_str(), "wb");
+
+	if (file == nullptr) {
+		std::cerr << "ERROR: Unable to write " << cookedFile << "!" << std::endl;
+		return false;
+	}
+
+	bool written = fwrite(&header, sizeof(header), 1, file) == 1;
+
+	for (const std::vector<glm::vec3>& hull : hulls) {
+
+		uint32_t hullVertices = static_cast<uint32_t>(hull.size());
+
+		written = written && fwrite(&hullVertices, sizeof(hullVertices), 1, file) == 1;
+		written = written && fwrite(hull.data(), sizeof(glm::vec3), hull.size(), file) == hull.size();
+	}
+
+	written = written && fwrite(vertices.data(), sizeof(glm::vec3), vertices.size(), file) == vertices.size();
+	written = written && fwrite(indices.data(), sizeof(int), indices.size(), file) == indices.size();
+	written = written && fwrite(hierarchy.data(), 1, hierarchy.size(), file) == hierarchy.size();
+
+	fclose(file);
+
+	if (!written) {
+		std::cerr << "ERROR: Unable to write " << cookedFile << "!" << std::endl;
+		std::remove(cookedFile.c_str());
+		return false;
+	}
+
+	if (VERBOSE) cout << "Cooked " << hulls.size() << " hulls and " << indices.size() / 3 << " triangles into " << cookedFile << endl;
+
+	return true;
+
+} // end write
+
+
+//********************* Loading *****************************************
+
+bool CookedCollision::open(const std::string& cookedFile)
+{
+	MappedFile file;
+
+	if (!file.open(cookedFile)) {
+		return false;
+	}
+
+	size_t offset = 0;
+
+	// Copies the next bytes of the file, if there are enough left
+	auto read = [&file, &offset](void* destination, size_t bytes) {
+
+		if (offset + bytes > file.getSize()) {
+			return false;
+		}
+
+		if (bytes > 0) {
+			memcpy(destination, file.getData() + offset, bytes);
+		}
+
+		offset += bytes;
+		return true;
+	};
+
+	CollisionFileHeader header = {};
+
+	if (!read(&header, sizeof(header)) || header.magic != COLLISION_FILE_MAGIC || header.version != COLLISION_FILE_VERSION) {
+		return false;
+	}
+
+	cooking = static_cast<COLLISION_COOKING>(header.cooking);
+	hulls.resize(header.hullCount);
+
+	for (std::vector<glm::vec3>& hull : hulls) {
+
+		uint32_t hullVertices = 0;
+
+		if (!read(&hullVertices, sizeof(hullVertices))) {
+			return false;
+		}
+
+		hull.resize(hullVertices);
+
+		if (!read(hull.data(), hull.size() * sizeof(glm::vec3))) {
+			return false;
+		}
+	}
+
+	vertices.resize(header.vertexCount);
+	indices.resize(header.indexCount);
+	hierarchy.resize(header.hierarchyBytes);
+
+	return read(vertices.data(), vertices.size() * sizeof(glm::vec3)) &&
+		   read(indices.data(), indices.size() * sizeof(int)) &&
+		   read(hierarchy.data(), hierarchy.size());
+
+} // end open
+
+
+/**
+ * @struct	TriangleMeshData
+ *
+ * @brief	Triangles and hierarchy that a btBvhTriangleMeshShape refers to but does
+ * 			not copy.
+ */
+struct TriangleMeshData {
+
+	std::vector<glm::vec3> vertices;
+	std::vector<int> indices;
+
+	std::unique_ptr<btTriangleIndexVertexArray> meshInterface;
+
+	// Bullet reads the hierarchy in place from a 16 byte aligned buffer
+	void* hierarchy = nullptr;
+
+	~TriangleMeshData()
+	{
+		if (hierarchy != nullptr) {
+			btAlignedFree(hierarchy);
+		}
+	}
+};
+
+
+std::shared_ptr<btCompoundShape> CookedCollision::createShape() const
+{
+	if (cooking == TRIANGLE_MESH && !indices.empty()) {
+
+		std::shared_ptr<TriangleMeshData> data = std::make_shared<TriangleMeshData>();
+		data->vertices = vertices;
+		data->indices = indices;
+		data->meshInterface = std::make_unique<btTriangleIndexVertexArray>(static_cast<int>(data->indices.size() / 3), data->indices.data(), 3 * sizeof(int),
+																		   static_cast<int>(data->vertices.size()), &data->vertices[0].x, sizeof(glm::vec3));
+
+		btBvhTriangleMeshShape* triangleMesh = nullptr;
+		btOptimizedBvh* bvh = nullptr;
+
+		if (!hierarchy.empty()) {
+
+			data->hierarchy = btAlignedAlloc(hierarchy.size(), 16);
+			memcpy(data->hierarchy, hierarchy.data(), hierarchy.size());
+
+			bvh = btOptimizedBvh::deSerializeInPlace(data->hierarchy, static_cast<unsigned int>(hierarchy.size()), false);
+		}
+
+		if (bvh != nullptr) {
+
+			triangleMesh = new btBvhTriangleMeshShape(data->meshInterface.get(), true, false);
+			triangleMesh->setOptimizedBvh(bvh);
+		}
+		else {
+
+			// The hierarchy could not be read, so build it again
+			triangleMesh = new btBvhTriangleMeshShape(data->meshInterface.get(), true, true);
+		}
+
+		std::shared_ptr<btCompoundShape> compoundShape = MeshComponent::makeCompoundShape(data);
+		compoundShape->addChildShape(btTransform::getIdentity(), triangleMesh);
+
+		return compoundShape;
+	}
+
+	std::shared_ptr<btCompoundShape> compoundShape = MeshComponent::makeCompoundShape();
+
+	for (const std::vector<glm::vec3>& hull : hulls) {
+
+		if (hull.empty()) {
+			continue;
+		}
+
+		// The bounding box is found once for all points
+		btConvexHullShape* hullShape = new btConvexHullShape(&hull[0].x, static_cast<int>(hull.size()), sizeof(glm::vec3));
+
+		compoundShape->addChildShape(btTransform::getIdentity(), hullShape);
+	}
+
+	return compoundShape;
+
+} // end createShape
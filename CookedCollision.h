@@ -0,0 +1,171 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "MathLibsConstsFuncs.h"
+
+#include "Bullet/btBulletDynamicsCommon.h"
+
+using namespace constants_and_types;
+
+// How the collision shape of a model is cooked
+enum COLLISION_COOKING { CONVEX_HULLS = 0, CONVEX_DECOMPOSITION, TRIANGLE_MESH };
+
+// Most vertices kept in a cooked hull. Bullet finds contacts with hulls in time
+// proportional to their vertices.
+static const int MAX_HULL_VERTICES = 48;
+
+// Most hulls a model is decomposed into
+static const int MAX_DECOMPOSITION_HULLS = 32;
+
+// Parts of a model are split while splitting removes at least this fraction of
+// the volume of their hull
+static const float DECOMPOSITION_MIN_VOLUME_GAIN = 0.1f;
+
+// Fewest triangles in a part of a decomposed model
+static const int DECOMPOSITION_MIN_TRIANGLES = 8;
+
+/**
+ * @struct	CollisionGeometry
+ *
+ * @brief	Triangles of one sub-mesh of a model that a collision shape is cooked from.
+ */
+struct CollisionGeometry {
+
+	std::vector<glm::vec3> positions;
+
+	// Three per triangle
+	std::vector<unsigned int> indices;
+};
+
+/**
+ * @class	CookedCollision
+ *
+ * @brief	Collision shape of a model cooked into a form that loads without
+ * 			processing the model's geometry. There are three kinds:
+ *
+ * 			CONVEX_HULLS keeps one simplified hull per sub-mesh.
+ *
+ * 			CONVEX_DECOMPOSITION splits the whole model into convex parts, in the
+ * 			manner of HACD and V-HACD. Parts are split in two by axis aligned
+ * 			planes for as long as the split removes enough of the volume of their
+ * 			hull, i.e. for as long as the part is noticeably concave. The best
+ * 			splits of the parts are searched for in parallel.
+ *
+ * 			TRIANGLE_MESH keeps every triangle in a bounding volume hierarchy. Only
+ * 			for models that never move. The hierarchy is stored along with the
+ * 			triangles so it does not have to be built when the file is loaded.
+ *
+ * 			Cooked files are written to the "Collision" directory of the
+ * 			AssetCache, one per model and kind.
+ */
+class CookedCollision
+{
+public:
+
+	/**
+	 * @fn	bool CookedCollision::build(const std::vector<CollisionGeometry>& meshes, COLLISION_COOKING cooking);
+	 *
+	 * @brief	Cooks the collision shape of a model.
+	 *
+	 * @param 	meshes 	Triangles of each sub-mesh of the model.
+	 * @param 	cooking	The kind of shape to cook.
+	 *
+	 * @returns	False if the model has no triangles.
+	 */
+	bool build(const std::vector<CollisionGeometry>& meshes, COLLISION_COOKING cooking);
+
+	/**
+	 * @fn	bool CookedCollision::write(const std::string& cookedFile) const;
+	 *
+	 * @brief	Writes the cooked shape to a file.
+	 *
+	 * @returns	True if it succeeds, false if it fails.
+	 */
+	bool write(const std::string& cookedFile) const;
+
+	/**
+	 * @fn	bool CookedCollision::open(const std::string& cookedFile);
+	 *
+	 * @brief	Reads a cooked shape from a file.
+	 *
+	 * @returns	True if it succeeds, false if the file is missing, invalid or was
+	 * 			written by another version of the engine.
+	 */
+	bool open(const std::string& cookedFile);
+
+	/**
+	 * @fn	std::shared_ptr<btCompoundShape> CookedCollision::createShape() const;
+	 *
+	 * @brief	Creates the Bullet shape. The shape is a compound of hulls or of one
+	 * 			triangle mesh and does not refer to this object.
+	 *
+	 * @returns	The collision shape.
+	 */
+	std::shared_ptr<btCompoundShape> createShape() const;
+
+	/**
+	 * @fn	COLLISION_COOKING CookedCollision::getCooking() const
+	 *
+	 * @brief	Gets the kind of shape that was cooked.
+	 */
+	COLLISION_COOKING getCooking() const { return cooking; }
+
+	/**
+	 * @fn	static const char* CookedCollision::getExtension(COLLISION_COOKING cooking);
+	 *
+	 * @brief	Gets the extension of the cooked files of a kind of shape.
+	 */
+	static const char* getExtension(COLLISION_COOKING cooking);
+
+	/**
+	 * @fn	static std::vector<glm::vec3> CookedCollision::simplifyHull(const std::vector<glm::vec3>& points, int maxVertices = MAX_HULL_VERTICES);
+	 *
+	 * @brief	Finds the vertices of the convex hull of a set of points. Hulls with
+	 * 			too many vertices are simplified to the vertices that lie furthest in
+	 * 			maxVertices directions spread evenly over the sphere.
+	 *
+	 * @param 	points	   	The points.
+	 * @param 	maxVertices	(Optional) Most vertices to keep.
+	 *
+	 * @returns	The vertices of the hull.
+	 */
+	static std::vector<glm::vec3> simplifyHull(const std::vector<glm::vec3>& points, int maxVertices = MAX_HULL_VERTICES);
+
+	/**
+	 * @fn	static std::vector<std::vector<glm::vec3>> CookedCollision::decompose(const CollisionGeometry& geometry, int maxHulls = MAX_DECOMPOSITION_HULLS);
+	 *
+	 * @brief	Approximates a concave model with convex hulls.
+	 *
+	 * @param 	geometry	Triangles of the whole model.
+	 * @param 	maxHulls	(Optional) Most hulls to make.
+	 *
+	 * @returns	The points of each hull, not yet simplified.
+	 */
+	static std::vector<std::vector<glm::vec3>> decompose(const CollisionGeometry& geometry, int maxHulls = MAX_DECOMPOSITION_HULLS);
+
+	/**
+	 * @fn	static float CookedCollision::getHullVolume(const std::vector<glm::vec3>& points);
+	 *
+	 * @brief	Gets the volume of the convex hull of a set of points.
+	 */
+	static float getHullVolume(const std::vector<glm::vec3>& points);
+
+protected:
+
+	/** @brief	The kind of shape */
+	COLLISION_COOKING cooking = CONVEX_HULLS;
+
+	/** @brief	Vertices of each hull */
+	std::vector<std::vector<glm::vec3>> hulls;
+
+	/** @brief	Triangles of a triangle mesh */
+	std::vector<glm::vec3> vertices;
+	std::vector<int> indices;
+
+	/** @brief	Bounding volume hierarchy of a triangle mesh, as serialized by Bullet */
+	std::vector<unsigned char> hierarchy;
+
+}; // end CookedCollision
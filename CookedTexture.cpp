@@ -0,0 +1,241 @@
+#include "CookedTexture.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+
+#include "stb_image.h"
+
+static const bool VERBOSE = false;
+
+// "DDS " and "DX10" four character codes
+static const uint32_t DDS_MAGIC = 0x20534444;
+static const uint32_t DDS_FOURCC_DX10 = 0x30315844;
+
+// Tag and version written to the reserved fields of the header by the engine.
+// Incrementing the version causes all textures to be cooked again.
+static const uint32_t DDS_ENGINE_TAG = 0x474E4547; // "GENG"
+static const uint32_t COOK_VERSION = 1;
+
+// Header flags
+static const uint32_t DDSD_CAPS = 0x1;
+static const uint32_t DDSD_HEIGHT = 0x2;
+static const uint32_t DDSD_WIDTH = 0x4;
+static const uint32_t DDSD_PIXELFORMAT = 0x1000;
+static const uint32_t DDSD_MIPMAPCOUNT = 0x20000;
+static const uint32_t DDSD_LINEARSIZE = 0x80000;
+static const uint32_t DDPF_FOURCC = 0x4;
+static const uint32_t DDSCAPS_COMPLEX = 0x8;
+static const uint32_t DDSCAPS_TEXTURE = 0x1000;
+static const uint32_t DDSCAPS_MIPMAP = 0x400000;
+static const uint32_t DDS_DIMENSION_TEXTURE2D = 3;
+
+// DXGI formats of the engine texture formats
+static const uint32_t DXGI_FORMAT_R8G8B8A8_UNORM = 28;
+static const uint32_t DXGI_FORMAT_BC1_UNORM = 71;
+static const uint32_t DXGI_FORMAT_BC3_UNORM = 77;
+static const uint32_t DXGI_FORMAT_BC4_UNORM = 80;
+static const uint32_t DXGI_FORMAT_BC5_UNORM = 83;
+static const uint32_t DXGI_FORMAT_BC7_UNORM = 98;
+
+struct DDSPixelFormat {
+	uint32_t size;
+	uint32_t flags;
+	uint32_t fourCC;
+	uint32_t rgbBitCount;
+	uint32_t bitMasks[4];
+};
+
+struct DDSHeader {
+	uint32_t size;
+	uint32_t flags;
+	uint32_t height;
+	uint32_t width;
+	uint32_t pitchOrLinearSize;
+	uint32_t depth;
+	uint32_t mipMapCount;
+	uint32_t reserved1[11];
+	DDSPixelFormat pixelFormat;
+	uint32_t caps;
+	uint32_t caps2;
+	uint32_t caps3;
+	uint32_t caps4;
+	uint32_t reserved2;
+};
+
+struct DDSHeaderDX10 {
+	uint32_t dxgiFormat;
+	uint32_t resourceDimension;
+	uint32_t miscFlag;
+	uint32_t arraySize;
+	uint32_t miscFlags2;
+};
+
+static_assert(sizeof(DDSHeader) == 124, "DDS header must be 124 bytes");
+static_assert(sizeof(DDSHeaderDX10) == 20, "DX10 header must be 20 bytes");
+
+static uint32_t toDXGIFormat(TEXTURE_FORMAT format)
+{
+	switch (format) {
+
+	case FORMAT_BC1: return DXGI_FORMAT_BC1_UNORM;
+	case FORMAT_BC3: return DXGI_FORMAT_BC3_UNORM;
+	case FORMAT_BC4: return DXGI_FORMAT_BC4_UNORM;
+	case FORMAT_BC5: return DXGI_FORMAT_BC5_UNORM;
+	case FORMAT_BC7: return DXGI_FORMAT_BC7_UNORM;
+	default: return DXGI_FORMAT_R8G8B8A8_UNORM;
+	}
+
+} // end toDXGIFormat
+
+static bool fromDXGIFormat(uint32_t dxgiFormat, TEXTURE_FORMAT& format)
+{
+	switch (dxgiFormat) {
+
+	case DXGI_FORMAT_BC1_UNORM: format = FORMAT_BC1; return true;
+	case DXGI_FORMAT_BC3_UNORM: format = FORMAT_BC3; return true;
+	case DXGI_FORMAT_BC4_UNORM: format = FORMAT_BC4; return true;
+	case DXGI_FORMAT_BC5_UNORM: format = FORMAT_BC5; return true;
+	case DXGI_FORMAT_BC7_UNORM: format = FORMAT_BC7; return true;
+	case DXGI_FORMAT_R8G8B8A8_UNORM: format = FORMAT_RGBA8; return true;
+	default: return false;
+	}
+
+} // end fromDXGIFormat
+
+
+bool CookedTexture::cook(const std::string& sourceFile, const std::string& cookedFile, TEXTURE_USAGE usage)
+{
+	// Store rows the way OpenGL expects
+	stbi_set_flip_vertically_on_load(true);
+
+	// Always expand to four channels so that every encoder sees RGBA texels
+	int width = 0, height = 0, nrChannels;
+	unsigned char* image = stbi_load(sourceFile.c_str(), &width, &height, &nrChannels, 4);
+
+	if (image == nullptr || width == 0 || height == 0) {
+		std::cerr << "ERROR: Unable to cook " << sourceFile << "!" << std::endl;
+		return false;
+	}
+
+	TEXTURE_FORMAT format = TextureCompression::chooseFormat(usage, TextureCompression::hasAlpha(image, width, height));
+
+	std::vector<MipLevel> levels = TextureCompression::buildMipChain(image, width, height, usage);
+
+	stbi_image_free(image);
+
+	DDSHeader header = {};
+	header.size = sizeof(DDSHeader);
+	header.flags = DDSD_CAPS | DDSD_HEIGHT | DDSD_WIDTH | DDSD_PIXELFORMAT | DDSD_MIPMAPCOUNT | DDSD_LINEARSIZE;
+	header.height = static_cast<uint32_t>(height);
+	header.width = static_cast<uint32_t>(width);
+	header.pitchOrLinearSize = static_cast<uint32_t>(TextureCompression::getLevelSize(format, width, height));
+	header.mipMapCount = static_cast<uint32_t>(levels.size());
+	header.reserved1[0] = DDS_ENGINE_TAG;
+	header.reserved1[1] = COOK_VERSION;
+	header.pixelFormat.size = sizeof(DDSPixelFormat);
+	header.pixelFormat.flags = DDPF_FOURCC;
+	header.pixelFormat.fourCC = DDS_FOURCC_DX10;
+	header.caps = DDSCAPS_COMPLEX | DDSCAPS_TEXTURE | DDSCAPS_MIPMAP;
+
+	DDSHeaderDX10 headerDX10 = {};
+	headerDX10.dxgiFormat = toDXGIFormat(format);
+	headerDX10.resourceDimension = DDS_DIMENSION_TEXTURE2D;
+	headerDX10.arraySize = 1;
+
+	FILE* file = nullptr;
+	fopen_s(&file, cookedFile.c_str(), "wb");
+
+	if (file == nullptr) {
+		std::cerr << "ERROR: Unable to write " << cookedFile << "!" << std::endl;
+		return false;
+	}
+
+	bool written = fwrite(&DDS_MAGIC, sizeof(DDS_MAGIC), 1, file) == 1 &&
+				   fwrite(&header, sizeof(header), 1, file) == 1 &&
+				   fwrite(&headerDX10, sizeof(headerDX10), 1, file) == 1;
+
+	for (const MipLevel& level : levels) {
+
+		std::vector<unsigned char> blocks = TextureCompression::compress(level, format);
+		written = written && fwrite(blocks.data(), 1, blocks.size(), file) == blocks.size();
+	}
+
+	fclose(file);
+
+	if (!written) {
+		std::cerr << "ERROR: Unable to write " << cookedFile << "!" << std::endl;
+		std::remove(cookedFile.c_str());
+		return false;
+	}
+
+	if (VERBOSE) cout << "Cooked " << sourceFile << " to " << cookedFile << " with " << levels.size() << " mip levels" << endl;
+
+	return true;
+
+} // end cook
+
+
+bool CookedTexture::open(const std::string& cookedFile)
+{
+	levelOffsets.clear();
+
+	if (!file.open(cookedFile)) {
+		return false;
+	}
+
+	const unsigned char* data = file.getData();
+	size_t headerSize = sizeof(DDS_MAGIC) + sizeof(DDSHeader) + sizeof(DDSHeaderDX10);
+
+	if (file.getSize() < headerSize) {
+		file.close();
+		return false;
+	}
+
+	uint32_t magic;
+	DDSHeader header;
+	DDSHeaderDX10 headerDX10;
+	memcpy(&magic, data, sizeof(magic));
+	memcpy(&header, data + sizeof(magic), sizeof(header));
+	memcpy(&headerDX10, data + sizeof(magic) + sizeof(header), sizeof(headerDX10));
+
+	// Only accept files cooked by this version of the engine
+	if (magic != DDS_MAGIC || header.size != sizeof(DDSHeader) ||
+		header.pixelFormat.fourCC != DDS_FOURCC_DX10 ||
+		header.reserved1[0] != DDS_ENGINE_TAG || header.reserved1[1] != COOK_VERSION ||
+		!fromDXGIFormat(headerDX10.dxgiFormat, format) ||
+		header.width == 0 || header.height == 0 || header.mipMapCount == 0) {
+
+		file.close();
+		return false;
+	}
+
+	width = static_cast<int>(header.width);
+	height = static_cast<int>(header.height);
+
+	// Locate each mip level and make sure the file is not truncated
+	size_t offset = headerSize;
+
+	for (uint32_t level = 0; level < header.mipMapCount; level++) {
+
+		levelOffsets.push_back(offset);
+		offset += TextureCompression::getLevelSize(format, getLevelWidth(level), getLevelHeight(level));
+	}
+
+	if (offset > file.getSize()) {
+
+		levelOffsets.clear();
+		file.close();
+		return false;
+	}
+
+	return true;
+
+} // end open
+
+
+size_t CookedTexture::getLevelSize(int level) const
+{
+	return TextureCompression::getLevelSize(format, getLevelWidth(level), getLevelHeight(level));
+
+} // end getLevelSize
@@ -0,0 +1,128 @@
+#pragma once
+
+#include <algorithm>
+
+#include "AssetCache.h"
+#include "TextureCompression.h"
+
+/**
+ * @class	CookedTexture
+ *
+ * @brief	A texture that has been cooked into a DDS container (with the DX10
+ * 			extended header) holding a complete, pre-built mip chain. Cooked files
+ * 			are memory mapped when opened so that each mip level can be passed
+ * 			straight to glCompressedTexImage2D.
+ *
+ * 			Rows are stored from bottom to top (the order OpenGL expects) rather
+ * 			than the top to bottom order used by other DDS tools. Files written by
+ * 			the engine are tagged in the reserved header fields and files without
+ * 			the tag are rejected so that they are cooked again.
+ */
+class CookedTexture
+{
+public:
+
+	/**
+	 * @fn	static bool CookedTexture::cook(const std::string& sourceFile, const std::string& cookedFile, TEXTURE_USAGE usage);
+	 *
+	 * @brief	Loads a source image, builds its mip chain, compresses every level
+	 * 			and writes the result to a cooked file.
+	 *
+	 * @param	sourceFile	Relative path and name of the source image.
+	 * @param	cookedFile	Relative path and name of the cooked file to write.
+	 * @param	usage	  	How the texture will be used in the shaders.
+	 *
+	 * @returns	True if it succeeds, false if it fails.
+	 */
+	static bool cook(const std::string& sourceFile, const std::string& cookedFile, TEXTURE_USAGE usage);
+
+	/**
+	 * @fn	bool CookedTexture::open(const std::string& cookedFile);
+	 *
+	 * @brief	Maps a cooked file and validates its header.
+	 *
+	 * @param	cookedFile	Relative path and name of the cooked file.
+	 *
+	 * @returns	True if it succeeds, false if the file is missing or invalid.
+	 */
+	bool open(const std::string& cookedFile);
+
+	/**
+	 * @fn	TEXTURE_FORMAT CookedTexture::getFormat() const
+	 *
+	 * @brief	Gets the format the mip levels are stored in.
+	 *
+	 * @returns	The format.
+	 */
+	TEXTURE_FORMAT getFormat() const { return format; }
+
+	/**
+	 * @fn	int CookedTexture::getMipCount() const
+	 *
+	 * @brief	Gets the number of mip levels in the file.
+	 *
+	 * @returns	The mip count.
+	 */
+	int getMipCount() const { return static_cast<int>(levelOffsets.size()); }
+
+	/**
+	 * @fn	int CookedTexture::getLevelWidth(int level) const
+	 *
+	 * @brief	Gets the width in texels of a mip level.
+	 *
+	 * @param	level	The mip level.
+	 *
+	 * @returns	The width.
+	 */
+	int getLevelWidth(int level) const { return std::max(1, width >> level); }
+
+	/**
+	 * @fn	int CookedTexture::getLevelHeight(int level) const
+	 *
+	 * @brief	Gets the height in texels of a mip level.
+	 *
+	 * @param	level	The mip level.
+	 *
+	 * @returns	The height.
+	 */
+	int getLevelHeight(int level) const { return std::max(1, height >> level); }
+
+	/**
+	 * @fn	const unsigned char* CookedTexture::getLevelData(int level) const
+	 *
+	 * @brief	Gets a pointer to the mapped data of a mip level.
+	 *
+	 * @param	level	The mip level.
+	 *
+	 * @returns	The level data.
+	 */
+	const unsigned char* getLevelData(int level) const { return file.getData() + levelOffsets[level]; }
+
+	/**
+	 * @fn	size_t CookedTexture::getLevelSize(int level) const
+	 *
+	 * @brief	Gets the size in bytes of a mip level.
+	 *
+	 * @param	level	The mip level.
+	 *
+	 * @returns	The level size.
+	 */
+	size_t getLevelSize(int level) const;
+
+protected:
+
+	/** @brief	Mapping of the cooked file */
+	MappedFile file;
+
+	/** @brief	Format of all mip levels */
+	TEXTURE_FORMAT format = FORMAT_RGBA8;
+
+	/** @brief	Width/height of level zero */
+	int width = 0;
+	int height = 0;
+
+	/** @brief	Byte offsets of each mip level from the start of the file */
+	std::vector<size_t> levelOffsets;
+
+}; // end CookedTexture
+
@@ -1,6 +1,6 @@
 #pragma once
-#include "MeshComponent.h"
-class CylinderMeshComponent : public MeshComponent
+#include "ProceduralMeshComponent.h"
+class CylinderMeshComponent : public ProceduralMeshComponent
 {
 public:
 	CylinderMeshComponent(GLuint shaderProgram, Material mat, 
@@ -9,15 +9,13 @@ public:
 
 protected:
 
-	virtual void buildMesh();
+	virtual size_t getGeometryKey() const override;
 
-	void initializeTopSubMesh();
-	void initializeBottomSubMesh();
-	void initializeBodySubMesh();
+	virtual void generateGeometry(int subMeshIndex, std::vector<pntVertexData>& vertexData, std::vector<unsigned int>& indices) const override;
 
-	float sliceInc, stackInc, radius, height;
+	virtual std::shared_ptr<btCollisionShape> createCollisionShape() const override;
+
+	float radius, height;
 	int slices, stacks;
-	Material cylinderMat;
 
 };
-
@@ -0,0 +1,237 @@
+#include "GPUDrivenRenderer.h"
+
+#include "BuildShaderProgram.h"
+#include "GeometryArena.h"
+#include "OcclusionCulling.h"
+#include "RenderQueue.h"
+#include "ShaderHotReload.h"
+#include "ShaderPermutations.h"
+
+static const bool VERBOSE = false;
+
+// Texture unit of the Hi-Z pyramid while the culling shader runs. Same unit
+// OcclusionCulling uses.
+static const GLuint hiZTextureUnit = 7;
+
+// Static variable definitions (Static variables must be defined outside the declaration)
+bool GPUDrivenRenderer::enabled = true;
+std::vector<GPUDrivenRenderer::DrawObject> GPUDrivenRenderer::objects;
+std::vector<GPUDrivenRenderer::Bucket> GPUDrivenRenderer::buckets;
+std::map<std::pair<GLuint, size_t>, size_t> GPUDrivenRenderer::bucketIndices;
+GpuBuffer GPUDrivenRenderer::objectBuffer;
+GpuBuffer GPUDrivenRenderer::commandBuffer;
+GpuBuffer GPUDrivenRenderer::countBuffer;
+size_t GPUDrivenRenderer::objectCapacity = 0;
+size_t GPUDrivenRenderer::bucketCapacity = 0;
+GLuint GPUDrivenRenderer::cullingProgram = 0;
+
+
+bool GPUDrivenRenderer::handlesSubMesh(const MeshComponent& mesh, const SubMesh& subMesh)
+{
+	if (!enabled || subMesh.renderMode != INDEXED || subMesh.primitiveMode != GL_TRIANGLES ||
+		mesh.getMaterial(subMesh).getTransparencyMat() < 1.0f) {
+		return false;
+	}
+
+	// Programs that could not be specialized do not read the draw objects
+	GLuint variant = ShaderPermutations::getVariant(mesh.getShaderProgram(), mesh.getMaterial(subMesh).getFeatureBits() | GPU_DRIVEN_VARIANT);
+
+	return variant != mesh.getShaderProgram();
+
+} // end handlesSubMesh
+
+
+void GPUDrivenRenderer::initialize()
+{
+	objectBuffer = GpuBuffer::create();
+	commandBuffer = GpuBuffer::create();
+	countBuffer = GpuBuffer::create();
+
+	ShaderInfo shaders[] = {
+		{ GL_COMPUTE_SHADER, "Shaders/drawCullingShader.glsl" },
+		{ GL_NONE, NULL } // signals that there are no more shaders
+	};
+
+	cullingProgram = BuildShaderProgram(shaders);
+
+	// Follow the culling program when it is rebuilt after a source change
+	ShaderHotReload::addSwapCallback([](GLuint oldProgram, GLuint newProgram) {
+
+		if (cullingProgram == oldProgram) {
+			cullingProgram = newProgram;
+		}
+	});
+
+} // end initialize
+
+
+void GPUDrivenRenderer::prepare()
+{
+	objects.clear();
+	buckets.clear();
+	bucketIndices.clear();
+
+	if (!enabled) {
+		return;
+	}
+
+	if (!objectBuffer) {
+		initialize();
+	}
+
+	// Sort the items into buckets
+	std::vector<std::pair<const RenderItem*, size_t>> drawItems;
+
+	for (const RenderItem& item : RenderQueue::getItems()) {
+
+		if (!handlesSubMesh(*item.mesh, *item.subMesh)) {
+			continue;
+		}
+
+		GLuint variant = ShaderPermutations::getVariant(item.mesh->getShaderProgram(),
+														item.material->getFeatureBits() | GPU_DRIVEN_VARIANT);
+
+		auto key = std::make_pair(variant, SharedMaterials::getTextureBindingHash(*item.material));
+		auto bucket = bucketIndices.find(key);
+
+		if (bucket == bucketIndices.end()) {
+
+			bucket = bucketIndices.emplace(key, buckets.size()).first;
+
+			Bucket newBucket;
+			newBucket.shaderProgram = variant;
+			newBucket.material = item.material;
+			buckets.push_back(newBucket);
+		}
+
+		buckets[bucket->second].objectCount++;
+		drawItems.push_back({ &item, bucket->second });
+	}
+
+	if (drawItems.empty()) {
+		return;
+	}
+
+	// Each bucket writes its commands to its own range of the command buffer
+	GLuint commandOffset = 0;
+
+	for (Bucket& bucket : buckets) {
+
+		bucket.commandOffset = commandOffset;
+		commandOffset += bucket.objectCount;
+	}
+
+	objects.resize(drawItems.size());
+
+	for (size_t i = 0; i < drawItems.size(); i++) {
+
+		const RenderItem& item = *drawItems[i].first;
+		const GeometryAllocation& geometry = GeometryArena::getAllocation(item.subMesh->geometry);
+		size_t bucket = drawItems[i].second;
+
+		DrawObject& object = objects[i];
+		object.modelMatrix = item.modelMatrix;
+		object.boundsCenterRadius = glm::vec4(item.boundsCenter, item.boundsRadius);
+		object.drawCommand = glm::uvec4(geometry.indexCount, geometry.firstIndex, geometry.baseVertex, 0);
+		object.bucket = glm::uvec4(static_cast<GLuint>(bucket), buckets[bucket].commandOffset,
+								   OcclusionCulling::isOccluded(item.mesh) ? 1 : 0, 0);
+		object.material = SharedMaterials::packMaterial(*item.material);
+	}
+
+	// Grow the buffers of the frame if needed
+	if (objects.size() > objectCapacity) {
+
+		objectCapacity = std::max(objects.size(), 2 * objectCapacity);
+
+		glNamedBufferData(objectBuffer.get(), objectCapacity * sizeof(DrawObject), nullptr, GL_DYNAMIC_DRAW);
+		glNamedBufferData(commandBuffer.get(), objectCapacity * sizeof(DrawElementsIndirectCommand), nullptr, GL_DYNAMIC_DRAW);
+	}
+
+	if (buckets.size() > bucketCapacity) {
+
+		bucketCapacity = std::max(buckets.size(), 2 * bucketCapacity);
+
+		glNamedBufferData(countBuffer.get(), bucketCapacity * sizeof(GLuint), nullptr, GL_DYNAMIC_DRAW);
+	}
+
+	glNamedBufferSubData(objectBuffer.get(), 0, objects.size() * sizeof(DrawObject), objects.data());
+
+} // end prepare
+
+
+void GPUDrivenRenderer::render(const glm::mat4& viewProjection, bool occlusionCulling)
+{
+	if (objects.empty()) {
+		return;
+	}
+
+	glClearNamedBufferSubData(countBuffer.get(), GL_R32UI, 0, buckets.size() * sizeof(GLuint), GL_RED_INTEGER, GL_UNSIGNED_INT, nullptr);
+
+	// Cull the objects and write the draw commands
+	GLuint hiZTexture = occlusionCulling ? OcclusionCulling::getHiZTexture() : 0;
+
+	glUseProgram(cullingProgram);
+	glUniformMatrix4fv(drawCullViewProjectionLocation, 1, GL_FALSE, glm::value_ptr(viewProjection));
+	glUniformMatrix4fv(drawCullHiZViewProjectionLocation, 1, GL_FALSE, glm::value_ptr(OcclusionCulling::getHiZViewProjection()));
+	glUniform1ui(drawCullObjectCountLocation, static_cast<GLuint>(objects.size()));
+	glUniform1i(drawCullHiZEnabledLocation, hiZTexture != 0 ? 1 : 0);
+	glUniform1i(drawCullSkipOccludedLocation, occlusionCulling ? 1 : 0);
+
+	if (hiZTexture != 0) {
+		glBindTextureUnit(hiZTextureUnit, hiZTexture);
+	}
+
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, drawObjectBindingPoint, objectBuffer.get());
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, drawCommandBindingPoint, commandBuffer.get());
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, drawCountBindingPoint, countBuffer.get());
+
+	glDispatchCompute((static_cast<GLuint>(objects.size()) + 63) / 64, 1, 1);
+
+	// The commands and counts are read by the draw calls
+	glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT);
+
+	// One draw call per bucket
+	glBindVertexArray(GeometryArena::getVertexArray(PNT_VERTEX_FORMAT));
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, commandBuffer.get());
+	glBindBuffer(GL_PARAMETER_BUFFER, countBuffer.get());
+
+	for (size_t i = 0; i < buckets.size(); i++) {
+
+		const Bucket& bucket = buckets[i];
+
+		glUseProgram(bucket.shaderProgram);
+
+		// Binds the textures shared by the bucket. The rest of the material is read
+		// from the draw objects.
+		SharedMaterials::setShaderMaterialProperties(*bucket.material);
+
+		glMultiDrawElementsIndirectCount(GL_TRIANGLES, GL_UNSIGNED_INT,
+										 reinterpret_cast<const void*>(bucket.commandOffset * sizeof(DrawElementsIndirectCommand)),
+										 static_cast<GLintptr>(i * sizeof(GLuint)), bucket.objectCount, 0);
+
+		SharedMaterials::cleanUpMaterial(*bucket.material);
+	}
+
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+	glBindBuffer(GL_PARAMETER_BUFFER, 0);
+	glBindVertexArray(0);
+
+} // end render
+
+
+void GPUDrivenRenderer::unload()
+{
+	objectBuffer.reset();
+	commandBuffer.reset();
+	countBuffer.reset();
+
+	objectCapacity = bucketCapacity = 0;
+
+	// The culling shader is deleted along with all other programs by deleteAllShaderPrograms
+	cullingProgram = 0;
+
+	objects.clear();
+	buckets.clear();
+	bucketIndices.clear();
+
+} // end unload
@@ -0,0 +1,203 @@
+#pragma once
+
+#include <map>
+
+#include "MathLibsConstsFuncs.h"
+#include "GpuResource.h"
+#include "MeshComponent.h"
+#include "SharedMaterials.h"
+
+using namespace constants_and_types;
+
+// Shader storage buffer binding points of the draw objects, the indirect draw
+// commands and the number of commands written for each bucket
+static const GLuint drawObjectBindingPoint = 11;
+static const GLuint drawCommandBindingPoint = 12;
+static const GLuint drawCountBindingPoint = 13;
+
+// Uniform locations in the draw culling compute shader
+static const GLuint drawCullViewProjectionLocation = 0;
+static const GLuint drawCullHiZViewProjectionLocation = 1;
+static const GLuint drawCullObjectCountLocation = 2;
+static const GLuint drawCullHiZEnabledLocation = 3;
+static const GLuint drawCullSkipOccludedLocation = 4;
+
+/**
+ * @struct	DrawElementsIndirectCommand
+ *
+ * @brief	Layout of one command in an indirect draw buffer for glMultiDrawElementsIndirect.
+ */
+struct DrawElementsIndirectCommand {
+
+	GLuint count;
+	GLuint instanceCount;
+	GLuint firstIndex;
+	GLint baseVertex;
+	GLuint baseInstance;
+};
+
+/**
+ * @class	GPUDrivenRenderer
+ *
+ * @brief	Draws the opaque, indexed triangle sub-meshes of the RenderQueue with a
+ * 			few multi-draw indirect calls instead of one draw call each.
+ *
+ * 			All sub-meshes live in the shared buffers of the GeometryArena, so every
+ * 			draw reads through the same vertex array object and differs only in its
+ * 			base vertex and first index. Each frame the transformation, bounds and material
+ * 			of every sub-mesh are written to a shader storage buffer as a draw
+ * 			object. For each camera a compute shader culls the objects against the
+ * 			view volume and, for the camera that is occlusion culled, the Hi-Z
+ * 			pyramid, and writes an indirect draw command for each object that may
+ * 			be visible. The objects are only written once however many cameras
+ * 			render them.
+ *
+ * 			Objects are grouped into buckets by shader variant and bound textures,
+ * 			which are the only state that cannot change within a multi-draw call.
+ * 			Each bucket is drawn by one glMultiDrawElementsIndirectCount with the
+ * 			number of commands the compute shader wrote for it. The shaders use the
+ * 			GPU_DRIVEN variant (see GPU_DRIVEN_VARIANT) to read the transformation
+ * 			and material of the object from the storage buffer.
+ *
+ * 			Sub-meshes that are transparent, not indexed or not triangle lists are
+ * 			left to MeshComponent::draw.
+ */
+class GPUDrivenRenderer
+{
+public:
+
+	/**
+	 * @fn	static void GPUDrivenRenderer::setEnabled(bool enabled)
+	 *
+	 * @brief	Enables drawing sub-meshes with multi-draw indirect calls. When disabled
+	 * 			all sub-meshes are drawn by MeshComponent::draw.
+	 */
+	static void setEnabled(bool enabled) { GPUDrivenRenderer::enabled = enabled; }
+	static bool isEnabled() { return enabled; }
+
+	/**
+	 * @fn	static bool GPUDrivenRenderer::handlesSubMesh(const MeshComponent& mesh, const SubMesh& subMesh);
+	 *
+	 * @brief	Determines if a sub-mesh is drawn by render rather than by the mesh.
+	 *
+	 * @param	mesh   	The mesh the sub-mesh belongs to.
+	 * @param	subMesh	The sub-mesh.
+	 */
+	static bool handlesSubMesh(const MeshComponent& mesh, const SubMesh& subMesh);
+
+	/**
+	 * @fn	static void GPUDrivenRenderer::prepare();
+	 *
+	 * @brief	Sorts the sub-meshes in the RenderQueue that it handles into buckets
+	 * 			and uploads them as draw objects. Should be called once per frame
+	 * 			after the RenderQueue has been built and OcclusionCulling::beginFrame
+	 * 			has found the occluded meshes.
+	 */
+	static void prepare();
+
+	/**
+	 * @fn	static void GPUDrivenRenderer::render(const glm::mat4& viewProjection, bool occlusionCulling);
+	 *
+	 * @brief	Culls and draws the objects uploaded by prepare. Called for each
+	 * 			camera with the framebuffer and viewport of the camera bound.
+	 *
+	 * @param	viewProjection	The view-projection matrix of the camera.
+	 * @param	occlusionCulling	True to also skip the objects hidden from the camera
+	 * 								OcclusionCulling ran for.
+	 */
+	static void render(const glm::mat4& viewProjection, bool occlusionCulling);
+
+	/**
+	 * @fn	static int GPUDrivenRenderer::getObjectCount()
+	 *
+	 * @brief	Gets the number of objects submitted to the culling shader in the last frame.
+	 */
+	static int getObjectCount() { return static_cast<int>(objects.size()); }
+
+	/**
+	 * @fn	static int GPUDrivenRenderer::getBucketCount()
+	 *
+	 * @brief	Gets the number of multi-draw calls made in the last frame.
+	 */
+	static int getBucketCount() { return static_cast<int>(buckets.size()); }
+
+	/**
+	 * @fn	static void GPUDrivenRenderer::unload();
+	 *
+	 * @brief	Deletes the draw object, command and count buffers.
+	 */
+	static void unload();
+
+protected:
+
+	/**
+	 * @struct	DrawObject
+	 *
+	 * @brief	One sub-mesh to be culled and drawn (std430 layout). Must match the
+	 * 			draw object in the shaders.
+	 */
+	struct DrawObject {
+
+		// World transformation
+		glm::mat4 modelMatrix;
+
+		// World space bounding sphere
+		glm::vec4 boundsCenterRadius;
+
+		// Index count (x), first index (y) and base vertex (z) in the shared buffers
+		glm::uvec4 drawCommand;
+
+		// Bucket (x), first command of the bucket (y) and 1 if OcclusionCulling
+		// found the mesh hidden (z)
+		glm::uvec4 bucket;
+
+		// Material of the sub-mesh
+		PackedMaterial material;
+	};
+
+	/**
+	 * @struct	Bucket
+	 *
+	 * @brief	Objects that are drawn by one multi-draw call.
+	 */
+	struct Bucket {
+
+		// Shader variant the objects are drawn with
+		GLuint shaderProgram = 0;
+
+		// Material of one of the objects. Used to bind the textures of the bucket.
+		const Material* material = nullptr;
+
+		// First command of the bucket and the number of objects in it
+		GLuint commandOffset = 0;
+		GLuint objectCount = 0;
+	};
+
+	/**
+	 * @fn	static void GPUDrivenRenderer::initialize();
+	 *
+	 * @brief	Creates the buffers and the culling shader.
+	 */
+	static void initialize();
+
+	/** @brief	True if sub-meshes are drawn with multi-draw indirect calls */
+	static bool enabled;
+
+	/** @brief	Draw objects and buckets of the current frame */
+	static std::vector<DrawObject> objects;
+	static std::vector<Bucket> buckets;
+
+	/** @brief	Buckets indexed by shader variant and texture binding hash */
+	static std::map<std::pair<GLuint, size_t>, size_t> bucketIndices;
+
+	/** @brief	Draw object, command and count buffers and their capacities */
+	static GpuBuffer objectBuffer;
+	static GpuBuffer commandBuffer;
+	static GpuBuffer countBuffer;
+	static size_t objectCapacity;
+	static size_t bucketCapacity;
+
+	/** @brief	Compute shader that culls the objects and writes the commands */
+	static GLuint cullingProgram;
+
+}; // end GPUDrivenRenderer
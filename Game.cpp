@@ -2,7 +2,7 @@
 static const bool  VERBOSE = false;
 
 //#include "SoundEngine.h"
-//#include "PhysicsEngine.h"
+#include "PhysicsEngine.h"
 
 
 //********************* Initialization Methods *****************************************
@@ -54,8 +54,7 @@ bool Game::initializeGame()
 	bool soundInit = true;
 
 	// Initialize the physics engine
-	// TODO
-	bool physicsInit = true;
+	bool physicsInit = PhysicsEngine::initialize();
 
 	// Check if all libraries initialized correctly
 	if (windowInit && graphicsInit && soundInit && physicsInit)
@@ -63,6 +62,15 @@ bool Game::initializeGame()
 		// Build the scene graph
 		loadScene();
 
+		// Report the compile time saved by the shader program cache
+		if (VERBOSE) printShaderCacheStats();
+
+		// Report how much of the shared geometry buffers the scene uses
+		if (VERBOSE) GeometryArena::printStats();
+
+		// Report how much geometry was shared by meshes with the same shape
+		if (VERBOSE) MeshComponent::printCacheStats();
+
 		// Explicitly call the resize method to set the initial projection transformation
 		// and viewport based on framebuffer size.
 		glm::ivec2 dim = getWindowDimensions();
@@ -113,6 +121,10 @@ bool Game::initializeRenderWindow()
 	// Explicitly request double buffers i.e. two frame buffers
 	glfwWindowHint(GLFW_DOUBLEBUFFER, GLFW_TRUE);
 
+	// Depth and stencil format of the window. Must match the depth copy used for occlusion culling.
+	glfwWindowHint(GLFW_DEPTH_BITS, 24);
+	glfwWindowHint(GLFW_STENCIL_BITS, 8);
+
 	// Create rendering window and the OpenGL context.
 	renderWindow = glfwCreateWindow(initialScreenWidth, initialScreenHeight, windowTitle.c_str(), NULL, NULL);
 
@@ -184,6 +196,10 @@ bool Game::initializeGraphics()
 	// Enable Gamma correction
 	//glEnable(GL_FRAMEBUFFER_SRGB);
 
+	// Rebuild shader programs in the background when their source files change,
+	// if hot reload is enabled
+	ShaderHotReload::start(renderWindow);
+
 	if (VERBOSE) cout << "Graphics Initialized" << endl;
 
 	// Display OpenGL context information (OpenGL and GLSL versions) on the
@@ -217,6 +233,9 @@ void Game::gameLoop()
 
 	while (isRunning) {
 
+		// Wait for the physics steps taken while the last frame was rendered
+		PhysicsEngine::synchronize();
+
 		processGameInput();
 		updateGame();
 		renderScene();
@@ -276,8 +295,8 @@ void Game::updateGame()
 
 	if (deltaTime >= FRAME_INTERVAL) {
 
-		// Update the physics engine
-		// TODO
+		// Move the dynamic bodies and count the physics steps to take
+		PhysicsEngine::update(deltaTime);
 
 		// Start an update traversal of all SceneGrapNode/GameObjects in the game
 		GameObject::update(deltaTime);
@@ -295,23 +314,138 @@ void Game::updateGame()
 	// Add pending, delete removed, and reparent GameObjects in the game.
 	GameObject::UpdateSceneGraph();
 
+	// Step the physics world while the frame is rendered
+	PhysicsEngine::startSimulation();
+
 } // end updateGame()
 
 void Game::renderScene()
 {
-	// Clear the color and depth buffers
+	// Swap in any shader programs that were rebuilt since the last frame
+	ShaderHotReload::update();
+
+	glm::ivec2 windowDimensions = getWindowDimensions();
+
+	// Clear the parts of the window that no camera covers. Each camera clears
+	// its own viewport.
 	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-	// TEMPORARY: NO longer necessary once CamearaComponent is fully implemented
-	mat4 viewingTrans = glm::lookAt(vec3(0.0f, 0.0f, 25.0f), vec3(0.0f, 0.0f, 0.0f),vec3(0.0f, 1.0f, 0.0f));
-	SharedTransformations::setViewMatrix(viewingTrans);
+	// Cameras in order of increasing depth, so deeper cameras render on top
+	std::vector<std::shared_ptr<CameraComponent>> cameras = CameraComponent::GetActiveCameras();
+
+	cameras.erase(std::remove_if(cameras.begin(), cameras.end(), [](const std::shared_ptr<CameraComponent>& camera) {
+		return camera->owningGameObject->getState() != ACTIVE;
+	}), cameras.end());
+
+	// Cameras that render into textures go first so the window shows this frame's images
+	std::stable_partition(cameras.begin(), cameras.end(), [](const std::shared_ptr<CameraComponent>& camera) {
+		return camera->getRenderTarget() != nullptr;
+	});
+
+	if (cameras.empty()) {
+
+		RenderTargetPool::endFrame();
+		glfwSwapBuffers(renderWindow);
+		return;
+	}
+
+	for (auto& camera : cameras) {
+		camera->updateMatrices(windowDimensions);
+	}
+
+	// Work that is done once per frame uses the window camera with the lowest depth
+	auto firstWindowCamera = std::find_if(cameras.begin(), cameras.end(), [](const std::shared_ptr<CameraComponent>& camera) {
+		return camera->getRenderTarget() == nullptr;
+	});
+
+	const CameraComponent& mainCamera = firstWindowCamera != cameras.end() ? **firstWindowCamera : *cameras.front();
+
+	SharedTransformations::setProjectionMatrix(mainCamera.getProjectionMatrix());
+	SharedTransformations::setViewMatrix(mainCamera.getViewMatrix());
+
+	// Determine which virtual texture pages are visible and stream them in
+	glm::ivec4 mainViewport = mainCamera.getViewportPixels();
+	VirtualTexture::renderFeedback(glm::ivec2(mainViewport.z, mainViewport.w));
+	VirtualTexture::updatePageCaches();
+
+	// Give the most influential lights a slot in the light block
+	LightComponent::updateLights(mainCamera.getEyePosition());
+
+	// Send the lights that changed since the last frame to the GPU
+	SharedLighting::uploadChangedLights();
+
+	// The queue is built once and culled separately for each camera
+	RenderQueue::build();
 
-	// Render the Scene ...
-	for (auto & mesh : MeshComponent::GetMeshComponents()) {
+	// Render the shadow maps of the lights that cast shadows. The atlas is fit to
+	// the main camera once per frame and sampled by every camera, so the cached
+	// static tiles stay valid from frame to frame.
+	ShadowMapping::update(mainCamera.getViewMatrix(), mainCamera.getProjectionMatrix(), windowDimensions);
 
-		mesh->draw();
+	// The Hi-Z pyramid is built from the depth of the whole window, so only a
+	// main camera that covers the window is occlusion culled
+	bool mainOcclusionCulling = mainCamera.coversWindow();
+
+	// Find the hidden meshes before the draw objects are flagged with them
+	if (mainOcclusionCulling) {
+		OcclusionCulling::beginFrame(mainCamera.getViewProjectionMatrix());
 	}
 
+	// Sort the opaque indexed sub-meshes into buckets once for all cameras
+	GPUDrivenRenderer::prepare();
+
+	std::unordered_set<const MeshComponent*> hiddenMeshes;
+
+	for (size_t i = 0; i < cameras.size(); i++) {
+
+		CameraComponent& camera = *cameras[i];
+		const mat4& viewProjection = camera.getViewProjectionMatrix();
+
+		// Bin the point and spot lights into the clusters of the view volume
+		ClusteredLighting::update(camera.getViewMatrix(), camera.getProjectionMatrix(), camera.getViewportPixels());
+
+		// Set the viewport and transformations of the camera and clear its viewport
+		camera.setCameraTransformations();
+
+		bool occlusionCulling = mainOcclusionCulling && &camera == &mainCamera;
+
+		// Lay down the depth of the meshes that are not occluded
+		if (occlusionCulling) {
+			OcclusionCulling::renderDepthPrePass(viewProjection);
+		}
+
+		// Draw the opaque indexed sub-meshes with one multi-draw call per bucket
+		GPUDrivenRenderer::render(viewProjection, occlusionCulling);
+
+		// Render the rest of the Scene ...
+		RenderQueue::findHiddenMeshes(viewProjection, hiddenMeshes);
+
+		for (auto & mesh : MeshComponent::GetMeshComponents()) {
+
+			if (hiddenMeshes.count(mesh.get()) > 0 || (occlusionCulling && OcclusionCulling::isOccluded(mesh.get()))) {
+				continue;
+			}
+
+			mesh->draw();
+		}
+
+		// Build the Hi-Z pyramid for the occlusion tests of the next frame
+		if (occlusionCulling) {
+			OcclusionCulling::endFrame(viewProjection, windowDimensions);
+		}
+
+		// Go back to the window and build the mip levels of the texture
+		if (camera.getRenderTarget()) {
+			camera.getRenderTarget()->end();
+		}
+	}
+
+	// Free the pooled textures that are no longer used and gather the frame's statistics
+	RenderTargetPool::endFrame();
+
+	// Keep the loaded textures within the texture memory budget
+	Texture::updateResidency();
+
 	// Swap the front and back buffers
 	glfwSwapBuffers(renderWindow);
 
@@ -321,6 +455,26 @@ void Game::renderScene()
 
 void Game::shutdown()
 {
+	// Delete all texture objects while the context still exists
+	Texture::unloadTextures();
+	VirtualTexture::unloadVirtualTextures();
+	TerrainComponent::unloadTerrains();
+	PhysicsEngine::unload();
+	ClusteredLighting::unload();
+	ShadowMapping::unload();
+	OcclusionCulling::unload();
+	GPUDrivenRenderer::unload();
+	RenderTarget::unloadRenderTargets();
+	RenderTargetPool::unload();
+	GeometryArena::unload();
+	RenderQueue::unload();
+
+	// Stop rebuilding shader programs before the shared context is destroyed
+	ShaderHotReload::stop();
+
+	// Join the worker threads
+	ThreadPool::unload();
+
 	// Destroy the window
 	glfwDestroyWindow(renderWindow);
 
@@ -362,16 +516,10 @@ void Game::window_close_callback(GLFWwindow* window)
 
 void Game::framebuffer_size_callback(GLFWwindow* window, int width, int height)
 {
-	// TEMPORARY: NO longer necessary once CamearaComponent is fully implemented
-	// Set parameters for the window transformation ...
+	// Cameras set their own viewports each frame and recompute their projections
+	// when the size of their viewports change
 	glViewport(0, 0, width, height);
 
-	// TEMPORARY: NO longer necessary once CamearaComponent is fully implemented
-	// Set the projection transformation ...
-	mat4 perspectProjection = glm::perspective(PI / 6.0f, (float)width / height, 1.0f, 1000.f);
-	//glUniformMatrix4fv(1001, 1, GL_FALSE, glm::value_ptr(perspectProjection));
-	SharedTransformations::setProjectionMatrix(perspectProjection);
-
 } // end framebuffer_size_callback
 
 //********************* static function definitions *****************************************
@@ -1,13 +1,27 @@
 #pragma once
 
+// Worker threads
+#include "ThreadPool.h"
+
 // Shader program building
 #include "BuildShaderProgram.h"
+#include "ShaderHotReload.h"
 #include "Texture.h"
+#include "VirtualTexture.h"
 
 // Shared Uniform Blocks
 #include "SharedMaterials.h"
 #include "SharedTransformations.h"
 #include "SharedLighting.h"
+#include "ClusteredLighting.h"
+
+// Rendering passes
+#include "GeometryArena.h"
+#include "RenderQueue.h"
+#include "ShadowMapping.h"
+#include "OcclusionCulling.h"
+#include "GPUDrivenRenderer.h"
+#include "RenderTarget.h"
 
 // Component container
 #include "GameObject.h"
@@ -23,6 +37,7 @@
 //#include "ModelMakerComponent.h"
 
 // Lights
+#include "LightComponent.h"
 //#include "DirectionalLightComponent.h"
 //#include "SpotLightComponent.h"
 //#include "PositionalLightComponent.h"
@@ -32,6 +47,12 @@
 #include "CylinderMeshComponent.h"
 #include "ModelMeshComponent.h"
 #include "BoxMeshComponent.h"
+#include "IcosphereMeshComponent.h"
+#include "CapsuleMeshComponent.h"
+#include "TorusMeshComponent.h"
+#include "PlaneMeshComponent.h"
+#include "HeightfieldMeshComponent.h"
+#include "TerrainComponent.h"
 //#include "TinyObjModelMakerComponent.h"
 
 // Movement and Control
@@ -44,7 +65,9 @@
 //#include "SpinComponent.h"
 
 // Physics
-//#include "RigidBodyComponent.h"
+#include "PhysicsEngine.h"
+#include "RigidBodyComponent.h"
+#include "SceneQuery.h"
 
 // Sound
 //#include "SoundEngine.h"
@@ -3,6 +3,7 @@
 #include "Component.h"
 #include "MeshComponent.h"
 #include "CameraComponent.h"
+#include "LightComponent.h"
 #include "Game.h"
 
 static const bool VERBOSE = false;
@@ -141,6 +142,12 @@ void GameObject::addComponent(std::shared_ptr<Component> component)
 		CameraComponent::addCamera(std::static_pointer_cast<CameraComponent>(component));
 	}
 
+	if (component->getComponentType() == LIGHT) {
+
+		// Add the light to the lights that compete for light slots
+		LightComponent::addLight(std::static_pointer_cast<LightComponent>(component));
+	}
+
 } // end addComponent
 
 
@@ -167,6 +174,12 @@ void GameObject::removeComponent(std::shared_ptr< Component> component)
 			CameraComponent::removeCamera(std::static_pointer_cast<CameraComponent>(component));
 		}
 
+		if (component->getComponentType() == LIGHT) {
+
+			// Free the light slot used by the light
+			LightComponent::removeLight(std::static_pointer_cast<LightComponent>(component));
+		}
+
 		std::iter_swap(iter, components.end() - 1);
 		components.pop_back();
 	}
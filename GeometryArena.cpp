@@ -0,0 +1,469 @@
+#include "GeometryArena.h"
+
+#include <algorithm>
+#include <cstddef>
+
+#include "MeshComponent.h"
+
+static const bool VERBOSE = false;
+
+// Static variable definitions (Static variables must be defined outside the declaration)
+std::vector<GeometryAllocation> GeometryArena::allocations;
+std::vector<GLuint> GeometryArena::freeHandles;
+GeometryArena::FreeList GeometryArena::vertexSpace;
+GeometryArena::FreeList GeometryArena::indexSpace;
+GpuBuffer GeometryArena::vertexBuffer;
+GpuBuffer GeometryArena::positionBuffer;
+GpuBuffer GeometryArena::indexBuffer;
+GpuVertexArray GeometryArena::pntVertexArray;
+GpuVertexArray GeometryArena::positionVertexArray;
+int GeometryArena::growths = 0;
+int GeometryArena::compactions = 0;
+
+
+bool GeometryArena::FreeList::allocate(GLuint count, GLuint& offset)
+{
+	auto best = freeBlocks.end();
+
+	for (auto block = freeBlocks.begin(); block != freeBlocks.end(); ++block) {
+
+		if (block->second >= count && (best == freeBlocks.end() || block->second < best->second)) {
+			best = block;
+		}
+	}
+
+	if (best == freeBlocks.end()) {
+		return false;
+	}
+
+	offset = best->first;
+	GLuint remaining = best->second - count;
+
+	freeBlocks.erase(best);
+
+	if (remaining > 0) {
+		freeBlocks[offset + count] = remaining;
+	}
+
+	used += count;
+
+	return true;
+
+} // end FreeList::allocate
+
+
+void GeometryArena::FreeList::release(GLuint offset, GLuint count)
+{
+	used -= count;
+
+	auto next = freeBlocks.lower_bound(offset);
+
+	// Merge with the block that starts where the range ends
+	if (next != freeBlocks.end() && offset + count == next->first) {
+
+		count += next->second;
+		next = freeBlocks.erase(next);
+	}
+
+	// Merge with the block that ends where the range starts
+	if (next != freeBlocks.begin()) {
+
+		auto previous = std::prev(next);
+
+		if (previous->first + previous->second == offset) {
+
+			previous->second += count;
+			return;
+		}
+	}
+
+	freeBlocks[offset] = count;
+
+} // end FreeList::release
+
+
+void GeometryArena::FreeList::grow(GLuint newCapacity)
+{
+	GLuint oldCapacity = capacity;
+
+	if (newCapacity <= oldCapacity) {
+		return;
+	}
+
+	capacity = newCapacity;
+
+	// Counted as used until released so that release can merge it
+	used += newCapacity - oldCapacity;
+	release(oldCapacity, newCapacity - oldCapacity);
+
+} // end FreeList::grow
+
+
+GLuint GeometryArena::FreeList::largestBlock() const
+{
+	GLuint largest = 0;
+
+	for (const auto& block : freeBlocks) {
+		largest = std::max(largest, block.second);
+	}
+
+	return largest;
+
+} // end FreeList::largestBlock
+
+
+float GeometryArena::FreeList::fragmentation() const
+{
+	GLuint free = capacity - used;
+
+	return free > 0 ? 1.0f - static_cast<float>(largestBlock()) / free : 0.0f;
+
+} // end FreeList::fragmentation
+
+
+void GeometryArena::initialize()
+{
+	// Full vertices
+	pntVertexArray = GpuVertexArray::create();
+	GLuint pntVao = pntVertexArray.get();
+
+	glVertexArrayAttribFormat(pntVao, 0, 4, GL_FLOAT, GL_FALSE, offsetof(pntVertexData, m_pos));
+	glVertexArrayAttribFormat(pntVao, 1, 3, GL_FLOAT, GL_FALSE, offsetof(pntVertexData, m_normal));
+	glVertexArrayAttribFormat(pntVao, 2, 2, GL_FLOAT, GL_FALSE, offsetof(pntVertexData, m_textCoord));
+	glVertexArrayAttribFormat(pntVao, 3, 3, GL_FLOAT, GL_FALSE, offsetof(pntVertexData, m_tangent));
+	glVertexArrayAttribFormat(pntVao, 4, 3, GL_FLOAT, GL_FALSE, offsetof(pntVertexData, m_bitangent));
+
+	for (GLuint attribute = 0; attribute < 5; attribute++) {
+
+		glVertexArrayAttribBinding(pntVao, attribute, 0);
+		glEnableVertexArrayAttrib(pntVao, attribute);
+	}
+
+	// Tightly packed positions for passes that only need depth. The w coordinate defaults to 1.
+	positionVertexArray = GpuVertexArray::create();
+	GLuint positionVao = positionVertexArray.get();
+
+	glVertexArrayAttribFormat(positionVao, 0, 3, GL_FLOAT, GL_FALSE, 0);
+	glVertexArrayAttribBinding(positionVao, 0, 0);
+	glEnableVertexArrayAttrib(positionVao, 0);
+
+	reallocate(INITIAL_ARENA_VERTICES, INITIAL_ARENA_INDICES, false);
+
+} // end initialize
+
+
+void GeometryArena::reallocate(GLuint newVertexCapacity, GLuint newIndexCapacity, bool compactRanges)
+{
+	GpuBuffer newVertexBuffer = GpuBuffer::create();
+	GpuBuffer newPositionBuffer = GpuBuffer::create();
+	GpuBuffer newIndexBuffer = GpuBuffer::create();
+
+	// Immutable storage. Ranges are written with glNamedBufferSubData.
+	glNamedBufferStorage(newVertexBuffer.get(), static_cast<GLsizeiptr>(newVertexCapacity) * sizeof(pntVertexData), nullptr, GL_DYNAMIC_STORAGE_BIT);
+	glNamedBufferStorage(newPositionBuffer.get(), static_cast<GLsizeiptr>(newVertexCapacity) * sizeof(glm::vec3), nullptr, GL_DYNAMIC_STORAGE_BIT);
+	glNamedBufferStorage(newIndexBuffer.get(), static_cast<GLsizeiptr>(newIndexCapacity) * sizeof(GLuint), nullptr, GL_DYNAMIC_STORAGE_BIT);
+
+	if (compactRanges) {
+
+		vertexSpace = FreeList();
+		indexSpace = FreeList();
+	}
+
+	// Copy the ranges in use, in order of their offsets when compacting
+	std::vector<GeometryAllocation*> inUse;
+
+	for (GeometryAllocation& allocation : allocations) {
+
+		if (allocation.inUse) {
+			inUse.push_back(&allocation);
+		}
+	}
+
+	std::sort(inUse.begin(), inUse.end(), [](const GeometryAllocation* a, const GeometryAllocation* b) {
+		return a->baseVertex < b->baseVertex;
+	});
+
+	for (GeometryAllocation* allocation : inUse) {
+
+		GLuint baseVertex = allocation->baseVertex;
+		GLuint firstIndex = allocation->firstIndex;
+
+		if (compactRanges) {
+
+			baseVertex = vertexSpace.capacity;
+			vertexSpace.capacity += allocation->vertexCount;
+			vertexSpace.used += allocation->vertexCount;
+
+			firstIndex = indexSpace.capacity;
+			indexSpace.capacity += allocation->indexCount;
+			indexSpace.used += allocation->indexCount;
+		}
+
+		glCopyNamedBufferSubData(vertexBuffer.get(), newVertexBuffer.get(),
+								 static_cast<GLintptr>(allocation->baseVertex) * sizeof(pntVertexData),
+								 static_cast<GLintptr>(baseVertex) * sizeof(pntVertexData),
+								 static_cast<GLsizeiptr>(allocation->vertexCount) * sizeof(pntVertexData));
+
+		glCopyNamedBufferSubData(positionBuffer.get(), newPositionBuffer.get(),
+								 static_cast<GLintptr>(allocation->baseVertex) * sizeof(glm::vec3),
+								 static_cast<GLintptr>(baseVertex) * sizeof(glm::vec3),
+								 static_cast<GLsizeiptr>(allocation->vertexCount) * sizeof(glm::vec3));
+
+		if (allocation->indexCount > 0) {
+
+			glCopyNamedBufferSubData(indexBuffer.get(), newIndexBuffer.get(),
+									 static_cast<GLintptr>(allocation->firstIndex) * sizeof(GLuint),
+									 static_cast<GLintptr>(firstIndex) * sizeof(GLuint),
+									 static_cast<GLsizeiptr>(allocation->indexCount) * sizeof(GLuint));
+		}
+
+		allocation->baseVertex = baseVertex;
+		allocation->firstIndex = firstIndex;
+	}
+
+	// The rest of the new buffers is free
+	vertexSpace.grow(newVertexCapacity);
+	indexSpace.grow(newIndexCapacity);
+
+	// The old buffers are deleted as they are replaced
+	vertexBuffer = newVertexBuffer;
+	positionBuffer = newPositionBuffer;
+	indexBuffer = newIndexBuffer;
+
+	glVertexArrayVertexBuffer(pntVertexArray.get(), 0, vertexBuffer.get(), 0, sizeof(pntVertexData));
+	glVertexArrayElementBuffer(pntVertexArray.get(), indexBuffer.get());
+
+	glVertexArrayVertexBuffer(positionVertexArray.get(), 0, positionBuffer.get(), 0, sizeof(glm::vec3));
+	glVertexArrayElementBuffer(positionVertexArray.get(), indexBuffer.get());
+
+	if (VERBOSE) cout << "Geometry arena " << (compactRanges ? "compacted" : "resized") << " to "
+		<< newVertexCapacity << " vertices and " << newIndexCapacity << " indices" << endl;
+
+} // end reallocate
+
+
+GLuint GeometryArena::allocate(const std::vector<pntVertexData>& vertexData, const std::vector<unsigned int>& indices)
+{
+	if (vertexData.empty()) {
+		return 0;
+	}
+
+	if (!pntVertexArray) {
+		initialize();
+	}
+
+	GeometryAllocation allocation;
+	allocation.vertexCount = static_cast<GLuint>(vertexData.size());
+	allocation.indexCount = static_cast<GLuint>(indices.size());
+	allocation.inUse = true;
+
+	GLuint freeVertices = vertexSpace.capacity - vertexSpace.used;
+	GLuint freeIndices = indexSpace.capacity - indexSpace.used;
+
+	bool fits = vertexSpace.largestBlock() >= allocation.vertexCount && indexSpace.largestBlock() >= allocation.indexCount;
+
+	if (!fits) {
+
+		if (freeVertices >= allocation.vertexCount && freeIndices >= allocation.indexCount) {
+
+			// There is room once the free space is in one block
+			compact();
+		}
+		else {
+
+			// Grow the buffers, at least doubling them. The new space at the end
+			// always holds the allocation.
+			GLuint vertexCapacity = std::max(2 * vertexSpace.capacity, vertexSpace.capacity + allocation.vertexCount);
+			GLuint indexCapacity = std::max(2 * indexSpace.capacity, indexSpace.capacity + allocation.indexCount);
+
+			reallocate(vertexCapacity, indexCapacity, false);
+			growths++;
+		}
+	}
+
+	vertexSpace.allocate(allocation.vertexCount, allocation.baseVertex);
+
+	if (allocation.indexCount > 0) {
+		indexSpace.allocate(allocation.indexCount, allocation.firstIndex);
+	}
+
+	// Write the vertices in both formats
+	std::vector<glm::vec3> positions(vertexData.size());
+
+	for (size_t i = 0; i < vertexData.size(); i++) {
+		positions[i] = glm::vec3(vertexData[i].m_pos);
+	}
+
+	glNamedBufferSubData(vertexBuffer.get(), static_cast<GLintptr>(allocation.baseVertex) * sizeof(pntVertexData),
+						 vertexData.size() * sizeof(pntVertexData), vertexData.data());
+
+	glNamedBufferSubData(positionBuffer.get(), static_cast<GLintptr>(allocation.baseVertex) * sizeof(glm::vec3),
+						 positions.size() * sizeof(glm::vec3), positions.data());
+
+	if (allocation.indexCount > 0) {
+
+		glNamedBufferSubData(indexBuffer.get(), static_cast<GLintptr>(allocation.firstIndex) * sizeof(GLuint),
+							 indices.size() * sizeof(GLuint), indices.data());
+	}
+
+	// Reuse a released handle if there is one
+	GLuint handle;
+
+	if (!freeHandles.empty()) {
+
+		handle = freeHandles.back();
+		freeHandles.pop_back();
+		allocations[handle - 1] = allocation;
+	}
+	else {
+
+		allocations.push_back(allocation);
+		handle = static_cast<GLuint>(allocations.size());
+	}
+
+	return handle;
+
+} // end allocate
+
+
+void GeometryArena::release(GLuint handle)
+{
+	if (handle == 0 || handle > allocations.size() || !allocations[handle - 1].inUse) {
+		return;
+	}
+
+	GeometryAllocation& allocation = allocations[handle - 1];
+
+	vertexSpace.release(allocation.baseVertex, allocation.vertexCount);
+
+	if (allocation.indexCount > 0) {
+		indexSpace.release(allocation.firstIndex, allocation.indexCount);
+	}
+
+	allocation = GeometryAllocation();
+	freeHandles.push_back(handle);
+
+	// Move the ranges together once the free space is broken up
+	if (vertexSpace.fragmentation() > ARENA_COMPACTION_THRESHOLD || indexSpace.fragmentation() > ARENA_COMPACTION_THRESHOLD) {
+		compact();
+	}
+
+} // end release
+
+
+const GeometryAllocation& GeometryArena::getAllocation(GLuint handle)
+{
+	static const GeometryAllocation none;
+
+	if (handle == 0 || handle > allocations.size()) {
+		return none;
+	}
+
+	return allocations[handle - 1];
+
+} // end getAllocation
+
+
+GLuint GeometryArena::getVertexArray(VERTEX_FORMAT format)
+{
+	if (!pntVertexArray) {
+		initialize();
+	}
+
+	return format == POSITION_VERTEX_FORMAT ? positionVertexArray.get() : pntVertexArray.get();
+
+} // end getVertexArray
+
+
+void GeometryArena::draw(GLuint handle, GLenum primitiveMode)
+{
+	const GeometryAllocation& allocation = getAllocation(handle);
+
+	if (allocation.indexCount > 0) {
+
+		// Trigger vertex fetch for indexed rendering
+		glDrawElementsBaseVertex(primitiveMode, allocation.indexCount, GL_UNSIGNED_INT,
+								 reinterpret_cast<const void*>(static_cast<size_t>(allocation.firstIndex) * sizeof(GLuint)),
+								 static_cast<GLint>(allocation.baseVertex));
+	}
+	else if (allocation.vertexCount > 0) {
+
+		// Trigger vertex fetch for ordered rendering
+		glDrawArrays(primitiveMode, static_cast<GLint>(allocation.baseVertex), allocation.vertexCount);
+	}
+
+} // end draw
+
+
+void GeometryArena::compact()
+{
+	if (!pntVertexArray) {
+		return;
+	}
+
+	reallocate(vertexSpace.capacity, indexSpace.capacity, true);
+	compactions++;
+
+} // end compact
+
+
+GeometryArenaStats GeometryArena::getStats()
+{
+	GeometryArenaStats stats;
+
+	stats.vertexCapacity = vertexSpace.capacity;
+	stats.verticesUsed = vertexSpace.used;
+	stats.vertexFreeBlocks = static_cast<GLuint>(vertexSpace.freeBlocks.size());
+	stats.largestFreeVertexBlock = vertexSpace.largestBlock();
+
+	stats.indexCapacity = indexSpace.capacity;
+	stats.indicesUsed = indexSpace.used;
+	stats.indexFreeBlocks = static_cast<GLuint>(indexSpace.freeBlocks.size());
+	stats.largestFreeIndexBlock = indexSpace.largestBlock();
+
+	stats.allocations = static_cast<int>(allocations.size() - freeHandles.size());
+	stats.growths = growths;
+	stats.compactions = compactions;
+
+	stats.vertexFragmentation = vertexSpace.fragmentation();
+	stats.indexFragmentation = indexSpace.fragmentation();
+
+	return stats;
+
+} // end getStats
+
+
+void GeometryArena::printStats()
+{
+	GeometryArenaStats stats = getStats();
+
+	auto percent = [](GLuint part, GLuint whole) { return whole > 0 ? 100.0f * part / whole : 0.0f; };
+
+	cout << "Geometry arena: " << stats.allocations << " allocations, "
+		<< stats.verticesUsed << " of " << stats.vertexCapacity << " vertices ("
+		<< percent(stats.verticesUsed, stats.vertexCapacity) << "%) in use, "
+		<< stats.indicesUsed << " of " << stats.indexCapacity << " indices ("
+		<< percent(stats.indicesUsed, stats.indexCapacity) << "%) in use" << endl;
+
+	cout << "\tFree blocks: " << stats.vertexFreeBlocks << " vertex (fragmentation "
+		<< stats.vertexFragmentation * 100.0f << "%), " << stats.indexFreeBlocks << " index (fragmentation "
+		<< stats.indexFragmentation * 100.0f << "%). Grown " << stats.growths << " times, compacted "
+		<< stats.compactions << " times" << endl;
+
+} // end printStats
+
+
+void GeometryArena::unload()
+{
+	pntVertexArray.reset();
+	positionVertexArray.reset();
+	vertexBuffer.reset();
+	positionBuffer.reset();
+	indexBuffer.reset();
+
+	allocations.clear();
+	freeHandles.clear();
+	vertexSpace = FreeList();
+	indexSpace = FreeList();
+
+} // end unload
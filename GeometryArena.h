@@ -0,0 +1,238 @@
+#pragma once
+
+#include <map>
+
+#include "MathLibsConstsFuncs.h"
+#include "GpuResource.h"
+
+using namespace constants_and_types;
+
+struct pntVertexData;
+
+/**
+ * @enum	VERTEX_FORMAT
+ *
+ * @brief	Vertex formats stored by the GeometryArena. Every allocation has its
+ * 			vertices in both formats at the same base vertex.
+ */
+enum VERTEX_FORMAT { PNT_VERTEX_FORMAT = 0, POSITION_VERTEX_FORMAT };
+
+// Initial capacities of the shared buffers in vertices and indices
+static const GLuint INITIAL_ARENA_VERTICES = 1 << 18;
+static const GLuint INITIAL_ARENA_INDICES = 1 << 20;
+
+// The arena is compacted when a range is released and the largest free block
+// is less than this fraction of the free space
+static const float ARENA_COMPACTION_THRESHOLD = 0.5f;
+
+/**
+ * @struct	GeometryAllocation
+ *
+ * @brief	Vertex and index ranges of one sub-mesh in the shared buffers.
+ */
+struct GeometryAllocation {
+
+	// First vertex of the range. Added to every index when drawing.
+	GLuint baseVertex = 0;
+	GLuint vertexCount = 0;
+
+	// First index of the range. Zero indices if the sub-mesh is not indexed.
+	GLuint firstIndex = 0;
+	GLuint indexCount = 0;
+
+	bool inUse = false;
+};
+
+/**
+ * @struct	GeometryArenaStats
+ *
+ * @brief	Utilization and fragmentation of the shared buffers.
+ */
+struct GeometryArenaStats {
+
+	GLuint vertexCapacity = 0;
+	GLuint verticesUsed = 0;
+	GLuint vertexFreeBlocks = 0;
+	GLuint largestFreeVertexBlock = 0;
+
+	GLuint indexCapacity = 0;
+	GLuint indicesUsed = 0;
+	GLuint indexFreeBlocks = 0;
+	GLuint largestFreeIndexBlock = 0;
+
+	// Live allocations
+	int allocations = 0;
+
+	// Times the buffers were grown or compacted since the game started
+	int growths = 0;
+	int compactions = 0;
+
+	// Fraction of the free space that is not in the largest free block (zero
+	// when all free space is contiguous)
+	float vertexFragmentation = 0.0f;
+	float indexFragmentation = 0.0f;
+};
+
+/**
+ * @class	GeometryArena
+ *
+ * @brief	Suballocates the vertices and indices of all sub-meshes from a few
+ * 			large buffers with immutable storage: one vertex buffer per
+ * 			VERTEX_FORMAT and one index buffer. There is one vertex array object
+ * 			per format, so sub-meshes are drawn without binding a vertex array
+ * 			object each, using their base vertex and first index instead.
+ *
+ * 			Sub-meshes refer to their ranges through a handle. Free ranges are kept
+ * 			in a free list and merged with their neighbors when released. When the
+ * 			free space becomes fragmented the ranges in use are moved to the front
+ * 			of new buffers and their handles updated, so sub-meshes never hold
+ * 			offsets that can go stale. The buffers grow when an allocation does not
+ * 			fit.
+ */
+class GeometryArena
+{
+public:
+
+	/**
+	 * @fn	static GLuint GeometryArena::allocate(const std::vector<pntVertexData>& vertexData, const std::vector<unsigned int>& indices);
+	 *
+	 * @brief	Copies vertices and, for indexed sub-meshes, indices into the shared
+	 * 			buffers. Indices are relative to the first vertex of the range.
+	 *
+	 * @param	vertexData	The vertices.
+	 * @param	indices   	The indices. Empty for sequential rendering.
+	 *
+	 * @returns	Handle of the ranges. Zero if the vertex data is empty.
+	 */
+	static GLuint allocate(const std::vector<pntVertexData>& vertexData, const std::vector<unsigned int>& indices);
+
+	/**
+	 * @fn	static void GeometryArena::release(GLuint handle);
+	 *
+	 * @brief	Frees the ranges of a handle. The arena may be compacted.
+	 */
+	static void release(GLuint handle);
+
+	/**
+	 * @fn	static const GeometryAllocation& GeometryArena::getAllocation(GLuint handle);
+	 *
+	 * @brief	Gets the current ranges of a handle.
+	 */
+	static const GeometryAllocation& getAllocation(GLuint handle);
+
+	/**
+	 * @fn	static GLuint GeometryArena::getVertexArray(VERTEX_FORMAT format);
+	 *
+	 * @brief	Gets the vertex array object that reads a vertex format and the shared
+	 * 			index buffer.
+	 */
+	static GLuint getVertexArray(VERTEX_FORMAT format);
+
+	/**
+	 * @fn	static void GeometryArena::draw(GLuint handle, GLenum primitiveMode);
+	 *
+	 * @brief	Draws the ranges of a handle. The vertex array object of a format must
+	 * 			be bound.
+	 *
+	 * @param	handle		 	Handle of the ranges.
+	 * @param	primitiveMode	The primitive mode.
+	 */
+	static void draw(GLuint handle, GLenum primitiveMode);
+
+	/**
+	 * @fn	static void GeometryArena::compact();
+	 *
+	 * @brief	Moves the ranges in use to the front of the buffers, leaving all free
+	 * 			space in one block at the end.
+	 */
+	static void compact();
+
+	/**
+	 * @fn	static GeometryArenaStats GeometryArena::getStats();
+	 *
+	 * @brief	Gets the utilization and fragmentation of the buffers.
+	 */
+	static GeometryArenaStats getStats();
+
+	/**
+	 * @fn	static void GeometryArena::printStats();
+	 *
+	 * @brief	Prints the utilization and fragmentation of the buffers.
+	 */
+	static void printStats();
+
+	/**
+	 * @fn	static void GeometryArena::unload();
+	 *
+	 * @brief	Deletes the buffers and vertex array objects. All handles become invalid.
+	 */
+	static void unload();
+
+protected:
+
+	/**
+	 * @struct	FreeList
+	 *
+	 * @brief	Free ranges of one buffer in elements, ordered by offset.
+	 */
+	struct FreeList {
+
+		// Size of each free block by offset
+		std::map<GLuint, GLuint> freeBlocks;
+
+		GLuint capacity = 0;
+		GLuint used = 0;
+
+		// Takes the smallest free block the range fits in. False if none is large enough.
+		bool allocate(GLuint count, GLuint& offset);
+
+		// Returns a range and merges it with the free blocks next to it
+		void release(GLuint offset, GLuint count);
+
+		// Adds the space between the old and new capacity at the end
+		void grow(GLuint newCapacity);
+
+		// Size of the largest free block
+		GLuint largestBlock() const;
+
+		// Fraction of the free space outside the largest free block
+		float fragmentation() const;
+	};
+
+	/**
+	 * @fn	static void GeometryArena::initialize();
+	 *
+	 * @brief	Creates the buffers and vertex array objects.
+	 */
+	static void initialize();
+
+	/**
+	 * @fn	static void GeometryArena::reallocate(GLuint newVertexCapacity, GLuint newIndexCapacity, bool compactRanges);
+	 *
+	 * @brief	Replaces the buffers with buffers of new capacities. The ranges in use
+	 * 			either keep their offsets or are moved to the front.
+	 */
+	static void reallocate(GLuint newVertexCapacity, GLuint newIndexCapacity, bool compactRanges);
+
+	/** @brief	Ranges of every handle. Handle n is at index n - 1. */
+	static std::vector<GeometryAllocation> allocations;
+
+	/** @brief	Handles that have been released and can be reused */
+	static std::vector<GLuint> freeHandles;
+
+	/** @brief	Free space of the vertex buffers (shared by all formats) and the index buffer */
+	static FreeList vertexSpace;
+	static FreeList indexSpace;
+
+	/** @brief	Shared buffers and the vertex array object of each format */
+	static GpuBuffer vertexBuffer;
+	static GpuBuffer positionBuffer;
+	static GpuBuffer indexBuffer;
+	static GpuVertexArray pntVertexArray;
+	static GpuVertexArray positionVertexArray;
+
+	/** @brief	Times the buffers were grown and compacted */
+	static int growths;
+	static int compactions;
+
+}; // end GeometryArena
@@ -0,0 +1,154 @@
+#pragma once
+
+#include <memory>
+
+#include "MathLibsConstsFuncs.h"
+
+using namespace constants_and_types;
+
+/**
+ * @enum	GPU_RESOURCE_TYPE
+ *
+ * @brief	Kinds of OpenGL objects that can be owned by a GpuResource.
+ */
+enum GPU_RESOURCE_TYPE { GPU_BUFFER, GPU_VERTEX_ARRAY, GPU_TEXTURE, GPU_PROGRAM, GPU_FRAMEBUFFER };
+
+/**
+ * @class	GpuResource
+ *
+ * @brief	Shared ownership of one OpenGL object. Copies of a GpuResource refer to
+ * 			the same object, which is deleted when the last copy is destroyed or
+ * 			reset. Resources that outlive the game must be reset before the OpenGL
+ * 			context is destroyed.
+ *
+ * @tparam	TYPE	Kind of OpenGL object.
+ */
+template <GPU_RESOURCE_TYPE TYPE>
+class GpuResource
+{
+public:
+
+	GpuResource() = default;
+
+	/**
+	 * @fn	static GpuResource GpuResource::create(GLenum target = GL_TEXTURE_2D)
+	 *
+	 * @brief	Creates a new OpenGL object.
+	 *
+	 * @param	target	Target of textures. Ignored for other kinds of objects.
+	 */
+	static GpuResource create(GLenum target = GL_TEXTURE_2D)
+	{
+		GLuint name = 0;
+
+		switch (TYPE) {
+
+		case GPU_BUFFER:
+			glCreateBuffers(1, &name);
+			break;
+		case GPU_VERTEX_ARRAY:
+			glCreateVertexArrays(1, &name);
+			break;
+		case GPU_TEXTURE:
+			glCreateTextures(target, 1, &name);
+			break;
+		case GPU_PROGRAM:
+			name = glCreateProgram();
+			break;
+		case GPU_FRAMEBUFFER:
+			glCreateFramebuffers(1, &name);
+			break;
+		}
+
+		return adopt(name);
+
+	} // end create
+
+	/**
+	 * @fn	static GpuResource GpuResource::adopt(GLuint name)
+	 *
+	 * @brief	Takes ownership of an OpenGL object that was created elsewhere.
+	 */
+	static GpuResource adopt(GLuint name)
+	{
+		GpuResource resource;
+
+		if (name != 0) {
+			resource.object = std::make_shared<const Object>(name);
+		}
+
+		return resource;
+
+	} // end adopt
+
+	/**
+	 * @fn	GLuint GpuResource::get() const
+	 *
+	 * @brief	Gets the name of the OpenGL object. Zero if there is none.
+	 */
+	GLuint get() const { return object ? object->name : 0; }
+
+	/**
+	 * @fn	void GpuResource::reset()
+	 *
+	 * @brief	Releases this reference. The object is deleted if it was the last one.
+	 */
+	void reset() { object.reset(); }
+
+	/**
+	 * @fn	long GpuResource::useCount() const
+	 *
+	 * @brief	Gets the number of GpuResources that refer to the object.
+	 */
+	long useCount() const { return object.use_count(); }
+
+	explicit operator bool() const { return object != nullptr; }
+
+protected:
+
+	/**
+	 * @struct	Object
+	 *
+	 * @brief	Deletes the OpenGL object when the last reference goes away.
+	 */
+	struct Object {
+
+		GLuint name;
+
+		explicit Object(GLuint name) : name(name) {}
+
+		Object(const Object&) = delete;
+		Object& operator=(const Object&) = delete;
+
+		~Object()
+		{
+			switch (TYPE) {
+
+			case GPU_BUFFER:
+				glDeleteBuffers(1, &name);
+				break;
+			case GPU_VERTEX_ARRAY:
+				glDeleteVertexArrays(1, &name);
+				break;
+			case GPU_TEXTURE:
+				glDeleteTextures(1, &name);
+				break;
+			case GPU_PROGRAM:
+				glDeleteProgram(name);
+				break;
+			case GPU_FRAMEBUFFER:
+				glDeleteFramebuffers(1, &name);
+				break;
+			}
+		}
+	};
+
+	std::shared_ptr<const Object> object;
+
+}; // end GpuResource
+
+typedef GpuResource<GPU_BUFFER> GpuBuffer;
+typedef GpuResource<GPU_VERTEX_ARRAY> GpuVertexArray;
+typedef GpuResource<GPU_TEXTURE> GpuTexture;
+typedef GpuResource<GPU_PROGRAM> GpuProgram;
+typedef GpuResource<GPU_FRAMEBUFFER> GpuFramebuffer;
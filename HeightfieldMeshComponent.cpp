@@ -0,0 +1,81 @@
+#include "HeightfieldMeshComponent.h"
+
+#include <algorithm>
+
+#include "ProceduralGeometry.h"
+
+
+HeightfieldMeshComponent::HeightfieldMeshComponent(GLuint shaderProgram, Material mat, std::vector<float> heights, int columns, int rows,
+												   float spacing, int chunkQuads, int updateOrder)
+	: ProceduralMeshComponent(shaderProgram, mat, updateOrder),
+	heights(std::make_shared<const std::vector<float>>(std::move(heights))),
+	columns(columns), rows(rows), spacing(spacing), chunkQuads(std::max(chunkQuads, 1))
+{
+	if (columns < 2 || rows < 2 || this->heights->size() < static_cast<size_t>(columns) * rows) {
+
+		std::cerr << "HeightfieldMeshComponent: " << columns << " x " << rows << " samples needed but "
+				  << this->heights->size() << " heights were given" << std::endl;
+
+		this->columns = this->rows = 0;
+	}
+
+	// Chunks at the far edges may be smaller
+	chunkColumns = this->columns > 1 ? (this->columns - 2) / this->chunkQuads + 1 : 0;
+	chunkRows = this->rows > 1 ? (this->rows - 2) / this->chunkQuads + 1 : 0;
+
+} // end HeightfieldMeshComponent constructor
+
+
+size_t HeightfieldMeshComponent::getGeometryKey() const
+{
+	std::vector<float> parameters = { static_cast<float>(columns), static_cast<float>(rows), spacing, static_cast<float>(chunkQuads) };
+	parameters.insert(parameters.end(), heights->begin(), heights->end());
+
+	return hashGeometry("Heightfield", parameters);
+}
+
+
+int HeightfieldMeshComponent::getSubMeshCount() const
+{
+	return chunkColumns * chunkRows;
+}
+
+
+void HeightfieldMeshComponent::generateGeometry(int subMeshIndex, std::vector<pntVertexData>& vertexData, std::vector<unsigned int>& indices) const
+{
+	int firstColumn = (subMeshIndex % chunkColumns) * chunkQuads;
+	int firstRow = (subMeshIndex / chunkColumns) * chunkQuads;
+
+	ProceduralGeometry::heightfield(*heights, columns, rows, spacing, firstColumn, firstRow,
+									std::min(chunkQuads, columns - 1 - firstColumn),
+									std::min(chunkQuads, rows - 1 - firstRow),
+									vertexData, indices);
+}
+
+
+std::shared_ptr<btCollisionShape> HeightfieldMeshComponent::createCollisionShape() const
+{
+	if (columns == 0) {
+		return nullptr;
+	}
+
+	auto range = std::minmax_element(heights->begin(), heights->end());
+	float minHeight = *range.first;
+	float maxHeight = *range.second;
+
+	btHeightfieldTerrainShape* terrainShape = new btHeightfieldTerrainShape(columns, rows, heights->data(), 1.0f,
+																			 minHeight, maxHeight, 1, PHY_FLOAT, false);
+
+	terrainShape->setLocalScaling(btVector3(spacing, 1.0f, spacing));
+
+	// The compound shape keeps the heights alive for as long as the terrain shape refers to them
+	std::shared_ptr<btCompoundShape> compoundShape = makeCompoundShape(heights);
+
+	btTransform offset;
+	offset.setIdentity();
+	offset.setOrigin(btVector3(0.0f, (minHeight + maxHeight) / 2.0f, 0.0f));
+
+	compoundShape->addChildShape(offset, terrainShape);
+
+	return compoundShape;
+}
@@ -0,0 +1,61 @@
+#pragma once
+#include "ProceduralMeshComponent.h"
+
+/**
+ * @class	HeightfieldMeshComponent
+ *
+ * @brief	Terrain made from a grid of height samples. The terrain is centered on
+ * 			the origin in the XZ plane and divided into square chunks of quads, one
+ * 			sub-mesh per chunk, so that the chunks that are out of view are culled.
+ */
+class HeightfieldMeshComponent : public ProceduralMeshComponent
+{
+public:
+
+	/**
+	 * @fn	HeightfieldMeshComponent::HeightfieldMeshComponent(GLuint shaderProgram, Material mat, std::vector<float> heights, int columns, int rows, float spacing = 1.0f, int chunkQuads = 64, int updateOrder = 100);
+	 *
+	 * @brief	Constructor
+	 *
+	 * @param 	shaderProgram	The shader program.
+	 * @param 	mat			 	The material.
+	 * @param 	heights		 	Heights of the samples by row (Z) then column (X).
+	 * @param 	columns		 	Samples along X. At least two.
+	 * @param 	rows		 	Samples along Z. At least two.
+	 * @param 	spacing		 	Distance between samples.
+	 * @param 	chunkQuads   	Quads along each side of a chunk.
+	 * @param 	updateOrder  	(Optional) The update order.
+	 */
+	HeightfieldMeshComponent(GLuint shaderProgram, Material mat, std::vector<float> heights, int columns, int rows,
+							 float spacing = 1.0f, int chunkQuads = 64, int updateOrder = 100);
+
+protected:
+
+	virtual size_t getGeometryKey() const override;
+
+	virtual int getSubMeshCount() const override;
+
+	virtual void generateGeometry(int subMeshIndex, std::vector<pntVertexData>& vertexData, std::vector<unsigned int>& indices) const override;
+
+	/**
+	 * @fn	virtual std::shared_ptr<btCollisionShape> HeightfieldMeshComponent::createCollisionShape() const override;
+	 *
+	 * @brief	Creates a btHeightfieldTerrainShape that refers to the same heights
+	 * 			as the mesh. Bullet centers the shape between the lowest and highest
+	 * 			samples, so it is offset to line up with the mesh.
+	 */
+	virtual std::shared_ptr<btCollisionShape> createCollisionShape() const override;
+
+	/** @brief	Heights of the samples. Shared with the collision shape, which does not copy them. */
+	std::shared_ptr<const std::vector<float>> heights;
+
+	int columns, rows;
+
+	float spacing;
+
+	int chunkQuads;
+
+	/** @brief	Number of chunks along X and Z */
+	int chunkColumns, chunkRows;
+
+}; // end HeightfieldMeshComponent
@@ -0,0 +1,27 @@
+#include "IcosphereMeshComponent.h"
+
+#include "ProceduralGeometry.h"
+
+
+IcosphereMeshComponent::IcosphereMeshComponent(GLuint shaderProgram, Material mat, float radius, int subdivisions, int updateOrder)
+	: ProceduralMeshComponent(shaderProgram, mat, updateOrder), radius(radius), subdivisions(subdivisions)
+{
+}
+
+
+size_t IcosphereMeshComponent::getGeometryKey() const
+{
+	return hashGeometry("Icosphere", { radius, static_cast<float>(subdivisions) });
+}
+
+
+void IcosphereMeshComponent::generateGeometry(int subMeshIndex, std::vector<pntVertexData>& vertexData, std::vector<unsigned int>& indices) const
+{
+	ProceduralGeometry::icosphere(radius, subdivisions, vertexData, indices);
+}
+
+
+std::shared_ptr<btCollisionShape> IcosphereMeshComponent::createCollisionShape() const
+{
+	return std::shared_ptr<btCollisionShape>(new btSphereShape(radius));
+}
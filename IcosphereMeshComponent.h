@@ -0,0 +1,27 @@
+#pragma once
+#include "ProceduralMeshComponent.h"
+
+/**
+ * @class	IcosphereMeshComponent
+ *
+ * @brief	Sphere made by subdividing an icosahedron. Its triangles are close to the
+ * 			same size all over the sphere, so it looks rounder than a
+ * 			SphereMeshComponent with the same number of triangles.
+ */
+class IcosphereMeshComponent : public ProceduralMeshComponent
+{
+public:
+	IcosphereMeshComponent(GLuint shaderProgram, Material mat, float radius = 1.0f, int subdivisions = 3, int updateOrder = 100);
+
+protected:
+
+	virtual size_t getGeometryKey() const override;
+
+	virtual void generateGeometry(int subMeshIndex, std::vector<pntVertexData>& vertexData, std::vector<unsigned int>& indices) const override;
+
+	virtual std::shared_ptr<btCollisionShape> createCollisionShape() const override;
+
+	float radius;
+	int subdivisions;
+
+}; // end IcosphereMeshComponent
@@ -0,0 +1,255 @@
+#include "LightComponent.h"
+
+static const bool VERBOSE = false;
+
+// Static variable definition (Static variables must be defined outside the declaration)
+std::vector<std::shared_ptr<LightComponent>> LightComponent::lightComps;
+
+
+LightComponent::LightComponent(LIGHT_TYPE lightType, int updateOrder)
+	: Component(updateOrder), lightType(lightType)
+{
+	componentType = LIGHT;
+
+} // end LightComponent constructor
+
+
+LightComponent::~LightComponent()
+{
+	releaseSlot();
+
+} // end ~LightComponent
+
+
+float LightComponent::getRange() const
+{
+	if (lightType == DIRECTIONAL_LIGHT) {
+		return POS_INFINITY;
+	}
+
+	// Brightest channel of the light
+	float intensity = 0.0f;
+
+	for (int i = 0; i < 3; i++) {
+		intensity = std::max({ intensity, ambientColor[i], diffuseColor[i], specularColor[i] });
+	}
+
+	// Solve quadratic * d^2 + linear * d + constant = intensity / cutoff for the distance d
+	float constant = attenuationFactors.x;
+	float linear = attenuationFactors.y;
+	float quadratic = attenuationFactors.z;
+	float limit = intensity / LIGHT_INFLUENCE_CUTOFF;
+
+	if (constant >= limit) {
+		return 0.0f;
+	}
+	else if (quadratic > 0.0f) {
+		return (-linear + std::sqrt(linear * linear - 4.0f * quadratic * (constant - limit))) / (2.0f * quadratic);
+	}
+	else if (linear > 0.0f) {
+		return (limit - constant) / linear;
+	}
+	else {
+		return POS_INFINITY;
+	}
+
+} // end getRange
+
+
+float LightComponent::getInfluence(const glm::vec3& eyePosition) const
+{
+	if (lightType == DIRECTIONAL_LIGHT) {
+		return POS_INFINITY;
+	}
+
+	// Lights without falloff are ranked by distance alone
+	float range = std::min(getRange(), 1.0e6f);
+	float distance = glm::length(owningGameObject->getPosition(WORLD) - eyePosition);
+
+	float influence = range / std::max(distance, 1.0e-3f);
+
+	// Favor lights that already have a slot
+	return slot >= 0 ? influence * LIGHT_SLOT_HYSTERESIS : influence;
+
+} // end getInfluence
+
+
+void LightComponent::addLight(std::shared_ptr<LightComponent> lightComponent)
+{
+	auto iter = std::find(lightComps.begin(), lightComps.end(), lightComponent);
+
+	if (iter == lightComps.end()) {
+
+		lightComps.emplace_back(lightComponent);
+	}
+
+} // end addLight
+
+
+void LightComponent::removeLight(std::shared_ptr<LightComponent> lightComponent)
+{
+	auto iter = std::find(lightComps.begin(), lightComps.end(), lightComponent);
+
+	if (iter != lightComps.end()) {
+
+		lightComponent->releaseSlot();
+
+		// Swap to end of vector and pop off (avoid erase copies)
+		std::iter_swap(iter, lightComps.end() - 1);
+		lightComps.pop_back();
+	}
+
+} // end removeLight
+
+
+void LightComponent::updateLights(const glm::vec3& eyePosition)
+{
+	// Lights that are on and attached to an active GameObject
+	std::vector<std::pair<float, LightComponent*>> candidates;
+
+	for (auto& light : lightComps) {
+
+		if (light->enabled && light->owningGameObject->getState() == ACTIVE) {
+
+			candidates.push_back({ light->getInfluence(eyePosition), light.get() });
+		}
+		else {
+
+			light->releaseSlot();
+		}
+	}
+
+	// Slots that are not enabled through SharedLighting directly
+	int availableSlots = 0;
+
+	for (int i = 0; i < MAX_LIGHTS; i++) {
+
+		if (SharedLighting::lights[i].inUse || !SharedLighting::lights[i].enabled) {
+			availableSlots++;
+		}
+	}
+
+	// Keep the most influential lights
+	size_t selectedCount = std::min(candidates.size(), static_cast<size_t>(availableSlots));
+
+	std::partial_sort(candidates.begin(), candidates.begin() + selectedCount, candidates.end(),
+		[](const std::pair<float, LightComponent*>& left, const std::pair<float, LightComponent*>& right) {
+			return left.first > right.first;
+		});
+
+	// Free the slots of the lights that lost them before they are reassigned
+	for (size_t i = selectedCount; i < candidates.size(); i++) {
+
+		candidates[i].second->releaseSlot();
+	}
+
+	for (size_t i = 0; i < selectedCount; i++) {
+
+		LightComponent* light = candidates[i].second;
+
+		if (light->slot < 0) {
+
+			for (int s = 0; s < MAX_LIGHTS; s++) {
+
+				if (!SharedLighting::lights[s].inUse && !SharedLighting::lights[s].enabled) {
+
+					SharedLighting::lights[s].inUse = true;
+					light->slot = s;
+
+					if (VERBOSE) cout << "Light slot " << s << " assigned" << endl;
+					break;
+				}
+			}
+		}
+
+		light->writeToSlot();
+	}
+
+} // end updateLights
+
+
+void LightComponent::writeToSlot()
+{
+	if (slot < 0) {
+		return;
+	}
+
+	const GeneralLight& current = SharedLighting::lights[slot];
+
+	glm::vec4 positionOrDirection;
+
+	if (lightType == DIRECTIONAL_LIGHT) {
+
+		// Direction towards the light
+		positionOrDirection = glm::vec4(-owningGameObject->getFowardDirection(WORLD), 0.0f);
+	}
+	else {
+
+		positionOrDirection = glm::vec4(owningGameObject->getPosition(WORLD), 1.0f);
+	}
+
+	// Only set attributes that differ so that unchanged slots are not uploaded
+	if (current.positionOrDirection != positionOrDirection) {
+		SharedLighting::setPositionOrDirection(slot, positionOrDirection);
+	}
+
+	if (current.ambientColor != ambientColor) {
+		SharedLighting::setAmbientColor(slot, ambientColor);
+	}
+
+	if (current.diffuseColor != diffuseColor) {
+		SharedLighting::setDiffuseColor(slot, diffuseColor);
+	}
+
+	if (current.specularColor != specularColor) {
+		SharedLighting::setSpecularColor(slot, specularColor);
+	}
+
+	if (current.constant != attenuationFactors.x || current.linear != attenuationFactors.y || current.quadratic != attenuationFactors.z) {
+		SharedLighting::setAttenuationFactors(slot, attenuationFactors);
+	}
+
+	bool isSpot = lightType == SPOT_LIGHT;
+
+	if (current.isSpot != isSpot) {
+		SharedLighting::setIsSpot(slot, isSpot);
+	}
+
+	if (isSpot) {
+
+		glm::vec3 spotDirection = owningGameObject->getFowardDirection(WORLD);
+
+		if (current.spotDirection != spotDirection) {
+			SharedLighting::setSpotDirection(slot, spotDirection);
+		}
+
+		if (current.spotCutoffCos != spotCutoffCos) {
+			SharedLighting::setSpotCutoffCos(slot, spotCutoffCos);
+		}
+
+		if (current.spotExponent != spotExponent) {
+			SharedLighting::setSpotExponent(slot, spotExponent);
+		}
+	}
+
+	if (!current.enabled) {
+		SharedLighting::setEnabled(slot, true);
+	}
+
+} // end writeToSlot
+
+
+void LightComponent::releaseSlot()
+{
+	if (slot < 0) {
+		return;
+	}
+
+	SharedLighting::setEnabled(slot, false);
+	SharedLighting::lights[slot].inUse = false;
+
+	if (VERBOSE) cout << "Light slot " << slot << " released" << endl;
+
+	slot = -1;
+
+} // end releaseSlot
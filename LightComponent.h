@@ -0,0 +1,223 @@
+#pragma once
+
+#include "Component.h"
+#include "SharedLighting.h"
+
+// Kinds of light a LightComponent can represent
+enum LIGHT_TYPE { DIRECTIONAL_LIGHT = 0, POSITIONAL_LIGHT, SPOT_LIGHT };
+
+// A light is considered out of range once its attenuation drops below this fraction
+static const float LIGHT_INFLUENCE_CUTOFF = 1.0f / 256.0f;
+
+// Factor applied to the influence of lights that already have a slot so that
+// lights with nearly equal influence do not trade slots every frame
+static const float LIGHT_SLOT_HYSTERESIS = 1.1f;
+
+/**
+ * @class	LightComponent
+ *
+ * @brief	A light source that follows the GameObject it is attached to. Positional
+ * 			and spot lights are placed at the world position of the GameObject.
+ * 			Directional and spot lights shine in its world forward direction.
+ *
+ * 			Lights are assigned slots in the SharedLighting light block automatically.
+ * 			When more lights are enabled than there are slots, the lights with the
+ * 			most influence on the view are given slots each frame. Influence is the
+ * 			attenuation range of the light divided by its distance from the eye.
+ * 			Directional lights always have the most influence.
+ *
+ * 			Slots that are enabled through SharedLighting directly are left alone.
+ */
+class LightComponent : public Component
+{
+public:
+
+	/**
+	 * @fn	LightComponent::LightComponent(LIGHT_TYPE lightType = POSITIONAL_LIGHT, int updateOrder = 100);
+	 *
+	 * @brief	Constructor. Creates an enabled white light with the default
+	 * 			SharedLighting attributes. The light is added to the lights that
+	 * 			compete for slots when GameObject::addComponent is called.
+	 *
+	 * @param 	lightType  	(Optional) The type of light.
+	 * @param 	updateOrder	(Optional) The update order.
+	 */
+	LightComponent(LIGHT_TYPE lightType = POSITIONAL_LIGHT, int updateOrder = 100);
+
+	/**
+	 * @fn	virtual LightComponent::~LightComponent();
+	 *
+	 * @brief	Destructor. Frees the slot of the light.
+	 */
+	virtual ~LightComponent();
+
+	LIGHT_TYPE getLightType() const { return lightType; }
+	void setLightType(LIGHT_TYPE lightType) { this->lightType = lightType; }
+
+	bool getEnabled() const { return enabled; }
+	void setEnabled(bool on) { enabled = on; }
+
+	glm::vec3 getAmbientColor() const { return ambientColor; }
+	void setAmbientColor(glm::vec3 color) { ambientColor = color; }
+
+	glm::vec3 getDiffuseColor() const { return diffuseColor; }
+	void setDiffuseColor(glm::vec3 color) { diffuseColor = color; }
+
+	glm::vec3 getSpecularColor() const { return specularColor; }
+	void setSpecularColor(glm::vec3 color) { specularColor = color; }
+
+	/**
+	 * @fn	void LightComponent::setAttenuationFactors(glm::vec3 factors)
+	 *
+	 * @brief	Sets the constant, linear and quadratic attenuation factors of a
+	 * 			positional or spot light.
+	 */
+	void setAttenuationFactors(glm::vec3 factors) { attenuationFactors = factors; }
+	glm::vec3 getAttenuationFactors() const { return attenuationFactors; }
+
+	float getSpotCutoffCos() const { return spotCutoffCos; }
+	void setSpotCutoffCos(float cutoffCos) { spotCutoffCos = cutoffCos; }
+
+	float getSpotExponent() const { return spotExponent; }
+	void setSpotExponent(float spotEx) { spotExponent = spotEx; }
+
+	/**
+	 * @fn	void LightComponent::setCastsShadows(bool castsShadows)
+	 *
+	 * @brief	Sets whether the light casts shadows. Directional lights use
+	 * 			cascaded shadow maps. Spot and positional lights are given one and
+	 * 			six tiles of the shadow atlas.
+	 */
+	void setCastsShadows(bool castsShadows) { this->castsShadows = castsShadows; }
+	bool getCastsShadows() const { return castsShadows; }
+
+	/**
+	 * @fn	void LightComponent::setShadowResolution(int resolution)
+	 *
+	 * @brief	Sets the width and height in texels of each shadow map of the light.
+	 * 			Zero uses the default of ShadowMapping for the type of light. The
+	 * 			resolution is lowered when shadows exceed their frame budget.
+	 */
+	void setShadowResolution(int resolution) { shadowResolution = resolution; }
+	int getShadowResolution() const { return shadowResolution; }
+
+	/**
+	 * @fn	void LightComponent::setShadowCascadeCount(int cascadeCount)
+	 *
+	 * @brief	Sets the number of cascades of a directional light. Zero uses the
+	 * 			default of ShadowMapping.
+	 */
+	void setShadowCascadeCount(int cascadeCount) { shadowCascadeCount = cascadeCount; }
+	int getShadowCascadeCount() const { return shadowCascadeCount; }
+
+	/**
+	 * @fn	float LightComponent::getRange() const;
+	 *
+	 * @brief	Gets the distance at which the attenuation of the light drops below
+	 * 			LIGHT_INFLUENCE_CUTOFF.
+	 *
+	 * @returns	The range. POS_INFINITY for directional lights and lights that are
+	 * 			not attenuated.
+	 */
+	float getRange() const;
+
+	/**
+	 * @fn	int LightComponent::getSlot() const
+	 *
+	 * @brief	Gets the index of the light in the SharedLighting light block.
+	 *
+	 * @returns	The slot, or -1 if the light does not currently have one.
+	 */
+	int getSlot() const { return slot; }
+
+	/**
+	 * @fn	static void LightComponent::addLight(std::shared_ptr<LightComponent> lightComponent);
+	 *
+	 * @brief	Adds a light to the lights that compete for slots.
+	 *
+	 * @param 	lightComponent	The light.
+	 */
+	static void addLight(std::shared_ptr<LightComponent> lightComponent);
+
+	/**
+	 * @fn	static void LightComponent::removeLight(std::shared_ptr<LightComponent> lightComponent);
+	 *
+	 * @brief	Removes a light and frees its slot.
+	 *
+	 * @param 	lightComponent	The light.
+	 */
+	static void removeLight(std::shared_ptr<LightComponent> lightComponent);
+
+	/**
+	 * @fn	static void LightComponent::updateLights(const glm::vec3& eyePosition);
+	 *
+	 * @brief	Assigns slots to the most influential lights and copies their
+	 * 			attributes and world transforms into their slots. Only attributes that
+	 * 			differ from those in the slot are set, so slots that did not change are
+	 * 			not uploaded by SharedLighting::uploadChangedLights. Should be called
+	 * 			once per frame before the lights are uploaded.
+	 *
+	 * @param 	eyePosition	World position of the viewpoint.
+	 */
+	static void updateLights(const glm::vec3& eyePosition);
+
+	/**
+	 * @fn	static const std::vector<std::shared_ptr<LightComponent>>& LightComponent::GetLightComponents()
+	 *
+	 * @brief	Gets all lights that compete for slots.
+	 */
+	static const std::vector<std::shared_ptr<LightComponent>>& GetLightComponents() { return lightComps; }
+
+protected:
+
+	/**
+	 * @fn	float LightComponent::getInfluence(const glm::vec3& eyePosition) const;
+	 *
+	 * @brief	Gets how much the light contributes to the view.
+	 */
+	float getInfluence(const glm::vec3& eyePosition) const;
+
+	/**
+	 * @fn	void LightComponent::writeToSlot();
+	 *
+	 * @brief	Sets the attributes of the slot that differ from this light.
+	 */
+	void writeToSlot();
+
+	/**
+	 * @fn	void LightComponent::releaseSlot();
+	 *
+	 * @brief	Disables the slot of the light and makes it available to other lights.
+	 */
+	void releaseSlot();
+
+	/** @brief	Type of the light */
+	LIGHT_TYPE lightType;
+
+	/** @brief	True if the light is on */
+	bool enabled = true;
+
+	/** @brief	Colors of the light */
+	glm::vec3 ambientColor = 0.15f * WHITE_RGB;
+	glm::vec3 diffuseColor = WHITE_RGB;
+	glm::vec3 specularColor = WHITE_RGB;
+
+	/** @brief	Constant, linear and quadratic attenuation */
+	glm::vec3 attenuationFactors = glm::vec3(1.0f, 0.0f, 0.0f);
+
+	/** @brief	Spot light attributes */
+	float spotCutoffCos = glm::cos(glm::radians(30.0f));
+	float spotExponent = 50.0f;
+
+	/** @brief	Shadow settings. Zero selects the defaults of ShadowMapping. */
+	bool castsShadows = false;
+	int shadowResolution = 0;
+	int shadowCascadeCount = 0;
+
+	/** @brief	Index in the SharedLighting light block. -1 if the light has no slot. */
+	int slot = -1;
+
+	/** @brief	Lights that compete for slots */
+	static std::vector<std::shared_ptr<LightComponent>> lightComps;
+
+}; // end LightComponent
@@ -1,9 +1,26 @@
 #pragma once
 
 #include "MathLibsConstsFuncs.h"
+#include "Texture.h"
+#include "RenderTarget.h"
+#include "VirtualTexture.h"
 
 using namespace constants_and_types;
 
+/**
+ * @enum	MATERIAL_FEATURE
+ *
+ * @brief	Bits that identify the optional features of a material. Shader program
+ * 			variants are specialized for a combination of these bits.
+ */
+enum MATERIAL_FEATURE {
+	DIFFUSE_TEXTURE_FEATURE = 1,
+	SPECULAR_TEXTURE_FEATURE = 2,
+	NORMAL_MAP_FEATURE = 4,
+	VIRTUAL_TEXTURE_FEATURE = 8,
+	ALL_MATERIAL_FEATURES = 15
+};
+
 struct Material
 {
 	friend class SharedMaterials;
@@ -39,6 +56,12 @@ struct Material
 		this->alphaTransparency = glm::clamp(alphaTransperancy, 0.0f, 1.0f);
 	}
 
+	// Gets the alpha value of the material. One is fully opaque.
+	float getTransparencyMat() const
+	{
+		return alphaTransparency;
+	}
+
 
 	void setEmissiveMat(glm::vec3 emissiveColor)
 	{
@@ -82,6 +105,95 @@ struct Material
 
 	} // end setNormalMap
 
+	// Overloads that keep a reference to the texture so that it is not
+	// unloaded while the material is in use. The material is left as it is if
+	// the texture failed to load.
+	void setDiffuseTexture(std::shared_ptr<Texture> texture)
+	{
+		if (texture == nullptr) {
+
+			std::cerr << "ERROR: Material given a diffuse texture that failed to load." << std::endl;
+			return;
+		}
+
+		this->diffuseTexture = texture;
+		setDiffuseTexture(texture->getTextureObject());
+
+	} // end setDiffuseTexture
+
+	void setSpecularTexture(std::shared_ptr<Texture> texture)
+	{
+		if (texture == nullptr) {
+
+			std::cerr << "ERROR: Material given a specular texture that failed to load." << std::endl;
+			return;
+		}
+
+		this->specularTexture = texture;
+		setSpecularTexture(texture->getTextureObject());
+
+	} // end setSpecularTexture
+
+	void setNormalMap(std::shared_ptr<Texture> texture)
+	{
+		if (texture == nullptr) {
+
+			std::cerr << "ERROR: Material given a normal map that failed to load." << std::endl;
+			return;
+		}
+
+		this->normalMapTexture = texture;
+		setNormalMap(texture->getTextureObject());
+
+	} // end setNormalMap
+
+	// Samples the color texture of a render target as the diffuse texture, e.g.
+	// for the screen of a monitor
+	void setDiffuseTexture(std::shared_ptr<RenderTarget> renderTarget)
+	{
+		this->renderTarget = renderTarget;
+		setDiffuseTexture(static_cast<GLint>(renderTarget->getColorTexture()));
+
+	} // end setDiffuseTexture
+
+
+	// Replaces the diffuse texture with a virtual texture. Only the parts of
+	// the texture that are visible are kept in memory. The material is left as
+	// it is if the virtual texture failed to load.
+	void setVirtualTexture(std::shared_ptr<VirtualTexture> virtualTexture)
+	{
+		if (virtualTexture == nullptr) {
+
+			std::cerr << "ERROR: Material given a virtual texture that failed to load." << std::endl;
+			return;
+		}
+
+		this->virtualTexture = virtualTexture;
+		setTextureMode(REPLACE_AMBIENT_DIFFUSE);
+		virtualTextureEnabled = true;
+
+	} // end setVirtualTexture
+
+
+	// Gets the MATERIAL_FEATURE bits of the features the material uses
+	unsigned int getFeatureBits() const
+	{
+		unsigned int featureBits = 0;
+
+		// Textures other than the normal map are ignored unless a texture mode is set
+		if (textureMode != NO_TEXTURE) {
+
+			if (diffuseTextureEnabled) featureBits |= DIFFUSE_TEXTURE_FEATURE;
+			if (specularTextureEnabled) featureBits |= SPECULAR_TEXTURE_FEATURE;
+			if (virtualTextureEnabled) featureBits |= VIRTUAL_TEXTURE_FEATURE;
+		}
+
+		if (normalMapTextureEnabled) featureBits |= NORMAL_MAP_FEATURE;
+
+		return featureBits;
+
+	} // end getFeatureBits
+
 
 	int _id;
 
@@ -110,6 +222,15 @@ protected:
 	GLuint normalMapTextureObject = 0;
 	bool normalMapTextureEnabled = false;
 
+	std::shared_ptr<VirtualTexture> virtualTexture;
+	bool virtualTextureEnabled = false;
+
+	// References to the textures (null if set by texture object)
+	std::shared_ptr<Texture> diffuseTexture;
+	std::shared_ptr<Texture> specularTexture;
+	std::shared_ptr<Texture> normalMapTexture;
+	std::shared_ptr<RenderTarget> renderTarget;
+
 };
 
 
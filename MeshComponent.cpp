@@ -2,149 +2,211 @@
 
 #include "SharedTransformations.h"
 #include "SharedMaterials.h"
+#include "ShaderPermutations.h"
+#include "GPUDrivenRenderer.h"
+#include "GeometryArena.h"
 
 static const bool  VERBOSE = false;
 
 /** @brief	Definition of a static data member; meshComps */
 std::vector<std::shared_ptr<class MeshComponent>> MeshComponent::meshComps;
 
-std::unordered_map<std::string, BaseMeshLoad> MeshComponent::loadedModels;
+std::unordered_map<size_t, std::weak_ptr<const ModelRecord>> MeshComponent::loadedModels;
+
+MeshCacheStats MeshComponent::cacheStats;
+
+// Sub-meshes of meshes that have not been built
+static const std::vector<SubMesh> noSubMeshes;
+
+ModelRecord::~ModelRecord()
+{
+	for (auto& subMesh : subMeshes) {
+
+		// Return the vertex and index ranges to the shared buffers
+		GeometryArena::release(subMesh.geometry);
+	}
+
+} // end ModelRecord destructor
+
 
 MeshComponent::~MeshComponent()
 {
 	if (VERBOSE) cout << "MeshComponent destructor called " << endl;
 
-	if (loadedModels.size() > 0) {
+	if (model && model.use_count() == 1) {
 
-		// Search for the model among those that were previously loaded
-		auto iter = loadedModels.find(scaleMeshName);
+		if (VERBOSE) cout << "freeing all resouces for model " << geometryKey << endl;
 
-		if (iter != loadedModels.end()) {
+		// Drop the expired entry. The record is freed along with this mesh.
+		loadedModels.erase(geometryKey);
 
-			iter->second.copyCount -= 1;
+		if (VERBOSE) listLoadedMeshes();
+	}
+	
+} // end destructor
 
-			if (VERBOSE) cout << "objects left of this type " << iter->second.copyCount << endl;
 
-			if (iter->second.copyCount <= 0) {
+const std::vector<SubMesh>& MeshComponent::getSubMeshes() const
+{
+	return model ? model->subMeshes : noSubMeshes;
+
+} // end getSubMeshes
 
-				if (VERBOSE) cout << "freeing all resouces for " << scaleMeshName << " model" << endl;
 
-				for (auto& subMesh : iter->second.modelSubMeshes) {
+// Preform drawing operations. 
+void MeshComponent::draw() const
+{
+	if (this->owningGameObject->getState() == ACTIVE) {
 
-					//MOVE to subMesh destructor ???
-					glDeleteVertexArrays(1, &subMesh.vao);
+		SharedTransformations::setModelingMatrix(this->owningGameObject->getModelingTransformation());
 
-					glDeleteBuffers(1, &subMesh.vertexBuffer);
+		// All sub-meshes are read through the same vertex array object
+		glBindVertexArray(GeometryArena::getVertexArray(PNT_VERTEX_FORMAT));
 
-					if (subMesh.renderMode == INDEXED) {
-						glDeleteBuffers(1, &subMesh.indexBuffer);
-					}
-				}
+		const std::vector<SubMesh>& subMeshes = getSubMeshes();
 
-				loadedModels.erase(iter);
+		// Render all subMeshes
+		for (size_t i = 0; i < subMeshes.size(); i++) {
 
-				delete collisionShape;
+			// Drawn along with other sub-meshes by one multi-draw call
+			if (GPUDrivenRenderer::handlesSubMesh(*this, subMeshes[i])) {
+				continue;
 			}
+
+			// Use the variant of the shader program that only does the work
+			// required by the material of the subMesh
+			glUseProgram(getShaderVariant(i));
+
+			drawSubMesh(subMeshes[i]);
 		}
-		else {
-				if (VERBOSE) cout << scaleMeshName << " not found" << endl;
-		}
-	
-		if (VERBOSE) listLoadedMeshes();
 	}
-	
-} // end destructor
 
+} // end draw
 
-// Preform drawing operations. 
-void MeshComponent::draw() const
+
+void MeshComponent::drawWithShaderProgram(GLuint shaderProgram) const
 {
 	if (this->owningGameObject->getState() == ACTIVE) {
 
-		// Use the shader program for this MeshComponent
+		// Use the shader program for this pass
 		glUseProgram(shaderProgram);
 
 		SharedTransformations::setModelingMatrix(this->owningGameObject->getModelingTransformation());
 
+		// All sub-meshes are read through the same vertex array object
+		glBindVertexArray(GeometryArena::getVertexArray(PNT_VERTEX_FORMAT));
+
 		// Render all subMeshes
-		for (auto & subMesh : subMeshes) {
+		for (auto & subMesh : getSubMeshes()) {
 
-			// Bind vertex array object for the subMesh
-			glBindVertexArray(subMesh.vao);
+			drawSubMesh(subMesh);
+		}
+	}
 
-			//glUniform1i(102, static_cast<int>(subMesh.material.textureMode));
+} // end drawWithShaderProgram
 
-			//if (subMesh.material.diffuseTextureEnabled == true) {
-			//	glBindTexture(GL_TEXTURE_2D, subMesh.material.diffuseTextureObject);
-			//}
-			//glUniform4fv(101, 1, glm::value_ptr(subMesh.material.diffuseMatColor));
-			
-			SharedMaterials::setShaderMaterialProperties(subMesh.material);
 
-			// Determine if sequential(ordered) or indexed rendering will be 
-			// used to render the sub Mesh
-			if (subMesh.renderMode == ORDERED) {
+void MeshComponent::drawSubMesh(const SubMesh& subMesh) const
+{
+	//glUniform1i(102, static_cast<int>(subMesh.material.textureMode));
 
-				// Trigger vertex fetch for ordered rendering 
-				glDrawArrays(subMesh.primitiveMode, 0, subMesh.count);
+	//if (subMesh.material.diffuseTextureEnabled == true) {
+	//	glBindTexture(GL_TEXTURE_2D, subMesh.material.diffuseTextureObject);
+	//}
+	//glUniform4fv(101, 1, glm::value_ptr(subMesh.material.diffuseMatColor));
+	
+	const Material& material = getMaterial(subMesh);
 
-			}
-			else if (subMesh.renderMode == INDEXED) {
+	SharedMaterials::setShaderMaterialProperties(material);
 
-				// Trigger vertex fetch for indexed rendering 
-				glDrawElements(subMesh.primitiveMode, subMesh.count, GL_UNSIGNED_INT, 0);
-			}
+	// Ordered or indexed rendering of the ranges of the sub mesh in the shared buffers
+	GeometryArena::draw(subMesh.geometry, subMesh.primitiveMode);
 
-			SharedMaterials::cleanUpMaterial(subMesh.material);
+	SharedMaterials::cleanUpMaterial(material);
 
-		}
+} // end drawSubMesh
+
+
+GLuint MeshComponent::getShaderVariant(size_t subMeshIndex) const
+{
+	const std::vector<SubMesh>& subMeshes = getSubMeshes();
+
+	if (shaderVariants.size() != subMeshes.size()) {
+		shaderVariants.resize(subMeshes.size());
 	}
 
-} // end draw
+	unsigned int featureBits = getMaterial(subMeshes[subMeshIndex]).getFeatureBits();
+	ShaderVariantSelection& selection = shaderVariants[subMeshIndex];
 
+	if (selection.shaderVariant == 0 || selection.featureBits != featureBits) {
 
-SubMesh  MeshComponent::buildSubMesh(const std::vector<pntVertexData>& vertexData)
+		selection.shaderVariant = ShaderPermutations::getVariant(this->shaderProgram, featureBits);
+		selection.featureBits = featureBits;
+	}
+
+	return selection.shaderVariant;
+
+} // end getShaderVariant
+
+
+void MeshComponent::setMaterial(const Material& material)
 {
-	// Create the SubMesh to be configured for the vertex data
-	SubMesh subMesh;
+	instanceMaterial = std::make_shared<const Material>(material);
 
-	// Generate, bind, and load the vertex array object.
-	// Store the identifier for the vertex array object in the subMesh
-	glGenVertexArrays(1, &subMesh.vao);
-	glBindVertexArray(subMesh.vao);
+} // end setMaterial
 
-	// Create a buffer and load the vertex positions and colors into it.
-	// Store the identifier for the buffer in the subMesh.
-	glGenBuffers(1, &subMesh.vertexBuffer);
-	glBindBuffer(GL_ARRAY_BUFFER, subMesh.vertexBuffer);
-	glBufferData(GL_ARRAY_BUFFER, vertexData.size() * sizeof(pntVertexData), &vertexData[0], GL_STATIC_DRAW);
 
-	// Specify the location and data format of an array of vertex positions
-	glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, sizeof(pntVertexData), 0);
-	glEnableVertexAttribArray(0);
+size_t MeshComponent::hashGeometry(const std::string& generator, const std::vector<float>& parameters)
+{
+	// 64 bit FNV-1a hash of the generator name and the bits of the parameters
+	size_t hash = 14695981039346656037ull;
+
+	auto combine = [&hash](const void* data, size_t size) {
 
-	// Specify the location and data format of an array of vertex normals
-	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(pntVertexData), (const void*)sizeof(glm::vec4));
-	glEnableVertexAttribArray(1);
+		const unsigned char* bytes = static_cast<const unsigned char*>(data);
 
-	// Specify the location and data format of an array of vertex texture coordinates
-	glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(pntVertexData), 
-		(const void*)(sizeof(glm::vec4) + sizeof(glm::vec3)));
-	glEnableVertexAttribArray(2);
+		for (size_t i = 0; i < size; i++) {
 
-	// Normal Mapping 
-	glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, sizeof(pntVertexData), (void*)( sizeof(glm::vec4) + sizeof(glm::vec3) + sizeof(glm::vec2)));
-	glEnableVertexAttribArray(3);
-	glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, sizeof(pntVertexData), (void*)(sizeof(glm::vec4) + 2 * sizeof(glm::vec3) + sizeof(glm::vec2)));
-	glEnableVertexAttribArray(4);
+			hash ^= bytes[i];
+			hash *= 1099511628211ull;
+		}
+	};
 
-	// Store the number of vertices to be rendered in the subMesh
-	subMesh.count = static_cast<GLuint>(vertexData.size());
+	combine(generator.data(), generator.size());
 
-	// Store the renderMode in the subMesh for ORDERED rendering
-	subMesh.renderMode = ORDERED;
+	for (float parameter : parameters) {
 
-	return subMesh;
+		// Treat -0 and 0 as the same dimension
+		if (parameter == 0.0f) {
+			parameter = 0.0f;
+		}
+
+		combine(&parameter, sizeof(float));
+	}
+
+	return hash;
+
+} // end hashGeometry
+
+
+std::shared_ptr<btCompoundShape> MeshComponent::makeCompoundShape(std::shared_ptr<const void> keepAlive)
+{
+	return std::shared_ptr<btCompoundShape>(new btCompoundShape(), [keepAlive](btCompoundShape* compoundShape) {
+
+		for (int i = 0; i < compoundShape->getNumChildShapes(); i++) {
+			delete compoundShape->getChildShape(i);
+		}
+
+		delete compoundShape;
+	});
+
+} // end makeCompoundShape
+
+
+SubMesh  MeshComponent::buildSubMesh(const std::vector<pntVertexData>& vertexData)
+{
+	// Sequential rendering uses no indices
+	return buildSubMesh(vertexData, std::vector<unsigned int>());
 
 } // end buildSubMesh
 
@@ -152,19 +214,55 @@ SubMesh  MeshComponent::buildSubMesh(const std::vector<pntVertexData>& vertexDat
 SubMesh MeshComponent::buildSubMesh(const std::vector<pntVertexData>& vertexData, const std::vector<unsigned int>& indices)
 {
 	// Create the SubMesh to be configured for the vertex data
-	SubMesh subMesh = buildSubMesh(vertexData);
-	
-	// Create buffer and load the indices into it.
-	// Store the identifier for the index buffer in the subMesh.
-	glGenBuffers(1, &subMesh.indexBuffer);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, subMesh.indexBuffer );
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(GLuint),&indices[0], GL_STATIC_DRAW);
+	SubMesh subMesh;
+
+	// Copy the vertex data and indices into the shared buffers. Positions are
+	// also stored tightly packed for passes that only need depth.
+	subMesh.geometry = GeometryArena::allocate(vertexData, indices);
+
+	// Find the bounds
+	std::vector<glm::vec3> positions(vertexData.size());
+	glm::vec3 boundsMin = INFINITY_V3;
+	glm::vec3 boundsMax = NEG_INFINITY_V3;
+
+	for (size_t i = 0; i < vertexData.size(); i++) {
+
+		positions[i] = glm::vec3(vertexData[i].m_pos);
+		boundsMin = glm::min(boundsMin, positions[i]);
+		boundsMax = glm::max(boundsMax, positions[i]);
+	}
+
+	subMesh.boundsCenter = 0.5f * (boundsMin + boundsMax);
+
+	for (const glm::vec3& position : positions) {
+		subMesh.boundsRadius = std::max(subMesh.boundsRadius, glm::length(position - subMesh.boundsCenter));
+	}
+
+	if (positions.size() <= MAX_OCCLUDER_VERTICES) {
+
+		subMesh.occluderPositions = std::make_shared<const std::vector<glm::vec3>>(positions);
+
+		if (!indices.empty()) {
+			subMesh.occluderIndices = std::make_shared<const std::vector<unsigned int>>(indices);
+		}
+	}
+
+	if (indices.empty()) {
 
-	// Store the number of indices to be process when rendering the subMesh
-	subMesh.count = static_cast<GLuint>(indices.size());
+		// Store the number of vertices to be rendered in the subMesh
+		subMesh.count = static_cast<GLuint>(vertexData.size());
 
-	// Store the renderMode in the subMesh for INDEXED rendering
-	subMesh.renderMode = INDEXED;
+		// Store the renderMode in the subMesh for ORDERED rendering
+		subMesh.renderMode = ORDERED;
+	}
+	else {
+
+		// Store the number of indices to be process when rendering the subMesh
+		subMesh.count = static_cast<GLuint>(indices.size());
+
+		// Store the renderMode in the subMesh for INDEXED rendering
+		subMesh.renderMode = INDEXED;
+	}
 
 	return subMesh;
 
@@ -200,6 +298,24 @@ void MeshComponent::removeMeshComp(std::shared_ptr<MeshComponent> meshComponent)
 
 } // end removeMeshComp
 
+void MeshComponent::replaceShaderProgram(GLuint oldProgram, GLuint newProgram)
+{
+	for (auto& meshComponent : meshComps) {
+
+		if (meshComponent->shaderProgram == oldProgram) {
+			meshComponent->shaderProgram = newProgram;
+		}
+
+		for (auto& selection : meshComponent->shaderVariants) {
+
+			if (selection.shaderVariant == oldProgram) {
+				selection.shaderVariant = newProgram;
+			}
+		}
+	}
+
+} // end replaceShaderProgram
+
 const std::vector<std::shared_ptr<MeshComponent>> & MeshComponent::GetMeshComponents()
 {
 	return meshComps;
@@ -209,20 +325,27 @@ const std::vector<std::shared_ptr<MeshComponent>> & MeshComponent::GetMeshCompon
 bool MeshComponent::previsouslyLoaded()
 {
 	// Search for the model among those that were previously loaded
-	auto iter = loadedModels.find(scaleMeshName);
+	auto iter = loadedModels.find(geometryKey);
+
+	// Check if the model was previously loaded and is still in use
+	std::shared_ptr<const ModelRecord> record;
 
-	// Check if the model was previously loaded
 	if (iter != loadedModels.end()) {
+		record = iter->second.lock();
+	}
 
-		if (VERBOSE) std::cout << endl << "Retrieving mesh: " << scaleMeshName << endl;
+	if (record) {
 
-		subMeshes = iter->second.modelSubMeshes;
+		if (VERBOSE) std::cout << endl << "Retrieving mesh: " << geometryKey << endl;
 
-		this->collisionShape = iter->second.collisionShape;
+		// Refer to the record rather than copying the sub-meshes
+		this->model = record;
+		this->collisionShape = record->collisionShape;
 
-		iter->second.copyCount += 1;
+		cacheStats.hits++;
+		cacheStats.bytesSaved += record->geometryBytes;
 
-		if (VERBOSE) std::cout << " copyCount = " << iter->second.copyCount << std::endl;
+		if (VERBOSE) std::cout << " copyCount = " << record.use_count() - 1 << std::endl;
 
 		if (VERBOSE) listLoadedMeshes();
 		
@@ -230,6 +353,8 @@ bool MeshComponent::previsouslyLoaded()
 	}
 	else {
 
+		cacheStats.misses++;
+
 		return false;
 
 	}
@@ -240,17 +365,29 @@ bool MeshComponent::previsouslyLoaded()
 
 void MeshComponent::saveInitialLoad()
 {
-	if (VERBOSE) std::cout << endl << "Loading Mesh: " << scaleMeshName << std::endl;
+	if (VERBOSE) std::cout << endl << "Loading Mesh: " << geometryKey << std::endl;
+
+	auto record = std::make_shared<ModelRecord>();
+
+	record->subMeshes = std::move(subMeshes);
+	record->collisionShape = this->collisionShape;
+
+	for (const SubMesh& subMesh : record->subMeshes) {
+
+		const GeometryAllocation& geometry = GeometryArena::getAllocation(subMesh.geometry);
 
-	BaseMeshLoad modelRecord;
+		// Both vertex formats and the indices
+		record->geometryBytes += geometry.vertexCount * (sizeof(pntVertexData) + sizeof(glm::vec3))
+							   + geometry.indexCount * sizeof(GLuint);
+	}
+
+	subMeshes.clear();
 
-	modelRecord.modelSubMeshes = subMeshes;
-	modelRecord.collisionShape = this->collisionShape;
-	modelRecord.copyCount = 1;
+	this->model = record;
 
 	// Add the loaded model to the map containing all loaded
 	// models to avoid loading it a second time.
-	loadedModels.emplace(scaleMeshName, modelRecord);
+	loadedModels[geometryKey] = this->model;
 
 	if (VERBOSE) listLoadedMeshes();
 }
@@ -266,4 +403,12 @@ void MeshComponent::listLoadedMeshes()
 
 	}
 	cout << endl;
-}
\ No newline at end of file
+}
+
+
+void MeshComponent::printCacheStats()
+{
+	cout << "Mesh cache: " << cacheStats.hits << " hits, " << cacheStats.misses << " misses, "
+		<< cacheStats.bytesSaved / 1024 << " KB of geometry shared instead of generated" << endl;
+
+} // end printCacheStats
\ No newline at end of file
@@ -52,6 +52,10 @@ struct pntVertexData
  */
 enum RENDER_MODE { ORDERED, INDEXED };
 
+// Sub-meshes with at most this many vertices keep a copy of their positions in
+// CPU memory so that they can be rasterized as occluders by OcclusionCulling
+static const size_t MAX_OCCLUDER_VERTICES = 4096;
+
 /**
  * @struct	SubMesh
  *
@@ -60,11 +64,15 @@ enum RENDER_MODE { ORDERED, INDEXED };
  */
 struct SubMesh {
 
-	GLuint vao = GL_INVALID_VALUE; // ID for Vertex Array Object for the sub-mesh
+	GLuint geometry = 0; // Handle of the vertex and index ranges of the sub-mesh in the GeometryArena
+
+	glm::vec3 boundsCenter = ZERO_V3; // Center of a sphere that bounds the sub-mesh in object coordinates
+
+	float boundsRadius = 0.0f; // Radius of the bounding sphere
 
-	GLuint vertexBuffer = GL_INVALID_VALUE; // ID for vertex data buffer for the sub-mesh
+	std::shared_ptr<const std::vector<glm::vec3>> occluderPositions; // Copy of the positions in CPU memory for software occlusion culling. Only kept for small meshes.
 
-	GLuint indexBuffer = GL_INVALID_VALUE; // ID for index buffer for the sub-mesh (if indexed rendering is used)
+	std::shared_ptr<const std::vector<unsigned int>> occluderIndices; // Copy of the indices of indexed sub-meshes that keep occluderPositions
 
 	GLuint count = 0; // Either the number of vertices in the mesh or the number of indices
 
@@ -72,23 +80,47 @@ struct SubMesh {
 
 	GLenum primitiveMode = GL_TRIANGLES; // Primitive mode for the mesh GL_POINTS, GL_LINES, etc.
 
-	Material material;  // Material properties used to render the object
+	Material material;  // Material properties loaded with the model. Not used by meshes that have a material of their own (see MeshComponent::setMaterial)
 
 }; // end SubMesh
 
 /**
- * @struct	BaseMeshLoad
+ * @struct	ModelRecord
  *
- * @brief	Used to keep track of what models have been loaded in order to 
- * 			avoid loading the same model multiple times.
+ * @brief	Sub-meshes and collision shape of a loaded model. Records are immutable
+ * 			once saved and shared by every MeshComponent that uses the model, in
+ * 			order to avoid loading the same model multiple times. The geometry of
+ * 			the sub-meshes is returned to the GeometryArena when the last
+ * 			MeshComponent that refers to the record is destroyed.
  */
-struct BaseMeshLoad {
+struct ModelRecord {
+
+	std::vector<SubMesh> subMeshes;
+
+	std::shared_ptr<btCollisionShape> collisionShape;
 
-	std::vector<SubMesh> modelSubMeshes;
+	// Size of the vertices and indices of all sub-meshes in the GeometryArena
+	size_t geometryBytes = 0;
 
-	btCollisionShape* collisionShape;
+	ModelRecord() = default;
+	ModelRecord(const ModelRecord&) = delete;
+	ModelRecord& operator=(const ModelRecord&) = delete;
+
+	~ModelRecord();
+};
+
+/**
+ * @struct	MeshCacheStats
+ *
+ * @brief	Number of meshes whose geometry was found among the loaded models (hits)
+ * 			or had to be generated (misses), and the size of the geometry that was
+ * 			shared instead of generated again.
+ */
+struct MeshCacheStats {
 
-	int copyCount = 0;
+	int hits = 0;
+	int misses = 0;
+	size_t bytesSaved = 0;
 };
 
 
@@ -120,7 +152,8 @@ public:
 	/**
 	 * @fn	MeshComponent::virtual~MeshComponent();
 	 *
-	 * @brief	Destructor. Deletes all dynamically allocated data.
+	 * @brief	Destructor. The model record is released along with the last mesh
+	 * 			that uses it.
 	 */
 	virtual~MeshComponent();
 
@@ -141,10 +174,23 @@ public:
 	 * @brief	Renders all sub-meshes that are part of the object. Binds the
 	 * 			vertex array object, sets the material properties, and sets the
 	 * 			modeling transformation based on the world transformation of the
-	 * 			owning game object.
+	 * 			owning game object. Each sub-mesh is rendered with the variant of
+	 * 			the shader program that is specialized for the features of its
+	 * 			material. Sub-meshes drawn by the GPUDrivenRenderer are skipped.
 	 */
 	virtual void draw() const;
 
+	/**
+	 * @fn	virtual void MeshComponent::drawWithShaderProgram(GLuint shaderProgram) const;
+	 *
+	 * @brief	Renders all sub-meshes using a different shader program than the one
+	 * 			the mesh was created with. Used by passes that render the scene for
+	 * 			purposes other than display (e.g. virtual texture feedback).
+	 *
+	 * @param 	shaderProgram	The shader program.
+	 */
+	virtual void drawWithShaderProgram(GLuint shaderProgram) const;
+
 	/**
 	 * @fn	static void MeshComponent::addMeshComp(std::shared_ptr<class MeshComponent> meshComponent);
 	 *
@@ -163,6 +209,18 @@ public:
 	 */
 	static void removeMeshComp(std::shared_ptr<class MeshComponent> meshComponent);
 
+	/**
+	 * @fn	static void MeshComponent::replaceShaderProgram(GLuint oldProgram, GLuint newProgram);
+	 *
+	 * @brief	Switches all mesh components and sub-mesh variants that are rendered
+	 * 			with one shader program to another. Used to swap in shader programs
+	 * 			that have been rebuilt while the game is running.
+	 *
+	 * @param 	oldProgram	The shader program being replaced.
+	 * @param 	newProgram	The shader program that replaces it.
+	 */
+	static void replaceShaderProgram(GLuint oldProgram, GLuint newProgram);
+
 	/**
 	 * @fn	btCollisionShape* MeshComponent::getCollisionShape() const
 	 *
@@ -170,7 +228,31 @@ public:
 	 *
 	 * @returns	Null if it fails, else the collision shape.
 	 */
-	btCollisionShape* getCollisionShape() const { return this->collisionShape; }
+	btCollisionShape* getCollisionShape() const { return this->collisionShape.get(); }
+
+	/**
+	 * @fn	std::shared_ptr<btCollisionShape> MeshComponent::getSharedCollisionShape() const
+	 *
+	 * @brief	Gets the collision shape for users that must keep it alive, such as
+	 * 			rigid bodies.
+	 *
+	 * @returns	Null if the mesh has not been built.
+	 */
+	std::shared_ptr<btCollisionShape> getSharedCollisionShape() const { return this->collisionShape; }
+
+	/**
+	 * @fn	static std::shared_ptr<btCompoundShape> MeshComponent::makeCompoundShape(std::shared_ptr<const void> keepAlive = nullptr);
+	 *
+	 * @brief	Creates an empty compound shape that deletes its child shapes along
+	 * 			with it. Bullet compound shapes do not own their children.
+	 *
+	 * @param 	keepAlive	Data the child shapes refer to but do not copy (e.g. the
+	 * 						heights of a btHeightfieldTerrainShape). Released with
+	 * 						the compound shape.
+	 *
+	 * @returns	The compound shape.
+	 */
+	static std::shared_ptr<btCompoundShape> makeCompoundShape(std::shared_ptr<const void> keepAlive = nullptr);
 
 	/**
 	 * @fn	static const std::vector<std::shared_ptr<class MeshComponent>> MeshComponent::GetMeshComponents();
@@ -182,6 +264,63 @@ public:
 	 */
 	static const std::vector<std::shared_ptr<class MeshComponent>> & GetMeshComponents();
 
+	/**
+	 * @fn	const std::vector<SubMesh>& MeshComponent::getSubMeshes() const
+	 *
+	 * @brief	Gets the sub-meshes that are part of this mesh. The sub-meshes are
+	 * 			shared with all meshes that use the same model.
+	 *
+	 * @returns	The sub-meshes.
+	 */
+	const std::vector<SubMesh>& getSubMeshes() const;
+
+	/**
+	 * @fn	void MeshComponent::setMaterial(const Material& material);
+	 *
+	 * @brief	Sets a material that is used for all sub-meshes of this mesh instead of
+	 * 			the materials the model was loaded with. Meshes with different
+	 * 			materials share the same geometry.
+	 *
+	 * @param 	material	The material.
+	 */
+	void setMaterial(const Material& material);
+
+	/**
+	 * @fn	const Material& MeshComponent::getMaterial(const SubMesh& subMesh) const
+	 *
+	 * @brief	Gets the material a sub-mesh of this mesh is rendered with.
+	 */
+	const Material& getMaterial(const SubMesh& subMesh) const { return instanceMaterial ? *instanceMaterial : subMesh.material; }
+
+	/**
+	 * @fn	static const MeshCacheStats& MeshComponent::getCacheStats()
+	 *
+	 * @brief	Gets the number of meshes that shared the geometry of a loaded model.
+	 */
+	static const MeshCacheStats& getCacheStats() { return cacheStats; }
+
+	/**
+	 * @fn	static void MeshComponent::printCacheStats();
+	 *
+	 * @brief	Prints the hits, misses and bytes saved by sharing loaded models.
+	 */
+	static void printCacheStats();
+
+	/**
+	 * @fn	GLuint MeshComponent::getShaderProgram() const
+	 *
+	 * @brief	Gets the shader program the mesh was created with.
+	 */
+	GLuint getShaderProgram() const { return shaderProgram; }
+
+	/**
+	 * @fn	void MeshComponent::setCastsShadows(bool castsShadows)
+	 *
+	 * @brief	Sets whether the mesh is rendered into shadow maps.
+	 */
+	void setCastsShadows(bool castsShadows) { this->castsShadows = castsShadows; }
+	bool getCastsShadows() const { return castsShadows; }
+
 protected:
 
 	/**
@@ -189,7 +328,7 @@ protected:
 	 *
 	 * @brief	Builds one sub mesh  that will be rendered using sequential
 	 * 			rendering based the vertex data that are passed to it. The vertex
-	 * 			data is loaded into a buffer located in GPU memory.
+	 * 			data is loaded into the shared buffers of the GeometryArena.
 	 *
 	 * @param 	vertexData	Information describing the vertex.
 	 *
@@ -203,7 +342,7 @@ protected:
 	 * @brief	Builds one sub mesh  that will be rendered using indexed
 	 * 			rendering based the vertex data, indices, and material properties
 	 * 			that are passed to it. Both the vertex data and the indices are
-	 * 			loaded into buffers located in GPU memory.
+	 * 			loaded into the shared buffers of the GeometryArena.
 	 *
 	 * @param 	vertexData	Information describing the vertex.
 	 * @param 	indices   	indices that will be used for indexed rendering.
@@ -212,26 +351,90 @@ protected:
 	 */
 	SubMesh buildSubMesh(const std::vector<pntVertexData>& vertexData, const std::vector<unsigned int>& indices);
 
+	/**
+	 * @fn	void MeshComponent::drawSubMesh(const SubMesh& subMesh) const;
+	 *
+	 * @brief	Sets the material properties and renders one sub-mesh with the
+	 * 			shader program that is in use. The vertex array object of the
+	 * 			GeometryArena must be bound.
+	 *
+	 * @param 	subMesh	The sub-mesh.
+	 */
+	void drawSubMesh(const SubMesh& subMesh) const;
+
+	/**
+	 * @fn	GLuint MeshComponent::getShaderVariant(size_t subMeshIndex) const;
+	 *
+	 * @brief	Gets the variant of the shader program for the material of a
+	 * 			sub-mesh. The variant is selected again if the material features
+	 * 			have changed.
+	 *
+	 * @param 	subMeshIndex	Index of the sub-mesh.
+	 *
+	 * @returns	The shader program to render the sub-mesh with.
+	 */
+	GLuint getShaderVariant(size_t subMeshIndex) const;
+
+	/**
+	 * @fn	static size_t MeshComponent::hashGeometry(const std::string& generator, const std::vector<float>& parameters);
+	 *
+	 * @brief	Gets the key of the geometry generated from a set of parameters.
+	 * 			Meshes with the same key share one loaded model. Materials and the
+	 * 			scale of the owning game object must not be part of the key.
+	 *
+	 * @param 	generator 	Name of the shape or path of the model file.
+	 * @param 	parameters	Dimensions and tessellation of the shape.
+	 *
+	 * @returns	The key.
+	 */
+	static size_t hashGeometry(const std::string& generator, const std::vector<float>& parameters);
+
 	/** @brief	Indentifier for the shader program used to render all sub-meshes (Design
 	 would have to incorporate the shader program into the SubMesh struct to support using
 	 different shader programs for different parts of the same object. */
 	GLuint shaderProgram = 0; 
 
-	/** @brief	Container for all sub meshes that are part of this MeshComponent.*/
+	/** @brief	Sub meshes built by buildMesh. Moved into the shared model record by
+	 saveInitialLoad. */
 	std::vector<SubMesh> subMeshes;
 
+	/** @brief	Shared model record with the sub meshes that are rendered for this MeshComponent. */
+	std::shared_ptr<const ModelRecord> model;
+
+	/** @brief	Material used for all sub meshes instead of the model materials. Null if
+	 the model materials are used. */
+	std::shared_ptr<const Material> instanceMaterial;
+
 	/**
-	 * @class	btCollisionShape*
+	 * @struct	ShaderVariantSelection
 	 *
-	 * @brief	Pointer to bt collision shape that can be used by the Physics
-	 * 			Engine for collision detection. The collision shape is based on
-	 * 			vertex data in the rendered sub meshes.
+	 * @brief	Shader program specialized for the features of the material of a
+	 * 			sub-mesh. Selected when the sub-mesh is first drawn.
 	 */
-	class btCollisionShape* collisionShape = nullptr;
+	struct ShaderVariantSelection {
+
+		GLuint shaderVariant = 0;
+
+		// Material features the shader variant was selected for
+		unsigned int featureBits = 0;
+	};
+
+	/** @brief	Shader variant of each sub mesh */
+	mutable std::vector<ShaderVariantSelection> shaderVariants;
 
-	/** @brief	Name of model that includes the scale. One
-	copy of each model will be loaded for specified scale */
-	string scaleMeshName;
+	/** @brief	True if the mesh is rendered into shadow maps */
+	bool castsShadows = true;
+
+	/**
+	 * @brief	Collision shape that can be used by the Physics Engine for collision
+	 * 			detection. The collision shape is based on vertex data in the rendered
+	 * 			sub meshes and is shared with all meshes that use the same model.
+	 */
+	std::shared_ptr<btCollisionShape> collisionShape;
+
+	/** @brief	Hash of the parameters the geometry is generated from (see hashGeometry).
+	 One copy of each model will be loaded for each key. */
+	size_t geometryKey = 0;
 
 	/************** Static data members used by the Game to manage MeshComponents **********/
 
@@ -244,8 +447,12 @@ protected:
 	/** @brief	All mesh components that need to be rendered. */
 	static std::vector<std::shared_ptr<class MeshComponent>> meshComps;
 
-	/** @brief	Map of ALL meshes that have been loaded previously.*/
-	static std::unordered_map<std::string, BaseMeshLoad> loadedModels;
+	/** @brief	Map of ALL meshes that are loaded, by geometry key. Records that are no
+	 longer used by any mesh have expired. */
+	static std::unordered_map<size_t, std::weak_ptr<const ModelRecord>> loadedModels;
+
+	/** @brief	Hits and misses of loadedModels */
+	static MeshCacheStats cacheStats;
 
 }; // end MeshComponent class
 
@@ -5,14 +5,20 @@
 #include "assimp/scene.h"
 #include "assimp/postprocess.h"
 
+#include "Bullet/BulletCollision/CollisionShapes/btScaledBvhTriangleMeshShape.h"
+
+#include "AssetCache.h"
 #include "Texture.h"
 #include "SharedMaterials.h"
 #include "SharedTransformations.h"
 
 static const bool VERBOSE = false;
 
-ModelMeshComponent::ModelMeshComponent (string filePathAndName, GLuint shaderProgram, int updateOrder)
-	: MeshComponent(shaderProgram, updateOrder), filePathAndName(filePathAndName)
+// Static variable definitions (Static variables must be defined outside the declaration)
+std::unordered_map<size_t, std::weak_ptr<btCollisionShape>> ModelMeshComponent::scaledCollisionShapes;
+
+ModelMeshComponent::ModelMeshComponent (string filePathAndName, GLuint shaderProgram, COLLISION_COOKING collisionCooking, int updateOrder)
+	: MeshComponent(shaderProgram, updateOrder), filePathAndName(filePathAndName), collisionCooking(collisionCooking)
 {
 }
 
@@ -25,12 +31,13 @@ ModelMeshComponent::~ModelMeshComponent()
 
 void ModelMeshComponent::buildMesh()
 {
-	// Scale information needs to be added to the filePathAndName
+	// The scale is applied by the modeling transformation, so the geometry is
+	// shared by models of every scale. Only the collision shape is scaled.
 	modelScale = owningGameObject->getScale(WORLD);
 
-	this->scaleMeshName = filePathAndName + " "+ std::to_string(modelScale[0][0])
-									+ " " + std::to_string(modelScale[1][1])
-									+ " " + std::to_string(modelScale[2][2]);
+	// The collision shape is part of the shared model, so models cooked in
+	// different ways are loaded separately
+	this->geometryKey = hashGeometry(filePathAndName, { static_cast<float>(collisionCooking) });
 
 	if ( previsouslyLoaded() == false ){
 
@@ -54,14 +61,16 @@ void ModelMeshComponent::buildMesh()
 			exit(EXIT_FAILURE);
 		}
 
-		/*
-		This is a concave shape made out of convex sub parts, called child shapes. Each
-		child shape has its own local offset transform, relative to the btCompoundShape. It 
-		is a good idea to approximate concave shapes using a collection of convex hulls, 
-		and store them in a btCompoundShape.
-		*/
-		// Create compound shape to hold the shapes of the individual meshes
-		btCompoundShape* modelCompondShape = new btCompoundShape();
+		// The collision shape is cooked the first time the model is loaded and read
+		// from the asset cache after that. The sub-meshes are only collected for
+		// cooking if there is no current cooked shape.
+		std::string cookedFile = AssetCache::getCookedPath(filePathAndName, "Collision", CookedCollision::getExtension(collisionCooking));
+
+		CookedCollision cookedCollision;
+		bool collisionCooked = AssetCache::isCookedFileCurrent(filePathAndName, cookedFile) &&
+							   cookedCollision.open(cookedFile) && cookedCollision.getCooking() == collisionCooking;
+
+		std::vector<CollisionGeometry> collisionMeshes;
 
 		// Iterate through each mesh
 		for (size_t i = 0; i < scene->mNumMeshes; i++) {
@@ -69,11 +78,21 @@ void ModelMeshComponent::buildMesh()
 			// Get the vertex mesh 
 			aiMesh* mesh = scene->mMeshes[i];
 
-			// Create a collision shape for the sub mesh
-			btConvexHullShape* meshCollisionShape = new btConvexHullShape();
-
 			// Read in the vertex data associated with the model
-			readVertexData(mesh, vData, indices, *meshCollisionShape);
+			readVertexData(mesh, vData, indices);
+
+			if (!collisionCooked) {
+
+				CollisionGeometry collisionMesh;
+				collisionMesh.positions.reserve(vData.size());
+
+				for (const pntVertexData& vertex : vData) {
+					collisionMesh.positions.push_back(vec3(vertex.m_pos));
+				}
+
+				collisionMesh.indices = indices;
+				collisionMeshes.push_back(std::move(collisionMesh));
+			}
 
 			// Get the Material*for the mesh
 			aiMaterial* meshMaterial = scene->mMaterials[scene->mMeshes[i]->mMaterialIndex];
@@ -92,11 +111,6 @@ void ModelMeshComponent::buildMesh()
 
 			subMesh.material = material;
 
-			// Add the mesh collision shape for collision detection
-			// Do NOT use the default btTransform constructor for this! It  
-			// makes a zero matrix and everything disappears. No problem for collision spheres! 
-			modelCompondShape->addChildShape(btTransform(btQuaternion(0, 0, 0)), meshCollisionShape);
-
 			subMeshes.push_back(subMesh);
 
 			//webGPU
@@ -106,16 +120,116 @@ void ModelMeshComponent::buildMesh()
 
 		} // needs to be moved up
 
-		// Set the collision shape for this model
-		this->collisionShape = modelCompondShape;
+		if (!collisionCooked && cookedCollision.build(collisionMeshes, collisionCooking)) {
+
+			cookedCollision.write(cookedFile);
+			collisionCooked = true;
+		}
+
+		// Set the unscaled collision shape for this model
+		if (collisionCooked) {
+
+			this->collisionShape = cookedCollision.createShape();
+		}
+		else {
+
+			// Nothing to cook without triangles. A hull of the vertices of each sub-mesh
+			// is made instead and nothing is written to the cache.
+			std::shared_ptr<btCompoundShape> modelCompoundShape = makeCompoundShape();
+
+			for (const CollisionGeometry& collisionMesh : collisionMeshes) {
+
+				if (collisionMesh.positions.empty()) {
+					continue;
+				}
+
+				std::unique_ptr<btConvexHullShape> meshCollisionShape(new btConvexHullShape());
+
+				for (const glm::vec3& position : collisionMesh.positions) {
+					meshCollisionShape->addPoint(btVector3(position.x, position.y, position.z), false);
+				}
+
+				meshCollisionShape->recalcLocalAabb();
+
+				// Do NOT use the default btTransform constructor for this! It
+				// makes a zero matrix and everything disappears.
+				modelCompoundShape->addChildShape(btTransform(btQuaternion(0, 0, 0)), meshCollisionShape.release());
+			}
+
+			this->collisionShape = modelCompoundShape;
+		}
 
 		saveInitialLoad();
 	}
 
+	// Collision shape for the scale of the owning game object
+	this->collisionShape = getScaledCollisionShape(glm::vec3(modelScale[0][0], modelScale[1][1], modelScale[2][2]));
+
 } // end initialize
 
 
-void ModelMeshComponent::readVertexData(aiMesh* mesh, std::vector<pntVertexData>& vertexData, std::vector<unsigned int>& indices, btConvexHullShape& hull)
+std::shared_ptr<btCollisionShape> ModelMeshComponent::getScaledCollisionShape(const glm::vec3& scale)
+{
+	if (scale == glm::vec3(1.0f)) {
+		return model->collisionShape;
+	}
+
+	// Search for a shape of the same model and scale that is still in use
+	size_t key = hashGeometry(filePathAndName, { scale.x, scale.y, scale.z });
+
+	auto iter = scaledCollisionShapes.find(key);
+
+	if (iter != scaledCollisionShapes.end()) {
+
+		if (std::shared_ptr<btCollisionShape> shape = iter->second.lock()) {
+			return shape;
+		}
+	}
+
+	// Copy the hulls of the shared shape with their points scaled
+	btCompoundShape* unscaledShape = static_cast<btCompoundShape*>(model->collisionShape.get());
+	btVector3 hullScale(scale.x, scale.y, scale.z);
+
+	// Triangle meshes are scaled without being copied
+	if (unscaledShape->getNumChildShapes() > 0 && unscaledShape->getChildShape(0)->getShapeType() == TRIANGLE_MESH_SHAPE_PROXYTYPE) {
+
+		std::shared_ptr<btCompoundShape> scaledShape = makeCompoundShape(model->collisionShape);
+
+		btBvhTriangleMeshShape* triangleMesh = static_cast<btBvhTriangleMeshShape*>(unscaledShape->getChildShape(0));
+		scaledShape->addChildShape(btTransform::getIdentity(), new btScaledBvhTriangleMeshShape(triangleMesh, hullScale));
+
+		scaledCollisionShapes[key] = scaledShape;
+
+		return scaledShape;
+	}
+
+	std::shared_ptr<btCompoundShape> scaledShape = makeCompoundShape();
+
+	for (int i = 0; i < unscaledShape->getNumChildShapes(); i++) {
+
+		btConvexHullShape* unscaledHull = static_cast<btConvexHullShape*>(unscaledShape->getChildShape(i));
+		std::unique_ptr<btConvexHullShape> hull(new btConvexHullShape());
+
+		for (int j = 0; j < unscaledHull->getNumPoints(); j++) {
+			hull->addPoint(unscaledHull->getUnscaledPoints()[j] * hullScale, false);
+		}
+
+		hull->recalcLocalAabb();
+
+		btTransform childTransform = unscaledShape->getChildTransform(i);
+		childTransform.setOrigin(childTransform.getOrigin() * hullScale);
+
+		scaledShape->addChildShape(childTransform, hull.release());
+	}
+
+	scaledCollisionShapes[key] = scaledShape;
+
+	return scaledShape;
+
+} // end getScaledCollisionShape
+
+
+void ModelMeshComponent::readVertexData(aiMesh* mesh, std::vector<pntVertexData>& vertexData, std::vector<unsigned int>& indices)
 {
 	// Read in vertex positions, normals, and texture coordinates. See 
 	// http://www.assimp.org/lib_html/structai_MeshComponent.html for more details
@@ -129,14 +243,6 @@ void ModelMeshComponent::readVertexData(aiMesh* mesh, std::vector<pntVertexData>
 			tempPosition.z = mesh->mVertices[i].z;
 			tempPosition.w = 1.0f;
 
-			// Apply the World scale set before initialization to the
-			// collision shape. If the model scale is changed to collision
-			// shape will not be adjusted in the present implementation
-			vec4 scalePos = modelScale * tempPosition;
-
-			// Add the vertex for the collision shape
-			hull.addPoint(btVector3(scalePos.x, scalePos.y, scalePos.z), true);
-
 			// Read in vertex normal vectors
 			glm::vec3 tempNormal;
 			tempNormal.x = mesh->mNormals[i].x;
@@ -261,7 +367,7 @@ Material ModelMeshComponent::readInMaterialProperties( const aiMaterial* assimpM
 			std::string relativeFilePath = getDirectoryPath(filename) + path.C_Str();
 			if (VERBOSE) std::cout << "Loading diffuse texture: " << relativeFilePath << std::endl;
 
-			meshMaterial.setDiffuseTexture(Texture::GetTexture(relativeFilePath)->getTextureObject());
+			meshMaterial.setDiffuseTexture(Texture::GetTexture(relativeFilePath));
 		}
 	}
 	if (assimpMaterial->GetTextureCount(aiTextureType_SPECULAR) > 0) {				// map_Ks
@@ -271,7 +377,7 @@ Material ModelMeshComponent::readInMaterialProperties( const aiMaterial* assimpM
 			std::string relativeFilePath = getDirectoryPath(filename) + path.C_Str();
 			if (VERBOSE) std::cout << "Loading specular texture: " << relativeFilePath << std::endl;
 
-			meshMaterial.setSpecularTexture(Texture::GetTexture(relativeFilePath)->getTextureObject());
+			meshMaterial.setSpecularTexture(Texture::GetTexture(relativeFilePath));
 		}
 	}
 
@@ -282,7 +388,7 @@ Material ModelMeshComponent::readInMaterialProperties( const aiMaterial* assimpM
 			std::string relativeFilePath = getDirectoryPath(filename) + path.C_Str();
 			if (VERBOSE) std::cout << "Loading Normal Map texture: " << relativeFilePath << std::endl;
 
-			meshMaterial.setNormalMap(Texture::GetTexture(relativeFilePath)->getTextureObject());
+			meshMaterial.setNormalMap(Texture::GetTexture(relativeFilePath, NORMAL_MAP_TEXTURE));
 		}
 	}
 
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "MeshComponent.h"
+#include "CookedCollision.h"
 
 /**
  * @class	ModelMesh
@@ -13,13 +14,18 @@ class ModelMeshComponent : public MeshComponent
 public:
 
 	/**
-	 * @fn	ModelMesh::ModelMesh(string filePathAndName);
+	 * @fn	ModelMeshComponent::ModelMeshComponent(string filePathAndName, GLuint shaderProgram, COLLISION_COOKING collisionCooking = CONVEX_HULLS, int updateOrder = 100);
 	 *
 	 * @brief	Constructor
 	 *
-	 * @param	filePathAndName	Relative path and file name for the model to be loaded.
+	 * @param	filePathAndName 	Relative path and file name for the model to be loaded.
+	 * @param	shaderProgram   	Shader program the model is rendered with.
+	 * @param	collisionCooking	(Optional) How the collision shape is cooked. Use
+	 * 								CONVEX_DECOMPOSITION for concave models that move and
+	 * 								TRIANGLE_MESH for models that never move.
+	 * @param	updateOrder			(Optional) The update order.
 	 */
-	ModelMeshComponent(string filePathAndName, GLuint shaderProgram, int updateOrder = 100);
+	ModelMeshComponent(string filePathAndName, GLuint shaderProgram, COLLISION_COOKING collisionCooking = CONVEX_HULLS, int updateOrder = 100);
 
 	/**
 	 * @fn	ModelMeshComponent::~ModelMeshComponent();
@@ -50,7 +56,7 @@ protected:
 	std::string getDirectoryPath(std::string sFilePath);
 
 	/**
-	 * @fn	void ModelMesh::readVertexData(aiMesh* mesh, std::vector<pntVertexData>& vertexData, std::vector<unsigned int>& indices, btConvexHullShape& hull);
+	 * @fn	void ModelMesh::readVertexData(aiMesh* mesh, std::vector<pntVertexData>& vertexData, std::vector<unsigned int>& indices);
 	 *
 	 * @brief	Reads vertex data and places it in data structures and variables that are passed
 	 * 			by reference.
@@ -58,9 +64,8 @@ protected:
 	 * @param [out]	mesh	  	If non-null, the mesh.
 	 * @param [out]	vertexData	Information describing the vertex.
 	 * @param [out]	indices   	The indices.
-	 * @param [out]	hull	  	The hull.
 	 */
-	void readVertexData(struct aiMesh* mesh, std::vector<pntVertexData>& vertexData, std::vector<unsigned int>& indices, btConvexHullShape& hull);
+	void readVertexData(struct aiMesh* mesh, std::vector<pntVertexData>& vertexData, std::vector<unsigned int>& indices);
 
 	/**
 	 * @fn	Material* ModelMesh::readInMaterialProperties( aiMaterial* assimpMaterial, std::string filename);
@@ -74,13 +79,32 @@ protected:
 	 */
 	Material readInMaterialProperties(const struct aiMaterial* assimpMaterial, std::string filename);
 
+	/**
+	 * @fn	std::shared_ptr<btCollisionShape> ModelMeshComponent::getScaledCollisionShape(const glm::vec3& scale);
+	 *
+	 * @brief	Gets the collision shape of the model for a scale. Shapes of the same
+	 * 			model and scale are shared. The model must be loaded.
+	 *
+	 * @param	scale	Scale of the owning game object.
+	 *
+	 * @returns	The unscaled shape of the model if the scale is one, else a copy with
+	 * 			scaled hulls or a scaled view of the triangle mesh.
+	 */
+	std::shared_ptr<btCollisionShape> getScaledCollisionShape(const glm::vec3& scale);
+
 	/** @brief	Relative path and file name for the model */
 	string filePathAndName;
 
-	/** @brief	The scale to be applied to the model and the collision
-	 shape for the model. The scale of the owning GameObject must be
-	 set before the model is loaded for this to be effective.*/
+	/** @brief	How the collision shape of the model is cooked */
+	COLLISION_COOKING collisionCooking;
+
+	/** @brief	The scale to be applied to the collision shape for the model. The
+	 scale of the owning GameObject must be set before the model is loaded for
+	 this to be effective.*/
 	mat4 modelScale = mat4(1.0f);
 
+	/** @brief	Collision shapes of scaled models by model and scale */
+	static std::unordered_map<size_t, std::weak_ptr<btCollisionShape>> scaledCollisionShapes;
+
 }; // end ModelMeshComponent class
 
@@ -0,0 +1,473 @@
+#include "OcclusionCulling.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "BuildShaderProgram.h"
+#include "RenderQueue.h"
+#include "ShaderHotReload.h"
+
+static const bool VERBOSE = false;
+
+// Texture units of the depth copy and the Hi-Z pyramid while the compute shaders run
+static const GLuint depthCopyTextureUnit = 6;
+static const GLuint hiZTextureUnit = 7;
+
+// Smallest clip space w of a vertex that is treated as in front of the eye.
+// Anything closer is assumed to cross the near plane.
+static const float MIN_CLIP_W = 1.0e-4f;
+
+// Static variable definitions (Static variables must be defined outside the declaration)
+OCCLUSION_MODE OcclusionCulling::mode = GPU_OCCLUSION;
+bool OcclusionCulling::depthPrePassEnabled = true;
+std::unordered_set<const MeshComponent*> OcclusionCulling::occludedMeshes;
+std::vector<const MeshComponent*> OcclusionCulling::meshes;
+std::vector<OcclusionCulling::MeshBounds> OcclusionCulling::meshBounds;
+std::vector<const MeshComponent*> OcclusionCulling::testedMeshes;
+GLuint OcclusionCulling::depthCopyTexture = 0;
+GLuint OcclusionCulling::depthCopyFramebuffer = 0;
+GLuint OcclusionCulling::hiZTexture = 0;
+glm::ivec2 OcclusionCulling::hiZSize = glm::ivec2(0, 0);
+int OcclusionCulling::hiZLevels = 0;
+glm::mat4 OcclusionCulling::hiZViewProjection = glm::mat4(1.0f);
+GLuint OcclusionCulling::hiZProgram = 0;
+GLuint OcclusionCulling::cullingProgram = 0;
+GLuint OcclusionCulling::boundsBuffer = 0;
+GLuint OcclusionCulling::resultsBuffer = 0;
+size_t OcclusionCulling::bufferCapacity = 0;
+GLsync OcclusionCulling::resultsFence = 0;
+
+// Depth buffer that occluders are rasterized into by the CPU
+static std::vector<float> softwareDepth;
+
+
+// Builds a compute shader and keeps the program identifier current when the
+// shader is rebuilt after a source change
+static void buildComputeProgram(const char* filename, GLuint& program)
+{
+	ShaderInfo shaders[] = {
+		{ GL_COMPUTE_SHADER, filename },
+		{ GL_NONE, NULL } // signals that there are no more shaders
+	};
+
+	program = BuildShaderProgram(shaders);
+
+	GLuint* programPointer = &program;
+
+	ShaderHotReload::addSwapCallback([programPointer](GLuint oldProgram, GLuint newProgram) {
+
+		if (*programPointer == oldProgram) {
+			*programPointer = newProgram;
+		}
+	});
+
+} // end buildComputeProgram
+
+
+// Rasterizes one triangle given in clip coordinates into the software depth
+// buffer, keeping the nearest depth of each pixel whose center it covers
+static void rasterizeTriangle(const glm::vec4& a, const glm::vec4& b, const glm::vec4& c)
+{
+	// Triangles that cross the near plane are skipped. Leaving out an occluder
+	// can only make fewer meshes hidden.
+	if (a.w < MIN_CLIP_W || b.w < MIN_CLIP_W || c.w < MIN_CLIP_W) {
+		return;
+	}
+
+	glm::vec3 v[3];
+	const glm::vec4* clip[3] = { &a, &b, &c };
+
+	for (int i = 0; i < 3; i++) {
+
+		glm::vec3 ndc = glm::vec3(*clip[i]) / clip[i]->w;
+		v[i] = glm::vec3((ndc.x * 0.5f + 0.5f) * SOFTWARE_DEPTH_WIDTH, (ndc.y * 0.5f + 0.5f) * SOFTWARE_DEPTH_HEIGHT, ndc.z * 0.5f + 0.5f);
+	}
+
+	auto edge = [](const glm::vec3& from, const glm::vec3& to, float x, float y) {
+		return (to.x - from.x) * (y - from.y) - (to.y - from.y) * (x - from.x);
+	};
+
+	float area = edge(v[0], v[1], v[2].x, v[2].y);
+
+	if (std::fabs(area) < 1.0e-8f) {
+		return;
+	}
+
+	int xMin = std::max(static_cast<int>(std::floor(std::min({ v[0].x, v[1].x, v[2].x }))), 0);
+	int xMax = std::min(static_cast<int>(std::ceil(std::max({ v[0].x, v[1].x, v[2].x }))), SOFTWARE_DEPTH_WIDTH - 1);
+	int yMin = std::max(static_cast<int>(std::floor(std::min({ v[0].y, v[1].y, v[2].y }))), 0);
+	int yMax = std::min(static_cast<int>(std::ceil(std::max({ v[0].y, v[1].y, v[2].y }))), SOFTWARE_DEPTH_HEIGHT - 1);
+
+	for (int y = yMin; y <= yMax; y++) {
+		for (int x = xMin; x <= xMax; x++) {
+
+			float px = x + 0.5f;
+			float py = y + 0.5f;
+
+			// Barycentric weights, positive inside for either winding
+			float w0 = edge(v[1], v[2], px, py) / area;
+			float w1 = edge(v[2], v[0], px, py) / area;
+			float w2 = edge(v[0], v[1], px, py) / area;
+
+			if (w0 < 0.0f || w1 < 0.0f || w2 < 0.0f) {
+				continue;
+			}
+
+			// Depth is linear in screen space after the perspective divide
+			float depth = w0 * v[0].z + w1 * v[1].z + w2 * v[2].z;
+			float& stored = softwareDepth[y * SOFTWARE_DEPTH_WIDTH + x];
+
+			stored = std::min(stored, depth);
+		}
+	}
+
+} // end rasterizeTriangle
+
+
+void OcclusionCulling::setMode(OCCLUSION_MODE newMode)
+{
+	mode = newMode;
+
+	// Results of the other mode no longer apply
+	occludedMeshes.clear();
+	testedMeshes.clear();
+
+} // end setMode
+
+
+void OcclusionCulling::beginFrame(const glm::mat4& viewProjection)
+{
+	occludedMeshes.clear();
+
+	gatherMeshBounds();
+
+	if (mode == GPU_OCCLUSION) {
+
+		readGPUResults();
+	}
+	else if (mode == CPU_OCCLUSION) {
+
+		cullOnCPU(viewProjection);
+	}
+
+} // end beginFrame
+
+
+void OcclusionCulling::renderDepthPrePass(const glm::mat4& viewProjection)
+{
+	if (depthPrePassEnabled) {
+
+		// Lay down the depth of the opaque meshes that will be drawn. The depth is
+		// pushed back slightly so that the shaded pass, whose vertex shader computes
+		// positions differently, passes the default GL_LESS depth test.
+		glEnable(GL_POLYGON_OFFSET_FILL);
+		glPolygonOffset(1.0f, 1.0f);
+		glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+
+		RenderQueue::drawDepth(viewProjection, [](const RenderItem& item) {
+			return item.material->getTransparencyMat() >= 1.0f && !isOccluded(item.mesh);
+		});
+
+		glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+		glDisable(GL_POLYGON_OFFSET_FILL);
+	}
+
+} // end renderDepthPrePass
+
+
+void OcclusionCulling::gatherMeshBounds()
+{
+	meshes.clear();
+	meshBounds.clear();
+
+	// The items of a mesh are next to each other in the queue
+	for (const RenderItem& item : RenderQueue::getItems()) {
+
+		glm::vec4 itemMin(item.boundsCenter - glm::vec3(item.boundsRadius), 1.0f);
+		glm::vec4 itemMax(item.boundsCenter + glm::vec3(item.boundsRadius), 1.0f);
+
+		if (meshes.empty() || meshes.back() != item.mesh) {
+
+			meshes.push_back(item.mesh);
+			meshBounds.push_back({ itemMin, itemMax });
+		}
+		else {
+
+			meshBounds.back().boundsMin = glm::min(meshBounds.back().boundsMin, itemMin);
+			meshBounds.back().boundsMax = glm::max(meshBounds.back().boundsMax, itemMax);
+		}
+	}
+
+} // end gatherMeshBounds
+
+
+void OcclusionCulling::readGPUResults()
+{
+	if (resultsFence == 0) {
+		return;
+	}
+
+	// The tests were started at the end of the last frame and are normally done.
+	// Rather than stall, draw everything if they are not.
+	GLenum status = glClientWaitSync(resultsFence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000);
+
+	glDeleteSync(resultsFence);
+	resultsFence = 0;
+
+	if (status == GL_TIMEOUT_EXPIRED || status == GL_WAIT_FAILED) {
+
+		if (VERBOSE) cout << "Occlusion results not ready" << endl;
+		return;
+	}
+
+	std::vector<GLuint> visible(testedMeshes.size());
+
+	if (!visible.empty()) {
+		glGetNamedBufferSubData(resultsBuffer, 0, visible.size() * sizeof(GLuint), visible.data());
+	}
+
+	// Ignore meshes that have been removed since the tests were started
+	std::unordered_set<const MeshComponent*> current(meshes.begin(), meshes.end());
+
+	for (size_t i = 0; i < visible.size(); i++) {
+
+		if (visible[i] == 0 && current.count(testedMeshes[i]) > 0) {
+			occludedMeshes.insert(testedMeshes[i]);
+		}
+	}
+
+} // end readGPUResults
+
+
+void OcclusionCulling::cullOnCPU(const glm::mat4& viewProjection)
+{
+	softwareDepth.assign(SOFTWARE_DEPTH_WIDTH * SOFTWARE_DEPTH_HEIGHT, 1.0f);
+
+	std::vector<glm::vec4> clipPositions;
+
+	// Rasterize the small opaque meshes that kept their positions
+	for (const RenderItem& item : RenderQueue::getItems()) {
+
+		const SubMesh& subMesh = *item.subMesh;
+
+		if (!subMesh.occluderPositions || subMesh.primitiveMode != GL_TRIANGLES ||
+			item.material->getTransparencyMat() < 1.0f || !RenderQueue::isVisible(item, viewProjection)) {
+			continue;
+		}
+
+		glm::mat4 modelViewProjection = viewProjection * item.modelMatrix;
+
+		clipPositions.resize(subMesh.occluderPositions->size());
+
+		for (size_t i = 0; i < clipPositions.size(); i++) {
+			clipPositions[i] = modelViewProjection * glm::vec4((*subMesh.occluderPositions)[i], 1.0f);
+		}
+
+		if (subMesh.occluderIndices) {
+
+			const std::vector<unsigned int>& indices = *subMesh.occluderIndices;
+
+			for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+				rasterizeTriangle(clipPositions[indices[i]], clipPositions[indices[i + 1]], clipPositions[indices[i + 2]]);
+			}
+		}
+		else {
+
+			for (size_t i = 0; i + 2 < clipPositions.size(); i += 3) {
+				rasterizeTriangle(clipPositions[i], clipPositions[i + 1], clipPositions[i + 2]);
+			}
+		}
+	}
+
+	// Test the bounding box of each mesh
+	for (size_t m = 0; m < meshes.size(); m++) {
+
+		glm::vec3 rectMin = INFINITY_V3;
+		glm::vec3 rectMax = NEG_INFINITY_V3;
+		bool crossesNearPlane = false;
+
+		for (int corner = 0; corner < 8; corner++) {
+
+			glm::vec4 position((corner & 1) ? meshBounds[m].boundsMax.x : meshBounds[m].boundsMin.x,
+							   (corner & 2) ? meshBounds[m].boundsMax.y : meshBounds[m].boundsMin.y,
+							   (corner & 4) ? meshBounds[m].boundsMax.z : meshBounds[m].boundsMin.z, 1.0f);
+
+			glm::vec4 clip = viewProjection * position;
+
+			if (clip.w < MIN_CLIP_W) {
+
+				crossesNearPlane = true;
+				break;
+			}
+
+			glm::vec3 ndc = glm::vec3(clip) / clip.w;
+			rectMin = glm::min(rectMin, ndc);
+			rectMax = glm::max(rectMax, ndc);
+		}
+
+		if (crossesNearPlane) {
+			continue;
+		}
+
+		// Pixels touched by the rectangle, grown by one pixel to allow for the
+		// pixels an occluder only partly covers
+		int xMin = std::max(static_cast<int>(std::floor((rectMin.x * 0.5f + 0.5f) * SOFTWARE_DEPTH_WIDTH)) - 1, 0);
+		int xMax = std::min(static_cast<int>(std::floor((rectMax.x * 0.5f + 0.5f) * SOFTWARE_DEPTH_WIDTH)) + 1, SOFTWARE_DEPTH_WIDTH - 1);
+		int yMin = std::max(static_cast<int>(std::floor((rectMin.y * 0.5f + 0.5f) * SOFTWARE_DEPTH_HEIGHT)) - 1, 0);
+		int yMax = std::min(static_cast<int>(std::floor((rectMax.y * 0.5f + 0.5f) * SOFTWARE_DEPTH_HEIGHT)) + 1, SOFTWARE_DEPTH_HEIGHT - 1);
+
+		float nearestDepth = rectMin.z * 0.5f + 0.5f;
+		bool occluded = true;
+
+		for (int y = yMin; y <= yMax && occluded; y++) {
+			for (int x = xMin; x <= xMax; x++) {
+
+				if (softwareDepth[y * SOFTWARE_DEPTH_WIDTH + x] >= nearestDepth) {
+
+					occluded = false;
+					break;
+				}
+			}
+		}
+
+		if (occluded) {
+			occludedMeshes.insert(meshes[m]);
+		}
+	}
+
+} // end cullOnCPU
+
+
+void OcclusionCulling::resizeHiZ(glm::ivec2 windowDimensions)
+{
+	glDeleteTextures(1, &depthCopyTexture);
+	glDeleteFramebuffers(1, &depthCopyFramebuffer);
+	glDeleteTextures(1, &hiZTexture);
+
+	hiZSize = windowDimensions;
+	hiZLevels = 1 + static_cast<int>(std::floor(std::log2(static_cast<float>(std::max(hiZSize.x, hiZSize.y)))));
+
+	// Same format as the default framebuffer so the depth can be blitted
+	glCreateTextures(GL_TEXTURE_2D, 1, &depthCopyTexture);
+	glTextureStorage2D(depthCopyTexture, 1, GL_DEPTH24_STENCIL8, hiZSize.x, hiZSize.y);
+	glTextureParameteri(depthCopyTexture, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTextureParameteri(depthCopyTexture, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+	glCreateFramebuffers(1, &depthCopyFramebuffer);
+	glNamedFramebufferTexture(depthCopyFramebuffer, GL_DEPTH_STENCIL_ATTACHMENT, depthCopyTexture, 0);
+	glNamedFramebufferDrawBuffer(depthCopyFramebuffer, GL_NONE);
+
+	// Each level holds the farthest depth of the texels below it
+	glCreateTextures(GL_TEXTURE_2D, 1, &hiZTexture);
+	glTextureStorage2D(hiZTexture, hiZLevels, GL_R32F, hiZSize.x, hiZSize.y);
+	glTextureParameteri(hiZTexture, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+	glTextureParameteri(hiZTexture, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+	if (VERBOSE) cout << "Hi-Z pyramid " << hiZSize.x << " x " << hiZSize.y << " with " << hiZLevels << " levels" << endl;
+
+} // end resizeHiZ
+
+
+void OcclusionCulling::endFrame(const glm::mat4& viewProjection, glm::ivec2 windowDimensions)
+{
+	if (mode != GPU_OCCLUSION || windowDimensions.x <= 0 || windowDimensions.y <= 0) {
+		return;
+	}
+
+	if (hiZProgram == 0) {
+
+		buildComputeProgram("Shaders/hiZBuildShader.glsl", hiZProgram);
+		buildComputeProgram("Shaders/occlusionCullingShader.glsl", cullingProgram);
+
+		glCreateBuffers(1, &boundsBuffer);
+		glCreateBuffers(1, &resultsBuffer);
+	}
+
+	if (windowDimensions != hiZSize) {
+		resizeHiZ(windowDimensions);
+	}
+
+	// Copy the depth of the frame
+	glBlitNamedFramebuffer(0, depthCopyFramebuffer, 0, 0, hiZSize.x, hiZSize.y,
+						   0, 0, hiZSize.x, hiZSize.y, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+
+	// Build the pyramid one level at a time. Level zero is converted from the copy.
+	glUseProgram(hiZProgram);
+	glBindTextureUnit(depthCopyTextureUnit, depthCopyTexture);
+	glBindTextureUnit(hiZTextureUnit, hiZTexture);
+
+	for (int level = 0; level < hiZLevels; level++) {
+
+		glm::ivec2 levelSize = glm::max(glm::ivec2(hiZSize.x >> level, hiZSize.y >> level), glm::ivec2(1, 1));
+
+		glUniform1i(hiZSourceLevelLocation, level - 1);
+		glBindImageTexture(0, hiZTexture, level, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32F);
+
+		glDispatchCompute((levelSize.x + 7) / 8, (levelSize.y + 7) / 8, 1);
+
+		// The next level reads this one
+		glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT | GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+	}
+
+	hiZViewProjection = viewProjection;
+
+	if (meshes.empty()) {
+		return;
+	}
+
+	// Upload the bounds of the meshes of this frame
+	if (meshes.size() > bufferCapacity) {
+
+		bufferCapacity = std::max(meshes.size(), 2 * bufferCapacity);
+
+		glNamedBufferData(boundsBuffer, bufferCapacity * sizeof(MeshBounds), nullptr, GL_DYNAMIC_DRAW);
+		glNamedBufferData(resultsBuffer, bufferCapacity * sizeof(GLuint), nullptr, GL_DYNAMIC_READ);
+	}
+
+	glNamedBufferSubData(boundsBuffer, 0, meshBounds.size() * sizeof(MeshBounds), meshBounds.data());
+
+	// Test every mesh against the pyramid
+	glUseProgram(cullingProgram);
+	glUniformMatrix4fv(occlusionViewProjectionLocation, 1, GL_FALSE, glm::value_ptr(viewProjection));
+	glUniform1ui(occlusionMeshCountLocation, static_cast<GLuint>(meshes.size()));
+
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, occlusionBoundsBindingPoint, boundsBuffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, occlusionResultsBindingPoint, resultsBuffer);
+
+	glDispatchCompute((static_cast<GLuint>(meshes.size()) + 63) / 64, 1, 1);
+
+	// The results are read with glGetNamedBufferSubData in the next frame
+	glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+
+	testedMeshes = meshes;
+	resultsFence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+} // end endFrame
+
+
+void OcclusionCulling::unload()
+{
+	if (resultsFence != 0) {
+
+		glDeleteSync(resultsFence);
+		resultsFence = 0;
+	}
+
+	glDeleteTextures(1, &depthCopyTexture);
+	glDeleteFramebuffers(1, &depthCopyFramebuffer);
+	glDeleteTextures(1, &hiZTexture);
+	glDeleteBuffers(1, &boundsBuffer);
+	glDeleteBuffers(1, &resultsBuffer);
+
+	depthCopyTexture = depthCopyFramebuffer = hiZTexture = 0;
+	boundsBuffer = resultsBuffer = 0;
+	bufferCapacity = 0;
+	hiZSize = glm::ivec2(0, 0);
+
+	// The compute shaders are deleted along with all other programs by deleteAllShaderPrograms
+	hiZProgram = cullingProgram = 0;
+
+	occludedMeshes.clear();
+	testedMeshes.clear();
+
+} // end unload
@@ -0,0 +1,205 @@
+#pragma once
+
+#include <unordered_set>
+
+#include "MathLibsConstsFuncs.h"
+#include "MeshComponent.h"
+
+using namespace constants_and_types;
+
+// Methods of testing meshes for occlusion
+enum OCCLUSION_MODE { NO_OCCLUSION = 0, GPU_OCCLUSION, CPU_OCCLUSION };
+
+// Size of the depth buffer that occluders are rasterized into by the CPU
+static const int SOFTWARE_DEPTH_WIDTH = 256;
+static const int SOFTWARE_DEPTH_HEIGHT = 128;
+
+// Shader storage buffer binding points of the mesh bounds and the results of
+// the occlusion culling compute shader
+static const GLuint occlusionBoundsBindingPoint = 9;
+static const GLuint occlusionResultsBindingPoint = 10;
+
+// Uniform locations in the Hi-Z and occlusion culling compute shaders
+static const GLuint hiZSourceLevelLocation = 0;
+static const GLuint occlusionViewProjectionLocation = 0;
+static const GLuint occlusionMeshCountLocation = 1;
+
+/**
+ * @class	OcclusionCulling
+ *
+ * @brief	Skips MeshComponents that are hidden behind other geometry and
+ * 			optionally renders a depth pre-pass so that the shading of hidden
+ * 			surfaces is rejected by the early depth test.
+ *
+ * 			GPU_OCCLUSION copies the depth buffer at the end of each frame and
+ * 			reduces it to a hierarchical depth (Hi-Z) pyramid in which each texel
+ * 			holds the farthest depth of the texels it covers. A compute shader then
+ * 			tests the screen rectangle of the bounding box of every mesh against the
+ * 			pyramid level where the rectangle covers at most 2x2 texels. The results
+ * 			are read back in the next frame, so a mesh that comes into view from
+ * 			behind an occluder appears one frame late.
+ *
+ * 			CPU_OCCLUSION rasterizes the triangles of small meshes (those that keep
+ * 			a copy of their positions, see MAX_OCCLUDER_VERTICES) into a low
+ * 			resolution depth buffer and tests the bounding boxes against it in the
+ * 			same frame. It does not need the GPU and is useful for comparison.
+ */
+class OcclusionCulling
+{
+public:
+
+	/**
+	 * @fn	static void OcclusionCulling::setMode(OCCLUSION_MODE mode)
+	 *
+	 * @brief	Selects how meshes are tested for occlusion.
+	 */
+	static void setMode(OCCLUSION_MODE mode);
+	static OCCLUSION_MODE getMode() { return mode; }
+
+	/**
+	 * @fn	static void OcclusionCulling::setDepthPrePassEnabled(bool enabled)
+	 *
+	 * @brief	Enables rendering the depth of opaque meshes before the scene is shaded.
+	 */
+	static void setDepthPrePassEnabled(bool enabled) { depthPrePassEnabled = enabled; }
+	static bool getDepthPrePassEnabled() { return depthPrePassEnabled; }
+
+	/**
+	 * @fn	static void OcclusionCulling::beginFrame(const glm::mat4& viewProjection);
+	 *
+	 * @brief	Determines which meshes are occluded. Should be called once per
+	 * 			frame after the RenderQueue has been built and before anything that
+	 * 			uses the results, e.g. GPUDrivenRenderer::prepare.
+	 *
+	 * @param	viewProjection	The view-projection matrix of the frame.
+	 */
+	static void beginFrame(const glm::mat4& viewProjection);
+
+	/**
+	 * @fn	static void OcclusionCulling::renderDepthPrePass(const glm::mat4& viewProjection);
+	 *
+	 * @brief	Renders the depth of the opaque meshes that are not occluded if the
+	 * 			depth pre-pass is enabled. Should be called after beginFrame, once
+	 * 			the window is bound and cleared and before the scene is shaded.
+	 *
+	 * @param	viewProjection	The view-projection matrix of the frame.
+	 */
+	static void renderDepthPrePass(const glm::mat4& viewProjection);
+
+	/**
+	 * @fn	static bool OcclusionCulling::isOccluded(const MeshComponent* mesh)
+	 *
+	 * @brief	Determines if a mesh was found to be hidden by beginFrame.
+	 */
+	static bool isOccluded(const MeshComponent* mesh) { return occludedMeshes.count(mesh) > 0; }
+
+	/**
+	 * @fn	static void OcclusionCulling::endFrame(const glm::mat4& viewProjection, glm::ivec2 windowDimensions);
+	 *
+	 * @brief	Builds the Hi-Z pyramid from the depth of the frame and starts the
+	 * 			occlusion tests for the next frame. Should be called after the scene
+	 * 			has been rendered into the window.
+	 *
+	 * @param	viewProjection  	The view-projection matrix of the frame.
+	 * @param	windowDimensions	Size of the framebuffer in pixels.
+	 */
+	static void endFrame(const glm::mat4& viewProjection, glm::ivec2 windowDimensions);
+
+	/**
+	 * @fn	static int OcclusionCulling::getOccludedCount()
+	 *
+	 * @brief	Gets the number of meshes skipped in the current frame.
+	 */
+	static int getOccludedCount() { return static_cast<int>(occludedMeshes.size()); }
+
+	/**
+	 * @fn	static GLuint OcclusionCulling::getHiZTexture()
+	 *
+	 * @brief	Gets the Hi-Z pyramid built by the last call to endFrame, or zero if
+	 * 			there is none. Other passes may test against it with the
+	 * 			view-projection matrix it was built with.
+	 */
+	static GLuint getHiZTexture() { return mode == GPU_OCCLUSION ? hiZTexture : 0; }
+	static const glm::mat4& getHiZViewProjection() { return hiZViewProjection; }
+
+	/**
+	 * @fn	static void OcclusionCulling::unload();
+	 *
+	 * @brief	Deletes the depth copy, the Hi-Z pyramid and the buffers.
+	 */
+	static void unload();
+
+protected:
+
+	/**
+	 * @struct	MeshBounds
+	 *
+	 * @brief	World space bounding box of a mesh (std430 layout).
+	 */
+	struct MeshBounds {
+
+		glm::vec4 boundsMin;
+		glm::vec4 boundsMax;
+	};
+
+	/**
+	 * @fn	static void OcclusionCulling::gatherMeshBounds();
+	 *
+	 * @brief	Computes the bounding box of every mesh in the RenderQueue.
+	 */
+	static void gatherMeshBounds();
+
+	/**
+	 * @fn	static void OcclusionCulling::readGPUResults();
+	 *
+	 * @brief	Reads the results of the occlusion tests started by the last call
+	 * 			to endFrame if the GPU has finished them.
+	 */
+	static void readGPUResults();
+
+	/**
+	 * @fn	static void OcclusionCulling::cullOnCPU(const glm::mat4& viewProjection);
+	 *
+	 * @brief	Rasterizes the occluders and tests the meshes on the CPU.
+	 */
+	static void cullOnCPU(const glm::mat4& viewProjection);
+
+	/**
+	 * @fn	static void OcclusionCulling::resizeHiZ(glm::ivec2 windowDimensions);
+	 *
+	 * @brief	Creates the depth copy and Hi-Z pyramid for the size of the window.
+	 */
+	static void resizeHiZ(glm::ivec2 windowDimensions);
+
+	/** @brief	Current settings */
+	static OCCLUSION_MODE mode;
+	static bool depthPrePassEnabled;
+
+	/** @brief	Meshes found to be hidden */
+	static std::unordered_set<const MeshComponent*> occludedMeshes;
+
+	/** @brief	Meshes and bounds of the current frame, and the meshes the pending GPU
+	 * 			tests were started for */
+	static std::vector<const MeshComponent*> meshes;
+	static std::vector<MeshBounds> meshBounds;
+	static std::vector<const MeshComponent*> testedMeshes;
+
+	/** @brief	Depth copy, Hi-Z pyramid and their size */
+	static GLuint depthCopyTexture;
+	static GLuint depthCopyFramebuffer;
+	static GLuint hiZTexture;
+	static glm::ivec2 hiZSize;
+	static int hiZLevels;
+	static glm::mat4 hiZViewProjection;
+
+	/** @brief	Compute shaders */
+	static GLuint hiZProgram;
+	static GLuint cullingProgram;
+
+	/** @brief	Bounds and results buffers, their capacity in meshes, and the fence of the pending tests */
+	static GLuint boundsBuffer;
+	static GLuint resultsBuffer;
+	static size_t bufferCapacity;
+	static GLsync resultsFence;
+
+}; // end OcclusionCulling
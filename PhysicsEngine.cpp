@@ -0,0 +1,404 @@
+#include "PhysicsEngine.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+#include "RigidBodyComponent.h"
+#include "GameObject.h"
+#include "ThreadPool.h"
+
+static const bool VERBOSE = false;
+
+// Static variable definitions (Static variables must be defined outside the declaration)
+std::unique_ptr<PhysicsTaskScheduler> PhysicsEngine::taskScheduler;
+std::unique_ptr<PhysicsWorld> PhysicsEngine::physicsWorld;
+std::thread PhysicsEngine::simulationThread;
+std::mutex PhysicsEngine::simulationMutex;
+std::condition_variable PhysicsEngine::simulationChanged;
+int PhysicsEngine::requestedSteps = 0;
+bool PhysicsEngine::stopping = false;
+int PhysicsEngine::pendingSteps = 0;
+PhysicsStats PhysicsEngine::stats;
+std::vector<RigidBodyComponent*> PhysicsEngine::rigidBodies;
+ContactManager PhysicsEngine::contactManager;
+float PhysicsEngine::accumulatedTime = 0.0f;
+
+
+PhysicsWorld::PhysicsWorld(const vec3& gravity)
+{
+	// The dispatcher and world size their per-thread arrays by the scheduler's thread
+	// count, but index them by the Bullet index of whichever thread runs a loop. Size
+	// them for every thread that may run Bullet code, whatever the current count.
+	btITaskScheduler* scheduler = btGetTaskScheduler();
+	int threadCount = scheduler->getNumThreads();
+	int maxThreadCount = std::max(scheduler->getMaxNumThreads(), 1);
+
+	scheduler->setNumThreads(maxThreadCount);
+
+	collisionConfiguration = std::make_unique<btDefaultCollisionConfiguration>();
+	dispatcher = std::make_unique<btCollisionDispatcherMt>(collisionConfiguration.get(), PHYSICS_PAIRS_PER_TASK);
+	broadphase = std::make_unique<btDbvtBroadphase>();
+	solverPool = std::make_unique<btConstraintSolverPoolMt>(maxThreadCount);
+	solver = std::make_unique<btSequentialImpulseConstraintSolverMt>();
+	world = std::make_unique<btDiscreteDynamicsWorldMt>(dispatcher.get(), broadphase.get(), solverPool.get(), solver.get(), collisionConfiguration.get());
+
+	scheduler->setNumThreads(threadCount);
+
+	world->setGravity(btVector3(gravity.x, gravity.y, gravity.z));
+
+} // end PhysicsWorld constructor
+
+
+bool PhysicsEngine::initialize(const vec3& gravity)
+{
+	// Bullet's parallel loops must have a scheduler before any world is created
+	if (taskScheduler == nullptr) {
+
+		taskScheduler = std::make_unique<PhysicsTaskScheduler>();
+		btSetTaskScheduler(taskScheduler.get());
+	}
+
+	physicsWorld = std::make_unique<PhysicsWorld>(gravity);
+
+	accumulatedTime = 0.0f;
+	pendingSteps = 0;
+	requestedSteps = 0;
+	stopping = false;
+
+	simulationThread = std::thread(simulationLoop);
+
+	if (VERBOSE) cout << "Physics engine initialized with " << taskScheduler->getNumThreads() << " threads" << endl;
+
+	return true;
+
+} // end initialize
+
+
+void PhysicsEngine::simulationLoop()
+{
+	while (true) {
+
+		int steps;
+
+		{
+			std::unique_lock<std::mutex> lock(simulationMutex);
+
+			simulationChanged.wait(lock, [] { return stopping || requestedSteps > 0; });
+
+			if (stopping) {
+				return;
+			}
+
+			steps = requestedSteps;
+		}
+
+		auto start = std::chrono::steady_clock::now();
+
+		for (int step = 0; step < steps; step++) {
+
+			for (RigidBodyComponent* rigidBody : rigidBodies) {
+				rigidBody->beginStep();
+			}
+
+			// Exactly one step. Bullet calls setWorldTransform of the bodies that moved.
+			physicsWorld->world->stepSimulation(PHYSICS_TIME_STEP, 0);
+
+			// Contacts are compared after every step so none are missed
+			contactManager.processStep(physicsWorld->dispatcher.get());
+		}
+
+		contactManager.endFrame();
+
+		std::chrono::duration<float, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+
+		{
+			std::lock_guard<std::mutex> lock(simulationMutex);
+
+			stats.steps = steps;
+			stats.stepMilliseconds = elapsed.count() / steps;
+			stats.contacts = contactManager.getContactCount();
+			stats.contactEvents = contactManager.getEventCount();
+
+			requestedSteps = 0;
+		}
+
+		simulationChanged.notify_all();
+	}
+
+} // end simulationLoop
+
+
+void PhysicsEngine::synchronize()
+{
+	if (!simulationThread.joinable()) {
+		return;
+	}
+
+	std::unique_lock<std::mutex> lock(simulationMutex);
+
+	simulationChanged.wait(lock, [] { return requestedSteps == 0; });
+
+} // end synchronize
+
+
+void PhysicsEngine::update(const float& deltaTime)
+{
+	if (physicsWorld == nullptr) {
+		return;
+	}
+
+	// The steps of the last frame must be finished before their results are read
+	synchronize();
+
+	accumulatedTime += deltaTime;
+
+	int steps = static_cast<int>(accumulatedTime / PHYSICS_TIME_STEP);
+
+	if (steps > PHYSICS_MAX_STEPS_PER_UPDATE) {
+
+		steps = PHYSICS_MAX_STEPS_PER_UPDATE;
+		accumulatedTime = steps * PHYSICS_TIME_STEP;
+	}
+
+	accumulatedTime -= steps * PHYSICS_TIME_STEP;
+
+	// Draw the dynamic bodies between the poses of the last two steps that have
+	// been taken. The steps counted now are shown in the next frame.
+	float fraction = getInterpolationFraction();
+
+	for (RigidBodyComponent* rigidBody : rigidBodies) {
+
+		if (rigidBody->getDynamicsState() == DYNAMIC) {
+			rigidBody->writeInterpolatedTransform(fraction);
+		}
+	}
+
+	// Handlers may change game objects and rigid bodies as the physics thread is idle
+	contactManager.dispatchEvents();
+
+	pendingSteps += steps;
+
+} // end update
+
+
+void PhysicsEngine::startSimulation()
+{
+	if (physicsWorld == nullptr || pendingSteps == 0) {
+		return;
+	}
+
+	synchronize();
+
+	for (RigidBodyComponent* rigidBody : rigidBodies) {
+
+		if (rigidBody->getDynamicsState() == KINEMATIC) {
+			rigidBody->readKinematicTransform();
+		}
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(simulationMutex);
+
+		requestedSteps = pendingSteps;
+	}
+
+	pendingSteps = 0;
+
+	simulationChanged.notify_all();
+
+} // end startSimulation
+
+
+void PhysicsEngine::addRigidBody(RigidBodyComponent* rigidBody)
+{
+	if (physicsWorld == nullptr) {
+
+		std::cerr << "ERROR: Rigid body added before the physics engine was initialized." << endl;
+		return;
+	}
+
+	synchronize();
+
+	physicsWorld->world->addRigidBody(rigidBody->getRigidBody(),
+									  static_cast<int>(1u << rigidBody->getCollisionLayer()), rigidBody->getCollisionMask());
+
+	rigidBodies.push_back(rigidBody);
+
+} // end addRigidBody
+
+
+void PhysicsEngine::removeRigidBody(RigidBodyComponent* rigidBody, bool keepContacts)
+{
+	auto iter = std::find(rigidBodies.begin(), rigidBodies.end(), rigidBody);
+
+	if (iter == rigidBodies.end()) {
+		return;
+	}
+
+	synchronize();
+
+	physicsWorld->world->removeRigidBody(rigidBody->getRigidBody());
+
+	std::iter_swap(iter, rigidBodies.end() - 1);
+	rigidBodies.pop_back();
+
+	// Contacts that still hold after the body is added back are kept, the others
+	// exit after the next step
+	if (!keepContacts) {
+		contactManager.removeBody(rigidBody);
+	}
+
+} // end removeRigidBody
+
+
+void PhysicsEngine::setGravity(const vec3& gravity)
+{
+	if (physicsWorld != nullptr) {
+
+		synchronize();
+		physicsWorld->world->setGravity(btVector3(gravity.x, gravity.y, gravity.z));
+	}
+
+} // end setGravity
+
+
+PhysicsStats PhysicsEngine::getStats()
+{
+	std::lock_guard<std::mutex> lock(simulationMutex);
+
+	PhysicsStats current = stats;
+	current.rigidBodies = static_cast<int>(rigidBodies.size());
+	current.threads = taskScheduler != nullptr ? taskScheduler->getNumThreads() : 0;
+
+	return current;
+
+} // end getStats
+
+
+void PhysicsEngine::runBenchmark(int boxCount, int steps)
+{
+	if (taskScheduler == nullptr) {
+
+		taskScheduler = std::make_unique<PhysicsTaskScheduler>();
+		btSetTaskScheduler(taskScheduler.get());
+	}
+
+	// Towers of boxes one meter on a side, in rows of towers two meters apart
+	const int towerCount = (boxCount + BENCHMARK_BOXES_PER_TOWER - 1) / BENCHMARK_BOXES_PER_TOWER;
+	const int towersPerRow = static_cast<int>(std::ceil(std::sqrt(static_cast<float>(towerCount))));
+
+	btBoxShape groundShape(btVector3(towersPerRow + 1.0f, 0.5f, towersPerRow + 1.0f));
+	btBoxShape boxShape(btVector3(0.5f, 0.5f, 0.5f));
+
+	btVector3 boxInertia(0.0f, 0.0f, 0.0f);
+	boxShape.calculateLocalInertia(1.0f, boxInertia);
+
+	int maxThreads = taskScheduler->getMaxNumThreads();
+	int savedThreads = taskScheduler->getNumThreads();
+	float singleThreadMilliseconds = 0.0f;
+
+	cout << "Physics benchmark: " << boxCount << " stacked boxes, " << steps << " steps" << endl;
+
+#ifndef BT_THREADSAFE
+	cout << "Bullet was built without BT_THREADSAFE; every step runs on one thread." << endl;
+#endif
+
+	for (int threads = 1; ; threads = std::min(threads * 2, maxThreads)) {
+
+		taskScheduler->setNumThreads(threads);
+
+		PhysicsWorld benchmarkWorld(vec3(0.0f, -9.81f, 0.0f));
+
+		std::vector<std::unique_ptr<btRigidBody>> bodies;
+		bodies.reserve(boxCount + 1);
+
+		btTransform pose;
+		pose.setIdentity();
+		pose.setOrigin(btVector3(0.0f, -0.5f, 0.0f));
+
+		btRigidBody::btRigidBodyConstructionInfo groundInfo(0.0f, nullptr, &groundShape);
+		groundInfo.m_startWorldTransform = pose;
+		bodies.push_back(std::make_unique<btRigidBody>(groundInfo));
+
+		for (int box = 0; box < boxCount; box++) {
+
+			int tower = box / BENCHMARK_BOXES_PER_TOWER;
+			float x = 2.0f * (tower % towersPerRow - 0.5f * towersPerRow);
+			float z = 2.0f * (tower / towersPerRow - 0.5f * towersPerRow);
+
+			pose.setOrigin(btVector3(x, 0.5f + box % BENCHMARK_BOXES_PER_TOWER, z));
+
+			btRigidBody::btRigidBodyConstructionInfo boxInfo(1.0f, nullptr, &boxShape, boxInertia);
+			boxInfo.m_startWorldTransform = pose;
+			bodies.push_back(std::make_unique<btRigidBody>(boxInfo));
+
+			// Resting stacks would fall asleep and stop costing anything
+			bodies.back()->setActivationState(DISABLE_DEACTIVATION);
+		}
+
+		for (std::unique_ptr<btRigidBody>& body : bodies) {
+			benchmarkWorld.world->addRigidBody(body.get());
+		}
+
+		auto start = std::chrono::steady_clock::now();
+
+		for (int step = 0; step < steps; step++) {
+			benchmarkWorld.world->stepSimulation(PHYSICS_TIME_STEP, 0);
+		}
+
+		std::chrono::duration<float, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+		float stepMilliseconds = elapsed.count() / steps;
+
+		if (threads == 1) {
+			singleThreadMilliseconds = stepMilliseconds;
+		}
+
+		cout << "  " << threads << " threads: " << stepMilliseconds << " ms per step, "
+			 << singleThreadMilliseconds / stepMilliseconds << "x speedup" << endl;
+
+		for (std::unique_ptr<btRigidBody>& body : bodies) {
+			benchmarkWorld.world->removeRigidBody(body.get());
+		}
+
+		if (threads == maxThreads) {
+			break;
+		}
+	}
+
+	taskScheduler->setNumThreads(savedThreads);
+
+} // end runBenchmark
+
+
+void PhysicsEngine::unload()
+{
+	if (physicsWorld == nullptr) {
+		return;
+	}
+
+	// Stop the physics thread once it has finished its steps
+	synchronize();
+
+	{
+		std::lock_guard<std::mutex> lock(simulationMutex);
+		stopping = true;
+	}
+
+	simulationChanged.notify_all();
+	simulationThread.join();
+
+	// The components outlive the world, so their bodies are taken out first
+	for (RigidBodyComponent* rigidBody : rigidBodies) {
+		physicsWorld->world->removeRigidBody(rigidBody->getRigidBody());
+	}
+
+	rigidBodies.clear();
+	contactManager.clear();
+
+	physicsWorld.reset();
+
+	btSetTaskScheduler(btGetSequentialTaskScheduler());
+	taskScheduler.reset();
+
+} // end unload
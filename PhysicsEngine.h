@@ -0,0 +1,277 @@
+#pragma once
+
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include "MathLibsConstsFuncs.h"
+
+#include "Bullet/btBulletDynamicsCommon.h"
+#include "Bullet/BulletCollision/CollisionDispatch/btCollisionDispatcherMt.h"
+#include "Bullet/BulletDynamics/ConstraintSolver/btSequentialImpulseConstraintSolverMt.h"
+#include "Bullet/BulletDynamics/Dynamics/btDiscreteDynamicsWorldMt.h"
+
+#include "ContactManager.h"
+#include "PhysicsTaskScheduler.h"
+
+using namespace constants_and_types;
+
+// Simulated time advanced by each step of the physics world
+static const float PHYSICS_TIME_STEP = 1.0f / 60.0f;
+
+// Most steps taken in one update. Time beyond this is dropped so that a long
+// frame does not make the next one longer still.
+static const int PHYSICS_MAX_STEPS_PER_UPDATE = 4;
+
+// Fewest collision pairs processed by one task of the dispatcher
+static const int PHYSICS_PAIRS_PER_TASK = 40;
+
+// Boxes in each tower of the physics benchmark
+static const int BENCHMARK_BOXES_PER_TOWER = 10;
+
+/**
+ * @struct	PhysicsWorld
+ *
+ * @brief	A multithreaded Bullet world and the parts it is made of. The parts are
+ * 			declared in the order they are created, so they are destroyed in the
+ * 			reverse order.
+ */
+struct PhysicsWorld {
+
+	std::unique_ptr<btDefaultCollisionConfiguration> collisionConfiguration;
+
+	// Finds the contacts of the overlapping pairs in parallel
+	std::unique_ptr<btCollisionDispatcherMt> dispatcher;
+
+	std::unique_ptr<btDbvtBroadphase> broadphase;
+
+	// One solver per thread for the islands that are solved in parallel
+	std::unique_ptr<btConstraintSolverPoolMt> solverPool;
+
+	// Solves large islands with parallel batches of constraints
+	std::unique_ptr<btSequentialImpulseConstraintSolverMt> solver;
+
+	std::unique_ptr<btDiscreteDynamicsWorldMt> world;
+
+	/**
+	 * @fn	PhysicsWorld::PhysicsWorld(const vec3& gravity);
+	 *
+	 * @brief	Creates the world.
+	 */
+	PhysicsWorld(const vec3& gravity);
+};
+
+/**
+ * @struct	PhysicsStats
+ *
+ * @brief	Cost of stepping the world.
+ */
+struct PhysicsStats {
+
+	// Rigid bodies in the world
+	int rigidBodies = 0;
+
+	// Threads the parallel loops of a step are split across
+	int threads = 0;
+
+	// Steps taken during the last frame
+	int steps = 0;
+
+	// Time taken by one step, averaged over the steps of the last frame
+	float stepMilliseconds = 0.0f;
+
+	// Pairs of bodies touching after the last step
+	int contacts = 0;
+
+	// Collision events found during the steps of the last frame
+	int contactEvents = 0;
+};
+
+/**
+ * @class	PhysicsEngine
+ *
+ * @brief	Owns the Bullet dynamics world and steps it at a fixed rate. The time of
+ * 			each update is accumulated and the world is stepped once for every
+ * 			PHYSICS_TIME_STEP that has built up. Rigid bodies are then drawn part
+ * 			way between the poses of the last two steps by the fraction of a step
+ * 			left over, so motion is smooth however the frame rate and the step rate
+ * 			line up.
+ *
+ * 			The world is stepped on a thread of its own while the main thread
+ * 			renders the frame, so the poses shown are those of the steps taken
+ * 			during the previous frame. The parallel parts of each step are run on
+ * 			the ThreadPool. Game objects and rigid bodies may only be changed
+ * 			between synchronize and startSimulation, i.e. while input is
+ * 			processed and the game objects are updated.
+ *
+ * 			After each step the ContactManager compares the contact manifolds with
+ * 			those of the previous step. The collision events it finds are sent to
+ * 			the components of the game objects involved during the next update,
+ * 			on the main thread.
+ */
+class PhysicsEngine
+{
+public:
+
+	/**
+	 * @fn	static bool PhysicsEngine::initialize(const vec3& gravity = vec3(0.0f, -9.81f, 0.0f));
+	 *
+	 * @brief	Creates the dynamics world and starts the physics thread.
+	 *
+	 * @param 	gravity	(Optional) Acceleration of gravity in meters per second squared.
+	 *
+	 * @returns	True if the world was created.
+	 */
+	static bool initialize(const vec3& gravity = vec3(0.0f, -9.81f, 0.0f));
+
+	/**
+	 * @fn	static void PhysicsEngine::update(const float& deltaTime);
+	 *
+	 * @brief	Writes the interpolated poses of the dynamic bodies into the scene
+	 * 			graph, dispatches the collision events of the steps taken during the
+	 * 			last frame and counts the steps needed to catch up with the time
+	 * 			accumulated so far. Called before the game objects are updated.
+	 *
+	 * @param 	deltaTime	The time in seconds since the last update.
+	 */
+	static void update(const float& deltaTime);
+
+	/**
+	 * @fn	static void PhysicsEngine::startSimulation();
+	 *
+	 * @brief	Reads the poses of the kinematic bodies from the scene graph and starts
+	 * 			the steps counted by update on the physics thread. Called once the
+	 * 			game objects have been updated, before the frame is rendered.
+	 */
+	static void startSimulation();
+
+	/**
+	 * @fn	static void PhysicsEngine::synchronize();
+	 *
+	 * @brief	Waits for the physics thread to finish its steps. Called before
+	 * 			anything that changes game objects or rigid bodies.
+	 */
+	static void synchronize();
+
+	/**
+	 * @fn	static void PhysicsEngine::runBenchmark(int boxCount = 5000, int steps = 200);
+	 *
+	 * @brief	Measures how stepping scales with the number of threads. Stacks of
+	 * 			boxes that are kept awake are stepped in a world of their own with
+	 * 			1, 2, 4, ... threads up to all threads of the ThreadPool, and the
+	 * 			time per step and the speedup over one thread are printed.
+	 *
+	 * @param 	boxCount	(Optional) Number of boxes.
+	 * @param 	steps   	(Optional) Steps timed for each number of threads.
+	 */
+	static void runBenchmark(int boxCount = 5000, int steps = 200);
+
+	/**
+	 * @fn	static void PhysicsEngine::unload();
+	 *
+	 * @brief	Stops the physics thread, removes all rigid bodies from the world and
+	 * 			destroys it.
+	 */
+	static void unload();
+
+	/**
+	 * @fn	static void PhysicsEngine::setGravity(const vec3& gravity);
+	 *
+	 * @brief	Sets the acceleration of gravity.
+	 */
+	static void setGravity(const vec3& gravity);
+
+	/**
+	 * @fn	static btDiscreteDynamicsWorld* PhysicsEngine::getWorld()
+	 *
+	 * @brief	Gets the dynamics world.
+	 *
+	 * @returns	Null if the engine has not been initialized.
+	 */
+	static btDiscreteDynamicsWorld* getWorld() { return physicsWorld != nullptr ? physicsWorld->world.get() : nullptr; }
+
+	/**
+	 * @fn	static PhysicsStats PhysicsEngine::getStats();
+	 *
+	 * @brief	Gets the cost of the steps taken during the last frame.
+	 */
+	static PhysicsStats getStats();
+
+	/**
+	 * @fn	static float PhysicsEngine::getInterpolationFraction()
+	 *
+	 * @brief	Gets the fraction of a step that has accumulated but not been simulated.
+	 */
+	static float getInterpolationFraction() { return accumulatedTime / PHYSICS_TIME_STEP; }
+
+protected:
+
+	/** @brief	friend declaration
+	 * Rigid body components add and remove their bodies as they are initialized
+	 * and destroyed.
+	 */
+	friend class RigidBodyComponent;
+
+	/**
+	 * @fn	static void PhysicsEngine::addRigidBody(class RigidBodyComponent* rigidBody);
+	 *
+	 * @brief	Adds the body of a rigid body component to the world.
+	 */
+	static void addRigidBody(class RigidBodyComponent* rigidBody);
+
+	/**
+	 * @fn	static void PhysicsEngine::removeRigidBody(class RigidBodyComponent* rigidBody, bool keepContacts = false);
+	 *
+	 * @brief	Removes the body of a rigid body component from the world. Its contacts
+	 * 			are forgotten and the bodies it touched get exit events, unless the
+	 * 			body is only removed to be added again right away.
+	 *
+	 * @param 	rigidBody   	The rigid body component.
+	 * @param 	keepContacts	(Optional) True if the body is added again right away.
+	 */
+	static void removeRigidBody(class RigidBodyComponent* rigidBody, bool keepContacts = false);
+
+	/**
+	 * @fn	static void PhysicsEngine::simulationLoop();
+	 *
+	 * @brief	Body of the physics thread. Takes the steps requested by
+	 * 			startSimulation.
+	 */
+	static void simulationLoop();
+
+	/** @brief	Runs the parallel loops of Bullet on the ThreadPool */
+	static std::unique_ptr<PhysicsTaskScheduler> taskScheduler;
+
+	/** @brief	The world the rigid body components are in */
+	static std::unique_ptr<PhysicsWorld> physicsWorld;
+
+	/** @brief	Thread that steps the world */
+	static std::thread simulationThread;
+
+	/** @brief	Guards requestedSteps and stopping and signals changes to them */
+	static std::mutex simulationMutex;
+	static std::condition_variable simulationChanged;
+
+	/** @brief	Steps the physics thread has yet to take. Zero while it is idle. */
+	static int requestedSteps;
+
+	/** @brief	Set to stop the physics thread */
+	static bool stopping;
+
+	/** @brief	Steps counted by update and not yet started */
+	static int pendingSteps;
+
+	/** @brief	Cost of the steps of the last update */
+	static PhysicsStats stats;
+
+	/** @brief	Rigid bodies in the world */
+	static std::vector<class RigidBodyComponent*> rigidBodies;
+
+	/** @brief	Touching pairs and the collision events of the steps of the last frame */
+	static ContactManager contactManager;
+
+	/** @brief	Time that has not been simulated yet. Less than one step after an update. */
+	static float accumulatedTime;
+
+}; // end PhysicsEngine
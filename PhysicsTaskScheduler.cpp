@@ -0,0 +1,110 @@
+#include "PhysicsTaskScheduler.h"
+
+#include <algorithm>
+
+#include "ThreadPool.h"
+
+static const bool VERBOSE = false;
+
+
+PhysicsTaskScheduler::PhysicsTaskScheduler()
+	: btITaskScheduler("ThreadPool")
+{
+	// The ThreadPool threads (including the main thread) and the physics thread
+	int bulletThreads = static_cast<int>(ThreadPool::getThreadCount()) + 1;
+
+	parallelLoopsEnabled = bulletThreads <= BT_MAX_THREAD_COUNT;
+
+	if (!parallelLoopsEnabled) {
+		std::cerr << "ERROR: More threads than Bullet supports. Physics loops run on the physics thread." << std::endl;
+	}
+
+	// The physics thread takes part in the loops it starts, so one per ThreadPool thread
+	threadCount = std::min(bulletThreads - 1, BT_MAX_THREAD_COUNT);
+
+	if (VERBOSE) cout << "Physics task scheduler using " << threadCount << " threads" << endl;
+
+} // end PhysicsTaskScheduler constructor
+
+
+int PhysicsTaskScheduler::getMaxNumThreads() const
+{
+	return std::min(static_cast<int>(ThreadPool::getThreadCount()) + 1, BT_MAX_THREAD_COUNT);
+
+} // end getMaxNumThreads
+
+
+void PhysicsTaskScheduler::setNumThreads(int numThreads)
+{
+	threadCount = std::max(1, std::min(numThreads, getMaxNumThreads()));
+
+} // end setNumThreads
+
+
+int PhysicsTaskScheduler::getTaskCount(int iBegin, int iEnd, int grainSize) const
+{
+	if (!parallelLoopsEnabled) {
+		return 1;
+	}
+
+	int count = iEnd - iBegin;
+
+	return std::max(1, std::min(threadCount, count / std::max(grainSize, 1)));
+
+} // end getTaskCount
+
+
+void PhysicsTaskScheduler::parallelFor(int iBegin, int iEnd, int grainSize, const btIParallelForBody& body)
+{
+	int count = iEnd - iBegin;
+	int taskCount = getTaskCount(iBegin, iEnd, grainSize);
+
+	if (taskCount == 1) {
+
+		body.forLoop(iBegin, iEnd);
+		return;
+	}
+
+	// One range of items per task. The ThreadPool runs one task per thread.
+	ThreadPool::parallelFor(taskCount, 1, [&body, iBegin, count, taskCount](size_t begin, size_t end) {
+
+		for (size_t task = begin; task < end; task++) {
+
+			body.forLoop(iBegin + static_cast<int>(count * task / taskCount),
+						 iBegin + static_cast<int>(count * (task + 1) / taskCount));
+		}
+	});
+
+} // end parallelFor
+
+
+btScalar PhysicsTaskScheduler::parallelSum(int iBegin, int iEnd, int grainSize, const btIParallelSumBody& body)
+{
+	int count = iEnd - iBegin;
+	int taskCount = getTaskCount(iBegin, iEnd, grainSize);
+
+	if (taskCount == 1) {
+		return body.sumLoop(iBegin, iEnd);
+	}
+
+	// Each task writes its own sum so no locking is needed
+	std::vector<btScalar> sums(taskCount, 0.0f);
+
+	ThreadPool::parallelFor(taskCount, 1, [&body, &sums, iBegin, count, taskCount](size_t begin, size_t end) {
+
+		for (size_t task = begin; task < end; task++) {
+
+			sums[task] = body.sumLoop(iBegin + static_cast<int>(count * task / taskCount),
+									  iBegin + static_cast<int>(count * (task + 1) / taskCount));
+		}
+	});
+
+	btScalar sum = 0.0f;
+
+	for (btScalar taskSum : sums) {
+		sum += taskSum;
+	}
+
+	return sum;
+
+} // end parallelSum
@@ -0,0 +1,104 @@
+#pragma once
+
+#include "MathLibsConstsFuncs.h"
+
+#include "Bullet/LinearMath/btThreads.h"
+
+using namespace constants_and_types;
+
+/**
+ * @class	PhysicsTaskScheduler
+ *
+ * @brief	Runs the parallel loops of the multithreaded Bullet world (collision pair
+ * 			processing, constraint solving, integration) on the engine's
+ * 			ThreadPool instead of a thread pool of Bullet's own, so physics and
+ * 			the other systems do not compete with two sets of threads for the
+ * 			cores.
+ *
+ * 			Bullet only calls the scheduler if it was built with BT_THREADSAFE
+ * 			(BULLET2_MULTITHREADING in its CMake options). Otherwise the loops
+ * 			run on the thread that steps the world.
+ *
+ * 			Bullet gives every thread that calls btGetCurrentThreadIndex the next
+ * 			free index, and the multithreaded dispatcher and world index their
+ * 			per-thread arrays with it. Bullet code may only run on a fixed set of
+ * 			threads: the main thread (index 0, as it sets the scheduler), the
+ * 			physics thread and the ThreadPool workers, which also run the loops
+ * 			the main thread picks up while waiting in ThreadPool::waitUntil.
+ * 			getMaxNumThreads counts all of them and worlds must size their
+ * 			per-thread arrays with it, not with getNumThreads. If there are more
+ * 			of them than BT_MAX_THREAD_COUNT the loops run on the thread that
+ * 			steps the world.
+ */
+class PhysicsTaskScheduler : public btITaskScheduler
+{
+public:
+
+	/**
+	 * @fn	PhysicsTaskScheduler::PhysicsTaskScheduler();
+	 *
+	 * @brief	Constructor. Splits the loops across every thread of the ThreadPool.
+	 */
+	PhysicsTaskScheduler();
+
+	/**
+	 * @fn	virtual int PhysicsTaskScheduler::getMaxNumThreads() const override;
+	 *
+	 * @brief	Gets the number of threads that may run Bullet code: the ThreadPool
+	 * 			threads and the physics thread.
+	 */
+	virtual int getMaxNumThreads() const override;
+
+	/**
+	 * @fn	virtual int PhysicsTaskScheduler::getNumThreads() const override
+	 *
+	 * @brief	Gets the number of threads the loops are split across.
+	 */
+	virtual int getNumThreads() const override { return threadCount; }
+
+	/**
+	 * @fn	virtual void PhysicsTaskScheduler::setNumThreads(int numThreads) override;
+	 *
+	 * @brief	Limits the number of threads the loops are split across. Used to
+	 * 			measure how stepping scales with the number of cores.
+	 *
+	 * @param 	numThreads	Number of threads. Clamped to [1, getMaxNumThreads()].
+	 */
+	virtual void setNumThreads(int numThreads) override;
+
+	/**
+	 * @fn	virtual void PhysicsTaskScheduler::parallelFor(int iBegin, int iEnd, int grainSize, const btIParallelForBody& body) override;
+	 *
+	 * @brief	Calls body.forLoop for ranges that together cover [iBegin, iEnd) and
+	 * 			returns when all have finished.
+	 *
+	 * @param 	iBegin   	First item.
+	 * @param 	iEnd	 	One past the last item.
+	 * @param 	grainSize	Fewest items worth a task of their own.
+	 * @param 	body	 	The loop body.
+	 */
+	virtual void parallelFor(int iBegin, int iEnd, int grainSize, const btIParallelForBody& body) override;
+
+	/**
+	 * @fn	virtual btScalar PhysicsTaskScheduler::parallelSum(int iBegin, int iEnd, int grainSize, const btIParallelSumBody& body) override;
+	 *
+	 * @brief	Like parallelFor, but adds up the values returned by body.sumLoop.
+	 */
+	virtual btScalar parallelSum(int iBegin, int iEnd, int grainSize, const btIParallelSumBody& body) override;
+
+protected:
+
+	/**
+	 * @fn	int PhysicsTaskScheduler::getTaskCount(int iBegin, int iEnd, int grainSize) const;
+	 *
+	 * @brief	Gets the number of ranges a loop is split into.
+	 */
+	int getTaskCount(int iBegin, int iEnd, int grainSize) const;
+
+	/** @brief	Threads the loops are split across */
+	int threadCount;
+
+	/** @brief	False if the threads could be given more indices than Bullet supports */
+	bool parallelLoopsEnabled;
+
+}; // end PhysicsTaskScheduler
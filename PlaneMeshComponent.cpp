@@ -0,0 +1,46 @@
+#include "PlaneMeshComponent.h"
+
+#include "ProceduralGeometry.h"
+
+// Half the thickness of the collision box of a plane. A box without thickness has
+// no collision margin and fast bodies pass through it.
+static const float PLANE_COLLISION_HALF_THICKNESS = 0.01f;
+
+
+PlaneMeshComponent::PlaneMeshComponent(GLuint shaderProgram, Material mat, float width, float depth, int columns, int rows, int updateOrder)
+	: ProceduralMeshComponent(shaderProgram, mat, updateOrder), width(width), depth(depth), columns(columns), rows(rows)
+{
+}
+
+
+size_t PlaneMeshComponent::getGeometryKey() const
+{
+	return hashGeometry("Plane", { width, depth, static_cast<float>(columns), static_cast<float>(rows) });
+}
+
+
+void PlaneMeshComponent::generateGeometry(int subMeshIndex, std::vector<pntVertexData>& vertexData, std::vector<unsigned int>& indices) const
+{
+	ProceduralGeometry::plane(width, depth, columns, rows, vertexData, indices);
+}
+
+
+std::shared_ptr<btCollisionShape> PlaneMeshComponent::createCollisionShape() const
+{
+	// A thin box, so that the plane can be moved and rotated like other objects. Its
+	// top face is level with the plane.
+	std::shared_ptr<btCompoundShape> compoundShape = makeCompoundShape();
+
+	btTransform offset;
+	offset.setIdentity();
+	offset.setOrigin(btVector3(0.0f, -PLANE_COLLISION_HALF_THICKNESS, 0.0f));
+
+	btBoxShape* box = new btBoxShape(btVector3(width / 2.0f, PLANE_COLLISION_HALF_THICKNESS, depth / 2.0f));
+
+	// The default margin is thicker than the box, which would leave the box inside out
+	box->setMargin(PLANE_COLLISION_HALF_THICKNESS);
+
+	compoundShape->addChildShape(offset, box);
+
+	return compoundShape;
+}
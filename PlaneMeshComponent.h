@@ -0,0 +1,30 @@
+#pragma once
+#include "ProceduralMeshComponent.h"
+
+/**
+ * @class	PlaneMeshComponent
+ *
+ * @brief	Flat rectangle in the XZ plane facing +Y, centered on the origin. It is
+ * 			divided into a grid of quads so that it can be lit per vertex and
+ * 			displaced.
+ */
+class PlaneMeshComponent : public ProceduralMeshComponent
+{
+public:
+	PlaneMeshComponent(GLuint shaderProgram, Material mat, float width = 10.0f, float depth = 10.0f,
+					   int columns = 10, int rows = 10, int updateOrder = 100);
+
+protected:
+
+	virtual size_t getGeometryKey() const override;
+
+	virtual void generateGeometry(int subMeshIndex, std::vector<pntVertexData>& vertexData, std::vector<unsigned int>& indices) const override;
+
+	virtual std::shared_ptr<btCollisionShape> createCollisionShape() const override;
+
+	float width, depth;
+
+	// Quads along X and Z
+	int columns, rows;
+
+}; // end PlaneMeshComponent
@@ -0,0 +1,720 @@
+#include "ProceduralGeometry.h"
+
+#include <algorithm>
+#include <unordered_map>
+
+#include "ThreadPool.h"
+
+static const bool VERBOSE = false;
+
+
+void ProceduralGeometry::forEachRow(size_t rows, size_t rowSize, const std::function<void(size_t row)>& body)
+{
+	auto writeRows = [&body](size_t begin, size_t end) {
+
+		for (size_t row = begin; row < end; row++) {
+			body(row);
+		}
+	};
+
+	if (rows * rowSize < PARALLEL_TESSELLATION_VERTICES) {
+
+		writeRows(0, rows);
+	}
+	else {
+
+		// Every row is written to its own part of the vectors, so the rows need no locking
+		ThreadPool::parallelFor(rows, 1, writeRows);
+	}
+
+} // end forEachRow
+
+
+void ProceduralGeometry::revolve(const std::vector<ProfilePoint>& profile, int slices, std::vector<pntVertexData>& vertexData, std::vector<unsigned int>& indices)
+{
+	slices = std::max(slices, 3);
+
+	if (profile.size() < 2) {
+
+		std::cerr << "ProceduralGeometry: a surface of revolution needs at least two profile points" << std::endl;
+		vertexData.clear();
+		indices.clear();
+		return;
+	}
+
+	const size_t rows = profile.size();
+	const size_t bands = rows - 1;
+	const bool bottomPole = profile.front().radius == 0.0f;
+	const bool topPole = profile.back().radius == 0.0f && bands > 1;
+
+	// Sines and cosines of the slice angles are computed once for all rows.
+	// Each pole vertex is in the middle of the one triangle that uses it, so
+	// pole rows are offset by half a slice.
+	const float sliceInc = (2.0f * PI) / slices;
+	const size_t rowSize = slices + 1;
+
+	std::vector<float> sines(rowSize), cosines(rowSize), poleSines(rowSize), poleCosines(rowSize);
+
+	for (size_t slice = 0; slice < rowSize; slice++) {
+
+		sines[slice] = glm::sin(slice * sliceInc);
+		cosines[slice] = glm::cos(slice * sliceInc);
+		poleSines[slice] = glm::sin(sliceInc / 2.0f + slice * sliceInc);
+		poleCosines[slice] = glm::cos(sliceInc / 2.0f + slice * sliceInc);
+	}
+
+	// One row of vertices for every profile point. The first and last vertex
+	// of a row are at the same position but on opposite sides of the texture seam.
+	vertexData.assign(rows * rowSize, pntVertexData());
+
+	forEachRow(rows, rowSize, [&](size_t row) {
+
+		const ProfilePoint& point = profile[row];
+		const bool pole = (row == 0 && bottomPole) || (row == rows - 1 && topPole);
+		const float* rowSines = pole ? poleSines.data() : sines.data();
+		const float* rowCosines = pole ? poleCosines.data() : cosines.data();
+		const float uOffset = pole ? 0.5f / slices : 0.0f;
+
+		// Direction of the profile at this point, at right angles to its normal
+		const glm::vec2 along(-point.normal.y, point.normal.x);
+
+		pntVertexData* vertex = &vertexData[row * rowSize];
+
+		for (size_t slice = 0; slice < rowSize; slice++) {
+
+			// Derivatives of the position around the axis (s) and along the profile (t)
+			vertex[slice] = pntVertexData(vec4(point.radius * rowSines[slice], point.y, point.radius * rowCosines[slice], 1.0f),
+										  vec3(point.normal.x * rowSines[slice], point.normal.y, point.normal.x * rowCosines[slice]),
+										  vec2(static_cast<float>(slice) / slices + uOffset, point.t),
+										  vec3(rowCosines[slice], 0.0f, -rowSines[slice]),
+										  vec3(along.x * rowSines[slice], along.y, along.x * rowCosines[slice]));
+		}
+	});
+
+	// One triangle per slice in the bands at the poles and two in the others
+	auto bandStart = [&](size_t band) {
+		return 6 * slices * band - (bottomPole && band > 0 ? 3 * slices : 0);
+	};
+
+	indices.assign(bandStart(bands) - (topPole ? 3 * slices : 0), 0);
+
+	forEachRow(bands, rowSize, [&](size_t band) {
+
+		unsigned int lower = static_cast<unsigned int>(band * rowSize);
+		unsigned int upper = static_cast<unsigned int>((band + 1) * rowSize);
+		unsigned int* index = &indices[bandStart(band)];
+
+		if (band == 0 && bottomPole) {
+
+			for (unsigned int j = 0; j < static_cast<unsigned int>(slices); j++) {
+
+				*index++ = lower + j;
+				*index++ = upper + j + 1;
+				*index++ = upper + j;
+			}
+		}
+		else if (band == bands - 1 && topPole) {
+
+			for (unsigned int j = 0; j < static_cast<unsigned int>(slices); j++) {
+
+				*index++ = upper + j;
+				*index++ = lower + j;
+				*index++ = lower + j + 1;
+			}
+		}
+		else {
+
+			for (unsigned int j = 0; j < static_cast<unsigned int>(slices); j++) {
+
+				*index++ = upper + j;
+				*index++ = lower + j;
+				*index++ = lower + j + 1;
+
+				*index++ = upper + j;
+				*index++ = lower + j + 1;
+				*index++ = upper + j + 1;
+			}
+		}
+	});
+
+} // end revolve
+
+
+void ProceduralGeometry::grid(int columns, int rows, const std::function<void(int row, pntVertexData* rowVertices)>& writeRow,
+							  std::vector<pntVertexData>& vertexData, std::vector<unsigned int>& indices)
+{
+	columns = std::max(columns, 1);
+	rows = std::max(rows, 1);
+
+	const size_t rowSize = columns + 1;
+
+	vertexData.assign((rows + 1) * rowSize, pntVertexData());
+	indices.assign(6 * columns * rows, 0);
+
+	forEachRow(rows + 1, rowSize, [&](size_t row) {
+
+		writeRow(static_cast<int>(row), &vertexData[row * rowSize]);
+	});
+
+	forEachRow(rows, rowSize, [&](size_t row) {
+
+		// Counterclockwise when seen from above
+		unsigned int back = static_cast<unsigned int>(row * rowSize);
+		unsigned int front = static_cast<unsigned int>((row + 1) * rowSize);
+		unsigned int* index = &indices[row * 6 * columns];
+
+		for (unsigned int column = 0; column < static_cast<unsigned int>(columns); column++) {
+
+			*index++ = front + column;
+			*index++ = front + column + 1;
+			*index++ = back + column + 1;
+
+			*index++ = front + column;
+			*index++ = back + column + 1;
+			*index++ = back + column;
+		}
+	});
+
+} // end grid
+
+
+void ProceduralGeometry::sphere(float radius, int stacks, int slices, std::vector<pntVertexData>& vertexData, std::vector<unsigned int>& indices)
+{
+	stacks = std::max(stacks, 2);
+
+	const float stackInc = PI / stacks;
+
+	// Half circle from the bottom pole to the top pole
+	std::vector<ProfilePoint> profile(stacks + 1);
+
+	for (int stack = 0; stack <= stacks; stack++) {
+
+		float stackAngle = -PI_OVER_2 + stack * stackInc;
+
+		profile[stack].radius = (stack == 0 || stack == stacks) ? 0.0f : radius * glm::cos(stackAngle);
+		profile[stack].y = radius * glm::sin(stackAngle);
+		profile[stack].normal = vec2(glm::cos(stackAngle), glm::sin(stackAngle));
+		profile[stack].t = static_cast<float>(stack) / stacks;
+	}
+
+	revolve(profile, slices, vertexData, indices);
+
+	if (VERBOSE) cout << "Sphere: " << vertexData.size() << " vertices, " << indices.size() << " indices" << endl;
+
+} // end sphere
+
+
+void ProceduralGeometry::icosphere(float radius, int subdivisions, std::vector<pntVertexData>& vertexData, std::vector<unsigned int>& indices)
+{
+	subdivisions = glm::clamp(subdivisions, 0, MAX_ICOSPHERE_SUBDIVISIONS);
+
+	// Icosahedron inscribed in the unit sphere
+	const float golden = (1.0f + glm::sqrt(5.0f)) / 2.0f;
+
+	std::vector<vec3> points = {
+		vec3(-1.0f, golden, 0.0f), vec3(1.0f, golden, 0.0f), vec3(-1.0f, -golden, 0.0f), vec3(1.0f, -golden, 0.0f),
+		vec3(0.0f, -1.0f, golden), vec3(0.0f, 1.0f, golden), vec3(0.0f, -1.0f, -golden), vec3(0.0f, 1.0f, -golden),
+		vec3(golden, 0.0f, -1.0f), vec3(golden, 0.0f, 1.0f), vec3(-golden, 0.0f, -1.0f), vec3(-golden, 0.0f, 1.0f) };
+
+	for (vec3& point : points) {
+		point = glm::normalize(point);
+	}
+
+	std::vector<unsigned int> triangles = {
+		0, 11, 5,	0, 5, 1,	0, 1, 7,	0, 7, 10,	0, 10, 11,
+		1, 5, 9,	5, 11, 4,	11, 10, 2,	10, 7, 6,	7, 1, 8,
+		3, 9, 4,	3, 4, 2,	3, 2, 6,	3, 6, 8,	3, 8, 9,
+		4, 9, 5,	2, 4, 11,	6, 2, 10,	8, 6, 7,	9, 8, 1 };
+
+	// Split every triangle into four. Edges are shared by two triangles, so the
+	// midpoint of each edge is only added once.
+	for (int level = 0; level < subdivisions; level++) {
+
+		std::unordered_map<unsigned long long, unsigned int> midpoints;
+		std::vector<unsigned int> split;
+		split.reserve(4 * triangles.size());
+
+		auto midpoint = [&](unsigned int a, unsigned int b) {
+
+			unsigned long long edge = (static_cast<unsigned long long>(std::min(a, b)) << 32) | std::max(a, b);
+			auto iter = midpoints.find(edge);
+
+			if (iter != midpoints.end()) {
+				return iter->second;
+			}
+
+			points.push_back(glm::normalize(points[a] + points[b]));
+			unsigned int index = static_cast<unsigned int>(points.size() - 1);
+			midpoints[edge] = index;
+
+			return index;
+		};
+
+		for (size_t i = 0; i < triangles.size(); i += 3) {
+
+			unsigned int a = triangles[i], b = triangles[i + 1], c = triangles[i + 2];
+			unsigned int ab = midpoint(a, b), bc = midpoint(b, c), ca = midpoint(c, a);
+
+			split.insert(split.end(), { a, ab, ca,  b, bc, ab,  c, ca, bc,  ab, bc, ca });
+		}
+
+		triangles.swap(split);
+	}
+
+	// Texture coordinates match those of sphere, with the seam at the +Z axis
+	auto textureU = [](const vec3& point) {
+
+		float u = std::atan2(point.x, point.z) / (2.0f * PI);
+		return u < 0.0f ? u + 1.0f : u;
+	};
+
+	auto isPole = [](const vec3& point) { return point.x * point.x + point.z * point.z < 1e-8f; };
+
+	// Output vertices as a point and the u coordinate. Triangles that cross the
+	// seam get copies of their vertices on the far side of the texture, and
+	// every triangle gets its own copy of a pole vertex in the middle of the
+	// u coordinates of its other vertices.
+	std::vector<unsigned int> source(points.size());
+	std::vector<float> us(points.size());
+	std::unordered_map<unsigned int, unsigned int> seamCopies;
+
+	for (unsigned int i = 0; i < points.size(); i++) {
+
+		source[i] = i;
+		us[i] = textureU(points[i]);
+	}
+
+	for (size_t i = 0; i < triangles.size(); i += 3) {
+
+		unsigned int* triangle = &triangles[i];
+		float minU = 1.0f, maxU = 0.0f;
+
+		for (int k = 0; k < 3; k++) {
+
+			if (!isPole(points[triangle[k]])) {
+
+				minU = std::min(minU, us[triangle[k]]);
+				maxU = std::max(maxU, us[triangle[k]]);
+			}
+		}
+
+		if (maxU - minU > 0.5f) {
+
+			for (int k = 0; k < 3; k++) {
+
+				if (!isPole(points[triangle[k]]) && us[triangle[k]] < 0.5f) {
+
+					auto iter = seamCopies.find(triangle[k]);
+
+					if (iter == seamCopies.end()) {
+
+						source.push_back(triangle[k]);
+						us.push_back(us[triangle[k]] + 1.0f);
+						iter = seamCopies.emplace(triangle[k], static_cast<unsigned int>(source.size() - 1)).first;
+					}
+
+					triangle[k] = iter->second;
+				}
+			}
+		}
+
+		for (int k = 0; k < 3; k++) {
+
+			if (isPole(points[source[triangle[k]]])) {
+
+				source.push_back(source[triangle[k]]);
+				us.push_back((us[triangle[(k + 1) % 3]] + us[triangle[(k + 2) % 3]]) / 2.0f);
+				triangle[k] = static_cast<unsigned int>(source.size() - 1);
+			}
+		}
+	}
+
+	// The attributes are written in blocks in the same way as the rows of the other shapes
+	const size_t blockSize = 256;
+	const size_t blocks = (source.size() + blockSize - 1) / blockSize;
+
+	vertexData.assign(source.size(), pntVertexData());
+
+	forEachRow(blocks, blockSize, [&](size_t block) {
+
+		size_t end = std::min((block + 1) * blockSize, source.size());
+
+		for (size_t i = block * blockSize; i < end; i++) {
+
+			const vec3& normal = points[source[i]];
+
+			float sliceAngle = us[i] * 2.0f * PI;
+			float stackAngle = std::asin(glm::clamp(normal.y, -1.0f, 1.0f));
+
+			vec3 tangent(glm::cos(sliceAngle), 0.0f, -glm::sin(sliceAngle));
+			vec3 bitangent(-glm::sin(stackAngle) * glm::sin(sliceAngle),
+						   glm::cos(stackAngle),
+						   -glm::sin(stackAngle) * glm::cos(sliceAngle));
+
+			vertexData[i] = pntVertexData(vec4(normal * radius, 1.0f), normal,
+										  vec2(us[i], (stackAngle + PI_OVER_2) / PI), tangent, bitangent);
+		}
+	});
+
+	indices.swap(triangles);
+
+	if (VERBOSE) cout << "Icosphere: " << vertexData.size() << " vertices, " << indices.size() << " indices" << endl;
+
+} // end icosphere
+
+
+void ProceduralGeometry::capsule(float radius, float height, int stacks, int slices, std::vector<pntVertexData>& vertexData, std::vector<unsigned int>& indices)
+{
+	stacks = std::max(stacks, 1);
+
+	const float stackInc = PI_OVER_2 / stacks;
+
+	// The texture runs along the profile in proportion to its length
+	const float profileLength = PI * radius + height;
+
+	// Bottom hemisphere from the pole to the equator, then the top hemisphere
+	// from the equator to the pole. The cylinder is the band between the equators.
+	std::vector<ProfilePoint> profile(2 * (stacks + 1));
+
+	for (int stack = 0; stack <= stacks; stack++) {
+
+		float stackAngle = -PI_OVER_2 + stack * stackInc;
+
+		ProfilePoint& bottom = profile[stack];
+		bottom.radius = stack == 0 ? 0.0f : radius * glm::cos(stackAngle);
+		bottom.y = -height / 2.0f + radius * glm::sin(stackAngle);
+		bottom.normal = vec2(glm::cos(stackAngle), glm::sin(stackAngle));
+		bottom.t = radius * stack * stackInc / profileLength;
+
+		stackAngle = stack * stackInc;
+
+		ProfilePoint& top = profile[stacks + 1 + stack];
+		top.radius = stack == stacks ? 0.0f : radius * glm::cos(stackAngle);
+		top.y = height / 2.0f + radius * glm::sin(stackAngle);
+		top.normal = vec2(glm::cos(stackAngle), glm::sin(stackAngle));
+		top.t = (PI_OVER_2 * radius + height + radius * stackAngle) / profileLength;
+	}
+
+	revolve(profile, slices, vertexData, indices);
+
+	if (VERBOSE) cout << "Capsule: " << vertexData.size() << " vertices, " << indices.size() << " indices" << endl;
+
+} // end capsule
+
+
+void ProceduralGeometry::torus(float majorRadius, float minorRadius, int rings, int sides, std::vector<pntVertexData>& vertexData, std::vector<unsigned int>& indices)
+{
+	sides = std::max(sides, 3);
+
+	const float sideInc = (2.0f * PI) / sides;
+
+	// Circle around the middle of the tube starting and ending on the outside
+	std::vector<ProfilePoint> profile(sides + 1);
+
+	for (int side = 0; side <= sides; side++) {
+
+		float sideAngle = side * sideInc;
+
+		profile[side].radius = majorRadius + minorRadius * glm::cos(sideAngle);
+		profile[side].y = minorRadius * glm::sin(sideAngle);
+		profile[side].normal = vec2(glm::cos(sideAngle), glm::sin(sideAngle));
+		profile[side].t = static_cast<float>(side) / sides;
+	}
+
+	revolve(profile, rings, vertexData, indices);
+
+	if (VERBOSE) cout << "Torus: " << vertexData.size() << " vertices, " << indices.size() << " indices" << endl;
+
+} // end torus
+
+
+void ProceduralGeometry::cylinder(float radius, float height, int stacks, int slices, std::vector<pntVertexData>& vertexData, std::vector<unsigned int>& indices)
+{
+	stacks = std::max(stacks, 1);
+	slices = std::max(slices, 3);
+
+	const float sliceInc = (2.0f * PI) / slices;
+	const float stackInc = height / stacks;
+
+	// Rows of the side with a vertex on each side of the texture seam, then
+	// the center and rim of the top and bottom caps
+	const size_t rowSize = slices + 1;
+	const unsigned int sideVertices = static_cast<unsigned int>((stacks + 1) * rowSize);
+	const unsigned int topCenter = sideVertices;
+	const unsigned int bottomCenter = topCenter + slices + 1;
+
+	vertexData.assign(sideVertices + 2 * (slices + 1), pntVertexData());
+	indices.assign(6 * slices * stacks + 6 * slices, 0);
+
+	forEachRow(stacks + 1, rowSize, [&](size_t stack) {
+
+		float y = -height / 2.0f + stack * stackInc;
+
+		for (size_t slice = 0; slice < rowSize; slice++) {
+
+			float sliceAngle = slice * sliceInc;
+
+			vec3 normal(glm::cos(sliceAngle), 0.0f, glm::sin(sliceAngle));
+			vec3 tangent(-glm::sin(sliceAngle), 0.0f, glm::cos(sliceAngle));
+			vec2 textCoord(sliceAngle / (2.0f * PI), static_cast<float>(stack) / stacks);
+
+			vertexData[stack * rowSize + slice] = pntVertexData(vec4(normal.x * radius, y, normal.z * radius, 1.0f), normal,
+																textCoord, tangent, UNIT_Y_V3);
+		}
+	});
+
+	forEachRow(stacks, rowSize, [&](size_t band) {
+
+		unsigned int lower = static_cast<unsigned int>(band * rowSize);
+		unsigned int upper = static_cast<unsigned int>((band + 1) * rowSize);
+		unsigned int* index = &indices[band * 6 * slices];
+
+		for (unsigned int j = 0; j < static_cast<unsigned int>(slices); j++) {
+
+			*index++ = upper + j;
+			*index++ = upper + j + 1;
+			*index++ = lower + j;
+
+			*index++ = lower + j;
+			*index++ = upper + j + 1;
+			*index++ = lower + j + 1;
+		}
+	});
+
+	// The caps are small enough to write serially. The texture is mapped onto
+	// them from above, so both share the same tangent frame.
+	vertexData[topCenter] = pntVertexData(vec4(0.0f, height / 2.0f, 0.0f, 1.0f), UNIT_Y_V3, vec2(0.5f, 0.5f), UNIT_X_V3, UNIT_Z_V3);
+	vertexData[bottomCenter] = pntVertexData(vec4(0.0f, -height / 2.0f, 0.0f, 1.0f), NEG_UNIT_Y_V3, vec2(0.5f, 0.5f), UNIT_X_V3, UNIT_Z_V3);
+
+	unsigned int* index = &indices[6 * slices * stacks];
+
+	for (unsigned int j = 0; j < static_cast<unsigned int>(slices); j++) {
+
+		float sliceAngle = j * sliceInc;
+		float x = glm::cos(sliceAngle);
+		float z = glm::sin(sliceAngle);
+		vec2 textCoord(0.5f * x + 0.5f, 0.5f * z + 0.5f);
+
+		vertexData[topCenter + 1 + j] = pntVertexData(vec4(x * radius, height / 2.0f, z * radius, 1.0f), UNIT_Y_V3, textCoord, UNIT_X_V3, UNIT_Z_V3);
+		vertexData[bottomCenter + 1 + j] = pntVertexData(vec4(x * radius, -height / 2.0f, z * radius, 1.0f), NEG_UNIT_Y_V3, textCoord, UNIT_X_V3, UNIT_Z_V3);
+
+		unsigned int next = (j + 1) % slices;
+
+		*index++ = topCenter;
+		*index++ = topCenter + 1 + next;
+		*index++ = topCenter + 1 + j;
+
+		*index++ = bottomCenter;
+		*index++ = bottomCenter + 1 + j;
+		*index++ = bottomCenter + 1 + next;
+	}
+
+	if (VERBOSE) cout << "Cylinder: " << vertexData.size() << " vertices, " << indices.size() << " indices" << endl;
+
+} // end cylinder
+
+
+void ProceduralGeometry::box(float halfWidth, float halfHeight, float halfDepth, std::vector<pntVertexData>& vertexData, std::vector<unsigned int>& indices)
+{
+	vertexData.clear();
+	indices.clear();
+
+	vec4 v1(-halfWidth, -halfHeight, halfDepth, 1.0f);
+	vec4 v2(halfWidth, -halfHeight, halfDepth, 1.0f);
+	vec4 v3(halfWidth, halfHeight, halfDepth, 1.0f);
+	vec4 v4(-halfWidth, halfHeight, halfDepth, 1.0f);
+	vec4 v5(-halfWidth, -halfHeight, -halfDepth, 1.0f);
+	vec4 v6(halfWidth, -halfHeight, -halfDepth, 1.0f);
+	vec4 v7(halfWidth, halfHeight, -halfDepth, 1.0f);
+	vec4 v8(-halfWidth, halfHeight, -halfDepth, 1.0f);
+
+	vec3 n1(0, 0, 1);  // +Z
+	vec3 n2(0, 0, -1); // -Z
+	vec3 n3(1, 0, 0);  // +X
+	vec3 n4(-1, 0, 0); // -X
+	vec3 n5(0, -1, 0); // -Y
+	vec3 n6(0, 1, 0);  // +Y
+
+	// Texture coordinates
+	vec2 t1(0, 1); // Top-left
+	vec2 t2(1, 1); // Top-right
+	vec2 t3(1, 0); // Bottom-right
+	vec2 t4(0, 0); // Bottom-left
+
+	// Front face (+Z)
+	vertexData.push_back(pntVertexData(v1, n1, t4)); // Bottom-left
+	vertexData.push_back(pntVertexData(v2, n1, t3)); // Bottom-right
+	vertexData.push_back(pntVertexData(v3, n1, t2)); // Top-right
+	vertexData.push_back(pntVertexData(v4, n1, t1)); // Top-left
+
+	// Right face (+X)
+	vertexData.push_back(pntVertexData(v2, n3, t1)); // v2
+	vertexData.push_back(pntVertexData(v6, n3, t2)); // v6
+	vertexData.push_back(pntVertexData(v7, n3, t3)); // v7
+	vertexData.push_back(pntVertexData(v3, n3, t4)); // v3
+
+	// Left face (-X) - Single texture
+	vertexData.push_back(pntVertexData(v5, n4, t1)); // v5
+	vertexData.push_back(pntVertexData(v1, n4, t2)); // v1
+	vertexData.push_back(pntVertexData(v4, n4, t3)); // v4
+	vertexData.push_back(pntVertexData(v8, n4, t4)); // v8
+
+	// Back face (-Z) - Inverted texture
+	vertexData.push_back(pntVertexData(v8, n2, t1)); // v8
+	vertexData.push_back(pntVertexData(v7, n2, t2)); // v7
+	vertexData.push_back(pntVertexData(v6, n2, t3)); // v6
+	vertexData.push_back(pntVertexData(v5, n2, t4)); // v5
+
+	// Top face (+Y) - Four copies of texture
+	vertexData.push_back(pntVertexData(v4, n6, t4 * 2.0f)); // v4
+	vertexData.push_back(pntVertexData(v3, n6, t3 * 2.0f)); // v3
+	vertexData.push_back(pntVertexData(v7, n6, t2 * 2.0f)); // v7
+	vertexData.push_back(pntVertexData(v8, n6, t1 * 2.0f)); // v8
+
+	// Bottom face (-Y) - Two copies of texture
+	vertexData.push_back(pntVertexData(v6, n5, t1 * 1.33f));
+	vertexData.push_back(pntVertexData(v2, n5, t2 * 1.33f));
+	vertexData.push_back(pntVertexData(v1, n5, t3 * 1.33f));
+	vertexData.push_back(pntVertexData(v5, n5, t4 * 1.33f));
+
+	// Indices for the triangles
+	for (unsigned int i = 0; i < 6; i++) {
+
+		indices.push_back(0 + 4 * i);
+		indices.push_back(1 + 4 * i);
+		indices.push_back(2 + 4 * i);
+		indices.push_back(2 + 4 * i);
+		indices.push_back(3 + 4 * i);
+		indices.push_back(0 + 4 * i);
+	}
+
+	// The faces are textured in different directions
+	computeTangents(vertexData, indices);
+
+} // end box
+
+
+void ProceduralGeometry::plane(float width, float depth, int columns, int rows, std::vector<pntVertexData>& vertexData, std::vector<unsigned int>& indices)
+{
+	columns = std::max(columns, 1);
+	rows = std::max(rows, 1);
+
+	grid(columns, rows, [&](int row, pntVertexData* rowVertices) {
+
+		float z = depth * (static_cast<float>(row) / rows - 0.5f);
+		float v = 1.0f - static_cast<float>(row) / rows;
+
+		for (int column = 0; column <= columns; column++) {
+
+			float u = static_cast<float>(column) / columns;
+
+			rowVertices[column] = pntVertexData(vec4(width * (u - 0.5f), 0.0f, z, 1.0f), UNIT_Y_V3, vec2(u, v), UNIT_X_V3, NEG_UNIT_Z_V3);
+		}
+
+	}, vertexData, indices);
+
+	if (VERBOSE) cout << "Plane: " << vertexData.size() << " vertices, " << indices.size() << " indices" << endl;
+
+} // end plane
+
+
+void ProceduralGeometry::heightfield(const std::vector<float>& heights, int columns, int rows, float spacing,
+									 int firstColumn, int firstRow, int chunkColumns, int chunkRows,
+									 std::vector<pntVertexData>& vertexData, std::vector<unsigned int>& indices)
+{
+	if (columns < 2 || rows < 2 || heights.size() < static_cast<size_t>(columns) * rows) {
+
+		std::cerr << "ProceduralGeometry: a heightfield needs at least 2 x 2 samples" << std::endl;
+		vertexData.clear();
+		indices.clear();
+		return;
+	}
+
+	auto height = [&](int column, int row) {
+		return heights[static_cast<size_t>(row) * columns + column];
+	};
+
+	const float halfWidth = (columns - 1) * spacing / 2.0f;
+	const float halfDepth = (rows - 1) * spacing / 2.0f;
+
+	grid(chunkColumns, chunkRows, [&](int chunkRow, pntVertexData* rowVertices) {
+
+		int row = firstRow + chunkRow;
+
+		// Neighbors for the central differences, one-sided at the edges
+		int back = std::max(row - 1, 0);
+		int front = std::min(row + 1, rows - 1);
+
+		for (int chunkColumn = 0; chunkColumn <= chunkColumns; chunkColumn++) {
+
+			int column = firstColumn + chunkColumn;
+			int left = std::max(column - 1, 0);
+			int right = std::min(column + 1, columns - 1);
+
+			// Slopes along X and Z
+			float dx = (height(right, row) - height(left, row)) / ((right - left) * spacing);
+			float dz = (height(column, front) - height(column, back)) / ((front - back) * spacing);
+
+			vec2 textCoord(static_cast<float>(column) / (columns - 1), 1.0f - static_cast<float>(row) / (rows - 1));
+
+			rowVertices[chunkColumn] = pntVertexData(vec4(column * spacing - halfWidth, height(column, row), row * spacing - halfDepth, 1.0f),
+													 glm::normalize(vec3(-dx, 1.0f, -dz)), textCoord,
+													 glm::normalize(vec3(1.0f, dx, 0.0f)),
+													 glm::normalize(vec3(0.0f, -dz, -1.0f)));
+		}
+
+	}, vertexData, indices);
+
+	if (VERBOSE) cout << "Heightfield chunk: " << vertexData.size() << " vertices, " << indices.size() << " indices" << endl;
+
+} // end heightfield
+
+
+void ProceduralGeometry::computeTangents(std::vector<pntVertexData>& vertexData, const std::vector<unsigned int>& indices)
+{
+	std::vector<vec3> tangents(vertexData.size(), ZERO_V3);
+	std::vector<vec3> bitangents(vertexData.size(), ZERO_V3);
+
+	for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+
+		const pntVertexData& a = vertexData[indices[i]];
+		const pntVertexData& b = vertexData[indices[i + 1]];
+		const pntVertexData& c = vertexData[indices[i + 2]];
+
+		vec3 edge1 = vec3(b.m_pos - a.m_pos);
+		vec3 edge2 = vec3(c.m_pos - a.m_pos);
+		vec2 deltaUV1 = b.m_textCoord - a.m_textCoord;
+		vec2 deltaUV2 = c.m_textCoord - a.m_textCoord;
+
+		float determinant = deltaUV1.x * deltaUV2.y - deltaUV2.x * deltaUV1.y;
+
+		if (glm::abs(determinant) < 1e-12f) {
+			continue; // Texture is degenerate on this triangle
+		}
+
+		vec3 tangent = (edge1 * deltaUV2.y - edge2 * deltaUV1.y) / determinant;
+		vec3 bitangent = (edge2 * deltaUV1.x - edge1 * deltaUV2.x) / determinant;
+
+		for (int k = 0; k < 3; k++) {
+
+			tangents[indices[i + k]] += tangent;
+			bitangents[indices[i + k]] += bitangent;
+		}
+	}
+
+	for (size_t i = 0; i < vertexData.size(); i++) {
+
+		// Make the tangent at right angles to the normal
+		const vec3& normal = vertexData[i].m_normal;
+		vec3 tangent = tangents[i] - normal * glm::dot(normal, tangents[i]);
+
+		if (glm::length(tangent) > 1e-6f) {
+			vertexData[i].m_tangent = glm::normalize(tangent);
+		}
+
+		if (glm::length(bitangents[i]) > 1e-6f) {
+			vertexData[i].m_bitangent = glm::normalize(bitangents[i]);
+		}
+	}
+
+} // end computeTangents
@@ -0,0 +1,239 @@
+#pragma once
+
+#include <functional>
+
+#include "MathLibsConstsFuncs.h"
+#include "MeshComponent.h"
+
+using namespace constants_and_types;
+
+// Shapes with at least this many vertices are tessellated by the ThreadPool
+static const size_t PARALLEL_TESSELLATION_VERTICES = 1 << 14;
+
+// Most subdivisions of an icosphere (20 * 4^7 triangles)
+static const int MAX_ICOSPHERE_SUBDIVISIONS = 7;
+
+/**
+ * @struct	ProfilePoint
+ *
+ * @brief	One point of the outline that is revolved around the Y axis to make a
+ * 			surface of revolution. The outline lies in the plane of the distance from
+ * 			the axis and the height.
+ */
+struct ProfilePoint {
+
+	// Distance from the Y axis. Zero at a pole.
+	float radius = 0.0f;
+
+	// Height
+	float y = 0.0f;
+
+	// Normal of the surface as (away from the axis, up)
+	glm::vec2 normal = glm::vec2(1.0f, 0.0f);
+
+	// Texture coordinate along the outline
+	float t = 0.0f;
+};
+
+/**
+ * @class	ProceduralGeometry
+ *
+ * @brief	Generates the vertices and indices of shapes as one indexed triangle
+ * 			list with shared vertices. Rows of vertices are written to their final
+ * 			place in vectors of the exact size, so large shapes are tessellated
+ * 			in parallel. The kernels that write a row are straight loops over
+ * 			tables of sines and cosines computed once per shape.
+ *
+ * 			Tangents and bitangents are the derivatives of the position with
+ * 			respect to the texture coordinates, as the normal mapping in the
+ * 			shaders expects. Triangles are wound counterclockwise when seen from
+ * 			outside the shape.
+ */
+class ProceduralGeometry
+{
+public:
+
+	/**
+	 * @fn	static void ProceduralGeometry::revolve(const std::vector<ProfilePoint>& profile, int slices, std::vector<pntVertexData>& vertexData, std::vector<unsigned int>& indices);
+	 *
+	 * @brief	Generates a surface of revolution by sweeping an outline around the Y
+	 * 			axis. The outline goes counterclockwise when seen with the axis on
+	 * 			the left, e.g. from the bottom to the top of a sphere. Points at the
+	 * 			start or end of the outline with a radius of zero are poles, which are
+	 * 			closed with one triangle per slice. The texture is wrapped around the
+	 * 			axis once with its seam at the +Z axis.
+	 *
+	 * @param 		profile   	The outline. At least two points.
+	 * @param 		slices	  	Divisions around the Y axis. At least three.
+	 * @param [out]	vertexData	The vertices.
+	 * @param [out]	indices   	The indices.
+	 */
+	static void revolve(const std::vector<ProfilePoint>& profile, int slices, std::vector<pntVertexData>& vertexData, std::vector<unsigned int>& indices);
+
+	/**
+	 * @fn	static void ProceduralGeometry::grid(int columns, int rows, const std::function<void(int row, pntVertexData* rowVertices)>& writeRow, std::vector<pntVertexData>& vertexData, std::vector<unsigned int>& indices);
+	 *
+	 * @brief	Generates a grid of quads facing up. Row vertices go along +X and rows
+	 * 			along +Z.
+	 *
+	 * @param 		columns   	Quads along X.
+	 * @param 		rows	  	Quads along Z.
+	 * @param 		writeRow  	Writes the columns + 1 vertices of one row.
+	 * @param [out]	vertexData	The vertices.
+	 * @param [out]	indices   	The indices.
+	 */
+	static void grid(int columns, int rows, const std::function<void(int row, pntVertexData* rowVertices)>& writeRow,
+					 std::vector<pntVertexData>& vertexData, std::vector<unsigned int>& indices);
+
+	/**
+	 * @fn	static void ProceduralGeometry::sphere(float radius, int stacks, int slices, std::vector<pntVertexData>& vertexData, std::vector<unsigned int>& indices);
+	 *
+	 * @brief	Generates a sphere centered on the origin. The texture is wrapped around
+	 * 			the sphere once with its seam at the +Z axis.
+	 *
+	 * @param 		radius	  	The radius.
+	 * @param 		stacks	  	Divisions from pole to pole. At least two.
+	 * @param 		slices	  	Divisions around the Y axis. At least three.
+	 * @param [out]	vertexData	The vertices.
+	 * @param [out]	indices   	The indices.
+	 */
+	static void sphere(float radius, int stacks, int slices, std::vector<pntVertexData>& vertexData, std::vector<unsigned int>& indices);
+
+	/**
+	 * @fn	static void ProceduralGeometry::icosphere(float radius, int subdivisions, std::vector<pntVertexData>& vertexData, std::vector<unsigned int>& indices);
+	 *
+	 * @brief	Generates a sphere by subdividing an icosahedron. Triangles are spread
+	 * 			evenly over the sphere instead of bunching up at the poles. Texture
+	 * 			coordinates are the same as those of sphere.
+	 *
+	 * @param 		radius			The radius.
+	 * @param 		subdivisions	Times each triangle is split into four. At most
+	 * 								MAX_ICOSPHERE_SUBDIVISIONS.
+	 * @param [out]	vertexData  	The vertices.
+	 * @param [out]	indices			The indices.
+	 */
+	static void icosphere(float radius, int subdivisions, std::vector<pntVertexData>& vertexData, std::vector<unsigned int>& indices);
+
+	/**
+	 * @fn	static void ProceduralGeometry::capsule(float radius, float height, int stacks, int slices, std::vector<pntVertexData>& vertexData, std::vector<unsigned int>& indices);
+	 *
+	 * @brief	Generates a capsule centered on the origin and aligned with the Y axis:
+	 * 			a cylinder closed by two hemispheres.
+	 *
+	 * @param 		radius	  	Radius of the cylinder and the hemispheres.
+	 * @param 		height	  	Height of the cylinder between the centers of the hemispheres.
+	 * @param 		stacks	  	Divisions of each hemisphere from pole to equator. At least one.
+	 * @param 		slices	  	Divisions around the Y axis. At least three.
+	 * @param [out]	vertexData	The vertices.
+	 * @param [out]	indices   	The indices.
+	 */
+	static void capsule(float radius, float height, int stacks, int slices, std::vector<pntVertexData>& vertexData, std::vector<unsigned int>& indices);
+
+	/**
+	 * @fn	static void ProceduralGeometry::torus(float majorRadius, float minorRadius, int rings, int sides, std::vector<pntVertexData>& vertexData, std::vector<unsigned int>& indices);
+	 *
+	 * @brief	Generates a torus centered on the origin that lies in the XZ plane.
+	 *
+	 * @param 		majorRadius	Distance from the center to the middle of the tube.
+	 * @param 		minorRadius	Radius of the tube.
+	 * @param 		rings	   	Divisions around the Y axis. At least three.
+	 * @param 		sides	   	Divisions around the tube. At least three.
+	 * @param [out]	vertexData 	The vertices.
+	 * @param [out]	indices	   	The indices.
+	 */
+	static void torus(float majorRadius, float minorRadius, int rings, int sides, std::vector<pntVertexData>& vertexData, std::vector<unsigned int>& indices);
+
+	/**
+	 * @fn	static void ProceduralGeometry::cylinder(float radius, float height, int stacks, int slices, std::vector<pntVertexData>& vertexData, std::vector<unsigned int>& indices);
+	 *
+	 * @brief	Generates a closed cylinder centered on the origin and aligned with the
+	 * 			Y axis. The texture is wrapped around the side once and mapped onto
+	 * 			each cap.
+	 *
+	 * @param 		radius	  	The radius.
+	 * @param 		height	  	The height.
+	 * @param 		stacks	  	Divisions along the Y axis. At least one.
+	 * @param 		slices	  	Divisions around the Y axis. At least three.
+	 * @param [out]	vertexData	The vertices.
+	 * @param [out]	indices   	The indices.
+	 */
+	static void cylinder(float radius, float height, int stacks, int slices, std::vector<pntVertexData>& vertexData, std::vector<unsigned int>& indices);
+
+	/**
+	 * @fn	static void ProceduralGeometry::box(float halfWidth, float halfHeight, float halfDepth, std::vector<pntVertexData>& vertexData, std::vector<unsigned int>& indices);
+	 *
+	 * @brief	Generates a box centered on the origin with four vertices per face.
+	 *
+	 * @param 		halfWidth 	Half the size along X.
+	 * @param 		halfHeight	Half the size along Y.
+	 * @param 		halfDepth 	Half the size along Z.
+	 * @param [out]	vertexData	The vertices.
+	 * @param [out]	indices   	The indices.
+	 */
+	static void box(float halfWidth, float halfHeight, float halfDepth, std::vector<pntVertexData>& vertexData, std::vector<unsigned int>& indices);
+
+	/**
+	 * @fn	static void ProceduralGeometry::plane(float width, float depth, int columns, int rows, std::vector<pntVertexData>& vertexData, std::vector<unsigned int>& indices);
+	 *
+	 * @brief	Generates a subdivided rectangle in the XZ plane facing +Y, centered on
+	 * 			the origin. The texture covers it once.
+	 *
+	 * @param 		width	  	Size along X.
+	 * @param 		depth	  	Size along Z.
+	 * @param 		columns   	Quads along X. At least one.
+	 * @param 		rows	  	Quads along Z. At least one.
+	 * @param [out]	vertexData	The vertices.
+	 * @param [out]	indices   	The indices.
+	 */
+	static void plane(float width, float depth, int columns, int rows, std::vector<pntVertexData>& vertexData, std::vector<unsigned int>& indices);
+
+	/**
+	 * @fn	static void ProceduralGeometry::heightfield(const std::vector<float>& heights, int columns, int rows, float spacing, int firstColumn, int firstRow, int chunkColumns, int chunkRows, std::vector<pntVertexData>& vertexData, std::vector<unsigned int>& indices);
+	 *
+	 * @brief	Generates one rectangular chunk of a terrain heightfield. The whole
+	 * 			heightfield is centered on the origin in the XZ plane and the
+	 * 			texture covers it once. Normals are found from the neighboring
+	 * 			samples, including those outside the chunk, so chunks meet without
+	 * 			seams in the lighting.
+	 *
+	 * @param 		heights			Heights of the samples by row (Z) then column (X).
+	 * @param 		columns			Samples along X.
+	 * @param 		rows			Samples along Z.
+	 * @param 		spacing			Distance between samples.
+	 * @param 		firstColumn 	First sample of the chunk along X.
+	 * @param 		firstRow		First sample of the chunk along Z.
+	 * @param 		chunkColumns	Quads of the chunk along X.
+	 * @param 		chunkRows   	Quads of the chunk along Z.
+	 * @param [out]	vertexData  	The vertices.
+	 * @param [out]	indices			The indices.
+	 */
+	static void heightfield(const std::vector<float>& heights, int columns, int rows, float spacing,
+							int firstColumn, int firstRow, int chunkColumns, int chunkRows,
+							std::vector<pntVertexData>& vertexData, std::vector<unsigned int>& indices);
+
+	/**
+	 * @fn	static void ProceduralGeometry::computeTangents(std::vector<pntVertexData>& vertexData, const std::vector<unsigned int>& indices);
+	 *
+	 * @brief	Sets the tangents and bitangents of indexed triangles from their
+	 * 			positions and texture coordinates. For shapes whose derivatives are not
+	 * 			known in closed form.
+	 *
+	 * @param [in,out]	vertexData	The vertices.
+	 * @param 			indices   	The indices.
+	 */
+	static void computeTangents(std::vector<pntVertexData>& vertexData, const std::vector<unsigned int>& indices);
+
+protected:
+
+	/**
+	 * @fn	static void ProceduralGeometry::forEachRow(size_t rows, size_t rowSize, const std::function<void(size_t row)>& body);
+	 *
+	 * @brief	Calls body for every row, in parallel if the shape is large.
+	 *
+	 * @param	rows   	Number of rows.
+	 * @param	rowSize	Vertices in each row.
+	 * @param	body   	Writes one row.
+	 */
+	static void forEachRow(size_t rows, size_t rowSize, const std::function<void(size_t row)>& body);
+
+}; // end ProceduralGeometry
@@ -0,0 +1,51 @@
+#include "ProceduralMeshComponent.h"
+
+#include "ThreadPool.h"
+
+static const bool VERBOSE = false;
+
+
+ProceduralMeshComponent::ProceduralMeshComponent(GLuint shaderProgram, Material material, int updateOrder)
+	: MeshComponent(shaderProgram, updateOrder)
+{
+	// Meshes with the same geometry share it whatever their material
+	setMaterial(material);
+
+} // end ProceduralMeshComponent constructor
+
+
+void ProceduralMeshComponent::buildMesh()
+{
+	this->geometryKey = getGeometryKey();
+
+	if (previsouslyLoaded() == false) {
+
+		size_t subMeshCount = static_cast<size_t>(std::max(getSubMeshCount(), 0));
+
+		std::vector<std::vector<pntVertexData>> vData(subMeshCount);
+		std::vector<std::vector<unsigned int>> indices(subMeshCount);
+
+		// Sub-meshes are generated side by side. Each one may also split its own rows.
+		ThreadPool::parallelFor(subMeshCount, 1, [&](size_t begin, size_t end) {
+
+			for (size_t i = begin; i < end; i++) {
+				generateGeometry(static_cast<int>(i), vData[i], indices[i]);
+			}
+		});
+
+		// The GeometryArena can only be filled on the main thread
+		for (size_t i = 0; i < subMeshCount; i++) {
+
+			if (!vData[i].empty()) {
+				this->subMeshes.push_back(buildSubMesh(vData[i], indices[i]));
+			}
+		}
+
+		if (VERBOSE) cout << "Generated " << this->subMeshes.size() << " procedural sub-meshes" << endl;
+
+		this->collisionShape = createCollisionShape();
+
+		this->saveInitialLoad();
+	}
+
+} // end buildMesh
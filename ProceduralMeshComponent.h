@@ -0,0 +1,61 @@
+#pragma once
+#include "MeshComponent.h"
+
+/**
+ * @class	ProceduralMeshComponent
+ *
+ * @brief	Base class of meshes whose geometry is generated from a few parameters.
+ * 			Meshes generated from the same parameters share one loaded model
+ * 			whatever their material. The geometry of all sub-meshes is generated in
+ * 			parallel before it is copied into the GeometryArena on the main thread.
+ */
+class ProceduralMeshComponent : public MeshComponent
+{
+public:
+
+	ProceduralMeshComponent(GLuint shaderProgram, Material material, int updateOrder = 100);
+
+	/**
+	 * @fn	virtual void ProceduralMeshComponent::buildMesh() override;
+	 *
+	 * @brief	Generates the sub-meshes and collision shape unless a mesh with the
+	 * 			same geometry key is already loaded.
+	 */
+	virtual void buildMesh() override;
+
+protected:
+
+	/**
+	 * @fn	virtual size_t ProceduralMeshComponent::getGeometryKey() const = 0;
+	 *
+	 * @brief	Gets the key of the generated geometry (see hashGeometry).
+	 */
+	virtual size_t getGeometryKey() const = 0;
+
+	/**
+	 * @fn	virtual int ProceduralMeshComponent::getSubMeshCount() const
+	 *
+	 * @brief	Gets the number of sub-meshes that are generated.
+	 */
+	virtual int getSubMeshCount() const { return 1; }
+
+	/**
+	 * @fn	virtual void ProceduralMeshComponent::generateGeometry(int subMeshIndex, std::vector<pntVertexData>& vertexData, std::vector<unsigned int>& indices) const = 0;
+	 *
+	 * @brief	Generates the vertices and indices of one sub-mesh. Called from worker
+	 * 			threads, so it must not make OpenGL calls or change the component.
+	 *
+	 * @param 		subMeshIndex	Index of the sub-mesh.
+	 * @param [out]	vertexData  	The vertices.
+	 * @param [out]	indices			The indices.
+	 */
+	virtual void generateGeometry(int subMeshIndex, std::vector<pntVertexData>& vertexData, std::vector<unsigned int>& indices) const = 0;
+
+	/**
+	 * @fn	virtual std::shared_ptr<btCollisionShape> ProceduralMeshComponent::createCollisionShape() const = 0;
+	 *
+	 * @brief	Creates the collision shape that matches the generated geometry.
+	 */
+	virtual std::shared_ptr<btCollisionShape> createCollisionShape() const = 0;
+
+}; // end ProceduralMeshComponent
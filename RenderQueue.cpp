@@ -0,0 +1,241 @@
+#include "RenderQueue.h"
+
+#include "BuildShaderProgram.h"
+#include "GeometryArena.h"
+#include "ShaderHotReload.h"
+
+static const bool VERBOSE = false;
+
+// Static variable definitions (Static variables must be defined outside the declaration)
+std::vector<RenderItem> RenderQueue::items;
+std::unordered_map<const MeshComponent*, RenderQueue::MeshHistory> RenderQueue::meshHistory;
+GLuint RenderQueue::depthProgram = 0;
+
+
+// Adds bytes to a 64 bit FNV-1a hash
+static void hashCombine(size_t& hash, const void* data, size_t size)
+{
+	const unsigned char* bytes = static_cast<const unsigned char*>(data);
+
+	for (size_t i = 0; i < size; i++) {
+
+		hash ^= bytes[i];
+		hash *= 1099511628211ull;
+	}
+
+} // end hashCombine
+
+
+void RenderQueue::build()
+{
+	items.clear();
+
+	for (auto& history : meshHistory) {
+		history.second.seen = false;
+	}
+
+	for (auto& mesh : MeshComponent::GetMeshComponents()) {
+
+		if (mesh->owningGameObject->getState() != ACTIVE) {
+			continue;
+		}
+
+		glm::mat4 modelMatrix = mesh->owningGameObject->getModelingTransformation();
+
+		// Count the frames the mesh has stayed in place
+		MeshHistory& history = meshHistory[mesh.get()];
+
+		if (history.modelMatrix == modelMatrix) {
+			history.unchangedFrames++;
+		}
+		else {
+			history.modelMatrix = modelMatrix;
+			history.unchangedFrames = 0;
+		}
+
+		history.seen = true;
+
+		// Largest scale factor of the transformation for the bounding spheres
+		float scale = std::max({ glm::length(glm::vec3(modelMatrix[0])),
+								 glm::length(glm::vec3(modelMatrix[1])),
+								 glm::length(glm::vec3(modelMatrix[2])) });
+
+		for (const SubMesh& subMesh : mesh->getSubMeshes()) {
+
+			RenderItem item;
+			item.mesh = mesh.get();
+			item.subMesh = &subMesh;
+			item.material = &mesh->getMaterial(subMesh);
+			item.modelMatrix = modelMatrix;
+			item.boundsCenter = glm::vec3(modelMatrix * glm::vec4(subMesh.boundsCenter, 1.0f));
+			item.boundsRadius = subMesh.boundsRadius * scale;
+			item.isStatic = history.unchangedFrames >= STATIC_MESH_FRAMES;
+			item.castsShadows = mesh->getCastsShadows();
+
+			items.push_back(item);
+		}
+	}
+
+	// Forget meshes that are no longer rendered
+	for (auto iter = meshHistory.begin(); iter != meshHistory.end(); ) {
+
+		if (iter->second.seen) {
+			++iter;
+		}
+		else {
+			iter = meshHistory.erase(iter);
+		}
+	}
+
+} // end build
+
+
+bool RenderQueue::isVisible(const RenderItem& item, const glm::mat4& viewProjection)
+{
+	// Test the bounding sphere against the six planes of the view volume. The
+	// planes are sums and differences of the rows of the matrix.
+	for (int row = 0; row < 3; row++) {
+
+		for (float side : { 1.0f, -1.0f }) {
+
+			glm::vec4 plane(viewProjection[0][3] + side * viewProjection[0][row],
+							viewProjection[1][3] + side * viewProjection[1][row],
+							viewProjection[2][3] + side * viewProjection[2][row],
+							viewProjection[3][3] + side * viewProjection[3][row]);
+
+			float distance = glm::dot(glm::vec3(plane), item.boundsCenter) + plane.w;
+
+			if (distance < -item.boundsRadius * glm::length(glm::vec3(plane))) {
+				return false;
+			}
+		}
+	}
+
+	return true;
+
+} // end isVisible
+
+
+void RenderQueue::findHiddenMeshes(const glm::mat4& viewProjection, std::unordered_set<const MeshComponent*>& hiddenMeshes)
+{
+	hiddenMeshes.clear();
+
+	// The items of a mesh are next to each other in the queue
+	size_t first = 0;
+
+	while (first < items.size()) {
+
+		const MeshComponent* mesh = items[first].mesh;
+		bool visible = false;
+
+		size_t next = first;
+
+		for (; next < items.size() && items[next].mesh == mesh; next++) {
+			visible = visible || isVisible(items[next], viewProjection);
+		}
+
+		if (!visible) {
+			hiddenMeshes.insert(mesh);
+		}
+
+		first = next;
+	}
+
+} // end findHiddenMeshes
+
+
+size_t RenderQueue::getStaticHash(const glm::mat4& viewProjection)
+{
+	size_t hash = 14695981039346656037ull;
+
+	hashCombine(hash, glm::value_ptr(viewProjection), sizeof(glm::mat4));
+
+	for (const RenderItem& item : items) {
+
+		if (item.isStatic && item.castsShadows && isVisible(item, viewProjection)) {
+
+			hashCombine(hash, &item.subMesh, sizeof(item.subMesh));
+			hashCombine(hash, glm::value_ptr(item.modelMatrix), sizeof(glm::mat4));
+		}
+	}
+
+	return hash;
+
+} // end getStaticHash
+
+
+bool RenderQueue::hasDynamicCasters(const glm::mat4& viewProjection)
+{
+	for (const RenderItem& item : items) {
+
+		if (!item.isStatic && item.castsShadows && isVisible(item, viewProjection)) {
+			return true;
+		}
+	}
+
+	return false;
+
+} // end hasDynamicCasters
+
+
+void RenderQueue::drawDepth(const glm::mat4& viewProjection, bool drawStatic, bool drawDynamic)
+{
+	drawDepth(viewProjection, [drawStatic, drawDynamic](const RenderItem& item) {
+		return item.castsShadows && (item.isStatic ? drawStatic : drawDynamic);
+	});
+
+} // end drawDepth
+
+
+void RenderQueue::drawDepth(const glm::mat4& viewProjection, const std::function<bool(const RenderItem&)>& include)
+{
+	if (depthProgram == 0) {
+
+		ShaderInfo shaders[] = {
+			{ GL_VERTEX_SHADER, "Shaders/depthOnlyShader.glsl" },
+			{ GL_NONE, NULL } // signals that there are no more shaders
+		};
+
+		depthProgram = BuildShaderProgram(shaders);
+
+		// Follow the depth program when it is rebuilt after a source change
+		ShaderHotReload::addSwapCallback([](GLuint oldProgram, GLuint newProgram) {
+
+			if (depthProgram == oldProgram) {
+				depthProgram = newProgram;
+			}
+		});
+	}
+
+	glUseProgram(depthProgram);
+
+	// Only positions are fetched
+	glBindVertexArray(GeometryArena::getVertexArray(POSITION_VERTEX_FORMAT));
+
+	for (const RenderItem& item : items) {
+
+		if (!include(item) || !isVisible(item, viewProjection)) {
+			continue;
+		}
+
+		glm::mat4 modelViewProjection = viewProjection * item.modelMatrix;
+		glUniformMatrix4fv(depthModelViewProjectionLocation, 1, GL_FALSE, glm::value_ptr(modelViewProjection));
+
+		GeometryArena::draw(item.subMesh->geometry, item.subMesh->primitiveMode);
+	}
+
+	glBindVertexArray(0);
+
+} // end drawDepth
+
+
+void RenderQueue::unload()
+{
+	depthProgram = 0;
+
+	items.clear();
+	meshHistory.clear();
+
+	if (VERBOSE) cout << "Render queue cleared" << endl;
+
+} // end unload
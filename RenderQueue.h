@@ -0,0 +1,173 @@
+#pragma once
+
+#include <functional>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "MathLibsConstsFuncs.h"
+#include "MeshComponent.h"
+
+using namespace constants_and_types;
+
+// Number of consecutive frames the transformation of a mesh must stay the same
+// before it is treated as static
+static const int STATIC_MESH_FRAMES = 30;
+
+// Uniform location of the model-view-projection matrix in the depth only shader
+static const GLuint depthModelViewProjectionLocation = 0;
+
+/**
+ * @struct	RenderItem
+ *
+ * @brief	One sub-mesh to be rendered along with the values that are needed to
+ * 			cull and sort it.
+ */
+struct RenderItem {
+
+	// Mesh the sub-mesh belongs to
+	const MeshComponent* mesh = nullptr;
+
+	// The sub-mesh
+	const SubMesh* subMesh = nullptr;
+
+	// Material the sub-mesh is rendered with by the mesh
+	const Material* material = nullptr;
+
+	// World transformation of the mesh
+	glm::mat4 modelMatrix = glm::mat4(1.0f);
+
+	// Bounding sphere in world coordinates
+	glm::vec3 boundsCenter = ZERO_V3;
+	float boundsRadius = 0.0f;
+
+	// True if the mesh has not moved for STATIC_MESH_FRAMES frames
+	bool isStatic = false;
+
+	// True if the mesh is rendered into shadow maps
+	bool castsShadows = true;
+
+}; // end RenderItem
+
+/**
+ * @class	RenderQueue
+ *
+ * @brief	Flat list of the sub-meshes of all active MeshComponents, rebuilt once per
+ * 			frame. Passes that render the scene from other viewpoints (shadow maps,
+ * 			depth pre-passes) work from the queue so that the scene graph is only
+ * 			traversed once per frame.
+ *
+ * 			Meshes whose transformation has not changed for STATIC_MESH_FRAMES frames
+ * 			are marked static so that passes can cache what they render for them.
+ */
+class RenderQueue
+{
+public:
+
+	/**
+	 * @fn	static void RenderQueue::build();
+	 *
+	 * @brief	Collects the sub-meshes of all active MeshComponents. Should be called
+	 * 			once per frame after the scene has been updated.
+	 */
+	static void build();
+
+	/**
+	 * @fn	static const std::vector<RenderItem>& RenderQueue::getItems()
+	 *
+	 * @brief	Gets the items collected by the last call to build.
+	 */
+	static const std::vector<RenderItem>& getItems() { return items; }
+
+	/**
+	 * @fn	static bool RenderQueue::isVisible(const RenderItem& item, const glm::mat4& viewProjection);
+	 *
+	 * @brief	Tests the bounding sphere of an item against the view volume of a
+	 * 			view-projection matrix.
+	 *
+	 * @returns	False if the item is completely outside the view volume.
+	 */
+	static bool isVisible(const RenderItem& item, const glm::mat4& viewProjection);
+
+	/**
+	 * @fn	static void RenderQueue::findHiddenMeshes(const glm::mat4& viewProjection, std::unordered_set<const MeshComponent*>& hiddenMeshes);
+	 *
+	 * @brief	Finds the meshes none of whose sub-meshes are inside the view volume of
+	 * 			a view-projection matrix. Used to cull the queue for each camera.
+	 *
+	 * @param 		  	viewProjection	The view-projection matrix of the camera.
+	 * @param [out]	hiddenMeshes  	The meshes that can be skipped.
+	 */
+	static void findHiddenMeshes(const glm::mat4& viewProjection, std::unordered_set<const MeshComponent*>& hiddenMeshes);
+
+	/**
+	 * @fn	static size_t RenderQueue::getStaticHash(const glm::mat4& viewProjection);
+	 *
+	 * @brief	Gets a hash of a view and the static shadow casters that are visible
+	 * 			in it. The hash changes when the view changes or when a static caster
+	 * 			is added, removed or moved in the view.
+	 */
+	static size_t getStaticHash(const glm::mat4& viewProjection);
+
+	/**
+	 * @fn	static bool RenderQueue::hasDynamicCasters(const glm::mat4& viewProjection);
+	 *
+	 * @brief	Determines if any shadow casters that moved recently are visible in a view.
+	 */
+	static bool hasDynamicCasters(const glm::mat4& viewProjection);
+
+	/**
+	 * @fn	static void RenderQueue::drawDepth(const glm::mat4& viewProjection, bool drawStatic, bool drawDynamic);
+	 *
+	 * @brief	Renders the visible shadow casters into the depth buffer of the bound
+	 * 			framebuffer using the position only vertex stream.
+	 *
+	 * @param	viewProjection	The view-projection matrix of the pass.
+	 * @param	drawStatic	  	True to render static casters.
+	 * @param	drawDynamic   	True to render casters that have moved recently.
+	 */
+	static void drawDepth(const glm::mat4& viewProjection, bool drawStatic, bool drawDynamic);
+
+	/**
+	 * @fn	static void RenderQueue::drawDepth(const glm::mat4& viewProjection, const std::function<bool(const RenderItem&)>& include);
+	 *
+	 * @brief	Renders the visible items selected by a function into the depth buffer
+	 * 			of the bound framebuffer using the position only vertex stream.
+	 *
+	 * @param	viewProjection	The view-projection matrix of the pass.
+	 * @param	include		  	Returns true for the items to render.
+	 */
+	static void drawDepth(const glm::mat4& viewProjection, const std::function<bool(const RenderItem&)>& include);
+
+	/**
+	 * @fn	static void RenderQueue::unload();
+	 *
+	 * @brief	Clears the queue. The depth only shader program is deleted along with
+	 * 			all other programs by deleteAllShaderPrograms.
+	 */
+	static void unload();
+
+protected:
+
+	/** @brief	Items collected by the last call to build */
+	static std::vector<RenderItem> items;
+
+	/**
+	 * @struct	MeshHistory
+	 *
+	 * @brief	Transformation of a mesh in the previous frame and how many frames
+	 * 			it has not changed.
+	 */
+	struct MeshHistory {
+
+		glm::mat4 modelMatrix = glm::mat4(1.0f);
+		int unchangedFrames = 0;
+		bool seen = false;
+	};
+
+	/** @brief	History of every mesh in the queue */
+	static std::unordered_map<const MeshComponent*, MeshHistory> meshHistory;
+
+	/** @brief	Shader program for depth only passes */
+	static GLuint depthProgram;
+
+}; // end RenderQueue
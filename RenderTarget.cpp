@@ -0,0 +1,255 @@
+#include "RenderTarget.h"
+
+#include <algorithm>
+
+static const bool VERBOSE = false;
+
+// Static variable definitions (Static variables must be defined outside the declaration)
+std::vector<RenderTargetPool::PooledTexture> RenderTargetPool::textures;
+RenderTargetStats RenderTargetPool::stats;
+int RenderTargetPool::frameAcquisitions = 0;
+int RenderTargetPool::frameHits = 0;
+int RenderTargetPool::frameEvictions = 0;
+unsigned int RenderTargetPool::frameNumber = 0;
+std::vector<RenderTarget*> RenderTarget::renderTargets;
+
+
+// Attachment point of a depth format
+static GLenum getDepthAttachment(GLenum depthFormat)
+{
+	if (depthFormat == GL_DEPTH24_STENCIL8 || depthFormat == GL_DEPTH32F_STENCIL8) {
+		return GL_DEPTH_STENCIL_ATTACHMENT;
+	}
+
+	return GL_DEPTH_ATTACHMENT;
+
+} // end getDepthAttachment
+
+
+GpuTexture RenderTargetPool::acquire(glm::ivec2 size, GLenum format)
+{
+	frameAcquisitions++;
+
+	for (PooledTexture& pooled : textures) {
+
+		if (!pooled.inUse && pooled.size == size && pooled.format == format) {
+
+			pooled.inUse = true;
+			frameHits++;
+
+			return pooled.texture;
+		}
+	}
+
+	GpuTexture texture = GpuTexture::create(GL_TEXTURE_2D);
+	glTextureStorage2D(texture.get(), 1, format, size.x, size.y);
+	glTextureParameteri(texture.get(), GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTextureParameteri(texture.get(), GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTextureParameteri(texture.get(), GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTextureParameteri(texture.get(), GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+	textures.push_back(PooledTexture{ texture, size, format, getTextureBytes(size, format), true, frameNumber });
+
+	if (VERBOSE) cout << "Pooled a new " << size.x << "x" << size.y << " render texture" << endl;
+
+	return texture;
+
+} // end acquire
+
+
+void RenderTargetPool::release(const GpuTexture& texture)
+{
+	for (PooledTexture& pooled : textures) {
+
+		if (pooled.texture.get() == texture.get()) {
+
+			pooled.inUse = false;
+			pooled.lastUsedFrame = frameNumber;
+			return;
+		}
+	}
+
+	std::cerr << "ERROR: Released a texture that is not in the render target pool." << std::endl;
+
+} // end release
+
+
+void RenderTargetPool::endFrame()
+{
+	// Delete the free textures that have not been requested for a while
+	size_t count = textures.size();
+
+	textures.erase(std::remove_if(textures.begin(), textures.end(), [](const PooledTexture& pooled) {
+		return !pooled.inUse && frameNumber - pooled.lastUsedFrame >= RENDER_TARGET_POOL_FRAMES;
+	}), textures.end());
+
+	frameEvictions += static_cast<int>(count - textures.size());
+
+	stats = RenderTargetStats();
+	stats.acquisitions = frameAcquisitions;
+	stats.hits = frameHits;
+	stats.hitRate = frameAcquisitions > 0 ? static_cast<float>(frameHits) / frameAcquisitions : 1.0f;
+	stats.evictions = frameEvictions;
+
+	for (const PooledTexture& pooled : textures) {
+
+		stats.pooledTextures++;
+		stats.pooledBytes += pooled.bytes;
+	}
+
+	for (const RenderTarget* target : RenderTarget::getRenderTargets()) {
+
+		stats.renderTargets++;
+		stats.renderTargetBytes += target->getSizeInBytes();
+	}
+
+	if (VERBOSE) printStats();
+
+	frameAcquisitions = frameHits = frameEvictions = 0;
+	frameNumber++;
+
+} // end endFrame
+
+
+void RenderTargetPool::printStats()
+{
+	cout << "Render targets: " << stats.renderTargets << " using " << stats.renderTargetBytes / 1024 << " KB, "
+		<< stats.pooledTextures << " pooled textures using " << stats.pooledBytes / 1024 << " KB. "
+		<< stats.hits << " of " << stats.acquisitions << " requests reused a pooled texture ("
+		<< stats.hitRate * 100.0f << "%), " << stats.evictions << " evicted" << endl;
+
+} // end printStats
+
+
+size_t RenderTargetPool::getTextureBytes(glm::ivec2 size, GLenum format, int mipLevels)
+{
+	size_t bytesPerTexel;
+
+	switch (format) {
+
+	case GL_R8:
+		bytesPerTexel = 1;
+		break;
+	case GL_RG8:
+	case GL_R16F:
+	case GL_DEPTH_COMPONENT16:
+		bytesPerTexel = 2;
+		break;
+	case GL_RGBA16F:
+	case GL_RG32F:
+	case GL_DEPTH32F_STENCIL8:
+		bytesPerTexel = 8;
+		break;
+	case GL_RGBA32F:
+		bytesPerTexel = 16;
+		break;
+	default:
+		// RGBA8, R11F_G11F_B10F, R32F and 24 or 32 bit depth. Drivers pad RGB8 to four bytes.
+		bytesPerTexel = 4;
+		break;
+	}
+
+	size_t bytes = 0;
+
+	for (int level = 0; level < mipLevels; level++) {
+
+		bytes += static_cast<size_t>(std::max(size.x >> level, 1)) * std::max(size.y >> level, 1) * bytesPerTexel;
+	}
+
+	return bytes;
+
+} // end getTextureBytes
+
+
+void RenderTargetPool::unload()
+{
+	textures.clear();
+	stats = RenderTargetStats();
+	frameAcquisitions = frameHits = frameEvictions = 0;
+
+} // end unload
+
+
+RenderTarget::RenderTarget(glm::ivec2 size, GLenum colorFormat, GLenum depthFormat)
+	: size(glm::max(size, glm::ivec2(1))), colorFormat(colorFormat), depthFormat(depthFormat)
+{
+	int mipLevels = 1 + static_cast<int>(std::floor(std::log2(std::max(this->size.x, this->size.y))));
+
+	colorTexture = GpuTexture::create(GL_TEXTURE_2D);
+	glTextureStorage2D(colorTexture.get(), mipLevels, colorFormat, this->size.x, this->size.y);
+	glTextureParameteri(colorTexture.get(), GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+	glTextureParameteri(colorTexture.get(), GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTextureParameteri(colorTexture.get(), GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTextureParameteri(colorTexture.get(), GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+	sizeInBytes = RenderTargetPool::getTextureBytes(this->size, colorFormat, mipLevels);
+
+	framebuffer = GpuFramebuffer::create();
+	glNamedFramebufferTexture(framebuffer.get(), GL_COLOR_ATTACHMENT0, colorTexture.get(), 0);
+	glNamedFramebufferDrawBuffer(framebuffer.get(), GL_COLOR_ATTACHMENT0);
+
+	renderTargets.push_back(this);
+
+} // end RenderTarget
+
+
+RenderTarget::~RenderTarget()
+{
+	if (depthTexture) {
+		RenderTargetPool::release(depthTexture);
+	}
+
+	renderTargets.erase(std::remove(renderTargets.begin(), renderTargets.end(), this), renderTargets.end());
+
+} // end ~RenderTarget
+
+
+void RenderTarget::begin()
+{
+	if (!depthTexture) {
+
+		depthTexture = RenderTargetPool::acquire(size, depthFormat);
+		glNamedFramebufferTexture(framebuffer.get(), getDepthAttachment(depthFormat), depthTexture.get(), 0);
+	}
+
+	if (!verified) {
+
+		if (glCheckNamedFramebufferStatus(framebuffer.get(), GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+			std::cerr << "ERROR: Render target framebuffer is not complete." << std::endl;
+		}
+
+		verified = true;
+	}
+
+	glBindFramebuffer(GL_FRAMEBUFFER, framebuffer.get());
+
+} // end begin
+
+
+void RenderTarget::end()
+{
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+	// Another target of the same size may use the depth buffer next
+	if (depthTexture) {
+
+		glNamedFramebufferTexture(framebuffer.get(), getDepthAttachment(depthFormat), 0, 0);
+		RenderTargetPool::release(depthTexture);
+		depthTexture.reset();
+	}
+
+	glGenerateTextureMipmap(colorTexture.get());
+
+} // end end
+
+
+void RenderTarget::unloadRenderTargets()
+{
+	for (RenderTarget* target : renderTargets) {
+
+		target->colorTexture.reset();
+		target->framebuffer.reset();
+		target->depthTexture.reset();
+	}
+
+} // end unloadRenderTargets
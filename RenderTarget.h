@@ -0,0 +1,267 @@
+#pragma once
+
+#include <vector>
+
+#include "MathLibsConstsFuncs.h"
+#include "GpuResource.h"
+
+using namespace constants_and_types;
+
+// Frames a free pooled texture is kept before it is deleted
+static const unsigned int RENDER_TARGET_POOL_FRAMES = 3;
+
+/**
+ * @struct	RenderTargetStats
+ *
+ * @brief	Statistics on the reuse of pooled textures during the last frame and
+ * 			on the memory used by render targets.
+ */
+struct RenderTargetStats {
+
+	/** @brief	Number of textures requested from the pool during the last frame */
+	int acquisitions = 0;
+
+	/** @brief	Number of requests that were met with a texture already in the pool */
+	int hits = 0;
+
+	/** @brief	Fraction of the requests that were hits. One if nothing was requested. */
+	float hitRate = 1.0f;
+
+	/** @brief	Number of pooled textures, in use or free, and the memory they use */
+	int pooledTextures = 0;
+	size_t pooledBytes = 0;
+
+	/** @brief	Number of pooled textures deleted because they went unused */
+	int evictions = 0;
+
+	/** @brief	Number of render targets and the memory used by their color textures */
+	int renderTargets = 0;
+	size_t renderTargetBytes = 0;
+
+}; // end RenderTargetStats
+
+/**
+ * @class	RenderTargetPool
+ *
+ * @brief	Textures that are only needed while something is rendered, e.g. the
+ * 			depth buffer of a camera that renders into a texture. A texture that
+ * 			is released goes back into the pool and is handed out again to the
+ * 			next request for the same size and format, in this frame or a later
+ * 			one, instead of allocating new storage. Free textures that are not
+ * 			requested again for RENDER_TARGET_POOL_FRAMES frames are deleted.
+ */
+class RenderTargetPool
+{
+public:
+
+	/**
+	 * @fn	static GpuTexture RenderTargetPool::acquire(glm::ivec2 size, GLenum format);
+	 *
+	 * @brief	Gets a texture with a single mip level from the pool, creating one
+	 * 			if no free texture of the same size and format is pooled. The
+	 * 			contents of the texture are undefined.
+	 *
+	 * @param 	size  	Width and height in pixels.
+	 * @param 	format	Sized internal format, e.g. GL_DEPTH_COMPONENT32F.
+	 *
+	 * @returns	The texture. Must be released when it is no longer rendered to.
+	 */
+	static GpuTexture acquire(glm::ivec2 size, GLenum format);
+
+	/**
+	 * @fn	static void RenderTargetPool::release(const GpuTexture& texture);
+	 *
+	 * @brief	Returns a texture to the pool.
+	 */
+	static void release(const GpuTexture& texture);
+
+	/**
+	 * @fn	static void RenderTargetPool::endFrame();
+	 *
+	 * @brief	Deletes the textures that went unused for too long and updates the
+	 * 			statistics of the frame. Called once at the end of every frame.
+	 */
+	static void endFrame();
+
+	/**
+	 * @fn	static const RenderTargetStats& RenderTargetPool::getStats()
+	 *
+	 * @brief	Gets the statistics as of the end of the last frame.
+	 */
+	static const RenderTargetStats& getStats() { return stats; }
+
+	/**
+	 * @fn	static void RenderTargetPool::printStats();
+	 *
+	 * @brief	Prints the statistics of the last frame.
+	 */
+	static void printStats();
+
+	/**
+	 * @fn	static size_t RenderTargetPool::getTextureBytes(glm::ivec2 size, GLenum format, int mipLevels = 1);
+	 *
+	 * @brief	Estimates the memory used by a texture of a sized internal format.
+	 */
+	static size_t getTextureBytes(glm::ivec2 size, GLenum format, int mipLevels = 1);
+
+	/**
+	 * @fn	static void RenderTargetPool::unload();
+	 *
+	 * @brief	Deletes all pooled textures. Called before the OpenGL context is destroyed.
+	 */
+	static void unload();
+
+protected:
+
+	struct PooledTexture {
+
+		GpuTexture texture;
+
+		glm::ivec2 size;
+		GLenum format;
+		size_t bytes;
+
+		bool inUse;
+
+		// Frame the texture was last released in
+		unsigned int lastUsedFrame;
+	};
+
+	/** @brief	Every texture in the pool */
+	static std::vector<PooledTexture> textures;
+
+	/** @brief	Statistics of the last frame */
+	static RenderTargetStats stats;
+
+	/** @brief	Requests and hits of the current frame */
+	static int frameAcquisitions;
+	static int frameHits;
+
+	/** @brief	Textures deleted during the current frame */
+	static int frameEvictions;
+
+	/** @brief	Frames ended so far */
+	static unsigned int frameNumber;
+
+}; // end RenderTargetPool
+
+/**
+ * @class	RenderTarget
+ *
+ * @brief	An offscreen framebuffer with a color texture that can be sampled by a
+ * 			Material, e.g. for mirrors, security monitors and minimaps. Cameras
+ * 			render into it when it is set as their render target.
+ *
+ * 			Only the color texture is kept from frame to frame. The depth buffer
+ * 			is acquired from the RenderTargetPool when rendering begins and
+ * 			released when it ends, so targets of the same size share their depth
+ * 			buffers. A full mip chain of the color texture is generated after
+ * 			every render so that distant screens do not shimmer.
+ *
+ * 			A mesh must not sample a target while it is being rendered into, so
+ * 			a screen should be kept out of the view of the camera that renders
+ * 			its image.
+ */
+class RenderTarget
+{
+public:
+
+	/**
+	 * @fn	RenderTarget::RenderTarget(glm::ivec2 size, GLenum colorFormat = GL_RGBA8, GLenum depthFormat = GL_DEPTH_COMPONENT32F);
+	 *
+	 * @brief	Creates the color texture and the framebuffer.
+	 *
+	 * @param 	size	   	Width and height in pixels.
+	 * @param 	colorFormat	(Optional) Sized internal format of the color texture.
+	 * @param 	depthFormat	(Optional) Sized internal format of the depth buffer.
+	 */
+	RenderTarget(glm::ivec2 size, GLenum colorFormat = GL_RGBA8, GLenum depthFormat = GL_DEPTH_COMPONENT32F);
+
+	~RenderTarget();
+
+	RenderTarget(const RenderTarget&) = delete;
+	RenderTarget& operator=(const RenderTarget&) = delete;
+
+	/**
+	 * @fn	void RenderTarget::begin();
+	 *
+	 * @brief	Attaches a pooled depth buffer and binds the framebuffer so that
+	 * 			what follows is rendered into the target.
+	 */
+	void begin();
+
+	/**
+	 * @fn	void RenderTarget::end();
+	 *
+	 * @brief	Binds the default framebuffer, returns the depth buffer to the pool
+	 * 			and generates the mip levels of the color texture.
+	 */
+	void end();
+
+	/**
+	 * @fn	GLuint RenderTarget::getColorTexture() const
+	 *
+	 * @brief	Gets the texture object of the color texture. Zero once unloaded.
+	 */
+	GLuint getColorTexture() const { return colorTexture.get(); }
+
+	/**
+	 * @fn	GLuint RenderTarget::getFramebuffer() const
+	 *
+	 * @brief	Gets the framebuffer object.
+	 */
+	GLuint getFramebuffer() const { return framebuffer.get(); }
+
+	/**
+	 * @fn	glm::ivec2 RenderTarget::getSize() const
+	 *
+	 * @brief	Gets the width and height in pixels.
+	 */
+	glm::ivec2 getSize() const { return size; }
+
+	/**
+	 * @fn	size_t RenderTarget::getSizeInBytes() const
+	 *
+	 * @brief	Gets the memory used by the color texture and its mip levels.
+	 */
+	size_t getSizeInBytes() const { return sizeInBytes; }
+
+	/**
+	 * @fn	static const std::vector<RenderTarget*>& RenderTarget::getRenderTargets()
+	 *
+	 * @brief	Gets every render target that exists.
+	 */
+	static const std::vector<RenderTarget*>& getRenderTargets() { return renderTargets; }
+
+	/**
+	 * @fn	static void RenderTarget::unloadRenderTargets();
+	 *
+	 * @brief	Deletes the OpenGL objects of all render targets. Called before the
+	 * 			OpenGL context is destroyed.
+	 */
+	static void unloadRenderTargets();
+
+protected:
+
+	/** @brief	Width and height in pixels */
+	glm::ivec2 size;
+
+	GLenum colorFormat;
+	GLenum depthFormat;
+
+	/** @brief	Memory used by the color texture */
+	size_t sizeInBytes;
+
+	GpuTexture colorTexture;
+	GpuFramebuffer framebuffer;
+
+	/** @brief	Pooled depth buffer. Only held between begin and end. */
+	GpuTexture depthTexture;
+
+	/** @brief	True once the framebuffer has been checked for completeness */
+	bool verified = false;
+
+	/** @brief	Every render target that exists */
+	static std::vector<RenderTarget*> renderTargets;
+
+}; // end RenderTarget
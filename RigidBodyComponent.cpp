@@ -0,0 +1,257 @@
+#include "RigidBodyComponent.h"
+
+#include "PhysicsEngine.h"
+#include "MeshComponent.h"
+#include "GameObject.h"
+
+static const bool VERBOSE = false;
+
+
+RigidBodyComponent::RigidBodyComponent(std::shared_ptr<MeshComponent> meshComponent, DynamicsState state, float mass, int updateOrder)
+	: Component(updateOrder), meshComponent(meshComponent), dynamicsState(state), mass(mass)
+{
+	componentType = RIGID_BODY;
+
+} // end RigidBodyComponent constructor
+
+
+RigidBodyComponent::RigidBodyComponent(std::shared_ptr<btCollisionShape> collisionShape, DynamicsState state, float mass, int updateOrder)
+	: Component(updateOrder), collisionShape(collisionShape), dynamicsState(state), mass(mass)
+{
+	componentType = RIGID_BODY;
+
+} // end RigidBodyComponent constructor
+
+
+RigidBodyComponent::~RigidBodyComponent()
+{
+	if (rigidBody != nullptr) {
+		PhysicsEngine::removeRigidBody(this);
+	}
+
+} // end RigidBodyComponent destructor
+
+
+void RigidBodyComponent::initialize()
+{
+	if (collisionShape == nullptr) {
+
+		std::shared_ptr<MeshComponent> mesh = meshComponent.lock();
+
+		if (mesh != nullptr) {
+			collisionShape = mesh->getSharedCollisionShape();
+		}
+	}
+
+	if (collisionShape == nullptr) {
+
+		std::cerr << "ERROR: Rigid body has no collision shape. Its mesh must be initialized first." << endl;
+		return;
+	}
+
+	// Start at the pose of the game object
+	getGameObjectTransform(currentTransform);
+	previousTransform = kinematicTransform = currentTransform;
+
+	btRigidBody::btRigidBodyConstructionInfo constructionInfo(0.0f, this, collisionShape.get());
+	rigidBody = std::make_unique<btRigidBody>(constructionInfo);
+
+	// Lets the physics engine find the component of a body in a contact
+	rigidBody->setUserPointer(this);
+
+	setBodyType();
+
+	PhysicsEngine::addRigidBody(this);
+
+	if (VERBOSE) cout << "Rigid body added to the physics world" << endl;
+
+} // end initialize
+
+
+void RigidBodyComponent::setBodyType()
+{
+	int flags = rigidBody->getCollisionFlags() & ~(btCollisionObject::CF_STATIC_OBJECT | btCollisionObject::CF_KINEMATIC_OBJECT);
+
+	if (dynamicsState == DYNAMIC && mass > 0.0f) {
+
+		btVector3 inertia(0.0f, 0.0f, 0.0f);
+		collisionShape->calculateLocalInertia(mass, inertia);
+
+		rigidBody->setCollisionFlags(flags);
+		rigidBody->setMassProps(mass, inertia);
+		rigidBody->forceActivationState(ACTIVE_TAG);
+	}
+	else if (dynamicsState == KINEMATIC) {
+
+		rigidBody->setCollisionFlags(flags | btCollisionObject::CF_KINEMATIC_OBJECT);
+		rigidBody->setMassProps(0.0f, btVector3(0.0f, 0.0f, 0.0f));
+
+		// Bullet only reads the pose of active kinematic bodies
+		rigidBody->forceActivationState(DISABLE_DEACTIVATION);
+	}
+	else {
+
+		rigidBody->setCollisionFlags(flags | btCollisionObject::CF_STATIC_OBJECT);
+		rigidBody->setMassProps(0.0f, btVector3(0.0f, 0.0f, 0.0f));
+		rigidBody->forceActivationState(ISLAND_SLEEPING);
+	}
+
+	rigidBody->updateInertiaTensor();
+	rigidBody->setLinearVelocity(btVector3(0.0f, 0.0f, 0.0f));
+	rigidBody->setAngularVelocity(btVector3(0.0f, 0.0f, 0.0f));
+
+} // end setBodyType
+
+
+void RigidBodyComponent::setDynamicsState(DynamicsState state)
+{
+	dynamicsState = state;
+
+	if (rigidBody == nullptr) {
+		return;
+	}
+
+	// The world sorts bodies into static and moving when they are added
+	PhysicsEngine::removeRigidBody(this, true);
+
+	btTransform worldTransform;
+	getGameObjectTransform(worldTransform);
+
+	rigidBody->setWorldTransform(worldTransform);
+	currentTransform = previousTransform = kinematicTransform = worldTransform;
+
+	setBodyType();
+
+	PhysicsEngine::addRigidBody(this);
+
+} // end setDynamicsState
+
+
+void RigidBodyComponent::setCollisionLayer(int layer, int collisionMask)
+{
+	if (layer < 0 || layer >= COLLISION_LAYERS) {
+
+		std::cerr << "ERROR: Collision layer " << layer << " is out of range." << endl;
+		return;
+	}
+
+	collisionLayer = layer;
+	this->collisionMask = collisionMask;
+
+	// The broadphase reads the filter of a body when it is added
+	if (rigidBody != nullptr) {
+
+		PhysicsEngine::removeRigidBody(this, true);
+		PhysicsEngine::addRigidBody(this);
+	}
+
+} // end setCollisionLayer
+
+
+vec3 RigidBodyComponent::getVelocity() const
+{
+	if (rigidBody == nullptr) {
+		return ZERO_V3;
+	}
+
+	const btVector3& velocity = rigidBody->getLinearVelocity();
+
+	return vec3(velocity.x(), velocity.y(), velocity.z());
+
+} // end getVelocity
+
+
+void RigidBodyComponent::setVelocity(const vec3& velocity)
+{
+	if (rigidBody != nullptr && dynamicsState == DYNAMIC) {
+
+		rigidBody->activate();
+		rigidBody->setLinearVelocity(btVector3(velocity.x, velocity.y, velocity.z));
+	}
+
+} // end setVelocity
+
+
+void RigidBodyComponent::applyImpulse(const vec3& impulse)
+{
+	if (rigidBody != nullptr && dynamicsState == DYNAMIC) {
+
+		rigidBody->activate();
+		rigidBody->applyCentralImpulse(btVector3(impulse.x, impulse.y, impulse.z));
+	}
+
+} // end applyImpulse
+
+
+void RigidBodyComponent::setFriction(float friction)
+{
+	if (rigidBody != nullptr) {
+		rigidBody->setFriction(friction);
+	}
+
+} // end setFriction
+
+
+void RigidBodyComponent::setRestitution(float restitution)
+{
+	if (rigidBody != nullptr) {
+		rigidBody->setRestitution(restitution);
+	}
+
+} // end setRestitution
+
+
+void RigidBodyComponent::getWorldTransform(btTransform& worldTransform) const
+{
+	worldTransform = (dynamicsState == KINEMATIC) ? kinematicTransform : currentTransform;
+
+} // end getWorldTransform
+
+
+void RigidBodyComponent::getGameObjectTransform(btTransform& worldTransform) const
+{
+	// Position and orientation only. Bullet transforms may not contain scale.
+	mat4 transform = owningGameObject->getWorldTransform();
+
+	// The basis vectors are normalized first, or the scale would skew the rotation
+	mat3 basis = mat3(transform);
+	basis[0] = glm::normalize(basis[0]);
+	basis[1] = glm::normalize(basis[1]);
+	basis[2] = glm::normalize(basis[2]);
+
+	glm::quat orientation = glm::quat_cast(basis);
+
+	worldTransform.setRotation(btQuaternion(orientation.x, orientation.y, orientation.z, orientation.w));
+	worldTransform.setOrigin(btVector3(transform[3].x, transform[3].y, transform[3].z));
+
+} // end getGameObjectTransform
+
+
+void RigidBodyComponent::setWorldTransform(const btTransform& worldTransform)
+{
+	currentTransform = worldTransform;
+
+} // end setWorldTransform
+
+
+void RigidBodyComponent::writeInterpolatedTransform(float fraction)
+{
+	const btVector3& previousOrigin = previousTransform.getOrigin();
+	btVector3 origin = previousOrigin + (currentTransform.getOrigin() - previousOrigin) * fraction;
+
+	btQuaternion rotation = slerp(previousTransform.getRotation(), currentTransform.getRotation(), fraction);
+
+	GameObject* gameObject = owningGameObject;
+
+	// Bullet transforms carry no scale, so the scale of the world transform is kept.
+	// The local scale is applied by the modeling transformation.
+	mat4 worldTransform = glm::translate(vec3(origin.x(), origin.y(), origin.z()))
+		* glm::mat4_cast(glm::quat(rotation.w(), rotation.x(), rotation.y(), rotation.z()))
+		* glm::scale(getScaleFromTransform(gameObject->getWorldTransform()));
+
+	// Frame of the parent that the local transform is relative to
+	mat4 parentTransform = gameObject->getWorldTransform() * glm::inverse(gameObject->localTransform);
+
+	gameObject->localTransform = glm::inverse(parentTransform) * worldTransform;
+
+} // end writeInterpolatedTransform
@@ -0,0 +1,263 @@
+#pragma once
+
+#include "Component.h"
+
+#include "Bullet/btBulletDynamicsCommon.h"
+
+// Number of collision layers. A body is on one layer and collides with the layers
+// in its mask, which has one bit per layer. Queries also take a layer mask.
+static const int COLLISION_LAYERS = 32;
+
+// Mask with the bits of all layers
+static const int ALL_LAYERS = -1;
+
+/**
+ * @class	RigidBodyComponent
+ *
+ * @brief	Puts the game object it is attached to into the physics world. The body
+ * 			behaves according to its DynamicsState:
+ *
+ * 			STATIONARY bodies never move and are not moved by collisions.
+ *
+ * 			KINEMATIC bodies are moved by the game object (by other components or
+ * 			the game) and push dynamic bodies out of their way. Their pose is read
+ * 			from the scene graph before the world is stepped.
+ *
+ * 			DYNAMIC bodies are moved by the simulation. Their poses are written
+ * 			straight into the local transform of the game object, interpolated
+ * 			between the last two steps.
+ *
+ * 			The collision shape is the one built by a mesh component (usually on
+ * 			the same game object) or one given to the constructor. Shapes of
+ * 			model meshes include the scale of the game object; the shapes of
+ * 			procedural meshes are sized by their own parameters. Heightfield and
+ * 			terrain shapes may only be used by stationary bodies.
+ */
+class RigidBodyComponent : public Component, public btMotionState
+{
+public:
+
+	/**
+	 * @fn	RigidBodyComponent::RigidBodyComponent(std::shared_ptr<class MeshComponent> meshComponent, DynamicsState state = DYNAMIC, float mass = 1.0f, int updateOrder = 200);
+	 *
+	 * @brief	Constructor for a body with the collision shape of a mesh.
+	 *
+	 * @param 	meshComponent	Mesh whose collision shape is used. The shape is taken
+	 * 							when this component is initialized.
+	 * @param 	state		 	(Optional) How the body moves.
+	 * @param 	mass		 	(Optional) Mass in kilograms. Only used by dynamic bodies.
+	 * @param 	updateOrder  	(Optional) The update order. Greater than that of mesh
+	 * 							components so their collision shapes are built first.
+	 */
+	RigidBodyComponent(std::shared_ptr<class MeshComponent> meshComponent, DynamicsState state = DYNAMIC, float mass = 1.0f, int updateOrder = 200);
+
+	/**
+	 * @fn	RigidBodyComponent::RigidBodyComponent(std::shared_ptr<btCollisionShape> collisionShape, DynamicsState state = DYNAMIC, float mass = 1.0f, int updateOrder = 200);
+	 *
+	 * @brief	Constructor for a body with a collision shape of its own.
+	 *
+	 * @param 	collisionShape	The collision shape.
+	 * @param 	state		  	(Optional) How the body moves.
+	 * @param 	mass		  	(Optional) Mass in kilograms. Only used by dynamic bodies.
+	 * @param 	updateOrder   	(Optional) The update order.
+	 */
+	RigidBodyComponent(std::shared_ptr<btCollisionShape> collisionShape, DynamicsState state = DYNAMIC, float mass = 1.0f, int updateOrder = 200);
+
+	/**
+	 * @fn	virtual RigidBodyComponent::~RigidBodyComponent();
+	 *
+	 * @brief	Destructor. Removes the body from the physics world.
+	 */
+	virtual ~RigidBodyComponent();
+
+	/**
+	 * @fn	virtual void RigidBodyComponent::initialize() override;
+	 *
+	 * @brief	Creates the body at the pose of the game object and adds it to the
+	 * 			physics world.
+	 */
+	virtual void initialize() override;
+
+	/**
+	 * @fn	DynamicsState RigidBodyComponent::getDynamicsState() const
+	 *
+	 * @brief	Gets how the body moves.
+	 */
+	DynamicsState getDynamicsState() const { return dynamicsState; }
+
+	/**
+	 * @fn	void RigidBodyComponent::setDynamicsState(DynamicsState state);
+	 *
+	 * @brief	Changes how the body moves. A body that becomes dynamic starts at rest
+	 * 			at the current pose of the game object.
+	 */
+	void setDynamicsState(DynamicsState state);
+
+	/**
+	 * @fn	btRigidBody* RigidBodyComponent::getRigidBody() const
+	 *
+	 * @brief	Gets the Bullet body for settings that are not wrapped here.
+	 *
+	 * @returns	Null before the component is initialized.
+	 */
+	btRigidBody* getRigidBody() const { return rigidBody.get(); }
+
+	/**
+	 * @fn	vec3 RigidBodyComponent::getVelocity() const;
+	 *
+	 * @brief	Gets the linear velocity in World coordinates.
+	 */
+	vec3 getVelocity() const;
+
+	/**
+	 * @fn	void RigidBodyComponent::setVelocity(const vec3& velocity);
+	 *
+	 * @brief	Sets the linear velocity of a dynamic body in World coordinates.
+	 */
+	void setVelocity(const vec3& velocity);
+
+	/**
+	 * @fn	void RigidBodyComponent::applyImpulse(const vec3& impulse);
+	 *
+	 * @brief	Changes the momentum of a dynamic body by an impulse through its center
+	 * 			of mass.
+	 *
+	 * @param 	impulse	The impulse in Newton seconds in World coordinates.
+	 */
+	void applyImpulse(const vec3& impulse);
+
+	/**
+	 * @fn	void RigidBodyComponent::setFriction(float friction);
+	 *
+	 * @brief	Sets the friction coefficient of the surface.
+	 */
+	void setFriction(float friction);
+
+	/**
+	 * @fn	void RigidBodyComponent::setRestitution(float restitution);
+	 *
+	 * @brief	Sets how bouncy the surface is. Zero loses all speed along the contact
+	 * 			normal, one loses none.
+	 */
+	void setRestitution(float restitution);
+
+	/**
+	 * @fn	void RigidBodyComponent::setCollisionLayer(int layer, int collisionMask = ALL_LAYERS);
+	 *
+	 * @brief	Puts the body on a collision layer. Bodies only collide if each is on a
+	 * 			layer in the mask of the other.
+	 *
+	 * @param 	layer		 	The layer, from 0 to COLLISION_LAYERS - 1. Bodies start
+	 * 							on layer 0.
+	 * @param 	collisionMask	(Optional) Bit (1 << layer) is set for each layer the
+	 * 							body collides with.
+	 */
+	void setCollisionLayer(int layer, int collisionMask = ALL_LAYERS);
+
+	/**
+	 * @fn	int RigidBodyComponent::getCollisionLayer() const
+	 *
+	 * @brief	Gets the collision layer of the body.
+	 */
+	int getCollisionLayer() const { return collisionLayer; }
+
+	/**
+	 * @fn	int RigidBodyComponent::getCollisionMask() const
+	 *
+	 * @brief	Gets the mask of the layers the body collides with.
+	 */
+	int getCollisionMask() const { return collisionMask; }
+
+	/**
+	 * @fn	virtual void RigidBodyComponent::getWorldTransform(btTransform& worldTransform) const override;
+	 *
+	 * @brief	Called by Bullet to get the pose of the body in World coordinates when
+	 * 			the body is created and, for kinematic bodies, at every step. Steps
+	 * 			are taken on the physics thread, so kinematic bodies return the pose
+	 * 			read from the scene graph before the steps were started.
+	 */
+	virtual void getWorldTransform(btTransform& worldTransform) const override;
+
+	/**
+	 * @fn	virtual void RigidBodyComponent::setWorldTransform(const btTransform& worldTransform) override;
+	 *
+	 * @brief	Called by Bullet with the new pose of a moving body after a step.
+	 */
+	virtual void setWorldTransform(const btTransform& worldTransform) override;
+
+protected:
+
+	/** @brief	friend declaration
+	 * The physics engine keeps the poses of the last two steps and writes the
+	 * interpolated pose into the scene graph.
+	 */
+	friend class PhysicsEngine;
+
+	/**
+	 * @fn	void RigidBodyComponent::beginStep();
+	 *
+	 * @brief	Saves the pose of the latest step as the previous one before the world
+	 * 			is stepped again.
+	 */
+	void beginStep() { previousTransform = currentTransform; }
+
+	/**
+	 * @fn	void RigidBodyComponent::readKinematicTransform()
+	 *
+	 * @brief	Saves the pose of the game object for Bullet to read while the world is
+	 * 			stepped.
+	 */
+	void readKinematicTransform() { getGameObjectTransform(kinematicTransform); }
+
+	/**
+	 * @fn	void RigidBodyComponent::getGameObjectTransform(btTransform& worldTransform) const;
+	 *
+	 * @brief	Gets the position and orientation of the game object in World
+	 * 			coordinates.
+	 */
+	void getGameObjectTransform(btTransform& worldTransform) const;
+
+	/**
+	 * @fn	void RigidBodyComponent::writeInterpolatedTransform(float fraction);
+	 *
+	 * @brief	Sets the local transform of the game object to a pose between the
+	 * 			previous and the latest step.
+	 *
+	 * @param 	fraction	Zero for the previous pose, one for the latest.
+	 */
+	void writeInterpolatedTransform(float fraction);
+
+	/**
+	 * @fn	void RigidBodyComponent::setBodyType();
+	 *
+	 * @brief	Sets the mass, flags and activation of the body from the dynamics state.
+	 */
+	void setBodyType();
+
+	/** @brief	Mesh the collision shape is taken from */
+	std::weak_ptr<class MeshComponent> meshComponent;
+
+	/** @brief	The collision shape. Kept alive while the body exists. */
+	std::shared_ptr<btCollisionShape> collisionShape;
+
+	/** @brief	The body in the physics world */
+	std::unique_ptr<btRigidBody> rigidBody;
+
+	/** @brief	How the body moves */
+	DynamicsState dynamicsState;
+
+	/** @brief	Mass of the body when it is dynamic */
+	float mass;
+
+	/** @brief	Layer the body is on and the layers it collides with */
+	int collisionLayer = 0;
+	int collisionMask = ALL_LAYERS;
+
+	/** @brief	Poses of the body after the last two steps, in World coordinates */
+	btTransform previousTransform;
+	btTransform currentTransform;
+
+	/** @brief	Pose of a kinematic game object when the steps were started */
+	btTransform kinematicTransform;
+
+}; // end RigidBodyComponent
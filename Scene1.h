@@ -27,6 +27,25 @@ class Scene1 : public Game
 		SharedMaterials::setUniformBlockForShader(shaderProgram);
 		SharedTransformations::setUniformBlockForShader(shaderProgram);
 		SharedLighting::setUniformBlockForShader(shaderProgram);
+
+		// ****** lightGameObject *********
+
+		GameObjectPtr lightGameObject = std::make_shared<GameObject>();
+		this->addChildGameObject(lightGameObject);
+		lightGameObject->rotateTo(vec3(-1.0f, -1.0f, -1.0f), LOCAL);
+		std::shared_ptr<LightComponent> sunLight = std::make_shared<LightComponent>(DIRECTIONAL_LIGHT);
+		sunLight->setCastsShadows(true);
+		lightGameObject->addComponent(sunLight);
+		lightGameObject->gameObjectName = "directional light";
+
+		// ****** cameraGameObject *********
+
+		GameObjectPtr cameraGameObject = std::make_shared<GameObject>();
+		this->addChildGameObject(cameraGameObject);
+		cameraGameObject->setPosition(vec3(0.0f, 0.0f, 25.0f), WORLD);
+		std::shared_ptr<CameraComponent> camera = std::make_shared<CameraComponent>();
+		cameraGameObject->addComponent(camera);
+		cameraGameObject->gameObjectName = "camera";
 	
 		// ****** Blue Sphere  *********
 		GameObjectPtr sphereObject2 = std::make_shared<GameObject>();
@@ -35,7 +54,8 @@ class Scene1 : public Game
 		sphereObject2->setPosition(vec3(0.0f, 0.0f, -40.0f), WORLD);
 
 		Material sphereMaterial2;
-		sphereMaterial2.setDiffuseTexture(Texture::GetTexture("Textures/Earthmap.jpg")->getTextureObject());
+		// Only the visible pages of the planet texture are kept in memory
+		sphereMaterial2.setVirtualTexture(VirtualTexture::GetVirtualTexture("Textures/Earthmap.jpg"));
 
 		sphereMaterial2.setTextureMode(DECAL);
 
@@ -44,5 +64,30 @@ class Scene1 : public Game
 
 		sphereObject2->addComponent(make_shared<ArrowRotateComponent>(glm::radians(25.0f)));
 
+		// ****** Minimap *********
+
+		// Camera looking down on the sphere that renders into a texture
+		std::shared_ptr<RenderTarget> minimapTarget = std::make_shared<RenderTarget>(glm::ivec2(512, 512));
+
+		GameObjectPtr minimapCameraObject = std::make_shared<GameObject>();
+		this->addChildGameObject(minimapCameraObject);
+		minimapCameraObject->setPosition(vec3(0.0f, 60.0f, -40.0f), WORLD);
+		minimapCameraObject->rotateTo(vec3(0.0f, -1.0f, 0.0f), LOCAL);
+		std::shared_ptr<CameraComponent> minimapCamera = std::make_shared<CameraComponent>();
+		minimapCamera->setRenderTarget(minimapTarget);
+		minimapCameraObject->addComponent(minimapCamera);
+		minimapCameraObject->gameObjectName = "minimap camera";
+
+		// Screen that shows what the minimap camera sees. Out of the view of that camera.
+		GameObjectPtr screenObject = std::make_shared<GameObject>();
+		addChildGameObject(screenObject);
+		screenObject->setPosition(vec3(-6.0f, 3.0f, 0.0f), WORLD);
+
+		Material screenMaterial;
+		screenMaterial.setDiffuseTexture(minimapTarget);
+
+		std::shared_ptr<BoxMeshComponent> screenMesh = std::make_shared<BoxMeshComponent>(shaderProgram, screenMaterial, 4.0f, 4.0f, 0.1f);
+		screenObject->addComponent(screenMesh);
+
 	}
 };
@@ -28,6 +28,25 @@ class Scene2 : public Game
 		SharedTransformations::setUniformBlockForShader(shaderProgram);
 		SharedLighting::setUniformBlockForShader(shaderProgram);
 
+		// ****** lightGameObject *********
+
+		GameObjectPtr lightGameObject = std::make_shared<GameObject>();
+		this->addChildGameObject(lightGameObject);
+		lightGameObject->rotateTo(vec3(-1.0f, -1.0f, -1.0f), LOCAL);
+		std::shared_ptr<LightComponent> sunLight = std::make_shared<LightComponent>(DIRECTIONAL_LIGHT);
+		sunLight->setCastsShadows(true);
+		lightGameObject->addComponent(sunLight);
+		lightGameObject->gameObjectName = "directional light";
+
+		// ****** cameraGameObject *********
+
+		GameObjectPtr cameraGameObject = std::make_shared<GameObject>();
+		this->addChildGameObject(cameraGameObject);
+		cameraGameObject->setPosition(vec3(0.0f, 0.0f, 25.0f), WORLD);
+		std::shared_ptr<CameraComponent> camera = std::make_shared<CameraComponent>();
+		cameraGameObject->addComponent(camera);
+		cameraGameObject->gameObjectName = "camera";
+
 		// ****** Brick Box *********
 		GameObjectPtr boxObject2 = std::make_shared<GameObject>();
 
@@ -37,7 +56,7 @@ class Scene2 : public Game
 		Material boxMaterial2;
 		boxMaterial2.setDiffuseColor(vec3(0.2f, 0.2f, 0.5f));
 
-		boxMaterial2.setDiffuseTexture(Texture::GetTexture("Textures/BRICK.BMP")->getTextureObject());
+		boxMaterial2.setDiffuseTexture(Texture::GetTexture("Textures/BRICK.BMP"));
 
 		boxMaterial2.setTextureMode(DECAL);
 
@@ -31,19 +31,72 @@ class Scene3 : public Game
 		SharedMaterials::setUniformBlockForShader(shaderProgram);
 		SharedLighting::setUniformBlockForShader(shaderProgram);
 
-		// ****** boxGameObject *********
+		// ****** lightGameObject *********
 
-		GameObjectPtr boxGameObject = std::make_shared<GameObject>();
-		this->addChildGameObject(boxGameObject);
-		boxGameObject->setPosition(vec3(0.0f, -5.0f, 0.0f), WORLD);
+		GameObjectPtr lightGameObject = std::make_shared<GameObject>();
+		this->addChildGameObject(lightGameObject);
+		lightGameObject->rotateTo(vec3(-1.0f, -1.0f, -1.0f), LOCAL);
+		std::shared_ptr<LightComponent> sunLight = std::make_shared<LightComponent>(DIRECTIONAL_LIGHT);
+		sunLight->setCastsShadows(true);
+		lightGameObject->addComponent(sunLight);
+		lightGameObject->gameObjectName = "directional light";
 
-		Material boxMat;
+		// ****** cameraGameObject *********
 
-		boxMat.setDiffuseTexture(Texture::GetTexture("Textures/wood.png")->getTextureObject());
-		std::shared_ptr<BoxMeshComponent> boxMesh = std::make_shared<BoxMeshComponent>(shaderProgram, boxMat,  100.0f, 1.0f, 100.0f);
+		GameObjectPtr cameraGameObject = std::make_shared<GameObject>();
+		this->addChildGameObject(cameraGameObject);
+		cameraGameObject->setPosition(vec3(0.0f, 0.0f, 25.0f), WORLD);
+		std::shared_ptr<CameraComponent> camera = std::make_shared<CameraComponent>();
+		camera->setCameraClearColor(YELLOW_RGBA);
+		cameraGameObject->addComponent(camera);
+		cameraGameObject->gameObjectName = "camera";
 
-		boxGameObject->addComponent(boxMesh);
-		boxGameObject->gameObjectName = "box - STATIONARY";
+		// Ring of colored point lights above the floor
+		for (int i = 0; i < 12; i++) {
+
+			float angle = 2.0f * PI * i / 12.0f;
+
+			int lightID = ClusteredLighting::addLight();
+			ClusteredLighting::setPosition(lightID, vec3(10.0f * cos(angle), -2.0f, 10.0f * sin(angle) - 5.0f));
+			ClusteredLighting::setDiffuseColor(lightID, 0.5f * (vec3(cos(angle), cos(angle + 2.0f * PI / 3.0f), cos(angle + 4.0f * PI / 3.0f)) + 1.0f));
+			ClusteredLighting::setRange(lightID, 8.0f);
+		}
+
+		// ****** terrainGameObject *********
+
+		ShaderInfo terrainShaders[] = {
+			{ GL_VERTEX_SHADER, "Shaders/terrainVertexShader.glsl" },
+			{ GL_FRAGMENT_SHADER, "Shaders/fragmentShader.glsl" },
+			{ GL_NONE, NULL } // signals that there are no more shaders 
+		};
+
+		GLuint terrainShaderProgram = BuildShaderProgram(terrainShaders);
+
+		SharedTransformations::setUniformBlockForShader(terrainShaderProgram);
+		SharedMaterials::setUniformBlockForShader(terrainShaderProgram);
+		SharedLighting::setUniformBlockForShader(terrainShaderProgram);
+
+		GameObjectPtr terrainGameObject = std::make_shared<GameObject>();
+		this->addChildGameObject(terrainGameObject);
+		terrainGameObject->setPosition(vec3(0.0f, -4.5f, 0.0f), WORLD);
+
+		Material terrainMat;
+		terrainMat.setDiffuseTexture(Texture::GetTexture("Textures/wood.png"));
+
+		// Tiles that are not on disk are generated: flat around the origin and
+		// rising into hills further out
+		TerrainSettings terrainSettings;
+		terrainSettings.tileDirectory = "Assets/Terrain";
+		terrainSettings.heightFunction = [](float x, float z) {
+
+			float hills = 12.0f * glm::sin(x * 0.011f) * glm::cos(z * 0.013f) + 4.0f * glm::sin((x + z) * 0.037f);
+			return hills * glm::clamp((glm::sqrt(x * x + z * z) - 60.0f) / 200.0f, 0.0f, 1.0f);
+		};
+
+		std::shared_ptr<TerrainComponent> terrain = std::make_shared<TerrainComponent>(terrainShaderProgram, terrainMat, terrainSettings);
+
+		terrainGameObject->addComponent(terrain);
+		terrainGameObject->gameObjectName = "terrain - STATIONARY";
 	
 		//// ****** dinoGameObject *********
 
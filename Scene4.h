@@ -0,0 +1,101 @@
+#pragma once
+
+#include "GameEngine.h"
+
+// Boxes in the physics benchmark. The towers have BENCHMARK_BOXES_PER_TOWER boxes.
+static const int BENCHMARK_BOXES = 5000;
+
+// Set to time stepping the stacks with each number of threads before the scene
+// is built. Blocks start-up for a while.
+static const bool RUN_PHYSICS_BENCHMARK = false;
+
+class Scene4 : public Game
+{
+	void loadScene() override
+	{
+		// Set the window title
+		glfwSetWindowTitle(renderWindow, "Scene 4 - Physics Benchmark");
+
+		// Set the clear color
+		glClearColor(0.5f, 0.5f, 0.5f, 1.0f);
+
+		// Time stepping the stacks with each number of threads before the scene is built
+		if (RUN_PHYSICS_BENCHMARK) {
+			PhysicsEngine::runBenchmark(BENCHMARK_BOXES);
+		}
+
+		// Build and use the shader program
+		ShaderInfo shaders[] = {
+			{ GL_VERTEX_SHADER, "Shaders/vertexShader.glsl" },
+			{ GL_FRAGMENT_SHADER, "Shaders/fragmentShader.glsl" },
+			{ GL_NONE, NULL } // signals that there are no more shaders 
+		};
+
+		GLuint shaderProgram = BuildShaderProgram(shaders);
+
+		SharedMaterials::setUniformBlockForShader(shaderProgram);
+		SharedTransformations::setUniformBlockForShader(shaderProgram);
+		SharedLighting::setUniformBlockForShader(shaderProgram);
+
+		// ****** lightGameObject *********
+
+		GameObjectPtr lightGameObject = std::make_shared<GameObject>();
+		this->addChildGameObject(lightGameObject);
+		lightGameObject->rotateTo(vec3(-1.0f, -1.0f, -1.0f), LOCAL);
+		std::shared_ptr<LightComponent> sunLight = std::make_shared<LightComponent>(DIRECTIONAL_LIGHT);
+		sunLight->setCastsShadows(true);
+		lightGameObject->addComponent(sunLight);
+		lightGameObject->gameObjectName = "directional light";
+
+		// ****** cameraGameObject *********
+
+		GameObjectPtr cameraGameObject = std::make_shared<GameObject>();
+		this->addChildGameObject(cameraGameObject);
+		cameraGameObject->setPosition(vec3(0.0f, 0.0f, 25.0f), WORLD);
+		std::shared_ptr<CameraComponent> camera = std::make_shared<CameraComponent>();
+		cameraGameObject->addComponent(camera);
+		cameraGameObject->gameObjectName = "camera";
+
+		// ****** groundGameObject *********
+
+		int towerCount = BENCHMARK_BOXES / BENCHMARK_BOXES_PER_TOWER;
+		int towersPerRow = static_cast<int>(std::ceil(std::sqrt(static_cast<float>(towerCount))));
+		vec3 groundCenter(0.0f, -10.0f, -40.0f);
+
+		GameObjectPtr groundObject = std::make_shared<GameObject>();
+		addChildGameObject(groundObject);
+		groundObject->setPosition(groundCenter - vec3(0.0f, 0.5f, 0.0f), WORLD);
+		groundObject->gameObjectName = "ground - STATIONARY";
+
+		Material groundMaterial;
+		groundMaterial.setDiffuseColor(vec3(0.3f, 0.3f, 0.3f));
+
+		float groundSize = 2.0f * towersPerRow + 4.0f;
+		std::shared_ptr<BoxMeshComponent> groundMesh = std::make_shared<BoxMeshComponent>(shaderProgram, groundMaterial, groundSize, 1.0f, groundSize);
+		groundObject->addComponent(groundMesh);
+		groundObject->addComponent(std::make_shared<RigidBodyComponent>(groundMesh, STATIONARY));
+
+		// ****** boxGameObjects *********
+
+		// Every box shares one mesh and one collision shape
+		Material boxMaterial;
+		boxMaterial.setDiffuseColor(vec3(0.2f, 0.2f, 0.5f));
+
+		for (int box = 0; box < BENCHMARK_BOXES; box++) {
+
+			int tower = box / BENCHMARK_BOXES_PER_TOWER;
+			float x = 2.0f * (tower % towersPerRow - 0.5f * towersPerRow);
+			float z = 2.0f * (tower / towersPerRow - 0.5f * towersPerRow);
+
+			GameObjectPtr boxObject = std::make_shared<GameObject>();
+			addChildGameObject(boxObject);
+			boxObject->setPosition(groundCenter + vec3(x, 0.5f + box % BENCHMARK_BOXES_PER_TOWER, z), WORLD);
+
+			std::shared_ptr<BoxMeshComponent> boxMesh = std::make_shared<BoxMeshComponent>(shaderProgram, boxMaterial, 1.0f, 1.0f, 1.0f);
+			boxObject->addComponent(boxMesh);
+			boxObject->addComponent(std::make_shared<RigidBodyComponent>(boxMesh, DYNAMIC, 1.0f));
+		}
+
+	} // end loadScene
+
+};
@@ -0,0 +1,279 @@
+#include "SceneQuery.h"
+
+#include <algorithm>
+
+#include "PhysicsEngine.h"
+#include "ThreadPool.h"
+
+static const bool VERBOSE = false;
+
+
+QueryHit SceneQuery::raycast(const vec3& origin, const vec3& direction, float maxDistance, int layerMask)
+{
+	PhysicsEngine::synchronize();
+
+	const btCollisionWorld* world = PhysicsEngine::getWorld();
+
+	if (world == nullptr) {
+		return QueryHit();
+	}
+
+	return castRay(world, RayQuery{ origin, direction, maxDistance, layerMask });
+
+} // end raycast
+
+
+QueryHit SceneQuery::sphereCast(const vec3& origin, float radius, const vec3& direction, float maxDistance, int layerMask)
+{
+	PhysicsEngine::synchronize();
+
+	const btCollisionWorld* world = PhysicsEngine::getWorld();
+
+	if (world == nullptr) {
+		return QueryHit();
+	}
+
+	btSphereShape sphere(radius);
+
+	return castShape(world, sphere, btQuaternion::getIdentity(), origin, direction, maxDistance, layerMask);
+
+} // end sphereCast
+
+
+QueryHit SceneQuery::boxCast(const vec3& origin, const vec3& halfExtents, const glm::quat& orientation,
+							 const vec3& direction, float maxDistance, int layerMask)
+{
+	PhysicsEngine::synchronize();
+
+	const btCollisionWorld* world = PhysicsEngine::getWorld();
+
+	if (world == nullptr) {
+		return QueryHit();
+	}
+
+	btBoxShape box(btVector3(halfExtents.x, halfExtents.y, halfExtents.z));
+
+	return castShape(world, box, btQuaternion(orientation.x, orientation.y, orientation.z, orientation.w),
+					 origin, direction, maxDistance, layerMask);
+
+} // end boxCast
+
+
+std::vector<RigidBodyComponent*> SceneQuery::overlapSphere(const vec3& center, float radius, int layerMask)
+{
+	btSphereShape sphere(radius);
+
+	btTransform pose;
+	pose.setIdentity();
+	pose.setOrigin(btVector3(center.x, center.y, center.z));
+
+	return overlap(sphere, pose, layerMask);
+
+} // end overlapSphere
+
+
+std::vector<RigidBodyComponent*> SceneQuery::overlapBox(const vec3& center, const vec3& halfExtents, const glm::quat& orientation, int layerMask)
+{
+	btBoxShape box(btVector3(halfExtents.x, halfExtents.y, halfExtents.z));
+
+	btTransform pose(btQuaternion(orientation.x, orientation.y, orientation.z, orientation.w),
+					 btVector3(center.x, center.y, center.z));
+
+	return overlap(box, pose, layerMask);
+
+} // end overlapBox
+
+
+void SceneQuery::raycast(const std::vector<RayQuery>& queries, std::vector<QueryHit>& hits)
+{
+	PhysicsEngine::synchronize();
+
+	const btCollisionWorld* world = PhysicsEngine::getWorld();
+
+	hits.assign(queries.size(), QueryHit());
+
+	if (world == nullptr) {
+		return;
+	}
+
+	runBatch(queries.size(), [world, &queries, &hits](size_t query) {
+
+		hits[query] = castRay(world, queries[query]);
+	});
+
+} // end raycast
+
+
+void SceneQuery::sphereCast(const std::vector<SphereCastQuery>& queries, std::vector<QueryHit>& hits)
+{
+	PhysicsEngine::synchronize();
+
+	const btCollisionWorld* world = PhysicsEngine::getWorld();
+
+	hits.assign(queries.size(), QueryHit());
+
+	if (world == nullptr) {
+		return;
+	}
+
+	runBatch(queries.size(), [world, &queries, &hits](size_t query) {
+
+		const SphereCastQuery& sphereQuery = queries[query];
+
+		btSphereShape sphere(sphereQuery.radius);
+
+		hits[query] = castShape(world, sphere, btQuaternion::getIdentity(), sphereQuery.origin,
+								sphereQuery.direction, sphereQuery.maxDistance, sphereQuery.layerMask);
+	});
+
+} // end sphereCast
+
+
+void SceneQuery::runBatch(size_t count, const std::function<void(size_t query)>& query)
+{
+#ifdef BT_THREADSAFE
+	ThreadPool::parallelFor(count, QUERIES_PER_TASK, [&query](size_t begin, size_t end) {
+
+		for (size_t i = begin; i < end; i++) {
+			query(i);
+		}
+	});
+#else
+	// The broadphase shares one traversal stack between all threads
+	for (size_t i = 0; i < count; i++) {
+		query(i);
+	}
+#endif
+
+	if (VERBOSE) cout << count << " queries run" << endl;
+
+} // end runBatch
+
+
+QueryHit SceneQuery::castRay(const btCollisionWorld* world, const RayQuery& query)
+{
+	QueryHit hit;
+
+	float length = glm::length(query.direction);
+
+	if (length == 0.0f || query.maxDistance <= 0.0f) {
+		return hit;
+	}
+
+	vec3 end = query.origin + query.direction * (query.maxDistance / length);
+
+	btVector3 rayFrom(query.origin.x, query.origin.y, query.origin.z);
+	btVector3 rayTo(end.x, end.y, end.z);
+
+	// The query is on every layer, so the masks of the bodies do not hide them
+	btCollisionWorld::ClosestRayResultCallback callback(rayFrom, rayTo);
+	callback.m_collisionFilterGroup = ALL_LAYERS;
+	callback.m_collisionFilterMask = query.layerMask;
+
+	world->rayTest(rayFrom, rayTo, callback);
+
+	if (callback.hasHit()) {
+
+		const btVector3& point = callback.m_hitPointWorld;
+		const btVector3& normal = callback.m_hitNormalWorld;
+
+		hit.hit = true;
+		hit.rigidBody = static_cast<RigidBodyComponent*>(callback.m_collisionObject->getUserPointer());
+		hit.point = vec3(point.x(), point.y(), point.z());
+		hit.normal = vec3(normal.x(), normal.y(), normal.z());
+		hit.distance = callback.m_closestHitFraction * query.maxDistance;
+	}
+
+	return hit;
+
+} // end castRay
+
+
+QueryHit SceneQuery::castShape(const btCollisionWorld* world, const btConvexShape& shape, const btQuaternion& orientation,
+							   const vec3& origin, const vec3& direction, float maxDistance, int layerMask)
+{
+	QueryHit hit;
+
+	float length = glm::length(direction);
+
+	if (length == 0.0f || maxDistance <= 0.0f) {
+		return hit;
+	}
+
+	vec3 end = origin + direction * (maxDistance / length);
+
+	btTransform from(orientation, btVector3(origin.x, origin.y, origin.z));
+	btTransform to(orientation, btVector3(end.x, end.y, end.z));
+
+	btCollisionWorld::ClosestConvexResultCallback callback(from.getOrigin(), to.getOrigin());
+	callback.m_collisionFilterGroup = ALL_LAYERS;
+	callback.m_collisionFilterMask = layerMask;
+
+	world->convexSweepTest(&shape, from, to, callback);
+
+	if (callback.hasHit()) {
+
+		const btVector3& point = callback.m_hitPointWorld;
+		const btVector3& normal = callback.m_hitNormalWorld;
+
+		hit.hit = true;
+		hit.rigidBody = static_cast<RigidBodyComponent*>(callback.m_hitCollisionObject->getUserPointer());
+		hit.point = vec3(point.x(), point.y(), point.z());
+		hit.normal = vec3(normal.x(), normal.y(), normal.z());
+		hit.distance = callback.m_closestHitFraction * maxDistance;
+	}
+
+	return hit;
+
+} // end castShape
+
+
+std::vector<RigidBodyComponent*> SceneQuery::overlap(btCollisionShape& shape, const btTransform& pose, int layerMask)
+{
+	// Collects each body touching the query object once
+	struct OverlapCallback : public btCollisionWorld::ContactResultCallback {
+
+		const btCollisionObject* queryObject;
+		std::vector<RigidBodyComponent*> bodies;
+
+		virtual btScalar addSingleResult(btManifoldPoint& point, const btCollisionObjectWrapper* wrapper0, int partId0, int index0,
+										 const btCollisionObjectWrapper* wrapper1, int partId1, int index1) override
+		{
+			const btCollisionObject* other = wrapper0->getCollisionObject();
+
+			if (other == queryObject) {
+				other = wrapper1->getCollisionObject();
+			}
+
+			RigidBodyComponent* body = static_cast<RigidBodyComponent*>(other->getUserPointer());
+
+			if (body != nullptr && std::find(bodies.begin(), bodies.end(), body) == bodies.end()) {
+				bodies.push_back(body);
+			}
+
+			return 0.0f;
+		}
+	};
+
+	PhysicsEngine::synchronize();
+
+	btCollisionWorld* world = PhysicsEngine::getWorld();
+
+	if (world == nullptr) {
+		return std::vector<RigidBodyComponent*>();
+	}
+
+	btCollisionObject queryObject;
+	queryObject.setCollisionShape(&shape);
+	queryObject.setWorldTransform(pose);
+
+	OverlapCallback callback;
+	callback.queryObject = &queryObject;
+	callback.m_collisionFilterGroup = ALL_LAYERS;
+	callback.m_collisionFilterMask = layerMask;
+
+	world->contactTest(&queryObject, callback);
+
+	return callback.bodies;
+
+} // end overlap
@@ -0,0 +1,207 @@
+#pragma once
+
+#include <functional>
+#include <vector>
+
+#include "MathLibsConstsFuncs.h"
+
+#include "Bullet/btBulletDynamicsCommon.h"
+
+#include "RigidBodyComponent.h"
+
+using namespace constants_and_types;
+
+// Fewest queries of a batch run by one task of the ThreadPool
+static const int QUERIES_PER_TASK = 64;
+
+/**
+ * @struct	QueryHit
+ *
+ * @brief	The closest hit of a ray or shape cast.
+ */
+struct QueryHit {
+
+	// True if anything was hit
+	bool hit = false;
+
+	// Body that was hit. Null for objects in the world that have no component.
+	RigidBodyComponent* rigidBody = nullptr;
+
+	// Point of contact and surface normal in World coordinates
+	vec3 point = vec3(0.0f);
+	vec3 normal = vec3(0.0f);
+
+	// Distance travelled along the cast before the hit
+	float distance = 0.0f;
+};
+
+/**
+ * @struct	RayQuery
+ *
+ * @brief	A ray in a batch of ray casts, e.g. a line of sight check.
+ */
+struct RayQuery {
+
+	vec3 origin;
+	vec3 direction;
+	float maxDistance;
+
+	int layerMask = ALL_LAYERS;
+};
+
+/**
+ * @struct	SphereCastQuery
+ *
+ * @brief	A sphere in a batch of sphere casts, e.g. a projectile's movement during
+ * 			a frame.
+ */
+struct SphereCastQuery {
+
+	vec3 origin;
+	float radius;
+	vec3 direction;
+	float maxDistance;
+
+	int layerMask = ALL_LAYERS;
+};
+
+/**
+ * @class	SceneQuery
+ *
+ * @brief	Spatial queries of the rigid bodies in the physics world: ray, sphere and
+ * 			box casts that find the closest hit and overlap tests that find every
+ * 			body touching a shape. The broadphase of the world narrows the bodies
+ * 			tested to those whose bounding boxes the query passes through.
+ *
+ * 			Only bodies on a layer in the layer mask of a query are found. Queries
+ * 			see the poses of the latest physics step, not the interpolated poses
+ * 			that are drawn. They wait for the physics thread to finish its steps,
+ * 			so they are best made while the game objects are updated.
+ *
+ * 			The batched casts run their queries in parallel on the ThreadPool.
+ * 			That needs a Bullet built with BT_THREADSAFE, whose broadphase keeps a
+ * 			traversal stack per thread. Otherwise they run one after another on the
+ * 			calling thread.
+ */
+class SceneQuery
+{
+public:
+
+	/**
+	 * @fn	static QueryHit SceneQuery::raycast(const vec3& origin, const vec3& direction, float maxDistance, int layerMask = ALL_LAYERS);
+	 *
+	 * @brief	Finds the first body along a ray.
+	 *
+	 * @param 	origin	   	Start of the ray in World coordinates.
+	 * @param 	direction  	Direction of the ray. Need not be normalized.
+	 * @param 	maxDistance	Length of the ray.
+	 * @param 	layerMask  	(Optional) Layers of the bodies that can be hit.
+	 *
+	 * @returns	The closest hit.
+	 */
+	static QueryHit raycast(const vec3& origin, const vec3& direction, float maxDistance, int layerMask = ALL_LAYERS);
+
+	/**
+	 * @fn	static QueryHit SceneQuery::sphereCast(const vec3& origin, float radius, const vec3& direction, float maxDistance, int layerMask = ALL_LAYERS);
+	 *
+	 * @brief	Finds the first body a moving sphere runs into.
+	 *
+	 * @param 	origin	   	Start position of the center of the sphere.
+	 * @param 	radius	   	Radius of the sphere.
+	 * @param 	direction  	Direction the sphere moves in.
+	 * @param 	maxDistance	Distance the sphere moves.
+	 * @param 	layerMask  	(Optional) Layers of the bodies that can be hit.
+	 *
+	 * @returns	The closest hit.
+	 */
+	static QueryHit sphereCast(const vec3& origin, float radius, const vec3& direction, float maxDistance, int layerMask = ALL_LAYERS);
+
+	/**
+	 * @fn	static QueryHit SceneQuery::boxCast(const vec3& origin, const vec3& halfExtents, const glm::quat& orientation, const vec3& direction, float maxDistance, int layerMask = ALL_LAYERS);
+	 *
+	 * @brief	Finds the first body a moving box runs into. The box does not turn as
+	 * 			it moves.
+	 *
+	 * @param 	origin	   	Start position of the center of the box.
+	 * @param 	halfExtents	Half the size of the box along each of its axes.
+	 * @param 	orientation	Orientation of the box.
+	 * @param 	direction  	Direction the box moves in.
+	 * @param 	maxDistance	Distance the box moves.
+	 * @param 	layerMask  	(Optional) Layers of the bodies that can be hit.
+	 *
+	 * @returns	The closest hit.
+	 */
+	static QueryHit boxCast(const vec3& origin, const vec3& halfExtents, const glm::quat& orientation,
+							const vec3& direction, float maxDistance, int layerMask = ALL_LAYERS);
+
+	/**
+	 * @fn	static std::vector<RigidBodyComponent*> SceneQuery::overlapSphere(const vec3& center, float radius, int layerMask = ALL_LAYERS);
+	 *
+	 * @brief	Finds the bodies that touch or are inside a sphere.
+	 *
+	 * @returns	Each body once, in no particular order.
+	 */
+	static std::vector<RigidBodyComponent*> overlapSphere(const vec3& center, float radius, int layerMask = ALL_LAYERS);
+
+	/**
+	 * @fn	static std::vector<RigidBodyComponent*> SceneQuery::overlapBox(const vec3& center, const vec3& halfExtents, const glm::quat& orientation, int layerMask = ALL_LAYERS);
+	 *
+	 * @brief	Finds the bodies that touch or are inside a box.
+	 *
+	 * @returns	Each body once, in no particular order.
+	 */
+	static std::vector<RigidBodyComponent*> overlapBox(const vec3& center, const vec3& halfExtents, const glm::quat& orientation, int layerMask = ALL_LAYERS);
+
+	/**
+	 * @fn	static void SceneQuery::raycast(const std::vector<RayQuery>& queries, std::vector<QueryHit>& hits);
+	 *
+	 * @brief	Casts a batch of rays in parallel.
+	 *
+	 * @param 		  	queries	The rays.
+	 * @param [out]	hits   	The closest hit of each ray, in the same order.
+	 */
+	static void raycast(const std::vector<RayQuery>& queries, std::vector<QueryHit>& hits);
+
+	/**
+	 * @fn	static void SceneQuery::sphereCast(const std::vector<SphereCastQuery>& queries, std::vector<QueryHit>& hits);
+	 *
+	 * @brief	Casts a batch of spheres in parallel.
+	 *
+	 * @param 		  	queries	The spheres.
+	 * @param [out]	hits   	The closest hit of each sphere, in the same order.
+	 */
+	static void sphereCast(const std::vector<SphereCastQuery>& queries, std::vector<QueryHit>& hits);
+
+protected:
+
+	/**
+	 * @fn	static QueryHit SceneQuery::castRay(const btCollisionWorld* world, const RayQuery& query);
+	 *
+	 * @brief	Casts a ray without waiting for the physics thread.
+	 */
+	static QueryHit castRay(const btCollisionWorld* world, const RayQuery& query);
+
+	/**
+	 * @fn	static QueryHit SceneQuery::castShape(const btCollisionWorld* world, const btConvexShape& shape, const btQuaternion& orientation, const vec3& origin, const vec3& direction, float maxDistance, int layerMask);
+	 *
+	 * @brief	Casts a convex shape without waiting for the physics thread.
+	 */
+	static QueryHit castShape(const btCollisionWorld* world, const btConvexShape& shape, const btQuaternion& orientation,
+							  const vec3& origin, const vec3& direction, float maxDistance, int layerMask);
+
+	/**
+	 * @fn	static std::vector<RigidBodyComponent*> SceneQuery::overlap(btCollisionShape& shape, const btTransform& pose, int layerMask);
+	 *
+	 * @brief	Finds the bodies touching a shape.
+	 */
+	static std::vector<RigidBodyComponent*> overlap(btCollisionShape& shape, const btTransform& pose, int layerMask);
+
+	/**
+	 * @fn	static void SceneQuery::runBatch(size_t count, const std::function<void(size_t query)>& query);
+	 *
+	 * @brief	Runs the queries of a batch on the ThreadPool if Bullet is thread safe,
+	 * 			else on the calling thread.
+	 */
+	static void runBatch(size_t count, const std::function<void(size_t query)>& query);
+
+}; // end SceneQuery
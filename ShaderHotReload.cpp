@@ -0,0 +1,337 @@
+#include "ShaderHotReload.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <filesystem>
+#include <mutex>
+#include <thread>
+
+#include "MeshComponent.h"
+
+static const bool VERBOSE = false;
+
+// Source files of a program created by BuildShaderProgram
+struct WatchedProgram {
+
+	// Program currently in use. Updated when a rebuilt program is swapped in.
+	GLuint program = 0;
+
+	// Shader types and names of the source files
+	std::vector<GLenum> types;
+	std::vector<std::string> filenames;
+
+	// Preprocessor definitions the program was built with
+	std::string defines;
+
+	// Newest modification time of the source files when the program was last built
+	std::filesystem::file_time_type builtWriteTime;
+
+	// Newest modification time seen by the previous check. A program is only
+	// rebuilt once its files have stopped changing between two checks so that
+	// files that are still being written are not compiled.
+	std::filesystem::file_time_type seenWriteTime;
+};
+
+// Result of rebuilding a watched program on the background context
+struct RebuiltProgram {
+
+	// Index of the watched program
+	size_t watchedIndex = 0;
+
+	// The new program. Zero if the sources failed to compile or link.
+	GLuint program = 0;
+
+	// Compiler or linker output
+	std::string errorLog;
+};
+
+// Static variable definitions (Static variables must be defined outside the declaration)
+#ifdef _DEBUG
+bool ShaderHotReload::enabled = true;
+#else
+bool ShaderHotReload::enabled = false;
+#endif
+GLFWwindow* ShaderHotReload::compileWindow = nullptr;
+std::vector<std::function<void(GLuint, GLuint)>> ShaderHotReload::swapCallbacks;
+
+// Programs whose source files are watched. Guarded by watchMutex.
+static std::vector<WatchedProgram> watchedPrograms;
+
+// Programs rebuilt by the background thread that have not been swapped in.
+// Guarded by watchMutex.
+static std::vector<RebuiltProgram> rebuiltPrograms;
+
+static std::mutex watchMutex;
+static std::condition_variable watchCondition;
+static std::thread watchThread;
+static bool watching = false;
+
+
+// Gets the newest modification time of a set of files. Files that cannot be
+// read (e.g. while an editor replaces them) are ignored.
+static std::filesystem::file_time_type newestWriteTime(const std::vector<std::string>& filenames)
+{
+	std::filesystem::file_time_type newest = std::filesystem::file_time_type::min();
+
+	for (const std::string& filename : filenames) {
+
+		std::error_code error;
+		std::filesystem::file_time_type writeTime = std::filesystem::last_write_time(filename, error);
+
+		if (!error && writeTime > newest) {
+			newest = writeTime;
+		}
+	}
+
+	return newest;
+
+} // end newestWriteTime
+
+
+bool ShaderHotReload::start(GLFWwindow* renderWindow)
+{
+	if (!enabled || compileWindow != nullptr) {
+		return true;
+	}
+
+	// Create an invisible window whose context shares programs with the render
+	// window. The context version and profile hints set for the render window
+	// are still in effect.
+	glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+	compileWindow = glfwCreateWindow(1, 1, "Shader Compiler", NULL, renderWindow);
+	glfwWindowHint(GLFW_VISIBLE, GLFW_TRUE);
+
+	if (compileWindow == nullptr) {
+
+		std::cerr << "Unable to create the shader compile context. Shader hot reload is disabled." << std::endl;
+		return false;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(watchMutex);
+
+		// Programs built before now are considered up to date
+		for (WatchedProgram& watched : watchedPrograms) {
+
+			watched.builtWriteTime = newestWriteTime(watched.filenames);
+			watched.seenWriteTime = watched.builtWriteTime;
+		}
+
+		watching = true;
+	}
+
+	watchThread = std::thread(watchSourceFiles);
+
+	if (VERBOSE) cout << "Shader hot reload started" << endl;
+
+	return true;
+
+} // end start
+
+
+void ShaderHotReload::stop()
+{
+	if (compileWindow == nullptr) {
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(watchMutex);
+		watching = false;
+	}
+
+	watchCondition.notify_all();
+
+	if (watchThread.joinable()) {
+		watchThread.join();
+	}
+
+	// Programs that were rebuilt but never swapped in are no longer needed
+	for (RebuiltProgram& rebuilt : rebuiltPrograms) {
+
+		if (rebuilt.program != 0) {
+			glDeleteProgram(rebuilt.program);
+		}
+	}
+
+	rebuiltPrograms.clear();
+	watchedPrograms.clear();
+	swapCallbacks.clear();
+
+	glfwDestroyWindow(compileWindow);
+	compileWindow = nullptr;
+
+} // end stop
+
+
+void ShaderHotReload::watchProgram(GLuint shaderProgram, const ShaderInfo* shaders, const std::string& defines)
+{
+	WatchedProgram watched;
+	watched.program = shaderProgram;
+	watched.defines = defines;
+
+	for (const ShaderInfo* entry = shaders; entry->type != GL_NONE; ++entry) {
+
+		watched.types.push_back(entry->type);
+		watched.filenames.push_back(entry->filename);
+	}
+
+	watched.builtWriteTime = newestWriteTime(watched.filenames);
+	watched.seenWriteTime = watched.builtWriteTime;
+
+	std::lock_guard<std::mutex> lock(watchMutex);
+	watchedPrograms.push_back(watched);
+
+} // end watchProgram
+
+
+void ShaderHotReload::addSwapCallback(std::function<void(GLuint, GLuint)> callback)
+{
+	swapCallbacks.push_back(callback);
+
+} // end addSwapCallback
+
+
+void ShaderHotReload::watchSourceFiles()
+{
+	// All programs built on this thread are created in the hidden context
+	glfwMakeContextCurrent(compileWindow);
+
+	std::unique_lock<std::mutex> lock(watchMutex);
+
+	while (watching) {
+
+		watchCondition.wait_for(lock, std::chrono::milliseconds(SHADER_WATCH_INTERVAL_MS));
+
+		if (!watching) {
+			break;
+		}
+
+		// Find the programs with source files that changed before the previous
+		// check and have not changed since
+		std::vector<std::pair<size_t, WatchedProgram>> changedPrograms;
+
+		for (size_t i = 0; i < watchedPrograms.size(); i++) {
+
+			WatchedProgram& watched = watchedPrograms[i];
+			std::filesystem::file_time_type writeTime = newestWriteTime(watched.filenames);
+
+			if (writeTime != watched.builtWriteTime && writeTime == watched.seenWriteTime) {
+
+				watched.builtWriteTime = writeTime;
+				changedPrograms.push_back({ i, watched });
+			}
+
+			watched.seenWriteTime = writeTime;
+		}
+
+		if (changedPrograms.empty()) {
+			continue;
+		}
+
+		// Compile without holding the lock so that the main thread is not blocked
+		lock.unlock();
+
+		std::vector<RebuiltProgram> rebuilt;
+
+		for (auto& changed : changedPrograms) {
+
+			std::vector<ShaderInfo> shaders;
+
+			for (size_t i = 0; i < changed.second.types.size(); i++) {
+				shaders.push_back({ changed.second.types[i], changed.second.filenames[i].c_str(), 0 });
+			}
+
+			shaders.push_back({ GL_NONE, NULL, 0 });
+
+			RebuiltProgram result;
+			result.watchedIndex = changed.first;
+			result.program = TryBuildShaderProgram(shaders.data(), result.errorLog, changed.second.defines);
+
+			if (result.program != 0) {
+
+				// Make sure the program is completely built before it is used
+				// by the render context
+				GLsync fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+				while (glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000) == GL_TIMEOUT_EXPIRED);
+
+				glDeleteSync(fence);
+			}
+
+			rebuilt.push_back(result);
+		}
+
+		lock.lock();
+
+		rebuiltPrograms.insert(rebuiltPrograms.end(), rebuilt.begin(), rebuilt.end());
+	}
+
+	lock.unlock();
+
+	glfwMakeContextCurrent(NULL);
+
+} // end watchSourceFiles
+
+
+void ShaderHotReload::update()
+{
+	if (compileWindow == nullptr) {
+		return;
+	}
+
+	std::vector<RebuiltProgram> rebuilt;
+	std::vector<WatchedProgram> watched;
+
+	{
+		std::lock_guard<std::mutex> lock(watchMutex);
+
+		if (rebuiltPrograms.empty()) {
+			return;
+		}
+
+		rebuilt.swap(rebuiltPrograms);
+		watched = watchedPrograms;
+	}
+
+	for (RebuiltProgram& result : rebuilt) {
+
+		const WatchedProgram& source = watched[result.watchedIndex];
+
+		std::string names;
+		for (const std::string& filename : source.filenames) {
+			names += (names.empty() ? "" : ", ") + filename;
+		}
+
+		if (result.program == 0) {
+
+			std::cerr << "\nUnable to reload " << names << ":\n" << result.errorLog
+				<< "\nThe previous shader program is still in use.\n" << std::endl;
+			continue;
+		}
+
+		GLuint oldProgram = source.program;
+
+		// Connect the new program to the same shared uniform blocks as the old one
+		setSharedUniformBlocksLike(result.program, oldProgram);
+
+		// Switch everything that rendered with the old program to the new one
+		MeshComponent::replaceShaderProgram(oldProgram, result.program);
+
+		for (auto& callback : swapCallbacks) {
+			callback(oldProgram, result.program);
+		}
+
+		swapShaderProgram(oldProgram, result.program);
+
+		{
+			std::lock_guard<std::mutex> lock(watchMutex);
+			watchedPrograms[result.watchedIndex].program = result.program;
+		}
+
+		watched[result.watchedIndex].program = result.program;
+
+		if (VERBOSE) cout << "Reloaded " << names << endl;
+	}
+
+} // end update
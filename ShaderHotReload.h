@@ -0,0 +1,119 @@
+#pragma once
+
+#include <functional>
+
+#include "MathLibsConstsFuncs.h"
+#include "BuildShaderProgram.h"
+
+#include <GLFW/glfw3.h>
+
+using namespace constants_and_types;
+
+// Milliseconds between checks of the shader source files for changes
+static const int SHADER_WATCH_INTERVAL_MS = 250;
+
+/**
+ * @class	ShaderHotReload
+ *
+ * @brief	Rebuilds shader programs while the game is running when one of their
+ * 			source files is saved.
+ *
+ * 			BuildShaderProgram registers every program it creates. A background
+ * 			thread checks the modification times of the source files and, once a
+ * 			changed file has stopped changing, compiles and links the program again
+ * 			on a hidden context that shares objects with the render window. Each
+ * 			frame update swaps successfully rebuilt programs into every
+ * 			MeshComponent that used the old program and reconnects the shared
+ * 			uniform blocks. If the new sources do not compile or link, the errors
+ * 			are printed and the old program keeps running.
+ *
+ * 			Changes to the layout of the shared uniform blocks require a restart,
+ * 			since the byte offsets of the block members are only found once.
+ */
+class ShaderHotReload
+{
+public:
+
+	/**
+	 * @fn	static void ShaderHotReload::setEnabled(bool enabled)
+	 *
+	 * @brief	Enables watching the source files. Enabled by default in debug builds
+	 * 			only. Must be set before the game is run, since the watcher is
+	 * 			started when the graphics are initialized.
+	 */
+	static void setEnabled(bool enabled) { ShaderHotReload::enabled = enabled; }
+	static bool isEnabled() { return enabled; }
+
+	/**
+	 * @fn	static bool ShaderHotReload::start(GLFWwindow* renderWindow);
+	 *
+	 * @brief	Creates the hidden context used for background compiles and starts
+	 * 			watching the source files of registered programs. Must be called on
+	 * 			the main thread after OpenGL has been initialized. Does nothing if
+	 * 			hot reload is not enabled.
+	 *
+	 * @param	renderWindow	Window whose context the programs are used in.
+	 *
+	 * @returns	True if it succeeds, false if the shared context could not be created.
+	 */
+	static bool start(GLFWwindow* renderWindow);
+
+	/**
+	 * @fn	static void ShaderHotReload::stop();
+	 *
+	 * @brief	Stops the background thread and destroys the hidden context. Must
+	 * 			be called before the render window is destroyed.
+	 */
+	static void stop();
+
+	/**
+	 * @fn	static void ShaderHotReload::watchProgram(GLuint shaderProgram, const ShaderInfo* shaders, const std::string& defines);
+	 *
+	 * @brief	Registers the source files of a shader program so that the program
+	 * 			is rebuilt when they change. Called by BuildShaderProgram.
+	 *
+	 * @param	shaderProgram	The shader program.
+	 * @param	shaders		 	The array of shaders the program was built from.
+	 * @param	defines		 	Preprocessor definitions the program was built with.
+	 */
+	static void watchProgram(GLuint shaderProgram, const ShaderInfo* shaders, const std::string& defines);
+
+	/**
+	 * @fn	static void ShaderHotReload::addSwapCallback(std::function<void(GLuint, GLuint)> callback);
+	 *
+	 * @brief	Registers a function that is called with the old and the new program
+	 * 			whenever a program is swapped. Used by classes other than
+	 * 			MeshComponent that hold on to shader programs.
+	 *
+	 * @param	callback	The function to call.
+	 */
+	static void addSwapCallback(std::function<void(GLuint, GLuint)> callback);
+
+	/**
+	 * @fn	static void ShaderHotReload::update();
+	 *
+	 * @brief	Swaps in the programs that have been rebuilt since the last call and
+	 * 			reports programs that failed to build. Should be called once per frame
+	 * 			on the main thread before the scene is rendered.
+	 */
+	static void update();
+
+protected:
+
+	/**
+	 * @fn	static void ShaderHotReload::watchSourceFiles();
+	 *
+	 * @brief	Body of the background thread.
+	 */
+	static void watchSourceFiles();
+
+	/** @brief	True if the source files are watched */
+	static bool enabled;
+
+	/** @brief	Hidden window that owns the background context */
+	static GLFWwindow* compileWindow;
+
+	/** @brief	Functions called when a program is swapped */
+	static std::vector<std::function<void(GLuint, GLuint)>> swapCallbacks;
+
+}; // end ShaderHotReload
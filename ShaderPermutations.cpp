@@ -0,0 +1,102 @@
+#include "ShaderPermutations.h"
+
+#include "BuildShaderProgram.h"
+#include "ShaderHotReload.h"
+
+static const bool VERBOSE = false;
+
+// Static variable definition (Static variables must be defined outside the declaration)
+std::map<std::pair<GLuint, unsigned int>, GLuint> ShaderPermutations::variants;
+
+
+GLuint ShaderPermutations::getVariant(GLuint shaderProgram, unsigned int featureBits)
+{
+	auto variant = variants.find({ shaderProgram, featureBits });
+
+	if (variant != variants.end()) {
+		return variant->second;
+	}
+
+	// Follow programs that are rebuilt while the game is running
+	if (variants.empty()) {
+		ShaderHotReload::addSwapCallback(replaceProgram);
+	}
+
+	std::vector<GLenum> types;
+	std::vector<std::string> filenames;
+
+	if (!getShaderProgramFiles(shaderProgram, types, filenames)) {
+
+		// Not built by BuildShaderProgram so there are no sources to specialize
+		variants[{ shaderProgram, featureBits }] = shaderProgram;
+		return shaderProgram;
+	}
+
+	std::vector<ShaderInfo> shaders;
+
+	for (size_t i = 0; i < types.size(); i++) {
+		shaders.push_back({ types[i], filenames[i].c_str(), 0 });
+	}
+
+	shaders.push_back({ GL_NONE, NULL, 0 });
+
+	GLuint program = BuildShaderProgram(shaders.data(), getDefines(featureBits));
+
+	if (program == 0) {
+
+		program = shaderProgram;
+	}
+	else {
+
+		setSharedUniformBlocksLike(program, shaderProgram);
+	}
+
+	if (VERBOSE) cout << "Built variant " << featureBits << " of shader program " << shaderProgram << endl;
+
+	variants[{ shaderProgram, featureBits }] = program;
+
+	return program;
+
+} // end getVariant
+
+
+void ShaderPermutations::precompileVariants(GLuint shaderProgram)
+{
+	for (unsigned int featureBits = 0; featureBits <= ALL_MATERIAL_FEATURES; featureBits++) {
+
+		getVariant(shaderProgram, featureBits);
+	}
+
+} // end precompileVariants
+
+
+std::string ShaderPermutations::getDefines(unsigned int featureBits)
+{
+	std::string defines = "#define MATERIAL_PERMUTATION\n";
+
+	defines += std::string("#define DIFFUSE_TEXTURE ") + ((featureBits & DIFFUSE_TEXTURE_FEATURE) ? "1\n" : "0\n");
+	defines += std::string("#define SPECULAR_TEXTURE ") + ((featureBits & SPECULAR_TEXTURE_FEATURE) ? "1\n" : "0\n");
+	defines += std::string("#define NORMAL_MAP ") + ((featureBits & NORMAL_MAP_FEATURE) ? "1\n" : "0\n");
+	defines += std::string("#define VIRTUAL_TEXTURE ") + ((featureBits & VIRTUAL_TEXTURE_FEATURE) ? "1\n" : "0\n");
+	defines += std::string("#define GPU_DRIVEN ") + ((featureBits & GPU_DRIVEN_VARIANT) ? "1\n" : "0\n");
+
+	return defines;
+
+} // end getDefines
+
+
+void ShaderPermutations::replaceProgram(GLuint oldProgram, GLuint newProgram)
+{
+	std::map<std::pair<GLuint, unsigned int>, GLuint> updated;
+
+	for (auto& variant : variants) {
+
+		GLuint program = variant.first.first == oldProgram ? newProgram : variant.first.first;
+		GLuint specialized = variant.second == oldProgram ? newProgram : variant.second;
+
+		updated[{ program, variant.first.second }] = specialized;
+	}
+
+	variants.swap(updated);
+
+} // end replaceProgram
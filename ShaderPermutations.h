@@ -0,0 +1,86 @@
+#pragma once
+
+#include <map>
+
+#include "MathLibsConstsFuncs.h"
+#include "Material.h"
+
+using namespace constants_and_types;
+
+// Bit added to the MATERIAL_FEATURE bits to get a variant for GPUDrivenRenderer.
+// The variant reads the modeling transformation and material of each draw from
+// shader storage buffers (GPU_DRIVEN) instead of the uniform blocks.
+static const unsigned int GPU_DRIVEN_VARIANT = 16;
+
+/**
+ * @class	ShaderPermutations
+ *
+ * @brief	Builds variants of a shader program that are specialized for the
+ * 			features a material uses.
+ *
+ * 			A variant is built from the same source files as the program created by
+ * 			BuildShaderProgram with MATERIAL_PERMUTATION and one define per
+ * 			MATERIAL_FEATURE (DIFFUSE_TEXTURE, SPECULAR_TEXTURE, NORMAL_MAP and
+ * 			VIRTUAL_TEXTURE) set to 0 or 1, and GPU_DRIVEN set to 1 for
+ * 			GPU_DRIVEN_VARIANT. The shaders use #if to compile out the work of
+ * 			features that are not used. Shaders built without the defines keep
+ * 			every feature and select them at run time.
+ *
+ * 			Variants are built the first time they are requested and go through the
+ * 			program binary cache like any other program, so only the first run pays
+ * 			for compiling them. precompileVariants can be used to build them while a
+ * 			scene is loading instead.
+ */
+class ShaderPermutations
+{
+public:
+
+	/**
+	 * @fn	static GLuint ShaderPermutations::getVariant(GLuint shaderProgram, unsigned int featureBits);
+	 *
+	 * @brief	Gets the variant of a program for a combination of material features,
+	 * 			building it if necessary. The variant is set up for the same shared
+	 * 			uniform blocks as the program.
+	 *
+	 * @param	shaderProgram	A program created by BuildShaderProgram.
+	 * @param	featureBits  	The MATERIAL_FEATURE bits of the material.
+	 *
+	 * @returns	The variant, or shaderProgram if a variant could not be built.
+	 */
+	static GLuint getVariant(GLuint shaderProgram, unsigned int featureBits);
+
+	/**
+	 * @fn	static void ShaderPermutations::precompileVariants(GLuint shaderProgram);
+	 *
+	 * @brief	Builds the variants of a program for every combination of material
+	 * 			features so that none are built while the game is running.
+	 *
+	 * @param	shaderProgram	A program created by BuildShaderProgram.
+	 */
+	static void precompileVariants(GLuint shaderProgram);
+
+	/**
+	 * @fn	static std::string ShaderPermutations::getDefines(unsigned int featureBits);
+	 *
+	 * @brief	Gets the preprocessor definitions of a combination of material features.
+	 *
+	 * @param	featureBits	The MATERIAL_FEATURE bits.
+	 *
+	 * @returns	The definitions, one per line.
+	 */
+	static std::string getDefines(unsigned int featureBits);
+
+protected:
+
+	/**
+	 * @fn	static void ShaderPermutations::replaceProgram(GLuint oldProgram, GLuint newProgram);
+	 *
+	 * @brief	Updates the variants when a program or variant is rebuilt after a
+	 * 			source change.
+	 */
+	static void replaceProgram(GLuint oldProgram, GLuint newProgram);
+
+	/** @brief	Variants indexed by the program they specialize and the feature bits */
+	static std::map<std::pair<GLuint, unsigned int>, GLuint> variants;
+
+}; // end ShaderPermutations
@@ -0,0 +1,128 @@
+// Targeting version 4.6 of GLSL. If the compiler does not support 4.5 it will cause an error.
+#version 460 core
+
+// Bins the clustered lights into the cluster grid. One invocation per cluster.
+// Each work group covers one depth slice of CLUSTER_GRID_X x CLUSTER_GRID_Y
+// screen tiles. Must match the constants in ClusteredLighting.h.
+const uint CLUSTER_GRID_X = 16;
+const uint CLUSTER_GRID_Y = 9;
+const uint MAX_LIGHTS_PER_CLUSTER = 128;
+const uint GROUP_SIZE = CLUSTER_GRID_X * CLUSTER_GRID_Y;
+
+layout(local_size_x = 16, local_size_y = 9, local_size_z = 1) in;
+
+struct ClusteredLight
+{
+	vec4 positionRange;				// world position (xyz) and range (w)
+	vec4 ambientColor;
+	vec4 diffuseColorSpotCutoff;	// diffuse color (rgb) and cosine of the spot cutoff (w)
+	vec4 specularColorSpotExponent;	// specular color (rgb) and spot exponent (w)
+	vec4 spotDirectionIsSpot;		// spot direction (xyz) and 1 if a spot light (w)
+	vec4 attenuationEnabled;		// constant, linear, quadratic (xyz) and 1 if on (w)
+};
+
+layout(std430, binding = 5) readonly buffer ClusteredLightBlock
+{
+	ClusteredLight clusteredLights[];
+};
+
+layout(std430, binding = 6) buffer ClusterGridBlock
+{
+	uvec4 clusterGridSize;
+	vec4 clusterDepthParameters;	// near, far, scale and bias of the depth slices
+	vec4 clusterTileSize;			// tile size (xy) and viewport size (zw) in pixels
+	vec4 clusterViewportOrigin;		// lower left corner of the viewport (xy) in pixels
+	uvec2 clusters[];				// offset and count of the light indices of each cluster
+};
+
+layout(std430, binding = 7) writeonly buffer ClusterLightIndexBlock
+{
+	uint clusterLightIndices[];
+};
+
+layout(location = 0) uniform mat4 viewMatrix;
+layout(location = 1) uniform mat4 inverseProjection;
+layout(location = 2) uniform uint lightCount;
+
+// View space centers (xyz) and ranges (w) of the lights in the current batch.
+// Disabled lights have a negative range.
+shared vec4 sharedLights[GROUP_SIZE];
+
+void main()
+{
+	uvec3 clusterID = gl_GlobalInvocationID;
+	uint cluster = clusterID.x + CLUSTER_GRID_X * (clusterID.y + CLUSTER_GRID_Y * clusterID.z);
+
+	// Exponentially spaced depth slices
+	float nearPlane = clusterDepthParameters.x;
+	float farPlane = clusterDepthParameters.y;
+	float sliceNear = nearPlane * pow(farPlane / nearPlane, float(clusterID.z) / float(clusterGridSize.z));
+	float sliceFar = nearPlane * pow(farPlane / nearPlane, float(clusterID.z + 1) / float(clusterGridSize.z));
+
+	// Normalized device coordinates of the tile corners
+	vec2 tileMin = vec2(clusterID.xy) * clusterTileSize.xy / clusterTileSize.zw * 2.0 - 1.0;
+	vec2 tileMax = vec2(clusterID.xy + 1) * clusterTileSize.xy / clusterTileSize.zw * 2.0 - 1.0;
+
+	vec3 boundsMin = vec3(1.0e30);
+	vec3 boundsMax = vec3(-1.0e30);
+
+	for (int corner = 0; corner < 4; corner++) {
+
+		vec2 ndc = vec2((corner & 1) != 0 ? tileMax.x : tileMin.x, (corner & 2) != 0 ? tileMax.y : tileMin.y);
+
+		// Point on the near plane in view space
+		vec4 point = inverseProjection * vec4(ndc, -1.0, 1.0);
+		vec3 onNearPlane = point.xyz / point.w;
+
+		// Extend the ray from the eye through the point to both slice depths
+		vec3 atNear = onNearPlane * (sliceNear / -onNearPlane.z);
+		vec3 atFar = onNearPlane * (sliceFar / -onNearPlane.z);
+
+		boundsMin = min(boundsMin, min(atNear, atFar));
+		boundsMax = max(boundsMax, max(atNear, atFar));
+	}
+
+	uint offset = cluster * MAX_LIGHTS_PER_CLUSTER;
+	uint count = 0;
+
+	// Load the lights in batches that are shared by the whole work group
+	for (uint batch = 0; batch < lightCount; batch += GROUP_SIZE) {
+
+		uint lightIndex = batch + gl_LocalInvocationIndex;
+		vec4 sphere = vec4(0.0, 0.0, 0.0, -1.0);
+
+		if (lightIndex < lightCount && clusteredLights[lightIndex].attenuationEnabled.w != 0.0) {
+
+			vec3 center = (viewMatrix * vec4(clusteredLights[lightIndex].positionRange.xyz, 1.0)).xyz;
+			sphere = vec4(center, clusteredLights[lightIndex].positionRange.w);
+		}
+
+		sharedLights[gl_LocalInvocationIndex] = sphere;
+
+		barrier();
+
+		uint batchCount = min(GROUP_SIZE, lightCount - batch);
+
+		for (uint i = 0; i < batchCount; i++) {
+
+			vec4 light = sharedLights[i];
+
+			if (light.w < 0.0) {
+				continue;
+			}
+
+			// Squared distance from the sphere center to the cluster bounds
+			vec3 offsetToBounds = clamp(light.xyz, boundsMin, boundsMax) - light.xyz;
+
+			if (dot(offsetToBounds, offsetToBounds) <= light.w * light.w && count < MAX_LIGHTS_PER_CLUSTER) {
+
+				clusterLightIndices[offset + count] = batch + i;
+				count++;
+			}
+		}
+
+		barrier();
+	}
+
+	clusters[cluster] = uvec2(offset, count);
+}
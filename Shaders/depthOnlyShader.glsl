@@ -0,0 +1,13 @@
+// Targeting version 4.6 of GLSL. If the compiler does not support 4.5 it will cause an error.
+#version 460 core
+
+// Vertex shader for passes that only write depth (e.g. shadow maps). Only the
+// position only vertex stream of a sub-mesh is bound. There is no fragment shader.
+layout(location = 0) uniform mat4 modelViewProjection;
+
+layout (location = 0) in vec4 vertexPosition;
+
+void main()
+{
+	gl_Position = modelViewProjection * vertexPosition;
+}
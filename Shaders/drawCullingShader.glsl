@@ -0,0 +1,163 @@
+// Targeting version 4.6 of GLSL. If the compiler does not support 4.5 it will cause an error.
+#version 460 core
+
+// Culls the objects drawn by GPUDrivenRenderer and writes an indirect draw
+// command for each one that may be visible. One invocation per object. The
+// commands of each bucket are written to its own range of the command buffer
+// and counted so that the bucket can be drawn by one multi-draw call. Must
+// match the binding points, uniform locations and layouts in GPUDrivenRenderer.h.
+layout(local_size_x = 64, local_size_y = 1, local_size_z = 1) in;
+
+struct DrawObject
+{
+	mat4 modelMatrix;
+	vec4 boundsCenterRadius;	// world space bounding sphere
+	uvec4 drawCommand;			// index count, first index and base vertex
+	uvec4 bucket;				// bucket, first command of the bucket and occluded flag
+	vec4 ambientColor;
+	vec4 diffuseColorAlpha;
+	vec4 specularColorExponent;
+	vec4 emissiveColor;
+	ivec4 textureParameters;	// texture mode, enabled textures and virtual texture identifier
+};
+
+// Layout of DrawElementsIndirectCommand
+struct DrawCommand
+{
+	uint count;
+	uint instanceCount;
+	uint firstIndex;
+	int baseVertex;
+	uint baseInstance;
+};
+
+layout(std430, binding = 11) readonly buffer DrawObjectBlock
+{
+	DrawObject drawObjects[];
+};
+
+layout(std430, binding = 12) writeonly buffer DrawCommandBlock
+{
+	DrawCommand drawCommands[];
+};
+
+layout(std430, binding = 13) buffer DrawCountBlock
+{
+	uint drawCounts[];
+};
+
+// Hi-Z pyramid built by OcclusionCulling at the end of the last frame
+layout(binding = 7) uniform sampler2D hiZ;
+
+layout(location = 0) uniform mat4 viewProjection;
+layout(location = 1) uniform mat4 hiZViewProjection;
+layout(location = 2) uniform uint objectCount;
+layout(location = 3) uniform bool hiZEnabled;
+layout(location = 4) uniform bool skipOccluded;
+
+// Tests a sphere against the six planes of the view volume. The planes are
+// sums and differences of the rows of the matrix.
+bool insideViewVolume(vec3 center, float radius)
+{
+	for (int row = 0; row < 3; row++) {
+		for (int side = -1; side <= 1; side += 2) {
+
+			vec4 plane = vec4(viewProjection[0][3] + side * viewProjection[0][row],
+							  viewProjection[1][3] + side * viewProjection[1][row],
+							  viewProjection[2][3] + side * viewProjection[2][row],
+							  viewProjection[3][3] + side * viewProjection[3][row]);
+
+			if (dot(plane.xyz, center) + plane.w < -radius * length(plane.xyz)) {
+				return false;
+			}
+		}
+	}
+
+	return true;
+}
+
+// Tests the box around a sphere against the Hi-Z pyramid. Same test as the
+// occlusion culling shader.
+bool hiddenByHiZ(vec3 center, float radius)
+{
+	vec3 rectMin = vec3(1.0e30);
+	vec3 rectMax = vec3(-1.0e30);
+
+	for (int corner = 0; corner < 8; corner++) {
+
+		vec3 offset = vec3((corner & 1) != 0 ? radius : -radius,
+						   (corner & 2) != 0 ? radius : -radius,
+						   (corner & 4) != 0 ? radius : -radius);
+
+		vec4 clip = hiZViewProjection * vec4(center + offset, 1.0);
+
+		// Boxes that reach behind the eye are never hidden
+		if (clip.w < 1.0e-4) {
+			return false;
+		}
+
+		vec3 ndc = clip.xyz / clip.w;
+		rectMin = min(rectMin, ndc);
+		rectMax = max(rectMax, ndc);
+	}
+
+	// Outside the view of the pyramid, so nothing is known about it
+	if (any(lessThan(rectMax.xy, vec2(-1.0))) || any(greaterThan(rectMin.xy, vec2(1.0)))) {
+		return false;
+	}
+
+	vec2 uvMin = clamp(rectMin.xy * 0.5 + 0.5, 0.0, 1.0);
+	vec2 uvMax = clamp(rectMax.xy * 0.5 + 0.5, 0.0, 1.0);
+	float nearestDepth = rectMin.z * 0.5 + 0.5;
+
+	// Pick the level where the rectangle spans at most 2x2 texels
+	vec2 extent = (uvMax - uvMin) * vec2(textureSize(hiZ, 0));
+	int level = clamp(int(ceil(log2(max(max(extent.x, extent.y), 1.0)))), 0, textureQueryLevels(hiZ) - 1);
+
+	ivec2 levelSize = textureSize(hiZ, level);
+	ivec2 texelMin = clamp(ivec2(uvMin * vec2(levelSize)), ivec2(0), levelSize - 1);
+	ivec2 texelMax = clamp(ivec2(uvMax * vec2(levelSize)), ivec2(0), levelSize - 1);
+
+	float farthestDepth = 0.0;
+
+	for (int y = texelMin.y; y <= texelMax.y; y++) {
+		for (int x = texelMin.x; x <= texelMax.x; x++) {
+
+			farthestDepth = max(farthestDepth, texelFetch(hiZ, ivec2(x, y), level).r);
+		}
+	}
+
+	return nearestDepth > farthestDepth;
+}
+
+void main()
+{
+	uint objectIndex = gl_GlobalInvocationID.x;
+
+	if (objectIndex >= objectCount) {
+		return;
+	}
+
+	DrawObject drawObject = drawObjects[objectIndex];
+
+	vec3 center = drawObject.boundsCenterRadius.xyz;
+	float radius = drawObject.boundsCenterRadius.w;
+
+	// Meshes found hidden on the CPU are only skipped for the occlusion culled camera
+	if (skipOccluded && drawObject.bucket.z != 0) {
+		return;
+	}
+
+	if (!insideViewVolume(center, radius) || (hiZEnabled && hiddenByHiZ(center, radius))) {
+		return;
+	}
+
+	uint bucket = drawObject.bucket.x;
+	uint command = drawObject.bucket.y + atomicAdd(drawCounts[bucket], 1);
+
+	drawCommands[command].count = drawObject.drawCommand.x;
+	drawCommands[command].instanceCount = 1;
+	drawCommands[command].firstIndex = drawObject.drawCommand.y;
+	drawCommands[command].baseVertex = int(drawObject.drawCommand.z);
+	drawCommands[command].baseInstance = objectIndex;
+}
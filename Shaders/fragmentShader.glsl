@@ -1,10 +1,24 @@
 // Targeting version 4.6 of GLSL. If the compiler does not support 4.5 it will cause an error.
 #version 460 core
 
+// Variants built by ShaderPermutations define MATERIAL_PERMUTATION and set each
+// material feature to 0 or 1 so that the work of unused features is compiled
+// out. Without a permutation every feature is compiled in and selected at run time.
+#ifndef MATERIAL_PERMUTATION
+#define DIFFUSE_TEXTURE 1
+#define SPECULAR_TEXTURE 1
+#define NORMAL_MAP 1
+#define VIRTUAL_TEXTURE 1
+#define GPU_DRIVEN 0
+#endif
+
 in vec3 worldPos;
 in vec3 worldNorm;
 in vec2 texCoord0;
+
+#if NORMAL_MAP
 in mat3 TBN;
+#endif
 out vec4 fragmentColor;
 
 const float gamma = 2.2;
@@ -49,6 +63,62 @@ layout(shared) uniform worldEyeBlock
 	vec3 worldEyePosition;
 };
 
+layout(shared) uniform transformBlock
+{
+	mat4 modelMatrix;
+	mat4 viewMatrix;
+	mat4 projectionMatrix;
+	mat4 normalModelMatrix;
+};
+
+// Point and spot lights that are binned into clusters by ClusteredLighting.
+// Must match the constants and layouts in ClusteredLighting.h.
+const uint MAX_LIGHTS_PER_CLUSTER = 128;
+
+struct ClusteredLight
+{
+	vec4 positionRange;				// world position (xyz) and range (w)
+	vec4 ambientColor;
+	vec4 diffuseColorSpotCutoff;	// diffuse color (rgb) and cosine of the spot cutoff (w)
+	vec4 specularColorSpotExponent;	// specular color (rgb) and spot exponent (w)
+	vec4 spotDirectionIsSpot;		// spot direction (xyz) and 1 if a spot light (w)
+	vec4 attenuationEnabled;		// constant, linear, quadratic (xyz) and 1 if on (w)
+};
+
+layout(std430, binding = 5) readonly buffer ClusteredLightBlock
+{
+	ClusteredLight clusteredLights[];
+};
+
+layout(std430, binding = 6) readonly buffer ClusterGridBlock
+{
+	uvec4 clusterGridSize;
+	vec4 clusterDepthParameters;	// near, far, scale and bias of the depth slices
+	vec4 clusterTileSize;			// tile size (xy) and viewport size (zw) in pixels
+	vec4 clusterViewportOrigin;		// lower left corner of the viewport (xy) in pixels
+	uvec2 clusters[];				// offset and count of the light indices of each cluster
+};
+
+layout(std430, binding = 7) readonly buffer ClusterLightIndexBlock
+{
+	uint clusterLightIndices[];
+};
+
+// Shadow maps rendered by ShadowMapping. Every shadow map is a tile of one
+// depth atlas. Must match the constants and layout in ShadowMapping.h.
+const int MAX_SHADOW_VIEWS = 32;
+
+layout(std430, binding = 8) readonly buffer ShadowBlock
+{
+	mat4 shadowViewProjections[MAX_SHADOW_VIEWS];
+	vec4 shadowTileRects[MAX_SHADOW_VIEWS];	// lower left corner (xy) and size (zw) of each tile
+	ivec4 lightShadows[MaxLights];			// first shadow map, count and type (0 directional, 1 spot, 2 positional)
+	vec4 cascadeSplits;						// view space depth at the far end of each cascade
+	vec4 shadowParameters;					// size of an atlas texel (x) and the normal offset (y)
+};
+
+layout(binding = 5) uniform sampler2DShadow shadowAtlas;
+
 
 struct Material
 {
@@ -62,12 +132,41 @@ struct Material
 	bool diffuseTextureEnabled;
 	bool specularTextureEnabled;
 	bool normalMapTextureEnabled;
+	bool virtualTextureEnabled;
+	int virtualTextureID;
+};
+
+#if GPU_DRIVEN
+// Objects drawn by GPUDrivenRenderer. Each reads its material from here rather
+// than from the material block. Must match the layout in GPUDrivenRenderer.h.
+struct DrawObject
+{
+	mat4 modelMatrix;
+	vec4 boundsCenterRadius;	// world space bounding sphere
+	uvec4 drawCommand;			// index count, first index and base vertex
+	uvec4 bucket;				// bucket, first command of the bucket and occluded flag
+	vec4 ambientColor;
+	vec4 diffuseColorAlpha;
+	vec4 specularColorExponent;
+	vec4 emissiveColor;
+	ivec4 textureParameters;	// texture mode, enabled textures and virtual texture identifier
+};
+
+layout(std430, binding = 11) readonly buffer DrawObjectBlock
+{
+	DrawObject drawObjects[];
 };
 
+flat in uint drawObjectIndex;
+
+// Filled in from the draw object at the start of main
+Material object;
+#else
 layout(shared) uniform MaterialBlock
 {
 	Material object;
 };
+#endif
 
 //layout(shared) uniform FogBlock
 //{
@@ -82,8 +181,166 @@ layout(binding = 0) uniform sampler2D diffuseSampler;
 layout(binding = 1) uniform sampler2D specularSampler;
 layout(binding = 2) uniform sampler2D normalMapSampler;
 
+#if VIRTUAL_TEXTURE
+// Virtual texturing. The page table gives the location of each page in the
+// page cache (xy) and the mip level of the page that is resident (z).
+layout(binding = 3) uniform usampler2D pageTableSampler;
+layout(binding = 4) uniform sampler2D pageCacheSampler;
+
+const float VT_PAGE_SIZE = 128.0;
+const float VT_PAGE_BORDER = 4.0;
+
+vec4 sampleVirtualTexture(vec2 uv)
+{
+	// Select the mip level from the screen space derivatives in virtual texels.
+	// Must match the level requested by the feedback shader.
+	vec2 virtualSize = vec2(textureSize(pageTableSampler, 0)) * VT_PAGE_SIZE;
+	vec2 dx = dFdx(uv * virtualSize);
+	vec2 dy = dFdy(uv * virtualSize);
+	float mip = 0.5 * log2(max(max(dot(dx, dx), dot(dy, dy)), 1e-8));
+	int level = clamp(int(floor(mip)), 0, textureQueryLevels(pageTableSampler) - 1);
+
+	uv = fract(uv);
+
+	uvec4 entry = texelFetch(pageTableSampler, ivec2(uv * vec2(textureSize(pageTableSampler, level))), level);
+
+	// Position within the page that is resident, which may be coarser than requested
+	vec2 residentPages = vec2(textureSize(pageTableSampler, int(entry.z)));
+	vec2 pagePosition = fract(uv * residentPages);
+
+	vec2 cacheTexel = vec2(entry.xy) * (VT_PAGE_SIZE + 2.0 * VT_PAGE_BORDER) + VT_PAGE_BORDER + pagePosition * VT_PAGE_SIZE;
+
+	return textureLod(pageCacheSampler, cacheTexel / vec2(textureSize(pageCacheSampler, 0)), 0.0);
+}
+#endif
+
+// Ambient, diffuse and Blinn-Phong specular contribution of one light. L is
+// the normalized direction from the fragment to the light. Shadow scales the
+// diffuse and specular contributions.
+vec3 shadeLight(vec3 lightAmbient, vec3 lightDiffuse, vec3 lightSpecular, vec3 L, vec3 N, vec3 V,
+				vec3 ambientMatColor, vec3 diffuseMatColor, vec3 specularMatColor, float shadow)
+{
+	vec3 color = lightAmbient * ambientMatColor;
+
+	float diffuseFactor = max(dot(N, L), 0.0);
+
+	if (diffuseFactor > 0.0 && shadow > 0.0) {
+
+		color += shadow * diffuseFactor * lightDiffuse * diffuseMatColor;
+
+		vec3 H = normalize(L + V);
+		color += shadow * pow(max(dot(N, H), 0.0), object.specularExp) * lightSpecular * specularMatColor;
+	}
+
+	return color;
+}
+
+// Fraction of the light that reaches a position according to one shadow map.
+// Filters a 3x3 block of depth comparisons that stays inside the tile.
+float sampleShadowMap(int view, vec3 position)
+{
+	vec4 shadowCoord = shadowViewProjections[view] * vec4(position, 1.0);
+	vec3 ndc = shadowCoord.xyz / shadowCoord.w;
+
+	// Outside the shadow map
+	if (any(greaterThan(abs(ndc), vec3(1.0)))) {
+		return 1.0;
+	}
+
+	vec3 coord = ndc * 0.5 + 0.5;
+	vec4 rect = shadowTileRects[view];
+	float texel = shadowParameters.x;
+
+	vec2 tileMin = rect.xy + 0.5 * texel;
+	vec2 tileMax = rect.xy + rect.zw - 0.5 * texel;
+
+	float lit = 0.0;
+
+	for (int x = -1; x <= 1; x++) {
+		for (int y = -1; y <= 1; y++) {
+
+			vec2 uv = clamp(rect.xy + coord.xy * rect.zw + vec2(x, y) * texel, tileMin, tileMax);
+			lit += texture(shadowAtlas, vec3(uv, coord.z));
+		}
+	}
+
+	return lit / 9.0;
+}
+
+// Fraction of a light in the light block that reaches the fragment
+float lightShadowFactor(int lightIndex, vec3 N, float viewDepth)
+{
+	ivec4 shadowInfo = lightShadows[lightIndex];
+
+	if (shadowInfo.y == 0) {
+		return 1.0;
+	}
+
+	int view = shadowInfo.x;
+
+	if (shadowInfo.z == 0) {
+
+		// Cascade that covers the depth of the fragment
+		if (viewDepth > cascadeSplits[shadowInfo.y - 1]) {
+			return 1.0;
+		}
+
+		int cascade = 0;
+
+		while (cascade < shadowInfo.y - 1 && viewDepth > cascadeSplits[cascade]) {
+			cascade++;
+		}
+
+		view += cascade;
+	}
+	else if (shadowInfo.z == 2) {
+
+		// Cube face in the order +X, -X, +Y, -Y, +Z, -Z
+		vec3 fromLight = worldPos - lights[lightIndex].positionOrDirection.xyz;
+		vec3 magnitude = abs(fromLight);
+
+		if (magnitude.x >= magnitude.y && magnitude.x >= magnitude.z) {
+			view += fromLight.x > 0.0 ? 0 : 1;
+		}
+		else if (magnitude.y >= magnitude.z) {
+			view += fromLight.y > 0.0 ? 2 : 3;
+		}
+		else {
+			view += fromLight.z > 0.0 ? 4 : 5;
+		}
+	}
+
+	// Move the position off the surface to keep it from shadowing itself
+	return sampleShadowMap(view, worldPos + N * shadowParameters.y);
+}
+
+// Falloff of a spot light for a fragment in direction -L from the light
+float spotFactor(vec3 L, vec3 spotDirection, float spotCutoffCos, float spotExponent)
+{
+	float spotCos = dot(-L, normalize(spotDirection));
+
+	return spotCos < spotCutoffCos ? 0.0 : pow(spotCos, spotExponent);
+}
+
 void main()
 {
+#if GPU_DRIVEN
+	DrawObject drawObject = drawObjects[drawObjectIndex];
+
+	object.ambientMatColor = drawObject.ambientColor.rgb;
+	object.diffuseMatColor = drawObject.diffuseColorAlpha.rgb;
+	object.specularMatColor = drawObject.specularColorExponent.rgb;
+	object.emmissiveMatColor = drawObject.emissiveColor.rgb;
+	object.specularExp = drawObject.specularColorExponent.w;
+	object.alpha = drawObject.diffuseColorAlpha.a;
+	object.textureMode = drawObject.textureParameters.x;
+	object.diffuseTextureEnabled = (drawObject.textureParameters.y & 1) != 0;
+	object.specularTextureEnabled = (drawObject.textureParameters.y & 2) != 0;
+	object.normalMapTextureEnabled = (drawObject.textureParameters.y & 4) != 0;
+	object.virtualTextureEnabled = (drawObject.textureParameters.y & 8) != 0;
+	object.virtualTextureID = drawObject.textureParameters.z;
+#endif
+
 	vec3 totalColor = object.emmissiveMatColor;
 
 	vec3 ambientColor = object.ambientMatColor;
@@ -96,13 +353,31 @@ void main()
 
 	vec3 fragWorldNormal = normalize(worldNorm);
 
+#if NORMAL_MAP
 	if (object.normalMapTextureEnabled) {
 
-		vec3 normal = texture(normalMapSampler, texCoord0).xyz;
-		normal = normalize(normal * 2.0f - 1.0f);
+		// Normal maps are stored in two channel (BC5) textures. Reconstruct z
+		// from x and y since tangent space normals always point out of the surface.
+		vec3 normal;
+		normal.xy = texture(normalMapSampler, texCoord0).rg * 2.0f - 1.0f;
+		normal.z = sqrt(max(1.0f - dot(normal.xy, normal.xy), 0.0f));
+		normal = normalize(normal);
 		fragWorldNormal = normalize(TBN * normal);
 	}
+#endif
 
+#if VIRTUAL_TEXTURE
+	if(object.textureMode != 0 && object.virtualTextureEnabled) {
+
+		vec4 virtualTextureColor = sampleVirtualTexture(texCoord0);
+
+		diffuseColor = virtualTextureColor.rgb;
+		alpha = min(alpha, virtualTextureColor.a);
+		ambientColor = diffuseColor;
+	}
+#endif
+
+#if DIFFUSE_TEXTURE
 	if(object.textureMode != 0 && object.diffuseTextureEnabled) {
 
 		vec4 diffuseTextureColor = texture( diffuseSampler, texCoord0 );
@@ -114,23 +389,91 @@ void main()
 		}
 		ambientColor = diffuseColor;
 	 }
+#endif
 
+#if SPECULAR_TEXTURE
 	 if(object.textureMode != 0 && object.specularTextureEnabled) {
 
 		specularColor = texture( specularSampler, texCoord0 ).rgb;
 	 }
+#endif
+
+	if(object.textureMode != 1) {
+
+		vec3 V = normalize(worldEyePosition - worldPos);
+
+		float viewDepth = -(viewMatrix * vec4(worldPos, 1.0)).z;
+
+		// Lights in the light block
+		for (int i = 0; i < MaxLights; i++) {
+
+			if (!lights[i].enabled) {
+				continue;
+			}
+
+			if (lights[i].positionOrDirection.w == 0.0) {
+
+				// Directional light
+				vec3 L = normalize(lights[i].positionOrDirection.xyz);
+
+				totalColor += shadeLight(lights[i].ambientColor, lights[i].diffuseColor, lights[i].specularColor,
+										 L, fragWorldNormal, V, ambientColor, diffuseColor, specularColor,
+										 lightShadowFactor(i, normalize(worldNorm), viewDepth));
+			}
+			else {
+
+				vec3 toLight = lights[i].positionOrDirection.xyz - worldPos;
+				float distance = length(toLight);
+				vec3 L = toLight / distance;
+
+				float attenuation = 1.0 / (lights[i].constant + lights[i].linear * distance + lights[i].quadratic * distance * distance);
+
+				if (lights[i].isSpot) {
+					attenuation *= spotFactor(L, lights[i].spotDirection, lights[i].spotCutoffCos, lights[i].spotExponent);
+				}
+
+				totalColor += attenuation * shadeLight(lights[i].ambientColor, lights[i].diffuseColor, lights[i].specularColor,
+													   L, fragWorldNormal, V, ambientColor, diffuseColor, specularColor,
+													   lightShadowFactor(i, normalize(worldNorm), viewDepth));
+			}
+		}
+
+		// Find the cluster that contains the fragment
+		float clusterDepth = max(viewDepth, clusterDepthParameters.x);
+		uint slice = uint(clamp(floor(log(clusterDepth) * clusterDepthParameters.z - clusterDepthParameters.w), 0.0, float(clusterGridSize.z - 1)));
+		uvec2 tile = min(uvec2(max(gl_FragCoord.xy - clusterViewportOrigin.xy, 0.0) / clusterTileSize.xy), clusterGridSize.xy - 1);
+		uvec2 lightList = clusters[tile.x + clusterGridSize.x * (tile.y + clusterGridSize.y * slice)];
+
+		// Clustered lights that can reach the cluster
+		for (uint i = 0; i < lightList.y; i++) {
+
+			ClusteredLight light = clusteredLights[clusterLightIndices[lightList.x + i]];
+
+			vec3 toLight = light.positionRange.xyz - worldPos;
+			float distance = length(toLight);
+
+			if (distance > light.positionRange.w) {
+				continue;
+			}
+
+			vec3 L = toLight / distance;
 
-//	 if(object.textureMode != 1) {
-//
-//		// Implement local illumination
-//		// TODO
-//
-//		fragmentColor = vec4(totalColor, alpha);
-//
-//	}
-//	else { // No lighting calculations applied
+			float attenuation = 1.0 / dot(light.attenuationEnabled.xyz, vec3(1.0, distance, distance * distance));
+
+			if (light.spotDirectionIsSpot.w != 0.0) {
+				attenuation *= spotFactor(L, light.spotDirectionIsSpot.xyz, light.diffuseColorSpotCutoff.w, light.specularColorSpotExponent.w);
+			}
+
+			totalColor += attenuation * shadeLight(light.ambientColor.rgb, light.diffuseColorSpotCutoff.rgb, light.specularColorSpotExponent.rgb,
+												   L, fragWorldNormal, V, ambientColor, diffuseColor, specularColor, 1.0);
+		}
+
+		fragmentColor = vec4(totalColor, alpha);
+
+	}
+	else { // No lighting calculations applied
 
 		fragmentColor = vec4(diffuseColor, alpha);
-//	}
+	}
 
 }
\ No newline at end of file
@@ -0,0 +1,53 @@
+// Targeting version 4.6 of GLSL. If the compiler does not support 4.5 it will cause an error.
+#version 460 core
+
+// Builds one level of the hierarchical depth (Hi-Z) pyramid. Level zero is
+// converted from the copy of the depth buffer. Every other level holds the
+// farthest depth of the texels it covers in the level below. Must match the
+// texture units and uniform locations in OcclusionCulling.
+layout(local_size_x = 8, local_size_y = 8, local_size_z = 1) in;
+
+layout(binding = 6) uniform sampler2D depthCopy;
+layout(binding = 7) uniform sampler2D hiZ;
+
+layout(r32f, binding = 0) uniform writeonly image2D hiZLevel;
+
+// Level that is read, or -1 to read the depth copy
+layout(location = 0) uniform int sourceLevel;
+
+void main()
+{
+	ivec2 texel = ivec2(gl_GlobalInvocationID.xy);
+	ivec2 levelSize = imageSize(hiZLevel);
+
+	if (any(greaterThanEqual(texel, levelSize))) {
+		return;
+	}
+
+	float depth = 0.0;
+
+	if (sourceLevel < 0) {
+
+		depth = texelFetch(depthCopy, texel, 0).r;
+	}
+	else {
+
+		ivec2 sourceSize = textureSize(hiZ, sourceLevel);
+
+		// The last texel of a row or column also covers the extra texel of an odd sized level
+		ivec2 extent = ivec2(2, 2);
+
+		if (texel.x == levelSize.x - 1 && (sourceSize.x & 1) != 0) extent.x = 3;
+		if (texel.y == levelSize.y - 1 && (sourceSize.y & 1) != 0) extent.y = 3;
+
+		for (int y = 0; y < extent.y; y++) {
+			for (int x = 0; x < extent.x; x++) {
+
+				ivec2 source = min(texel * 2 + ivec2(x, y), sourceSize - 1);
+				depth = max(depth, texelFetch(hiZ, source, sourceLevel).r);
+			}
+		}
+	}
+
+	imageStore(hiZLevel, texel, vec4(depth));
+}
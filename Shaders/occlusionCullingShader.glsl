@@ -0,0 +1,92 @@
+// Targeting version 4.6 of GLSL. If the compiler does not support 4.5 it will cause an error.
+#version 460 core
+
+// Tests the bounding box of each mesh against the Hi-Z pyramid. One invocation
+// per mesh. A mesh is occluded if the nearest depth of its box is farther than
+// the farthest depth under its screen rectangle. Must match the binding points
+// and uniform locations in OcclusionCulling.
+layout(local_size_x = 64, local_size_y = 1, local_size_z = 1) in;
+
+struct MeshBounds
+{
+	vec4 boundsMin;		// world space minimum corner (xyz)
+	vec4 boundsMax;		// world space maximum corner (xyz)
+};
+
+layout(std430, binding = 9) readonly buffer OcclusionBoundsBlock
+{
+	MeshBounds meshBounds[];
+};
+
+// 1 if the mesh may be visible and 0 if it is occluded
+layout(std430, binding = 10) writeonly buffer OcclusionResultsBlock
+{
+	uint meshVisible[];
+};
+
+layout(binding = 7) uniform sampler2D hiZ;
+
+layout(location = 0) uniform mat4 viewProjection;
+layout(location = 1) uniform uint meshCount;
+
+void main()
+{
+	uint meshIndex = gl_GlobalInvocationID.x;
+
+	if (meshIndex >= meshCount) {
+		return;
+	}
+
+	vec3 boundsMin = meshBounds[meshIndex].boundsMin.xyz;
+	vec3 boundsMax = meshBounds[meshIndex].boundsMax.xyz;
+
+	vec3 rectMin = vec3(1.0e30);
+	vec3 rectMax = vec3(-1.0e30);
+
+	for (int corner = 0; corner < 8; corner++) {
+
+		vec3 position = mix(boundsMin, boundsMax, vec3(corner & 1, (corner >> 1) & 1, (corner >> 2) & 1));
+		vec4 clip = viewProjection * vec4(position, 1.0);
+
+		// Boxes that reach behind the eye are always drawn
+		if (clip.w < 1.0e-4) {
+
+			meshVisible[meshIndex] = 1;
+			return;
+		}
+
+		vec3 ndc = clip.xyz / clip.w;
+		rectMin = min(rectMin, ndc);
+		rectMax = max(rectMax, ndc);
+	}
+
+	// Boxes outside the window are not drawn
+	if (any(lessThan(rectMax.xy, vec2(-1.0))) || any(greaterThan(rectMin.xy, vec2(1.0)))) {
+
+		meshVisible[meshIndex] = 0;
+		return;
+	}
+
+	vec2 uvMin = clamp(rectMin.xy * 0.5 + 0.5, 0.0, 1.0);
+	vec2 uvMax = clamp(rectMax.xy * 0.5 + 0.5, 0.0, 1.0);
+	float nearestDepth = rectMin.z * 0.5 + 0.5;
+
+	// Pick the level where the rectangle spans at most 2x2 texels
+	vec2 extent = (uvMax - uvMin) * vec2(textureSize(hiZ, 0));
+	int level = clamp(int(ceil(log2(max(max(extent.x, extent.y), 1.0)))), 0, textureQueryLevels(hiZ) - 1);
+
+	ivec2 levelSize = textureSize(hiZ, level);
+	ivec2 texelMin = clamp(ivec2(uvMin * vec2(levelSize)), ivec2(0), levelSize - 1);
+	ivec2 texelMax = clamp(ivec2(uvMax * vec2(levelSize)), ivec2(0), levelSize - 1);
+
+	float farthestDepth = 0.0;
+
+	for (int y = texelMin.y; y <= texelMax.y; y++) {
+		for (int x = texelMin.x; x <= texelMax.x; x++) {
+
+			farthestDepth = max(farthestDepth, texelFetch(hiZ, ivec2(x, y), level).r);
+		}
+	}
+
+	meshVisible[meshIndex] = nearestDepth <= farthestDepth ? 1 : 0;
+}
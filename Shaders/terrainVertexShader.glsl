@@ -0,0 +1,102 @@
+// Targeting version 4.6 of GLSL. If the compiler does not support 4.5 it will cause an error.
+#version 460 core
+
+// Vertex shader of TerrainComponent. Every terrain node is drawn with the same
+// flat patch, which is placed, displaced by the height texture of its tile and
+// morphed towards the next coarser level of detail as it gets further from the
+// camera. Outputs the same values as vertexShader.glsl so that it can be used
+// with fragmentShader.glsl.
+
+// Variants built by ShaderPermutations define MATERIAL_PERMUTATION and set each
+// material feature to 0 or 1 so that the work of unused features is compiled
+// out. Without a permutation every feature is compiled in and selected at run time.
+#ifndef MATERIAL_PERMUTATION
+#define DIFFUSE_TEXTURE 1
+#define SPECULAR_TEXTURE 1
+#define NORMAL_MAP 1
+#define VIRTUAL_TEXTURE 1
+#define GPU_DRIVEN 0
+#endif
+
+// Must match the constants in TerrainComponent.h
+const float TERRAIN_PATCH_QUADS = 32.0;
+const float TERRAIN_TEXTURE_REPEAT = 8.0;
+
+layout(shared) uniform transformBlock
+{
+	mat4 modelMatrix;
+	mat4 viewMatrix;
+	mat4 projectionMatrix;
+	mat4 normalModelMatrix;
+};
+
+// World position of the corner of the node (xy) and its size (z), and the
+// height of the terrain origin (w)
+layout(location = 120) uniform vec4 terrainNode;
+
+// World position of the corner of the tile (xy), its size (z) and its layer in
+// the height texture (w)
+layout(location = 121) uniform vec4 terrainTile;
+
+// Distances from the camera at which the node starts and finishes morphing
+layout(location = 122) uniform vec2 terrainMorphRange;
+
+layout(location = 123) uniform vec3 terrainCameraPosition;
+
+// Heights of the resident tiles, one per layer
+layout(binding = 6) uniform sampler2DArray terrainHeightSampler;
+
+out vec3 worldPos;
+out vec3 worldNorm;
+out vec2 texCoord0;
+
+#if NORMAL_MAP
+out mat3 TBN;
+#endif
+
+// Flat patch in the unit square of the XZ plane
+layout (location = 0) in vec4 vertexPosition;
+
+float terrainHeight(vec2 worldXZ)
+{
+	// Samples lie on the corners of the texels' footprint, so they are offset by half a texel
+	float samples = float(textureSize(terrainHeightSampler, 0).x);
+	vec2 uv = ((worldXZ - terrainTile.xy) / terrainTile.z * (samples - 1.0) + 0.5) / samples;
+
+	return terrainNode.w + textureLod(terrainHeightSampler, vec3(uv, terrainTile.w), 0.0).r;
+}
+
+void main()
+{
+	vec2 gridPos = vertexPosition.xz;
+	vec2 worldXZ = terrainNode.xy + gridPos * terrainNode.z;
+
+	// Vertices that are not on the coarser grid slide to the middle of the
+	// coarser edge they lie on. Fully morphed nodes match their coarser neighbors.
+	float distanceToCamera = distance(terrainCameraPosition, vec3(worldXZ.x, terrainHeight(worldXZ), worldXZ.y));
+	float morph = clamp((distanceToCamera - terrainMorphRange.x) / (terrainMorphRange.y - terrainMorphRange.x), 0.0, 1.0);
+
+	gridPos -= fract(gridPos * TERRAIN_PATCH_QUADS * 0.5) * 2.0 / TERRAIN_PATCH_QUADS * morph;
+	worldXZ = terrainNode.xy + gridPos * terrainNode.z;
+
+	worldPos = vec3(worldXZ.x, terrainHeight(worldXZ), worldXZ.y);
+
+	// Slopes from the neighboring samples
+	float spacing = terrainTile.z / (float(textureSize(terrainHeightSampler, 0).x) - 1.0);
+	float slopeX = (terrainHeight(worldXZ + vec2(spacing, 0.0)) - terrainHeight(worldXZ - vec2(spacing, 0.0))) / (2.0 * spacing);
+	float slopeZ = (terrainHeight(worldXZ + vec2(0.0, spacing)) - terrainHeight(worldXZ - vec2(0.0, spacing))) / (2.0 * spacing);
+
+	worldNorm = normalize(vec3(-slopeX, 1.0, -slopeZ));
+
+	// The texture repeats across the terrain with t increasing towards -Z
+	texCoord0 = vec2(worldXZ.x, -worldXZ.y) / TERRAIN_TEXTURE_REPEAT;
+
+#if NORMAL_MAP
+	vec3 T = normalize(vec3(1.0, slopeX, 0.0));
+	vec3 B = normalize(vec3(0.0, -slopeZ, -1.0));
+
+	TBN = mat3(T, B, worldNorm);
+#endif
+
+	gl_Position = projectionMatrix * viewMatrix * vec4(worldPos, 1.0);
+}
@@ -1,6 +1,17 @@
 // Targeting version 4.6 of GLSL. If the compiler does not support 4.5 it will cause an error.
 #version 460 core
 
+// Variants built by ShaderPermutations define MATERIAL_PERMUTATION and set each
+// material feature to 0 or 1 so that the work of unused features is compiled
+// out. Without a permutation every feature is compiled in and selected at run time.
+#ifndef MATERIAL_PERMUTATION
+#define DIFFUSE_TEXTURE 1
+#define SPECULAR_TEXTURE 1
+#define NORMAL_MAP 1
+#define VIRTUAL_TEXTURE 1
+#define GPU_DRIVEN 0
+#endif
+
 layout(shared) uniform transformBlock
 {
 	mat4 modelMatrix;
@@ -9,10 +20,37 @@ layout(shared) uniform transformBlock
 	mat4 normalModelMatrix;
 };
 
+#if GPU_DRIVEN
+// Objects drawn by GPUDrivenRenderer. The base instance of each indirect draw
+// command is the index of the object. Must match the layout in GPUDrivenRenderer.h.
+struct DrawObject
+{
+	mat4 modelMatrix;
+	vec4 boundsCenterRadius;	// world space bounding sphere
+	uvec4 drawCommand;			// index count, first index and base vertex
+	uvec4 bucket;				// bucket, first command of the bucket and occluded flag
+	vec4 ambientColor;
+	vec4 diffuseColorAlpha;
+	vec4 specularColorExponent;
+	vec4 emissiveColor;
+	ivec4 textureParameters;	// texture mode, enabled textures and virtual texture identifier
+};
+
+layout(std430, binding = 11) readonly buffer DrawObjectBlock
+{
+	DrawObject drawObjects[];
+};
+
+flat out uint drawObjectIndex;
+#endif
+
 out vec3 worldPos;
 out vec3 worldNorm;
 out vec2 texCoord0;
+
+#if NORMAL_MAP
 out mat3 TBN;
+#endif
 
 layout (location = 0) in vec4 vertexPosition;
 layout (location = 1) in vec3 normal;
@@ -22,22 +60,34 @@ layout(location = 4) in vec3 aBitangent;
 
 void main()
 {
+#if GPU_DRIVEN
+	drawObjectIndex = uint(gl_BaseInstance);
+	mat4 objectModelMatrix = drawObjects[drawObjectIndex].modelMatrix;
+	// Inverse transpose, as for normalModelMatrix, so that scaled objects keep correct normals
+	mat3 objectNormalMatrix = transpose(inverse(mat3(objectModelMatrix)));
+#else
+	mat4 objectModelMatrix = modelMatrix;
+	mat3 objectNormalMatrix = mat3(normalModelMatrix);
+#endif
+
+#if NORMAL_MAP
 	// Normal Mapping
-	vec3 T = normalize(vec3(modelMatrix * vec4(aTangent, 0.0)));
-	vec3 B = normalize(vec3(modelMatrix * vec4(aBitangent, 0.0)));
-	vec3 N = normalize(vec3(modelMatrix * vec4(normal, 0.0)));
+	vec3 T = normalize(vec3(objectModelMatrix * vec4(aTangent, 0.0)));
+	vec3 B = normalize(vec3(objectModelMatrix * vec4(aBitangent, 0.0)));
+	vec3 N = normalize(vec3(objectModelMatrix * vec4(normal, 0.0)));
 
 	TBN = (mat3(T, B, N));
+#endif
 
 	// Transform the position of the vertex to clip 
 	// coordinates (minus perspective division)
-	gl_Position = projectionMatrix * viewMatrix * modelMatrix * vertexPosition;
+	gl_Position = projectionMatrix * viewMatrix * objectModelMatrix * vertexPosition;
 
 	// Transform the position of the vertex to world coords for lighting
-	worldPos = (modelMatrix * vertexPosition).xyz;
+	worldPos = (objectModelMatrix * vertexPosition).xyz;
 
 	// Transform the normal to world coords for lighting
-	worldNorm = normalize(mat3(normalModelMatrix) * normal); 
+	worldNorm = normalize(objectNormalMatrix * normal); 
 
 	// Pass through the texture coordinate
 	texCoord0 = vertexTexCoord;
@@ -0,0 +1,60 @@
+// Targeting version 4.6 of GLSL. If the compiler does not support 4.5 it will cause an error.
+#version 460 core
+
+// Writes the virtual texture page needed by each pixel. Rendered into a small
+// integer framebuffer that is read back to decide which pages to load.
+
+in vec3 worldPos;
+in vec3 worldNorm;
+in vec2 texCoord0;
+in mat3 TBN;
+out uvec4 feedback;
+
+// Must match the material block in the fragment shader
+struct Material
+{
+	vec3 ambientMatColor;
+	vec3 diffuseMatColor;
+	vec3 specularMatColor;
+	vec3 emmissiveMatColor;
+	float specularExp;
+	float alpha;
+	int textureMode;
+	bool diffuseTextureEnabled;
+	bool specularTextureEnabled;
+	bool normalMapTextureEnabled;
+	bool virtualTextureEnabled;
+	int virtualTextureID;
+};
+
+layout(shared) uniform MaterialBlock
+{
+	Material object;
+};
+
+layout(binding = 3) uniform usampler2D pageTableSampler;
+
+// Makes up for the derivatives being larger in the smaller framebuffer
+layout(location = 110) uniform float mipBias;
+
+const float VT_PAGE_SIZE = 128.0;
+
+void main()
+{
+	if (!object.virtualTextureEnabled || object.textureMode == 0) {
+
+		// No page requested
+		feedback = uvec4(255);
+		return;
+	}
+
+	vec2 virtualSize = vec2(textureSize(pageTableSampler, 0)) * VT_PAGE_SIZE;
+	vec2 dx = dFdx(texCoord0 * virtualSize);
+	vec2 dy = dFdy(texCoord0 * virtualSize);
+	float mip = 0.5 * log2(max(max(dot(dx, dx), dot(dy, dy)), 1e-8)) + mipBias;
+	int level = clamp(int(floor(mip)), 0, textureQueryLevels(pageTableSampler) - 1);
+
+	ivec2 page = ivec2(fract(texCoord0) * vec2(textureSize(pageTableSampler, level)));
+
+	feedback = uvec4(page, level, object.virtualTextureID);
+}
@@ -0,0 +1,490 @@
+#include "ShadowMapping.h"
+
+#include <algorithm>
+#include <numeric>
+
+#include "LightComponent.h"
+#include "RenderQueue.h"
+
+static const bool VERBOSE = false;
+
+// Distance behind the view volume of a cascade that casters are still rendered from
+static const float SHADOW_CASTER_MARGIN = 100.0f;
+
+// Near plane of the shadow maps of spot and positional lights
+static const float SHADOW_NEAR_PLANE = 0.1f;
+
+// Static variable definitions (Static variables must be defined outside the declaration)
+ShadowSettings ShadowMapping::settings;
+std::vector<ShadowMapping::ShadowView> ShadowMapping::views;
+std::vector<int> ShadowMapping::tileResolutions;
+std::vector<glm::ivec3> ShadowMapping::tiles;
+std::vector<ShadowMapping::TileState> ShadowMapping::tileStates;
+ShadowMapping::ShadowBlock ShadowMapping::blockData;
+int ShadowMapping::qualityLevel = 0;
+int ShadowMapping::framesOverBudget = 0;
+int ShadowMapping::framesUnderBudget = 0;
+GLuint ShadowMapping::atlasTexture = 0;
+GLuint ShadowMapping::staticAtlasTexture = 0;
+GLuint ShadowMapping::atlasFramebuffer = 0;
+GLuint ShadowMapping::staticAtlasFramebuffer = 0;
+GLuint ShadowMapping::shadowBuffer = 0;
+GLuint ShadowMapping::timerQueries[3] = { 0, 0, 0 };
+unsigned int ShadowMapping::frameNumber = 0;
+
+
+void ShadowMapping::setSettings(const ShadowSettings& newSettings)
+{
+	settings = newSettings;
+
+	// Force the tiles to be allocated and rendered again
+	tileResolutions.clear();
+	qualityLevel = 0;
+
+} // end setSettings
+
+
+void ShadowMapping::initialize()
+{
+	// Both atlases use the same format so that tiles can be copied between them
+	GLuint* textures[] = { &atlasTexture, &staticAtlasTexture };
+	GLuint* framebuffers[] = { &atlasFramebuffer, &staticAtlasFramebuffer };
+
+	for (int i = 0; i < 2; i++) {
+
+		glCreateTextures(GL_TEXTURE_2D, 1, textures[i]);
+		glTextureStorage2D(*textures[i], 1, GL_DEPTH_COMPONENT24, SHADOW_ATLAS_SIZE, SHADOW_ATLAS_SIZE);
+
+		glCreateFramebuffers(1, framebuffers[i]);
+		glNamedFramebufferTexture(*framebuffers[i], GL_DEPTH_ATTACHMENT, *textures[i], 0);
+
+		// Depth only
+		glNamedFramebufferDrawBuffer(*framebuffers[i], GL_NONE);
+		glNamedFramebufferReadBuffer(*framebuffers[i], GL_NONE);
+
+		if (glCheckNamedFramebufferStatus(*framebuffers[i], GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+			std::cerr << "Shadow atlas framebuffer is not complete." << std::endl;
+		}
+	}
+
+	// Depth comparison and bilinear filtering of the comparison results
+	glTextureParameteri(atlasTexture, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTextureParameteri(atlasTexture, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTextureParameteri(atlasTexture, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTextureParameteri(atlasTexture, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTextureParameteri(atlasTexture, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+	glTextureParameteri(atlasTexture, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+
+	glCreateBuffers(1, &shadowBuffer);
+	glNamedBufferStorage(shadowBuffer, sizeof(ShadowBlock), nullptr, GL_DYNAMIC_STORAGE_BIT);
+
+	glGenQueries(3, timerQueries);
+
+	if (VERBOSE) cout << "Shadow atlas created" << endl;
+
+} // end initialize
+
+
+void ShadowMapping::update(const glm::mat4& viewMatrix, const glm::mat4& projectionMatrix, glm::ivec2 windowDimensions)
+{
+	if (atlasTexture == 0) {
+		initialize();
+	}
+
+	adjustQuality();
+
+	buildViews(viewMatrix, projectionMatrix);
+	allocateTiles();
+
+	// Time the shadow passes. Results are read a few frames later so that
+	// the CPU does not wait for the GPU.
+	glBeginQuery(GL_TIME_ELAPSED, timerQueries[frameNumber % 3]);
+
+	renderViews();
+
+	glEndQuery(GL_TIME_ELAPSED);
+	frameNumber++;
+
+	// Describe the tiles to the fragment shader
+	for (size_t i = 0; i < views.size(); i++) {
+
+		blockData.viewProjections[i] = views[i].viewProjection;
+		blockData.tileRects[i] = glm::vec4(views[i].tile.x, views[i].tile.y, views[i].tile.z, views[i].tile.z) / static_cast<float>(SHADOW_ATLAS_SIZE);
+	}
+
+	blockData.shadowParameters = glm::vec4(1.0f / SHADOW_ATLAS_SIZE, settings.normalOffset, 0.0f, 0.0f);
+
+	glNamedBufferSubData(shadowBuffer, 0, sizeof(ShadowBlock), &blockData);
+
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, shadowBlockBindingPoint, shadowBuffer);
+	glBindTextureUnit(shadowAtlasTextureUnit, atlasTexture);
+
+	// Return to rendering the scene into the window
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	glViewport(0, 0, windowDimensions.x, windowDimensions.y);
+
+} // end update
+
+
+void ShadowMapping::buildViews(const glm::mat4& viewMatrix, const glm::mat4& projectionMatrix)
+{
+	views.clear();
+
+	for (glm::ivec4& lightShadow : blockData.lightShadows) {
+		lightShadow = glm::ivec4(0, 0, 0, 0);
+	}
+
+	// Visit the lights in slot order so that their shadow maps keep the same
+	// tiles from frame to frame
+	std::vector<LightComponent*> lights;
+
+	for (auto& light : LightComponent::GetLightComponents()) {
+
+		if (light->getCastsShadows() && light->getSlot() >= 0) {
+			lights.push_back(light.get());
+		}
+	}
+
+	std::sort(lights.begin(), lights.end(), [](const LightComponent* left, const LightComponent* right) {
+		return left->getSlot() < right->getSlot();
+	});
+
+	int resolutionShift = qualityLevel;
+	int cascadesRemoved = std::max(qualityLevel - 1, 0);
+
+	// Eye frustum used to fit the cascades
+	glm::mat4 inverseView = glm::inverse(viewMatrix);
+	float nearPlane = projectionMatrix[3][2] / (projectionMatrix[2][2] - 1.0f);
+	float farPlane = projectionMatrix[3][2] / (projectionMatrix[2][2] + 1.0f);
+	float shadowFar = std::min(farPlane, settings.shadowDistance);
+	float tanHalfX = 1.0f / projectionMatrix[0][0];
+	float tanHalfY = 1.0f / projectionMatrix[1][1];
+
+	for (LightComponent* light : lights) {
+
+		int slot = light->getSlot();
+		LIGHT_TYPE type = light->getLightType();
+
+		int viewCount = type == DIRECTIONAL_LIGHT ? glm::clamp(light->getShadowCascadeCount() > 0 ? light->getShadowCascadeCount() : settings.cascadeCount, 1, MAX_SHADOW_CASCADES)
+			: type == SPOT_LIGHT ? 1 : 6;
+
+		if (type == DIRECTIONAL_LIGHT) {
+			viewCount = std::max(viewCount - cascadesRemoved, 1);
+		}
+
+		if (static_cast<int>(views.size()) + viewCount > MAX_SHADOW_VIEWS) {
+
+			if (VERBOSE) cout << "Too many shadow maps. Light slot " << slot << " has no shadows." << endl;
+			continue;
+		}
+
+		int resolution = light->getShadowResolution() > 0 ? light->getShadowResolution()
+			: type == DIRECTIONAL_LIGHT ? settings.cascadeResolution
+			: type == SPOT_LIGHT ? settings.spotResolution : settings.pointResolution;
+
+		resolution = glm::clamp(resolution >> resolutionShift, MIN_SHADOW_RESOLUTION, SHADOW_ATLAS_SIZE);
+
+		blockData.lightShadows[slot] = glm::ivec4(static_cast<int>(views.size()), viewCount, static_cast<int>(type), 0);
+
+		glm::vec3 position = light->owningGameObject->getPosition(WORLD);
+		glm::vec3 forward = glm::normalize(light->owningGameObject->getFowardDirection(WORLD));
+
+		if (type == DIRECTIONAL_LIGHT) {
+
+			glm::vec3 towardLight = -forward;
+			glm::vec3 up = std::fabs(towardLight.y) > 0.99f ? UNIT_X_V3 : UNIT_Y_V3;
+
+			float splitNear = nearPlane;
+
+			for (int cascade = 0; cascade < viewCount; cascade++) {
+
+				// Blend of logarithmic and uniform splits
+				float fraction = static_cast<float>(cascade + 1) / viewCount;
+				float logSplit = nearPlane * std::pow(shadowFar / nearPlane, fraction);
+				float uniformSplit = nearPlane + (shadowFar - nearPlane) * fraction;
+				float splitFar = settings.cascadeSplitLambda * logSplit + (1.0f - settings.cascadeSplitLambda) * uniformSplit;
+
+				blockData.cascadeSplits[cascade] = splitFar;
+
+				// Corners of the part of the eye frustum covered by the cascade
+				glm::vec3 corners[8];
+				glm::vec3 center = ZERO_V3;
+
+				for (int i = 0; i < 8; i++) {
+
+					float depth = (i & 4) ? splitFar : splitNear;
+					glm::vec4 corner((i & 1 ? 1.0f : -1.0f) * depth * tanHalfX, (i & 2 ? 1.0f : -1.0f) * depth * tanHalfY, -depth, 1.0f);
+
+					corners[i] = glm::vec3(inverseView * corner);
+					center += corners[i] / 8.0f;
+				}
+
+				// A bounding sphere keeps the size of the cascade the same as the
+				// eye turns, which keeps the shadow edges from shimmering
+				float radius = 0.0f;
+
+				for (const glm::vec3& corner : corners) {
+					radius = std::max(radius, glm::length(corner - center));
+				}
+
+				radius = std::ceil(radius * 16.0f) / 16.0f;
+
+				glm::mat4 lightView = glm::lookAt(center + towardLight * (radius + SHADOW_CASTER_MARGIN), center, up);
+				glm::mat4 lightProjection = glm::ortho(-radius, radius, -radius, radius, 0.0f, 2.0f * radius + SHADOW_CASTER_MARGIN);
+
+				// Move the cascade in whole texels
+				glm::vec4 origin = lightProjection * lightView * glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+				glm::vec2 texelOrigin = glm::vec2(origin.x, origin.y) * (resolution * 0.5f);
+				glm::vec2 offset = (glm::vec2(std::round(texelOrigin.x), std::round(texelOrigin.y)) - texelOrigin) * (2.0f / resolution);
+
+				lightProjection[3][0] += offset.x;
+				lightProjection[3][1] += offset.y;
+
+				ShadowView view;
+				view.viewProjection = lightProjection * lightView;
+				view.resolution = resolution;
+				views.push_back(view);
+
+				splitNear = splitFar;
+			}
+		}
+		else {
+
+			float range = std::min(light->getRange(), 1000.0f);
+
+			if (type == SPOT_LIGHT) {
+
+				float halfAngle = std::acos(glm::clamp(light->getSpotCutoffCos(), 0.05f, 1.0f));
+				glm::vec3 up = std::fabs(forward.y) > 0.99f ? UNIT_X_V3 : UNIT_Y_V3;
+
+				ShadowView view;
+				view.viewProjection = glm::perspective(2.0f * halfAngle, 1.0f, SHADOW_NEAR_PLANE, std::max(range, 2.0f * SHADOW_NEAR_PLANE))
+					* glm::lookAt(position, position + forward, up);
+				view.resolution = resolution;
+				views.push_back(view);
+			}
+			else {
+
+				// Cube faces in the order +X, -X, +Y, -Y, +Z, -Z. Must match the
+				// face selection in the fragment shader.
+				const glm::vec3 faceDirections[6] = { UNIT_X_V3, -UNIT_X_V3, UNIT_Y_V3, -UNIT_Y_V3, UNIT_Z_V3, -UNIT_Z_V3 };
+				const glm::vec3 faceUps[6] = { -UNIT_Y_V3, -UNIT_Y_V3, UNIT_Z_V3, -UNIT_Z_V3, -UNIT_Y_V3, -UNIT_Y_V3 };
+
+				glm::mat4 faceProjection = glm::perspective(PI / 2.0f, 1.0f, SHADOW_NEAR_PLANE, std::max(range, 2.0f * SHADOW_NEAR_PLANE));
+
+				for (int face = 0; face < 6; face++) {
+
+					ShadowView view;
+					view.viewProjection = faceProjection * glm::lookAt(position, position + faceDirections[face], faceUps[face]);
+					view.resolution = resolution;
+					views.push_back(view);
+				}
+			}
+		}
+	}
+
+} // end buildViews
+
+
+void ShadowMapping::allocateTiles()
+{
+	std::vector<int> resolutions;
+
+	for (const ShadowView& view : views) {
+		resolutions.push_back(view.resolution);
+	}
+
+	if (resolutions != tileResolutions) {
+
+		tileResolutions = resolutions;
+		tiles.assign(views.size(), glm::ivec3(0, 0, 0));
+
+		// Nothing in the atlases matches the new tiles
+		tileStates.assign(views.size(), TileState());
+
+		// Pack the largest tiles first into rows. Halve every tile until they fit.
+		std::vector<size_t> order(views.size());
+		std::iota(order.begin(), order.end(), 0);
+		std::stable_sort(order.begin(), order.end(), [&](size_t left, size_t right) {
+			return resolutions[left] > resolutions[right];
+		});
+
+		for (int shift = 0; ; shift++) {
+
+			int x = 0, y = 0, rowHeight = 0;
+			bool fits = true;
+
+			for (size_t index : order) {
+
+				int size = std::max(resolutions[index] >> shift, 1);
+
+				if (x + size > SHADOW_ATLAS_SIZE) {
+
+					x = 0;
+					y += rowHeight;
+					rowHeight = 0;
+				}
+
+				if (y + size > SHADOW_ATLAS_SIZE) {
+
+					fits = false;
+					break;
+				}
+
+				tiles[index] = glm::ivec3(x, y, size);
+				x += size;
+				rowHeight = std::max(rowHeight, size);
+			}
+
+			if (fits) {
+				break;
+			}
+		}
+
+		if (VERBOSE) cout << "Allocated " << views.size() << " shadow atlas tiles" << endl;
+	}
+
+	for (size_t i = 0; i < views.size(); i++) {
+		views[i].tile = tiles[i];
+	}
+
+} // end allocateTiles
+
+
+void ShadowMapping::renderViews()
+{
+	// Keep the depth of surfaces facing the light from shadowing themselves
+	glEnable(GL_POLYGON_OFFSET_FILL);
+	glPolygonOffset(2.0f, 4.0f);
+	glEnable(GL_SCISSOR_TEST);
+
+	int staticRenders = 0;
+
+	for (size_t i = 0; i < views.size(); i++) {
+
+		const ShadowView& view = views[i];
+		const glm::ivec3& tile = view.tile;
+		TileState& state = tileStates[i];
+
+		glViewport(tile.x, tile.y, tile.z, tile.z);
+		glScissor(tile.x, tile.y, tile.z, tile.z);
+
+		size_t staticHash = RenderQueue::getStaticHash(view.viewProjection);
+		bool hasDynamicCasters = RenderQueue::hasDynamicCasters(view.viewProjection);
+		bool restoreTile = hasDynamicCasters || state.hadDynamicCasters;
+
+		// Render the static casters when the view or the static casters in it changed
+		if (staticHash != state.staticHash) {
+
+			glBindFramebuffer(GL_FRAMEBUFFER, staticAtlasFramebuffer);
+			glClear(GL_DEPTH_BUFFER_BIT);
+
+			RenderQueue::drawDepth(view.viewProjection, true, false);
+
+			state.staticHash = staticHash;
+			restoreTile = true;
+			staticRenders++;
+		}
+
+		// Otherwise the tile still holds the depth of the last frame
+		if (restoreTile) {
+
+			// Start from the static depth and add the casters that moved recently
+			glCopyImageSubData(staticAtlasTexture, GL_TEXTURE_2D, 0, tile.x, tile.y, 0,
+							   atlasTexture, GL_TEXTURE_2D, 0, tile.x, tile.y, 0, tile.z, tile.z, 1);
+
+			if (hasDynamicCasters) {
+
+				glBindFramebuffer(GL_FRAMEBUFFER, atlasFramebuffer);
+
+				RenderQueue::drawDepth(view.viewProjection, false, true);
+			}
+		}
+
+		state.hadDynamicCasters = hasDynamicCasters;
+	}
+
+	glDisable(GL_SCISSOR_TEST);
+	glDisable(GL_POLYGON_OFFSET_FILL);
+
+	if (VERBOSE && staticRenders > 0) cout << staticRenders << " static shadow maps rendered" << endl;
+
+} // end renderViews
+
+
+void ShadowMapping::adjustQuality()
+{
+	// The oldest query was issued two frames ago
+	if (settings.frameBudgetMs <= 0.0f || frameNumber < 3) {
+		return;
+	}
+
+	GLuint query = timerQueries[frameNumber % 3];
+	GLint available = 0;
+
+	glGetQueryObjectiv(query, GL_QUERY_RESULT_AVAILABLE, &available);
+
+	if (!available) {
+		return;
+	}
+
+	GLuint64 elapsed = 0;
+	glGetQueryObjectui64v(query, GL_QUERY_RESULT, &elapsed);
+
+	float milliseconds = elapsed / 1.0e6f;
+
+	if (milliseconds > settings.frameBudgetMs) {
+
+		framesUnderBudget = 0;
+
+		// Lower the quality after a few slow frames in a row
+		if (++framesOverBudget > 10 && qualityLevel < MAX_SHADOW_QUALITY_LEVEL) {
+
+			qualityLevel++;
+			framesOverBudget = 0;
+
+			if (VERBOSE) cout << "Shadow quality level raised to " << qualityLevel << endl;
+		}
+	}
+	else if (milliseconds < 0.5f * settings.frameBudgetMs) {
+
+		framesOverBudget = 0;
+
+		// Raise the quality only after a long run of fast frames
+		if (++framesUnderBudget > 120 && qualityLevel > 0) {
+
+			qualityLevel--;
+			framesUnderBudget = 0;
+
+			if (VERBOSE) cout << "Shadow quality level lowered to " << qualityLevel << endl;
+		}
+	}
+	else {
+
+		framesOverBudget = 0;
+		framesUnderBudget = 0;
+	}
+
+} // end adjustQuality
+
+
+void ShadowMapping::unload()
+{
+	glDeleteTextures(1, &atlasTexture);
+	glDeleteTextures(1, &staticAtlasTexture);
+	glDeleteFramebuffers(1, &atlasFramebuffer);
+	glDeleteFramebuffers(1, &staticAtlasFramebuffer);
+	glDeleteBuffers(1, &shadowBuffer);
+	glDeleteQueries(3, timerQueries);
+
+	atlasTexture = staticAtlasTexture = 0;
+	atlasFramebuffer = staticAtlasFramebuffer = 0;
+	shadowBuffer = 0;
+
+	views.clear();
+	tiles.clear();
+	tileStates.clear();
+	tileResolutions.clear();
+	frameNumber = 0;
+
+} // end unload
@@ -0,0 +1,256 @@
+#pragma once
+
+#include "MathLibsConstsFuncs.h"
+#include "SharedLighting.h"
+
+using namespace constants_and_types;
+
+// Width and height in texels of the shadow atlas. Every shadow map, including
+// the cascades of directional lights, is a square tile of the atlas.
+static const int SHADOW_ATLAS_SIZE = 4096;
+
+// Largest number of shadow maps (tiles) rendered in a frame. Must match the
+// shadow block in the fragment shader.
+static const int MAX_SHADOW_VIEWS = 32;
+
+// Largest number of cascades of a directional light
+static const int MAX_SHADOW_CASCADES = 4;
+
+// Smallest resolution a shadow map is reduced to in order to meet the frame budget
+static const int MIN_SHADOW_RESOLUTION = 128;
+
+// Highest quality level. Each level halves the resolution of the shadow maps.
+// Levels above one also remove one cascade each.
+static const int MAX_SHADOW_QUALITY_LEVEL = 3;
+
+// Texture unit of the shadow atlas and binding point of the shadow block
+static const GLuint shadowAtlasTextureUnit = 5;
+static const GLuint shadowBlockBindingPoint = 8;
+
+/**
+ * @struct	ShadowSettings
+ *
+ * @brief	Default shadow map counts and resolutions, and the time the shadow passes
+ * 			may take each frame.
+ */
+struct ShadowSettings {
+
+	// Number of cascades of directional lights
+	int cascadeCount = 4;
+
+	// Resolution of each cascade of a directional light
+	int cascadeResolution = 2048;
+
+	// Resolution of the shadow map of a spot light
+	int spotResolution = 1024;
+
+	// Resolution of each of the six shadow maps of a positional light
+	int pointResolution = 512;
+
+	// Distance from the eye covered by the cascades
+	float shadowDistance = 100.0f;
+
+	// Blend between logarithmic (1) and uniform (0) cascade splits
+	float cascadeSplitLambda = 0.75f;
+
+	// GPU time in milliseconds the shadow passes may take each frame. The
+	// quality level is adjusted to stay within it. Zero disables adjustment.
+	float frameBudgetMs = 2.0f;
+
+	// Distance in world units that positions are moved along their normal
+	// before they are compared against a shadow map
+	float normalOffset = 0.05f;
+};
+
+/**
+ * @class	ShadowMapping
+ *
+ * @brief	Renders shadow maps for the LightComponents that cast shadows.
+ *
+ * 			Directional lights use cascaded shadow maps that cover the view frustum
+ * 			up to ShadowSettings::shadowDistance. Spot lights use one shadow map and
+ * 			positional lights use six, one per cube face. All shadow maps are tiles
+ * 			of a single depth texture atlas so the fragment shader samples them
+ * 			through one sampler.
+ *
+ * 			Shadow maps are rendered from the RenderQueue with the position only
+ * 			vertex stream. Static casters are rendered into a second atlas that is
+ * 			only updated when the view of a tile or the static casters in it change.
+ * 			Each frame the static depth is copied into the tile and only the casters
+ * 			that moved recently are rendered on top of it. Tiles without moving
+ * 			casters are left as they are.
+ *
+ * 			The GPU time of the shadow passes is measured. When it exceeds the frame
+ * 			budget the quality level is raised, which lowers the resolution and
+ * 			cascade count of every light. When there is plenty of time left it is
+ * 			lowered again.
+ */
+class ShadowMapping
+{
+public:
+
+	/**
+	 * @fn	static void ShadowMapping::setSettings(const ShadowSettings& settings);
+	 *
+	 * @brief	Sets the defaults and frame budget. The shadow maps are rebuilt.
+	 */
+	static void setSettings(const ShadowSettings& settings);
+
+	static const ShadowSettings& getSettings() { return settings; }
+
+	/**
+	 * @fn	static int ShadowMapping::getQualityLevel()
+	 *
+	 * @brief	Gets the current quality level. Zero is full quality.
+	 */
+	static int getQualityLevel() { return qualityLevel; }
+
+	/**
+	 * @fn	static void ShadowMapping::update(const glm::mat4& viewMatrix, const glm::mat4& projectionMatrix, glm::ivec2 windowDimensions);
+	 *
+	 * @brief	Renders the shadow maps of the lights that cast shadows and makes them
+	 * 			available to the fragment shader. Should be called once per frame
+	 * 			after the lights have been assigned slots and the RenderQueue has
+	 * 			been built, and before the scene is rendered. Restores the default
+	 * 			framebuffer and a viewport covering the window.
+	 *
+	 * @param	viewMatrix			The viewing transformation.
+	 * @param	projectionMatrix	The perspective projection.
+	 * @param	windowDimensions	Size of the framebuffer in pixels.
+	 */
+	static void update(const glm::mat4& viewMatrix, const glm::mat4& projectionMatrix, glm::ivec2 windowDimensions);
+
+	/**
+	 * @fn	static void ShadowMapping::unload();
+	 *
+	 * @brief	Deletes the atlases, framebuffers, queries and the shadow block.
+	 */
+	static void unload();
+
+protected:
+
+	/**
+	 * @struct	ShadowView
+	 *
+	 * @brief	One shadow map and its tile in the atlas.
+	 */
+	struct ShadowView {
+
+		// Transformation from world coordinates to the clip coordinates of the shadow map
+		glm::mat4 viewProjection = glm::mat4(1.0f);
+
+		// Requested width and height of the shadow map
+		int resolution = 0;
+
+		// Lower left corner (xy) and size (z) of the tile in texels
+		glm::ivec3 tile;
+	};
+
+	/**
+	 * @struct	TileState
+	 *
+	 * @brief	What a tile of the atlases held at the end of the last frame.
+	 */
+	struct TileState {
+
+		// Hash of the view and static casters rendered into the static atlas tile
+		size_t staticHash = 0;
+
+		// True if casters that moved recently were rendered on top of the static depth
+		bool hadDynamicCasters = true;
+	};
+
+	/**
+	 * @struct	ShadowBlock
+	 *
+	 * @brief	Contents of the shadow shader storage buffer (std430 layout).
+	 */
+	struct ShadowBlock {
+
+		// Transformations of the shadow maps
+		glm::mat4 viewProjections[MAX_SHADOW_VIEWS];
+
+		// Lower left corner (xy) and size (zw) of the tile of each shadow map in texture coordinates
+		glm::vec4 tileRects[MAX_SHADOW_VIEWS];
+
+		// First shadow map (x), number of shadow maps (y) and type (z) of each light slot.
+		// The type is 0 for directional, 1 for spot and 2 for positional lights.
+		glm::ivec4 lightShadows[MAX_LIGHTS];
+
+		// View space depth at the far end of each cascade
+		glm::vec4 cascadeSplits;
+
+		// Size of an atlas texel in texture coordinates (x) and the normal offset (y)
+		glm::vec4 shadowParameters;
+	};
+
+	/**
+	 * @fn	static void ShadowMapping::initialize();
+	 *
+	 * @brief	Creates the atlases, framebuffers, queries and the shadow block.
+	 */
+	static void initialize();
+
+	/**
+	 * @fn	static void ShadowMapping::buildViews(const glm::mat4& viewMatrix, const glm::mat4& projectionMatrix);
+	 *
+	 * @brief	Computes the shadow maps needed by the lights that cast shadows.
+	 */
+	static void buildViews(const glm::mat4& viewMatrix, const glm::mat4& projectionMatrix);
+
+	/**
+	 * @fn	static void ShadowMapping::allocateTiles();
+	 *
+	 * @brief	Places the shadow maps in the atlas. Tiles and cached static depth
+	 * 			are kept if the resolutions have not changed since the last frame.
+	 */
+	static void allocateTiles();
+
+	/**
+	 * @fn	static void ShadowMapping::renderViews();
+	 *
+	 * @brief	Renders the shadow maps into their tiles.
+	 */
+	static void renderViews();
+
+	/**
+	 * @fn	static void ShadowMapping::adjustQuality();
+	 *
+	 * @brief	Reads the GPU time of an earlier frame and adjusts the quality level
+	 * 			to meet the frame budget.
+	 */
+	static void adjustQuality();
+
+	/** @brief	Defaults and frame budget */
+	static ShadowSettings settings;
+
+	/** @brief	Shadow maps of the current frame */
+	static std::vector<ShadowView> views;
+
+	/** @brief	Resolutions of the shadow maps when the tiles were last allocated */
+	static std::vector<int> tileResolutions;
+
+	/** @brief	Tiles of the shadow maps and what they hold */
+	static std::vector<glm::ivec3> tiles;
+	static std::vector<TileState> tileStates;
+
+	/** @brief	CPU copy of the shadow block */
+	static ShadowBlock blockData;
+
+	/** @brief	Current quality level and the frames spent over or well under the budget */
+	static int qualityLevel;
+	static int framesOverBudget;
+	static int framesUnderBudget;
+
+	/** @brief	Depth textures, framebuffers and the shadow block buffer */
+	static GLuint atlasTexture;
+	static GLuint staticAtlasTexture;
+	static GLuint atlasFramebuffer;
+	static GLuint staticAtlasFramebuffer;
+	static GLuint shadowBuffer;
+
+	/** @brief	Timer queries of the last few frames */
+	static GLuint timerQueries[3];
+	static unsigned int frameNumber;
+
+}; // end ShadowMapping
@@ -1,6 +1,8 @@
 #include "SharedLighting.h"
 
 #include <sstream> 
+#include <algorithm>
+#include <cstring>
 
 GeneralLight SharedLighting::lights[MAX_LIGHTS];
 
@@ -8,6 +10,27 @@ const std::string SharedLighting::generalLightBlockName = "LightBlock";
 
 SharedUniformBlock SharedLighting::lightBlock(generalLightBlockBindingPoint);
 
+bool SharedLighting::attributesInitialized = false;
+
+std::bitset<MAX_LIGHTS> SharedLighting::lightsChanged;
+
+std::vector<unsigned char> SharedLighting::lightBlockData;
+
+// Writes a member of the light block to the CPU copy. Members that are not
+// used by the shaders have an offset of -1 and are skipped.
+static void writeBlockMember(std::vector<unsigned char>& blockData, GLint offset, const void* value, size_t size, GLint& firstByte, GLint& endByte)
+{
+	if (offset < 0 || offset + size > blockData.size()) {
+		return;
+	}
+
+	memcpy(blockData.data() + offset, value, size);
+
+	firstByte = std::min(firstByte, offset);
+	endByte = std::max(endByte, offset + static_cast<GLint>(size));
+
+} // end writeBlockMember
+
 void SharedLighting::setUniformBlockForShader(GLuint shaderProgram)
 {
 	std::vector <std::string > lightBlockMemberNames = buildUniformBlockNameList();
@@ -42,9 +65,21 @@ void SharedLighting::setUniformBlockForShader(GLuint shaderProgram)
 		lights[i].enabledLoc = uniformOffsets[offsetIndex++];
 
 		// Initialize the attributes of the light to something meaningful
-		initilizeAttributes(i);
+		if (!attributesInitialized) {
+			initilizeAttributes(i);
+		}
+	}
+
+	// Create the CPU copy of the block once its size is known. All lights are
+	// uploaded with the next call to uploadChangedLights.
+	if (lightBlockData.empty() && lightBlock.getSize() > 0) {
+
+		lightBlockData.assign(lightBlock.getSize(), 0);
+		lightsChanged.set();
 	}
 
+	attributesInitialized = true;
+
 } // end setUniformBlockForShader
 
 
@@ -102,69 +137,99 @@ void SharedLighting::initilizeAttributes(GLint lightNumber)
 } // end initilizeAttributes
 
 
-void SharedLighting::setEnabled(int lightIndex, bool on)
+void SharedLighting::uploadChangedLights()
 {
-	// Bind the buffer. 
-	glBindBuffer(GL_UNIFORM_BUFFER, lightBlock.getBuffer());
+	if (lightsChanged.none() || lightBlockData.empty()) {
+		return;
+	}
 
-	lights[lightIndex].enabled = on;
+	GLint firstByte = static_cast<GLint>(lightBlockData.size());
+	GLint endByte = 0;
 
-	glBufferSubData(GL_UNIFORM_BUFFER, lights[lightIndex].enabledLoc, sizeof(bool), &lights[lightIndex].enabled);
+	for (int i = 0; i < MAX_LIGHTS; i++) {
 
-	// Unbind the buffer. 
-	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+		if (lightsChanged[i]) {
+			copyLightToBlock(i, firstByte, endByte);
+		}
+	}
+
+	lightsChanged.reset();
+
+	if (endByte > firstByte) {
+
+		// Bind the buffer. 
+		glBindBuffer(GL_UNIFORM_BUFFER, lightBlock.getBuffer());
+
+		glBufferSubData(GL_UNIFORM_BUFFER, firstByte, endByte - firstByte, lightBlockData.data() + firstByte);
+
+		// Unbind the buffer. 
+		glBindBuffer(GL_UNIFORM_BUFFER, 0);
+	}
+
+} // end uploadChangedLights
+
+
+void SharedLighting::copyLightToBlock(int lightIndex, GLint& firstByte, GLint& endByte)
+{
+	const GeneralLight& light = lights[lightIndex];
+
+	// Booleans are four bytes in uniform blocks
+	GLint isSpot = light.isSpot;
+	GLint enabled = light.enabled;
+
+	writeBlockMember(lightBlockData, light.ambientColorLoc, value_ptr(light.ambientColor), sizeof(glm::vec3), firstByte, endByte);
+	writeBlockMember(lightBlockData, light.diffuseColorLoc, value_ptr(light.diffuseColor), sizeof(glm::vec3), firstByte, endByte);
+	writeBlockMember(lightBlockData, light.specularColorLoc, value_ptr(light.specularColor), sizeof(glm::vec3), firstByte, endByte);
+	writeBlockMember(lightBlockData, light.positionOrDirectionLoc, value_ptr(light.positionOrDirection), sizeof(glm::vec4), firstByte, endByte);
+	writeBlockMember(lightBlockData, light.spotDirectionLoc, value_ptr(light.spotDirection), sizeof(glm::vec3), firstByte, endByte);
+	writeBlockMember(lightBlockData, light.isSpotLoc, &isSpot, sizeof(GLint), firstByte, endByte);
+	writeBlockMember(lightBlockData, light.spotCutoffCosLoc, &light.spotCutoffCos, sizeof(float), firstByte, endByte);
+	writeBlockMember(lightBlockData, light.spotExponentLoc, &light.spotExponent, sizeof(float), firstByte, endByte);
+	writeBlockMember(lightBlockData, light.constantLoc, &light.constant, sizeof(float), firstByte, endByte);
+	writeBlockMember(lightBlockData, light.linearLoc, &light.linear, sizeof(float), firstByte, endByte);
+	writeBlockMember(lightBlockData, light.quadraticLoc, &light.quadratic, sizeof(float), firstByte, endByte);
+	writeBlockMember(lightBlockData, light.enabledLoc, &enabled, sizeof(GLint), firstByte, endByte);
+
+} // end copyLightToBlock
+
+
+void SharedLighting::setEnabled(int lightIndex, bool on)
+{
+	lights[lightIndex].enabled = on;
+
+	lightsChanged[lightIndex] = true;
 
 } // end setEnabled
 
 void SharedLighting::setAmbientColor(int lightIndex, glm::vec3 color4)
 {
-	// Bind the buffer. 
-	glBindBuffer(GL_UNIFORM_BUFFER, lightBlock.getBuffer());
-
 	lights[lightIndex].ambientColor = color4;
-	glBufferSubData(GL_UNIFORM_BUFFER, lights[lightIndex].ambientColorLoc, sizeof(glm::vec3), value_ptr(lights[lightIndex].ambientColor));
 
-	// Unbind the buffer. 
-	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+	lightsChanged[lightIndex] = true;
 
 } // end setAmbientColor
 
 void SharedLighting::setDiffuseColor(int lightIndex, glm::vec3 color4)
 {
-	// Bind the buffer. 
-	glBindBuffer(GL_UNIFORM_BUFFER, lightBlock.getBuffer());
-
 	lights[lightIndex].diffuseColor = color4;
-	glBufferSubData(GL_UNIFORM_BUFFER, lights[lightIndex].diffuseColorLoc, sizeof(glm::vec3), value_ptr(lights[lightIndex].diffuseColor));
 
-	// Unbind the buffer.
-	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+	lightsChanged[lightIndex] = true;
 
 } // end setDiffuseColor
 
 void SharedLighting::setSpecularColor(int lightIndex, glm::vec3 color4)
 {
-	// Bind the buffer. 
-	glBindBuffer(GL_UNIFORM_BUFFER, lightBlock.getBuffer());
-
 	lights[lightIndex].specularColor = color4;
-	glBufferSubData(GL_UNIFORM_BUFFER, lights[lightIndex].specularColorLoc, sizeof(glm::vec3), value_ptr(lights[lightIndex].specularColor));
 
-	// Unbind the buffer. 
-	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+	lightsChanged[lightIndex] = true;
 
 } // end setSpecularColor
 
 void SharedLighting::setPositionOrDirection(int lightIndex, glm::vec4 positOrDirect)
 {
-	// Bind the buffer. 
-	glBindBuffer(GL_UNIFORM_BUFFER, lightBlock.getBuffer());
-
 	lights[lightIndex].positionOrDirection = positOrDirect;
-	glBufferSubData(GL_UNIFORM_BUFFER, lights[lightIndex].positionOrDirectionLoc, sizeof(glm::vec4), value_ptr(lights[lightIndex].positionOrDirection));
 
-	// Unbind the buffer. 
-	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+	lightsChanged[lightIndex] = true;
 
 } // end setPositionOrDirection
 
@@ -178,88 +243,56 @@ void SharedLighting::setAttenuationFactors(int lightIndex, glm::vec3 factors)
 
 void SharedLighting::setConstantAttenuation(int lightIndex, float factor)
 {
-	// Bind the buffer. 
-	glBindBuffer(GL_UNIFORM_BUFFER, lightBlock.getBuffer());
-
 	lights[lightIndex].constant = factor;
-	glBufferSubData(GL_UNIFORM_BUFFER, lights[lightIndex].constantLoc, sizeof(float), &lights[lightIndex].constant);
 
-	// Unbind the buffer. 
-	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+	lightsChanged[lightIndex] = true;
 
 } // end setConstantAttenuation
 
 void SharedLighting::setLinearAttenuation(int lightIndex, float factor)
 {
-	// Bind the buffer. 
-	glBindBuffer(GL_UNIFORM_BUFFER, lightBlock.getBuffer());
-
 	lights[lightIndex].linear = factor;
-	glBufferSubData(GL_UNIFORM_BUFFER, lights[lightIndex].linearLoc, sizeof(float), &lights[lightIndex].linear);
 
-	// Unbind the buffer. 
-	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+	lightsChanged[lightIndex] = true;
 
 } // end setLinearAttenuation
 
 void SharedLighting::setQuadraticAttenuation(int lightIndex, float factor)
 {
-	// Bind the buffer. 
-	glBindBuffer(GL_UNIFORM_BUFFER, lightBlock.getBuffer());
-
 	lights[lightIndex].quadratic = factor;
-	glBufferSubData(GL_UNIFORM_BUFFER, lights[lightIndex].quadraticLoc, sizeof(float), &lights[lightIndex].quadratic);
 
-	// Unbind the buffer. 
-	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+	lightsChanged[lightIndex] = true;
 
 } // end setQuadraticAttenuation
 
 void SharedLighting::setIsSpot(int lightIndex, bool spotOn)
 {
-	glBindBuffer(GL_UNIFORM_BUFFER, lightBlock.getBuffer());
-
 	lights[lightIndex].isSpot = spotOn;
 
-	glBufferSubData(GL_UNIFORM_BUFFER, lights[lightIndex].isSpotLoc, sizeof(bool), &lights[lightIndex].isSpot);
-
-	// Unbind the buffer. 
-	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+	lightsChanged[lightIndex] = true;
 
 } // end setIsSpot
 
 void SharedLighting::setSpotDirection(int lightIndex, glm::vec3 spotDirect)
 {
-	glBindBuffer(GL_UNIFORM_BUFFER, lightBlock.getBuffer());
-
 	lights[lightIndex].spotDirection = glm::normalize(spotDirect);
-	glBufferSubData(GL_UNIFORM_BUFFER, lights[lightIndex].spotDirectionLoc, sizeof(glm::vec3), value_ptr(lights[lightIndex].spotDirection));
 
-	// Unbind the buffer. 
-	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+	lightsChanged[lightIndex] = true;
 
 } // end setSpotDirection
 
 void SharedLighting::setSpotCutoffCos(int lightIndex, float cutoffCosRadians)
 {
-	glBindBuffer(GL_UNIFORM_BUFFER, lightBlock.getBuffer());
-
 	lights[lightIndex].spotCutoffCos = cutoffCosRadians;
-	glBufferSubData(GL_UNIFORM_BUFFER, lights[lightIndex].spotCutoffCosLoc, sizeof(float), &lights[lightIndex].spotCutoffCos);
 
-	// Unbind the buffer. 
-	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+	lightsChanged[lightIndex] = true;
 
 } // end setSpotCutoffCos
 
 void SharedLighting::setSpotExponent(int lightIndex, float spotEx)
 {
-	glBindBuffer(GL_UNIFORM_BUFFER, lightBlock.getBuffer());
-
 	lights[lightIndex].spotExponent = spotEx;
-	glBufferSubData(GL_UNIFORM_BUFFER, lights[lightIndex].spotExponentLoc, sizeof(float), &lights[lightIndex].spotExponent);
 
-	// Unbind the buffer. 
-	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+	lightsChanged[lightIndex] = true;
 
 } // end setSpotExponent
\ No newline at end of file
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <bitset>
+
 #include "SharedUniformBlock.h"
 
 static const int generalLightBlockBindingPoint = 24;
@@ -60,6 +62,15 @@ public:
 
 	static void setUniformBlockForShader(GLuint shaderProgram);
 
+	// The setters below only change a copy of the light block in CPU memory and
+	// mark the light as changed, so any number of light properties can be set or
+	// animated each frame. Changes are sent to the GPU by uploadChangedLights.
+
+	// Copies the changed lights into the CPU copy of the light block and uploads
+	// the range of the block they occupy with a single buffer update. Should be
+	// called once per frame before the scene is rendered.
+	static void uploadChangedLights();
+
 	static bool getEnabled(int lightIndex) { return lights[lightIndex].enabled; }
 	static void setEnabled(int lightIndex, bool on);
 
@@ -104,11 +115,25 @@ protected:
 
 	static void initilizeAttributes(GLint lightNumber);
 
+	// Writes the attributes of a light into the CPU copy of the light block and
+	// extends [firstByte, endByte) to include them
+	static void copyLightToBlock(int lightIndex, GLint& firstByte, GLint& endByte);
+
 	static GeneralLight lights[MAX_LIGHTS];
 
 	static SharedUniformBlock lightBlock;
 
 	const static std::string generalLightBlockName;
+
+	// Indicates the lights have been given their initial attributes. Shader
+	// programs that are set up later (e.g. rebuilt programs) keep the current values.
+	static bool attributesInitialized;
+
+	// Lights that have changed since the last upload
+	static std::bitset<MAX_LIGHTS> lightsChanged;
+
+	// Copy of the contents of the light block buffer
+	static std::vector<unsigned char> lightBlockData;
 };
 
 
@@ -20,6 +20,10 @@ GLuint SharedMaterials::normalMapEnabledLocation;
 
 GLuint SharedMaterials::textureModeLoction;
 
+GLuint SharedMaterials::virtualTextureEnabledLocation;
+
+GLuint SharedMaterials::virtualTextureIDLocation;
+
 SharedUniformBlock SharedMaterials::materialBlock(materialBlockBindingPoint);
 
 const std::string SharedMaterials::materialBlockName = "MaterialBlock";
@@ -29,7 +33,8 @@ void SharedMaterials::setUniformBlockForShader(GLuint shaderProgram)
 {
 	std::vector<std::string> materialMemberNames = { "object.ambientMatColor", "object.diffuseMatColor", 
 		"object.specularMatColor", "object.emmissiveMatColor", "object.specularExp", "object.alpha","object.diffuseTextureEnabled" ,
-		"object.specularTextureEnabled", "object.normalMapTextureEnabled", "object.textureMode" };
+		"object.specularTextureEnabled", "object.normalMapTextureEnabled", "object.textureMode",
+		"object.virtualTextureEnabled", "object.virtualTextureID" };
 
 	std::vector<GLint> uniformOffsets = materialBlock.setUniformBlockForShader(shaderProgram, materialBlockName, materialMemberNames);
 
@@ -44,6 +49,8 @@ void SharedMaterials::setUniformBlockForShader(GLuint shaderProgram)
 	specularTextureEnabledLocation = uniformOffsets[7];
 	normalMapEnabledLocation = uniformOffsets[8];
 	textureModeLoction = uniformOffsets[9];
+	virtualTextureEnabledLocation = uniformOffsets[10];
+	virtualTextureIDLocation = uniformOffsets[11];
 
 } // end setUniformBlockForShader
 
@@ -67,6 +74,12 @@ void SharedMaterials::setShaderMaterialProperties(const Material & material)
 		glBufferSubData(GL_UNIFORM_BUFFER, normalMapEnabledLocation, sizeof(bool), &material.normalMapTextureEnabled);
 		glBufferSubData(GL_UNIFORM_BUFFER, textureModeLoction, sizeof(int), &material.textureMode);
 
+		// Written as a full four byte GLSL bool
+		GLint virtualTextureEnabled = material.virtualTextureEnabled ? 1 : 0;
+		GLint virtualTextureID = material.virtualTextureEnabled ? material.virtualTexture->getID() : 0;
+		glBufferSubData(GL_UNIFORM_BUFFER, virtualTextureEnabledLocation, sizeof(GLint), &virtualTextureEnabled);
+		glBufferSubData(GL_UNIFORM_BUFFER, virtualTextureIDLocation, sizeof(GLint), &virtualTextureID);
+
 		// Unbind the buffer. 
 		glBindBuffer(GL_UNIFORM_BUFFER, 0);
 
@@ -75,15 +88,26 @@ void SharedMaterials::setShaderMaterialProperties(const Material & material)
 
 			glBindTextureUnit(0, material.diffuseTextureObject);
 
+			if (material.diffuseTexture) material.diffuseTexture->touch();
 		}
 		if (material.specularTextureEnabled == true) {
 
 			glBindTextureUnit(1, material.specularTextureObject);
+
+			if (material.specularTexture) material.specularTexture->touch();
 		}
 
 		if (material.normalMapTextureEnabled == true) {
 
 			glBindTextureUnit(2, material.normalMapTextureObject);
+
+			if (material.normalMapTexture) material.normalMapTexture->touch();
+		}
+
+		if (material.virtualTextureEnabled == true) {
+
+			glBindTextureUnit(pageTableTextureUnit, material.virtualTexture->getPageTableObject());
+			glBindTextureUnit(pageCacheTextureUnit, material.virtualTexture->getPageCacheObject());
 		}
 
 	}
@@ -111,3 +135,43 @@ void SharedMaterials::cleanUpMaterial(const Material & material)
 		glDisable(GL_BLEND);
 	}
 }
+
+
+PackedMaterial SharedMaterials::packMaterial(const Material & material)
+{
+	PackedMaterial packed;
+
+	packed.ambientColor = glm::vec4(material.ambientColor, 1.0f);
+	packed.diffuseColorAlpha = glm::vec4(material.diffuseColor, material.alphaTransparency);
+	packed.specularColorExponent = glm::vec4(material.specularColor, material.specularExpMat);
+	packed.emissiveColor = glm::vec4(material.emissiveColor, 1.0f);
+
+	int enabledTextures = 0;
+
+	if (material.diffuseTextureEnabled) enabledTextures |= DIFFUSE_TEXTURE_FEATURE;
+	if (material.specularTextureEnabled) enabledTextures |= SPECULAR_TEXTURE_FEATURE;
+	if (material.normalMapTextureEnabled) enabledTextures |= NORMAL_MAP_FEATURE;
+	if (material.virtualTextureEnabled) enabledTextures |= VIRTUAL_TEXTURE_FEATURE;
+
+	packed.textureParameters = glm::ivec4(material.textureMode, enabledTextures,
+										  material.virtualTextureEnabled ? material.virtualTexture->getID() : 0, 0);
+
+	return packed;
+
+} // end packMaterial
+
+
+size_t SharedMaterials::getTextureBindingHash(const Material & material)
+{
+	size_t hash = 17;
+
+	auto combine = [&hash](size_t value) { hash = hash * 31 + value; };
+
+	combine(material.diffuseTextureEnabled ? material.diffuseTextureObject : 0);
+	combine(material.specularTextureEnabled ? material.specularTextureObject : 0);
+	combine(material.normalMapTextureEnabled ? material.normalMapTextureObject : 0);
+	combine(material.virtualTextureEnabled ? reinterpret_cast<size_t>(material.virtualTexture.get()) : 0);
+
+	return hash;
+
+} // end getTextureBindingHash
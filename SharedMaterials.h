@@ -10,8 +10,28 @@ static const GLuint diffuseSamplerLocation = 100;
 static const GLuint specularSamplerLocation = 101;
 static const GLuint normalMapSamplerLocation = 102;
 
+// Texture units of the virtual texture page table and page cache
+static const GLuint pageTableTextureUnit = 3;
+static const GLuint pageCacheTextureUnit = 4;
+
 using namespace constants_and_types;
 
+/**
+ * @struct	PackedMaterial
+ *
+ * @brief	Material properties in a form that can be stored in a shader storage
+ * 			buffer (std430 layout). Used when many objects are drawn by one call and
+ * 			each reads its own material.
+ */
+struct PackedMaterial {
+
+	glm::vec4 ambientColor;				// ambient color (rgb)
+	glm::vec4 diffuseColorAlpha;		// diffuse color (rgb) and alpha (w)
+	glm::vec4 specularColorExponent;	// specular color (rgb) and specular exponent (w)
+	glm::vec4 emissiveColor;			// emissive color (rgb)
+	glm::ivec4 textureParameters;		// texture mode (x), MATERIAL_FEATURE bits of the enabled textures (y) and virtual texture identifier (z)
+};
+
 class SharedMaterials
 {
 public:
@@ -43,6 +63,25 @@ public:
 	 */
 	static void cleanUpMaterial(const Material & material);
 
+	/**
+	 * @fn	static PackedMaterial SharedMaterials::packMaterial(const Material & material);
+	 *
+	 * @brief	Gets the properties of a material for a shader storage buffer.
+	 *
+	 * @param 	material	The material.
+	 */
+	static PackedMaterial packMaterial(const Material & material);
+
+	/**
+	 * @fn	static size_t SharedMaterials::getTextureBindingHash(const Material & material);
+	 *
+	 * @brief	Gets a hash of the textures a material binds. Materials with the same
+	 * 			hash can be rendered without changing texture bindings.
+	 *
+	 * @param 	material	The material.
+	 */
+	static size_t getTextureBindingHash(const Material & material);
+
 protected:
 
 	static GLuint ambientColorLocation; // Byte offset ambient material color
@@ -65,6 +104,10 @@ protected:
 
 	static GLuint textureModeLoction; //Byte offset of texture mode indicator
 
+	static GLuint virtualTextureEnabledLocation; //Byte offset of virtual texture enabled indicator
+
+	static GLuint virtualTextureIDLocation; //Byte offset of virtual texture identifier
+
 	static SharedUniformBlock materialBlock; // Shared uniform block manager for material propertie
 
 	const static std::string materialBlockName; // Name of the material uniform block
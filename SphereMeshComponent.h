@@ -1,34 +1,21 @@
 #pragma once
-#include "MeshComponent.h"
+#include "ProceduralMeshComponent.h"
 #include <vector>
 
-class SphereMeshComponent : public MeshComponent
+class SphereMeshComponent : public ProceduralMeshComponent
 {
 public:
 	SphereMeshComponent(GLuint shaderProgram, Material mat, float radius = 1.0f, int stacks = 12, 
 						int slices = 16, int updateOrder = 100);
 
-	virtual void buildMesh() override;
-
 protected:
 
-	float sliceInc, stackInc, radius;
-	int slices, stacks;
-	Material sphereMat;
-
-	void initializeTopSubMesh();
-	void initializeBottomSubMesh();
-	void initializeBodySubMesh();
-
-	std::vector<pntVertexData> createStackVertexData(float startingSliceAngle, float stackAngle);
+	virtual size_t getGeometryKey() const override;
 
-	std::vector<pntVertexData> upper;
+	virtual void generateGeometry(int subMeshIndex, std::vector<pntVertexData>& vertexData, std::vector<unsigned int>& indices) const override;
 
-	std::vector<pntVertexData> lower;
+	virtual std::shared_ptr<btCollisionShape> createCollisionShape() const override;
 
-	std::vector<unsigned int> indices;
-
-	//int upperBase = 0;
-	//int lowerBase = 0;
+	float radius;
+	int slices, stacks;
 };
-
@@ -0,0 +1,613 @@
+#include "TerrainComponent.h"
+
+#include <algorithm>
+#include <limits>
+#include <string>
+
+#include "GeometryArena.h"
+#include "RenderQueue.h"
+#include "ShaderPermutations.h"
+#include "SharedMaterials.h"
+#include "SharedTransformations.h"
+#include "ThreadPool.h"
+
+static const bool VERBOSE = false;
+
+// Static variable definitions (Static variables must be defined outside the declaration)
+std::vector<TerrainComponent*> TerrainComponent::terrains;
+
+// Index of a node in the height ranges of a tile. The levels are stored one
+// after the other with the root first, each by row (Z) then column (X).
+static int nodeIndex(int level, int x, int z)
+{
+	return ((1 << (2 * level)) - 1) / 3 + z * (1 << level) + x;
+
+} // end nodeIndex
+
+// Number of tiles between two tiles along the axis on which they are furthest apart
+static int tileDistance(glm::ivec2 a, glm::ivec2 b)
+{
+	return std::max(std::abs(a.x - b.x), std::abs(a.y - b.y));
+
+} // end tileDistance
+
+
+TerrainComponent::TerrainComponent(GLuint shaderProgram, Material material, TerrainSettings settings, int updateOrder)
+	: MeshComponent(shaderProgram, updateOrder), settings(std::move(settings)), loadedTiles(std::make_shared<LoadedTiles>())
+{
+	setMaterial(material);
+
+	// Every tile within the streaming radius must fit in the height texture
+	int maxRadius = (static_cast<int>(glm::sqrt(static_cast<float>(TERRAIN_MAX_RESIDENT_TILES))) - 1) / 2;
+
+	if (this->settings.streamingRadius > maxRadius) {
+
+		std::cerr << "TerrainComponent: streaming radius reduced to " << maxRadius << " tiles" << std::endl;
+		this->settings.streamingRadius = maxRadius;
+	}
+
+	this->settings.collisionRadius = std::min(this->settings.collisionRadius, this->settings.streamingRadius);
+
+	terrains.push_back(this);
+
+} // end TerrainComponent constructor
+
+
+TerrainComponent::~TerrainComponent()
+{
+	// The compound shape does not own the shapes of the tiles
+	if (terrainShape) {
+
+		for (auto& entry : residentTiles) {
+
+			if (entry.second->collisionShape) {
+				terrainShape->removeChildShape(entry.second->collisionShape.get());
+			}
+		}
+	}
+
+	if (patchGeometry != 0) {
+		GeometryArena::release(patchGeometry);
+	}
+
+	terrains.erase(std::remove(terrains.begin(), terrains.end(), this), terrains.end());
+
+} // end TerrainComponent destructor
+
+
+void TerrainComponent::buildMesh()
+{
+	// Patch in the unit square of the XZ plane. Its indices are ordered by
+	// quarter so that each quarter can be drawn on its own.
+	std::vector<pntVertexData> vData;
+	std::vector<unsigned int> indices;
+
+	for (int row = 0; row <= TERRAIN_PATCH_QUADS; row++) {
+
+		for (int column = 0; column <= TERRAIN_PATCH_QUADS; column++) {
+
+			vec2 position(static_cast<float>(column) / TERRAIN_PATCH_QUADS, static_cast<float>(row) / TERRAIN_PATCH_QUADS);
+			vData.push_back(pntVertexData(vec4(position.x, 0.0f, position.y, 1.0f), UNIT_Y_V3, position, UNIT_X_V3, NEG_UNIT_Z_V3));
+		}
+	}
+
+	const int half = TERRAIN_PATCH_QUADS / 2;
+
+	for (int quarter = 0; quarter < 4; quarter++) {
+
+		for (int row = (quarter >> 1) * half; row < ((quarter >> 1) + 1) * half; row++) {
+
+			for (int column = (quarter & 1) * half; column < ((quarter & 1) + 1) * half; column++) {
+
+				// Counterclockwise when seen from above
+				unsigned int back = row * (TERRAIN_PATCH_QUADS + 1) + column;
+				unsigned int front = back + TERRAIN_PATCH_QUADS + 1;
+
+				indices.insert(indices.end(), { front, front + 1, back + 1, front, back + 1, back });
+			}
+		}
+	}
+
+	patchGeometry = GeometryArena::allocate(vData, indices);
+
+	// One layer per resident tile
+	heightTexture = GpuTexture::create(GL_TEXTURE_2D_ARRAY);
+	glTextureStorage3D(heightTexture.get(), 1, GL_R32F, TERRAIN_TILE_SAMPLES, TERRAIN_TILE_SAMPLES, TERRAIN_MAX_RESIDENT_TILES);
+	glTextureParameteri(heightTexture.get(), GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTextureParameteri(heightTexture.get(), GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTextureParameteri(heightTexture.get(), GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTextureParameteri(heightTexture.get(), GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+	freeLayers.clear();
+
+	for (int layer = TERRAIN_MAX_RESIDENT_TILES - 1; layer >= 0; layer--) {
+		freeLayers.push_back(layer);
+	}
+
+	// The shapes of the tiles are added as they come within the collision radius
+	terrainShape = std::shared_ptr<btCompoundShape>(new btCompoundShape());
+	this->collisionShape = terrainShape;
+
+} // end buildMesh
+
+
+std::shared_ptr<TerrainComponent::Tile> TerrainComponent::loadTile(const TerrainSettings& settings, glm::ivec2 coordinates)
+{
+	std::shared_ptr<Tile> tile = std::make_shared<Tile>();
+	tile->coordinates = coordinates;
+
+	std::vector<float> heights(TERRAIN_TILE_SAMPLES * TERRAIN_TILE_SAMPLES, 0.0f);
+	bool loaded = false;
+
+	if (!settings.tileDirectory.empty()) {
+
+		std::string fileName = settings.tileDirectory + "/tile_" + std::to_string(coordinates.x) + "_" + std::to_string(coordinates.y) + ".r32";
+
+		FILE* file = nullptr;
+		fopen_s(&file, fileName.c_str(), "rb");
+
+		if (file != nullptr) {
+
+			loaded = fread(heights.data(), sizeof(float), heights.size(), file) == heights.size();
+			fclose(file);
+
+			if (!loaded) {
+
+				std::cerr << "ERROR: " << fileName << " does not hold " << TERRAIN_TILE_SAMPLES << " x " << TERRAIN_TILE_SAMPLES << " heights!" << std::endl;
+				std::fill(heights.begin(), heights.end(), 0.0f);
+			}
+		}
+	}
+
+	if (!loaded && settings.heightFunction) {
+
+		float spacing = settings.tileSize / (TERRAIN_TILE_SAMPLES - 1);
+		vec2 corner = vec2(coordinates) * settings.tileSize;
+
+		for (int row = 0; row < TERRAIN_TILE_SAMPLES; row++) {
+
+			for (int column = 0; column < TERRAIN_TILE_SAMPLES; column++) {
+				heights[row * TERRAIN_TILE_SAMPLES + column] = settings.heightFunction(corner.x + column * spacing, corner.y + row * spacing);
+			}
+		}
+	}
+
+	// Height ranges of the deepest nodes from the samples, including the samples
+	// on their edges, then of each parent from its children
+	const int deepest = TERRAIN_LOD_LEVELS - 1;
+	const int nodesAcross = 1 << deepest;
+	const int quadsPerNode = (TERRAIN_TILE_SAMPLES - 1) / nodesAcross;
+
+	tile->nodeHeightRanges.resize(nodeIndex(TERRAIN_LOD_LEVELS, 0, 0));
+
+	for (int z = 0; z < nodesAcross; z++) {
+
+		for (int x = 0; x < nodesAcross; x++) {
+
+			vec2 range(INFINITY, -INFINITY);
+
+			for (int row = z * quadsPerNode; row <= (z + 1) * quadsPerNode; row++) {
+
+				for (int column = x * quadsPerNode; column <= (x + 1) * quadsPerNode; column++) {
+
+					float height = heights[row * TERRAIN_TILE_SAMPLES + column];
+					range = vec2(std::min(range.x, height), std::max(range.y, height));
+				}
+			}
+
+			tile->nodeHeightRanges[nodeIndex(deepest, x, z)] = range;
+		}
+	}
+
+	for (int level = deepest - 1; level >= 0; level--) {
+
+		for (int z = 0; z < (1 << level); z++) {
+
+			for (int x = 0; x < (1 << level); x++) {
+
+				vec2 range(INFINITY, -INFINITY);
+
+				for (int child = 0; child < 4; child++) {
+
+					vec2 childRange = tile->nodeHeightRanges[nodeIndex(level + 1, 2 * x + (child & 1), 2 * z + (child >> 1))];
+					range = vec2(std::min(range.x, childRange.x), std::max(range.y, childRange.y));
+				}
+
+				tile->nodeHeightRanges[nodeIndex(level, x, z)] = range;
+			}
+		}
+	}
+
+	tile->heights = std::make_shared<const std::vector<float>>(std::move(heights));
+
+	return tile;
+
+} // end loadTile
+
+
+void TerrainComponent::update(const float& deltaTime)
+{
+	MeshComponent::update(deltaTime);
+
+	if (!heightTexture) {
+		return;
+	}
+
+	glm::ivec2 cameraTile = getTileCoordinates(getCameraPosition());
+
+	uploadLoadedTiles(cameraTile);
+	requestTiles(cameraTile);
+	updateCollisionShapes(cameraTile);
+
+	stats.residentTiles = static_cast<int>(residentTiles.size());
+	stats.pendingTiles = static_cast<int>(pendingTiles.size());
+
+} // end update
+
+
+void TerrainComponent::requestTiles(glm::ivec2 cameraTile)
+{
+	if (pendingTiles.size() >= TERRAIN_MAX_PENDING_TILES) {
+		return;
+	}
+
+	std::vector<glm::ivec2> wanted;
+
+	for (int z = -settings.streamingRadius; z <= settings.streamingRadius; z++) {
+
+		for (int x = -settings.streamingRadius; x <= settings.streamingRadius; x++) {
+
+			glm::ivec2 coordinates = cameraTile + glm::ivec2(x, z);
+			long long key = tileKey(coordinates);
+
+			if (residentTiles.count(key) == 0 && pendingTiles.count(key) == 0) {
+				wanted.push_back(coordinates);
+			}
+		}
+	}
+
+	// Closest tiles first
+	std::sort(wanted.begin(), wanted.end(), [cameraTile](const glm::ivec2& a, const glm::ivec2& b) {
+
+		glm::ivec2 toA = a - cameraTile;
+		glm::ivec2 toB = b - cameraTile;
+
+		return toA.x * toA.x + toA.y * toA.y < toB.x * toB.x + toB.y * toB.y;
+	});
+
+	for (const glm::ivec2& coordinates : wanted) {
+
+		if (pendingTiles.size() >= TERRAIN_MAX_PENDING_TILES) {
+			break;
+		}
+
+		pendingTiles.insert(tileKey(coordinates));
+
+		// The task keeps its own copies in case the terrain is destroyed first
+		std::shared_ptr<LoadedTiles> destination = loadedTiles;
+		TerrainSettings tileSettings = settings;
+
+		ThreadPool::submit([destination, tileSettings, coordinates] {
+
+			std::shared_ptr<Tile> tile = loadTile(tileSettings, coordinates);
+
+			std::lock_guard<std::mutex> lock(destination->mutex);
+			destination->tiles.push_back(tile);
+		});
+
+		if (VERBOSE) cout << "Requested terrain tile " << coordinates.x << ", " << coordinates.y << endl;
+	}
+
+} // end requestTiles
+
+
+void TerrainComponent::uploadLoadedTiles(glm::ivec2 cameraTile)
+{
+	std::vector<std::shared_ptr<Tile>> tiles;
+
+	{
+		std::lock_guard<std::mutex> lock(loadedTiles->mutex);
+
+		size_t count = std::min(loadedTiles->tiles.size(), static_cast<size_t>(TERRAIN_MAX_TILE_UPLOADS_PER_FRAME));
+
+		tiles.assign(loadedTiles->tiles.begin(), loadedTiles->tiles.begin() + count);
+		loadedTiles->tiles.erase(loadedTiles->tiles.begin(), loadedTiles->tiles.begin() + count);
+	}
+
+	for (std::shared_ptr<Tile>& tile : tiles) {
+
+		long long key = tileKey(tile->coordinates);
+		pendingTiles.erase(key);
+
+		// The camera may have moved away while the tile was loading
+		if (tileDistance(tile->coordinates, cameraTile) > settings.streamingRadius) {
+			continue;
+		}
+
+		if (freeLayers.empty()) {
+
+			// Evict the furthest tile outside the streaming radius
+			auto furthest = residentTiles.end();
+			int furthestDistance = settings.streamingRadius;
+
+			for (auto iter = residentTiles.begin(); iter != residentTiles.end(); iter++) {
+
+				int distance = tileDistance(iter->second->coordinates, cameraTile);
+
+				if (distance > furthestDistance) {
+
+					furthest = iter;
+					furthestDistance = distance;
+				}
+			}
+
+			if (furthest == residentTiles.end()) {
+				continue;
+			}
+
+			if (furthest->second->collisionShape) {
+				terrainShape->removeChildShape(furthest->second->collisionShape.get());
+			}
+
+			freeLayers.push_back(furthest->second->layer);
+			residentTiles.erase(furthest);
+		}
+
+		tile->layer = freeLayers.back();
+		freeLayers.pop_back();
+
+		glTextureSubImage3D(heightTexture.get(), 0, 0, 0, tile->layer, TERRAIN_TILE_SAMPLES, TERRAIN_TILE_SAMPLES, 1,
+							GL_RED, GL_FLOAT, tile->heights->data());
+
+		residentTiles[key] = tile;
+
+		if (VERBOSE) cout << "Uploaded terrain tile " << tile->coordinates.x << ", " << tile->coordinates.y << " to layer " << tile->layer << endl;
+	}
+
+} // end uploadLoadedTiles
+
+
+void TerrainComponent::updateCollisionShapes(glm::ivec2 cameraTile)
+{
+	const float spacing = settings.tileSize / (TERRAIN_TILE_SAMPLES - 1);
+
+	stats.collisionTiles = 0;
+
+	for (auto& entry : residentTiles) {
+
+		Tile& tile = *entry.second;
+		int distance = tileDistance(tile.coordinates, cameraTile);
+
+		if (distance <= settings.collisionRadius && !tile.collisionShape) {
+
+			// Bullet centers the shape between the lowest and highest samples
+			vec2 range = tile.nodeHeightRanges[0];
+
+			btHeightfieldTerrainShape* tileShape = new btHeightfieldTerrainShape(TERRAIN_TILE_SAMPLES, TERRAIN_TILE_SAMPLES, tile.heights->data(), 1.0f,
+																				  range.x, range.y, 1, PHY_FLOAT, false);
+			tileShape->setLocalScaling(btVector3(spacing, 1.0f, spacing));
+
+			// The shape refers to the heights without copying them
+			std::shared_ptr<const std::vector<float>> heights = tile.heights;
+			tile.collisionShape = std::shared_ptr<btCollisionShape>(tileShape, [heights](btCollisionShape* shape) { delete shape; });
+
+			btTransform transform;
+			transform.setIdentity();
+			transform.setOrigin(btVector3((tile.coordinates.x + 0.5f) * settings.tileSize, (range.x + range.y) / 2.0f,
+										  (tile.coordinates.y + 0.5f) * settings.tileSize));
+
+			terrainShape->addChildShape(transform, tileShape);
+		}
+		else if (distance > settings.collisionRadius + 1 && tile.collisionShape) {
+
+			// Removed one tile later than added so that shapes are not rebuilt at the border
+			terrainShape->removeChildShape(tile.collisionShape.get());
+			tile.collisionShape.reset();
+		}
+
+		if (tile.collisionShape) {
+			stats.collisionTiles++;
+		}
+	}
+
+} // end updateCollisionShapes
+
+
+float TerrainComponent::getLodRange(int level) const
+{
+	return settings.lodDistanceFactor * settings.tileSize / (1 << level);
+
+} // end getLodRange
+
+
+glm::vec3 TerrainComponent::getCameraPosition() const
+{
+	return vec3(glm::inverse(SharedTransformations::getViewMatrix())[3]) - this->owningGameObject->getPosition(WORLD);
+
+} // end getCameraPosition
+
+
+glm::ivec2 TerrainComponent::getTileCoordinates(const glm::vec3& position) const
+{
+	return glm::ivec2(glm::floor(position.x / settings.tileSize), glm::floor(position.z / settings.tileSize));
+
+} // end getTileCoordinates
+
+
+bool TerrainComponent::selectNode(const Tile& tile, int level, int x, int z, const glm::vec3& camera, const glm::mat4& viewProjection) const
+{
+	float size = settings.tileSize / (1 << level);
+	vec2 corner = vec2(tile.coordinates) * settings.tileSize + vec2(x, z) * size;
+	vec2 heightRange = tile.nodeHeightRanges[nodeIndex(level, x, z)];
+
+	vec3 boundsMin(corner.x, heightRange.x, corner.y);
+	vec3 boundsMax(corner.x + size, heightRange.y, corner.y + size);
+
+	// Distance from the camera to the bounding box of the node
+	float distance = glm::length(glm::max(glm::max(boundsMin - camera, camera - boundsMax), ZERO_V3));
+
+	// The roots of the tiles are drawn at any distance
+	if (level > 0 && distance > getLodRange(level)) {
+		return false;
+	}
+
+	RenderItem bounds;
+	bounds.boundsCenter = 0.5f * (boundsMin + boundsMax);
+	bounds.boundsRadius = 0.5f * glm::length(boundsMax - boundsMin);
+
+	if (!RenderQueue::isVisible(bounds, viewProjection)) {
+		return true; // Nothing to draw, and nothing for the parent to draw either
+	}
+
+	if (level == TERRAIN_LOD_LEVELS - 1 || distance > getLodRange(level + 1)) {
+
+		selectedNodes.push_back({ &tile, level, corner, size, 0xF });
+		return true;
+	}
+
+	// Quarters whose children are out of their range are drawn at this level
+	unsigned int quarters = 0;
+
+	for (int child = 0; child < 4; child++) {
+
+		if (!selectNode(tile, level + 1, 2 * x + (child & 1), 2 * z + (child >> 1), camera, viewProjection)) {
+			quarters |= 1u << child;
+		}
+	}
+
+	if (quarters != 0) {
+		selectedNodes.push_back({ &tile, level, corner, size, quarters });
+	}
+
+	return true;
+
+} // end selectNode
+
+
+void TerrainComponent::draw() const
+{
+	if (this->owningGameObject->getState() != ACTIVE || !heightTexture || patchGeometry == 0) {
+		return;
+	}
+
+	vec3 origin = this->owningGameObject->getPosition(WORLD);
+	vec3 camera = getCameraPosition();
+	glm::ivec2 cameraTile = getTileCoordinates(camera);
+
+	// Nodes are selected relative to the terrain origin
+	mat4 viewProjection = SharedTransformations::getProjectionMatrix() * SharedTransformations::getViewMatrix() * glm::translate(origin);
+
+	selectedNodes.clear();
+
+	for (const auto& entry : residentTiles) {
+
+		if (tileDistance(entry.second->coordinates, cameraTile) <= settings.streamingRadius) {
+			selectNode(*entry.second, 0, 0, 0, camera, viewProjection);
+		}
+	}
+
+	stats.nodesDrawn = static_cast<int>(selectedNodes.size());
+	stats.quartersDrawn = 0;
+
+	if (selectedNodes.empty()) {
+		return;
+	}
+
+	const Material& material = *instanceMaterial;
+
+	glUseProgram(ShaderPermutations::getVariant(this->shaderProgram, material.getFeatureBits()));
+
+	// The vertex shader places the nodes in world coordinates
+	SharedTransformations::setModelingMatrix(mat4(1.0f));
+	SharedMaterials::setShaderMaterialProperties(material);
+
+	glBindVertexArray(GeometryArena::getVertexArray(PNT_VERTEX_FORMAT));
+	glBindTextureUnit(TERRAIN_HEIGHT_TEXTURE_UNIT, heightTexture.get());
+	glUniform3fv(terrainCameraPositionLocation, 1, glm::value_ptr(camera + origin));
+
+	const GeometryAllocation& patch = GeometryArena::getAllocation(patchGeometry);
+	const GLuint quarterIndices = patch.indexCount / 4;
+
+	for (const SelectedNode& node : selectedNodes) {
+
+		glUniform4f(terrainNodeLocation, node.corner.x + origin.x, node.corner.y + origin.z, node.size, origin.y);
+		glUniform4f(terrainTileLocation, node.tile->coordinates.x * settings.tileSize + origin.x,
+					node.tile->coordinates.y * settings.tileSize + origin.z, settings.tileSize, static_cast<float>(node.tile->layer));
+
+		// Nodes morph into the next coarser level towards the end of their range.
+		// The roots have no coarser level, so their range never ends.
+		vec2 morphRange(0.5f * std::numeric_limits<float>::max(), std::numeric_limits<float>::max());
+
+		if (node.level > 0) {
+
+			float end = getLodRange(node.level);
+			float start = node.level < TERRAIN_LOD_LEVELS - 1 ? getLodRange(node.level + 1) : 0.0f;
+
+			morphRange = vec2(start + (end - start) * TERRAIN_MORPH_START, end);
+		}
+
+		glUniform2fv(terrainMorphRangeLocation, 1, glm::value_ptr(morphRange));
+
+		for (int quarter = 0; quarter < 4; quarter++) {
+
+			if ((node.quarters & (1u << quarter)) == 0) {
+				continue;
+			}
+
+			// Neighboring quarters are drawn with one call
+			int count = 1;
+
+			while (quarter + count < 4 && (node.quarters & (1u << (quarter + count))) != 0) {
+				count++;
+			}
+
+			glDrawElementsBaseVertex(GL_TRIANGLES, count * quarterIndices, GL_UNSIGNED_INT,
+									 reinterpret_cast<const void*>(static_cast<size_t>(patch.firstIndex + quarter * quarterIndices) * sizeof(GLuint)),
+									 static_cast<GLint>(patch.baseVertex));
+
+			stats.quartersDrawn += count;
+			quarter += count - 1;
+		}
+	}
+
+	SharedMaterials::cleanUpMaterial(material);
+
+} // end draw
+
+
+float TerrainComponent::getHeight(float x, float z) const
+{
+	vec3 origin = this->owningGameObject->getPosition(WORLD);
+	vec3 position = vec3(x, 0.0f, z) - origin;
+
+	auto iter = residentTiles.find(tileKey(getTileCoordinates(position)));
+
+	if (iter == residentTiles.end()) {
+		return origin.y;
+	}
+
+	const Tile& tile = *iter->second;
+	const std::vector<float>& heights = *tile.heights;
+
+	// Position in samples from the corner of the tile
+	vec2 sample = (vec2(position.x, position.z) / settings.tileSize - vec2(tile.coordinates)) * static_cast<float>(TERRAIN_TILE_SAMPLES - 1);
+	glm::ivec2 cell = glm::clamp(glm::ivec2(glm::floor(sample)), glm::ivec2(0), glm::ivec2(TERRAIN_TILE_SAMPLES - 2));
+	vec2 weight = glm::clamp(sample - vec2(cell), 0.0f, 1.0f);
+
+	auto height = [&heights](int column, int row) { return heights[row * TERRAIN_TILE_SAMPLES + column]; };
+
+	float back = glm::mix(height(cell.x, cell.y), height(cell.x + 1, cell.y), weight.x);
+	float front = glm::mix(height(cell.x, cell.y + 1), height(cell.x + 1, cell.y + 1), weight.x);
+
+	return origin.y + glm::mix(back, front, weight.y);
+
+} // end getHeight
+
+
+void TerrainComponent::unloadTerrains()
+{
+	for (TerrainComponent* terrain : terrains) {
+		terrain->heightTexture.reset();
+	}
+
+} // end unloadTerrains
@@ -0,0 +1,338 @@
+#pragma once
+
+#include <functional>
+#include <mutex>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "MeshComponent.h"
+#include "GpuResource.h"
+
+// Quads along each side of the patch that every terrain node is drawn with
+static const int TERRAIN_PATCH_QUADS = 32;
+
+// Height samples along each side of a tile. Neighboring tiles share the
+// samples on their common edge.
+static const int TERRAIN_TILE_SAMPLES = 257;
+
+// Depth of the quadtree of each tile. The nodes at the deepest level have one
+// patch quad per height sample.
+static const int TERRAIN_LOD_LEVELS = 4;
+
+// Layers of the height texture, and so the most tiles that can be resident
+static const int TERRAIN_MAX_RESIDENT_TILES = 64;
+
+// Largest number of tiles that are loaded in the background at once
+static const int TERRAIN_MAX_PENDING_TILES = 4;
+
+// Largest number of loaded tiles that are copied into the height texture each frame
+static const int TERRAIN_MAX_TILE_UPLOADS_PER_FRAME = 2;
+
+// Fraction of the range of a level of detail after which its nodes start to morph
+static const float TERRAIN_MORPH_START = 0.7f;
+
+// World units covered by one repeat of the material textures
+static const float TERRAIN_TEXTURE_REPEAT = 8.0f;
+
+// Uniform locations in terrainVertexShader.glsl
+static const GLuint terrainNodeLocation = 120;
+static const GLuint terrainTileLocation = 121;
+static const GLuint terrainMorphRangeLocation = 122;
+static const GLuint terrainCameraPositionLocation = 123;
+
+// Texture unit of the height texture
+static const GLuint TERRAIN_HEIGHT_TEXTURE_UNIT = 6;
+
+/**
+ * @struct	TerrainSettings
+ *
+ * @brief	Where the heights of a terrain come from and how it is streamed and
+ * 			drawn.
+ */
+struct TerrainSettings {
+
+	// Directory of the tile files. The tile at (x, z) is stored in
+	// tile_<x>_<z>.r32 as TERRAIN_TILE_SAMPLES x TERRAIN_TILE_SAMPLES 32 bit
+	// floats, by row (Z) then column (X).
+	std::string tileDirectory;
+
+	// Height at a position relative to the terrain origin. Used for tiles that
+	// have no file. Tiles without either are flat. Called from worker threads.
+	std::function<float(float x, float z)> heightFunction;
+
+	// Width and depth of a tile in world units
+	float tileSize = 512.0f;
+
+	// Tiles in each direction from the tile under the camera that are kept resident
+	int streamingRadius = 3;
+
+	// Tiles in each direction from the tile under the camera that have collision shapes
+	int collisionRadius = 1;
+
+	// The nodes at each level of detail are split when the camera is closer
+	// than this many times their size
+	float lodDistanceFactor = 2.0f;
+};
+
+/**
+ * @struct	TerrainStats
+ *
+ * @brief	Work done by a terrain in the last frame.
+ */
+struct TerrainStats {
+
+	int residentTiles = 0;
+	int pendingTiles = 0;
+	int collisionTiles = 0;
+
+	// Nodes and patch quarters drawn
+	int nodesDrawn = 0;
+	int quartersDrawn = 0;
+};
+
+/**
+ * @class	TerrainComponent
+ *
+ * @brief	Terrain of any size made of square tiles of height samples that are
+ * 			streamed from disk around the camera.
+ *
+ * 			Tiles are read on the ThreadPool and copied into the layers of one
+ * 			height texture array on the main thread. Each tile is the root of a
+ * 			quadtree whose nodes are drawn with the same small patch of quads
+ * 			(Continuous Distance-Dependent Level of Detail). Nodes are split when
+ * 			the camera is within a distance proportional to their size, so the
+ * 			number of vertices drawn does not depend on the size of the terrain.
+ * 			The vertex shader morphs vertices towards the coarser level as the
+ * 			distance approaches the end of the range, so levels meet without
+ * 			cracks or popping. Nodes outside the view volume are culled using the
+ * 			heights of the node.
+ *
+ * 			Tiles near the camera get a btHeightfieldTerrainShape built from the
+ * 			same heights. The shapes are children of the compound shape returned by
+ * 			getCollisionShape.
+ *
+ * 			The terrain is not part of the RenderQueue, so it neither casts
+ * 			shadows nor is drawn by GPUDrivenRenderer. It must be drawn with a
+ * 			program built from terrainVertexShader.glsl.
+ */
+class TerrainComponent : public MeshComponent
+{
+public:
+
+	/**
+	 * @fn	TerrainComponent::TerrainComponent(GLuint shaderProgram, Material material, TerrainSettings settings, int updateOrder = 100);
+	 *
+	 * @brief	Constructor
+	 *
+	 * @param 	shaderProgram	Program built from terrainVertexShader.glsl and a fragment shader.
+	 * @param 	material	 	Material of the whole terrain.
+	 * @param 	settings	 	Where the heights come from and how they are streamed.
+	 * @param 	updateOrder  	(Optional) The update order.
+	 */
+	TerrainComponent(GLuint shaderProgram, Material material, TerrainSettings settings, int updateOrder = 100);
+
+	virtual ~TerrainComponent();
+
+	/**
+	 * @fn	virtual void TerrainComponent::buildMesh() override;
+	 *
+	 * @brief	Creates the patch, the height texture and the compound collision shape.
+	 */
+	virtual void buildMesh() override;
+
+	/**
+	 * @fn	virtual void TerrainComponent::update(const float& deltaTime) override;
+	 *
+	 * @brief	Requests the tiles around the camera, uploads the tiles that have
+	 * 			been loaded and updates the collision shapes.
+	 */
+	virtual void update(const float& deltaTime) override;
+
+	/**
+	 * @fn	virtual void TerrainComponent::draw() const override;
+	 *
+	 * @brief	Selects the nodes of the resident tiles for the current view and draws them.
+	 */
+	virtual void draw() const override;
+
+	/**
+	 * @fn	float TerrainComponent::getHeight(float x, float z) const;
+	 *
+	 * @brief	Gets the height of the terrain at a world position from the resident
+	 * 			tiles, interpolated between the samples.
+	 *
+	 * @returns	The height, or the height of the terrain origin if the tile is not resident.
+	 */
+	float getHeight(float x, float z) const;
+
+	/**
+	 * @fn	const TerrainStats& TerrainComponent::getStats() const
+	 *
+	 * @brief	Gets the work done in the last frame.
+	 */
+	const TerrainStats& getStats() const { return stats; }
+
+	/**
+	 * @fn	static void TerrainComponent::unloadTerrains();
+	 *
+	 * @brief	Deletes the height textures of all terrains. Must be called before the
+	 * 			OpenGL context is destroyed.
+	 */
+	static void unloadTerrains();
+
+protected:
+
+	/**
+	 * @struct	Tile
+	 *
+	 * @brief	Heights of one tile and the range of heights of each node of its quadtree.
+	 */
+	struct Tile {
+
+		glm::ivec2 coordinates;
+
+		std::shared_ptr<const std::vector<float>> heights;
+
+		// Lowest and highest height of each node, level by level with the root first
+		std::vector<glm::vec2> nodeHeightRanges;
+
+		// Layer of the height texture. -1 until the tile is uploaded.
+		int layer = -1;
+
+		std::shared_ptr<btCollisionShape> collisionShape;
+	};
+
+	/**
+	 * @struct	LoadedTiles
+	 *
+	 * @brief	Tiles that have been loaded by worker threads and are waiting to be
+	 * 			uploaded. Shared with the load tasks, which may outlive the terrain.
+	 */
+	struct LoadedTiles {
+
+		std::mutex mutex;
+		std::vector<std::shared_ptr<Tile>> tiles;
+	};
+
+	/**
+	 * @struct	SelectedNode
+	 *
+	 * @brief	A node to be drawn in the current frame.
+	 */
+	struct SelectedNode {
+
+		const Tile* tile;
+		int level;
+		glm::vec2 corner;
+		float size;
+
+		// Quarters of the patch to draw, one bit each. Quarters covered by finer
+		// nodes are left out.
+		unsigned int quarters;
+	};
+
+	/**
+	 * @fn	static std::shared_ptr<Tile> TerrainComponent::loadTile(const TerrainSettings& settings, glm::ivec2 coordinates);
+	 *
+	 * @brief	Reads or generates the heights of a tile and finds the height range of
+	 * 			every node. Runs on a worker thread.
+	 */
+	static std::shared_ptr<Tile> loadTile(const TerrainSettings& settings, glm::ivec2 coordinates);
+
+	/**
+	 * @fn	void TerrainComponent::requestTiles(glm::ivec2 cameraTile);
+	 *
+	 * @brief	Starts loading the closest tiles within the streaming radius that are
+	 * 			neither resident nor loading.
+	 */
+	void requestTiles(glm::ivec2 cameraTile);
+
+	/**
+	 * @fn	void TerrainComponent::uploadLoadedTiles(glm::ivec2 cameraTile);
+	 *
+	 * @brief	Copies loaded tiles into free layers of the height texture, evicting
+	 * 			the furthest tiles outside the streaming radius if necessary.
+	 */
+	void uploadLoadedTiles(glm::ivec2 cameraTile);
+
+	/**
+	 * @fn	void TerrainComponent::updateCollisionShapes(glm::ivec2 cameraTile);
+	 *
+	 * @brief	Creates the collision shapes of the tiles that came within the
+	 * 			collision radius and removes those of the tiles that left it.
+	 */
+	void updateCollisionShapes(glm::ivec2 cameraTile);
+
+	/**
+	 * @fn	bool TerrainComponent::selectNode(const Tile& tile, int level, int x, int z, const glm::vec3& camera, const glm::mat4& viewProjection) const;
+	 *
+	 * @brief	Adds the node, or the parts of it that are not covered by its
+	 * 			children, to the selected nodes.
+	 *
+	 * @returns	False if the node is beyond the range of its level of detail and its
+	 * 			area must be drawn by its parent.
+	 */
+	bool selectNode(const Tile& tile, int level, int x, int z, const glm::vec3& camera, const glm::mat4& viewProjection) const;
+
+	/**
+	 * @fn	float TerrainComponent::getLodRange(int level) const;
+	 *
+	 * @brief	Gets the distance from the camera within which the nodes of a level are drawn.
+	 */
+	float getLodRange(int level) const;
+
+	/**
+	 * @fn	glm::vec3 TerrainComponent::getCameraPosition() const;
+	 *
+	 * @brief	Gets the position of the camera relative to the terrain origin.
+	 */
+	glm::vec3 getCameraPosition() const;
+
+	/**
+	 * @fn	glm::ivec2 TerrainComponent::getTileCoordinates(const glm::vec3& position) const;
+	 *
+	 * @brief	Gets the coordinates of the tile below a position relative to the terrain origin.
+	 */
+	glm::ivec2 getTileCoordinates(const glm::vec3& position) const;
+
+	/**
+	 * @fn	static long long TerrainComponent::tileKey(glm::ivec2 coordinates)
+	 *
+	 * @brief	Packs the coordinates of a tile into one key.
+	 */
+	static long long tileKey(glm::ivec2 coordinates)
+	{
+		return (static_cast<long long>(coordinates.x) << 32) | static_cast<unsigned int>(coordinates.y);
+	}
+
+	TerrainSettings settings;
+
+	/** @brief	Handle of the patch in the GeometryArena. Its indices are ordered by quarter. */
+	GLuint patchGeometry = 0;
+
+	/** @brief	Heights of the resident tiles, one tile per layer */
+	GpuTexture heightTexture;
+
+	/** @brief	Layers of the height texture that hold no tile */
+	std::vector<int> freeLayers;
+
+	/** @brief	Tiles in the height texture by tileKey */
+	std::unordered_map<long long, std::shared_ptr<Tile>> residentTiles;
+
+	/** @brief	Keys of the tiles that are being loaded */
+	std::unordered_set<long long> pendingTiles;
+
+	std::shared_ptr<LoadedTiles> loadedTiles;
+
+	/** @brief	Collision shape of the whole terrain. Its children are the shapes of the tiles. */
+	std::shared_ptr<btCompoundShape> terrainShape;
+
+	/** @brief	Nodes selected for the current frame */
+	mutable std::vector<SelectedNode> selectedNodes;
+
+	mutable TerrainStats stats;
+
+	/** @brief	All terrains that exist, so that their textures can be deleted at shutdown */
+	static std::vector<TerrainComponent*> terrains;
+
+}; // end TerrainComponent
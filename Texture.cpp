@@ -1,4 +1,8 @@
 #include "Texture.h"
+#include "CookedTexture.h"
+
+#include <algorithm>
+
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h"
 
@@ -7,15 +11,182 @@ static const bool VERBOSE = false;
 
 // Map containing all textures that have been loaded
 // (Static variables must be defined outside the declaration)
-std::unordered_map<std::string, class Texture*> Texture::loadedTextures;
+std::map<std::pair<std::string, TEXTURE_USAGE>, std::shared_ptr<Texture>> Texture::loadedTextures;
+
+bool Texture::compressionEnabled = true;
+
+size_t Texture::memoryBudget = DEFAULT_TEXTURE_MEMORY_BUDGET;
+
+TextureStats Texture::stats;
+
+unsigned long long Texture::currentFrame = 0;
+
+int Texture::texturesWithDroppedLevels = 0;
+
+// Dropped mip levels are only restored while the resident textures use less
+// than this fraction of the budget. Prevents levels from being dropped and
+// restored on alternate frames.
+static const float RESTORE_BUDGET_FRACTION = 0.75f;
+
+std::string Texture::getCookedFileName(const std::string& fileName, TEXTURE_USAGE usage)
+{
+	static const char* usageExtensions[] = { ".color.dds", ".normal.dds", ".single.dds" };
+
+	return AssetCache::getCookedPath(fileName, "Textures", usageExtensions[usage]);
+
+} // end getCookedFileName
+
+
+bool Texture::loadCompressed(const std::string& fileName, TEXTURE_USAGE usage)
+{
+	std::string cookedFile = getCookedFileName(fileName, usage);
+
+	// Cook the texture if it has not been cooked or the source image has changed
+	if (!AssetCache::isCookedFileCurrent(fileName, cookedFile)) {
+
+		if (VERBOSE) cout << "Cooking texture: " << fileName << endl;
+
+		if (!CookedTexture::cook(fileName, cookedFile, usage)) {
+			return false;
+		}
+	}
+
+	CookedTexture cooked;
+
+	if (!cooked.open(cookedFile)) {
+
+		// The cooked file is invalid or was written by an older version of
+		// the engine. Cook it again.
+		if (!CookedTexture::cook(fileName, cookedFile, usage) || !cooked.open(cookedFile)) {
+			return false;
+		}
+	}
+
+	if (!TextureCompression::isSupported(cooked.getFormat())) {
+
+		std::cerr << "WARNING: " << cookedFile << " uses a format that is not supported." << std::endl;
+		return false;
+	}
+
+	this->width = cooked.getLevelWidth(0);
+	this->height = cooked.getLevelHeight(0);
+	this->internalFormat = TextureCompression::getInternalFormat(cooked.getFormat());
+	this->mipLevels = cooked.getMipCount();
+	this->streamable = true;
+
+	this->textureID = GpuTexture::create(GL_TEXTURE_2D);
+
+	// Assign texture to ID
+	glBindTexture(GL_TEXTURE_2D, this->textureID.get());
+
+	uploadCookedLevels(cooked, 0);
+
+	setSamplingParameters();
+
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	if (VERBOSE) std::cout << "Loaded: " << cookedFile << " compressed texture. width " << width << " height " << height
+						   << " levels " << mipLevels << " bytes " << sizeInBytes << std::endl;
+
+	return true;
+
+} // end loadCompressed
+
+
+void Texture::uploadCookedLevels(const CookedTexture& cooked, int firstLevel)
+{
+	int residentLevels = cooked.getMipCount() - firstLevel;
+
+	stats.residentBytes -= sizeInBytes;
+	sizeInBytes = 0;
+
+	// Every level is supplied so glGenerateMipmap is not needed
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, residentLevels - 1);
+
+	for (int level = 0; level < residentLevels; level++) {
+
+		int cookedLevel = firstLevel + level;
+
+		// Upload directly from the mapped file
+		if (cooked.getFormat() == FORMAT_RGBA8) {
+
+			glTexImage2D(GL_TEXTURE_2D, level, GL_RGBA8, cooked.getLevelWidth(cookedLevel), cooked.getLevelHeight(cookedLevel),
+						 0, GL_RGBA, GL_UNSIGNED_BYTE, cooked.getLevelData(cookedLevel));
+		}
+		else {
+
+			glCompressedTexImage2D(GL_TEXTURE_2D, level, internalFormat, cooked.getLevelWidth(cookedLevel), cooked.getLevelHeight(cookedLevel),
+								   0, static_cast<GLsizei>(cooked.getLevelSize(cookedLevel)), cooked.getLevelData(cookedLevel));
+		}
+
+		sizeInBytes += cooked.getLevelSize(cookedLevel);
+	}
+
+	firstResidentLevel = firstLevel;
+
+	stats.residentBytes += sizeInBytes;
+	stats.peakResidentBytes = std::max(stats.peakResidentBytes, stats.residentBytes);
+
+} // end uploadCookedLevels
+
+
+bool Texture::setFirstResidentLevel(int level)
+{
+	CookedTexture cooked;
+
+	if (!streamable || !cooked.open(getCookedFileName(fileName, usage))) {
+		return false;
+	}
+
+	bool droppedBefore = firstResidentLevel > 0;
+
+	// Respecifying the levels of the same texture object keeps its identifier
+	// valid for all of the materials that use it.
+	glBindTexture(GL_TEXTURE_2D, this->textureID.get());
+	uploadCookedLevels(cooked, level);
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	bool droppedAfter = firstResidentLevel > 0;
+
+	if (droppedBefore != droppedAfter) {
+		texturesWithDroppedLevels += droppedAfter ? 1 : -1;
+	}
+
+	if (VERBOSE) cout << fileName << " first resident mip level " << firstResidentLevel << " bytes " << sizeInBytes << endl;
+
+	return true;
 
-bool Texture::load(const std::string& fileName)
+} // end setFirstResidentLevel
+
+
+bool Texture::canDropMipLevel() const
+{
+	int nextWidth = std::max(1, width >> (firstResidentLevel + 1));
+	int nextHeight = std::max(1, height >> (firstResidentLevel + 1));
+
+	return streamable && firstResidentLevel + 1 < mipLevels &&
+		   std::max(nextWidth, nextHeight) >= MIN_STREAMED_TEXTURE_SIZE;
+
+} // end canDropMipLevel
+
+
+bool Texture::load(const std::string& fileName, TEXTURE_USAGE usage)
 {	
+	if (compressionEnabled) {
+
+		if (loadCompressed(fileName, usage)) {
+			return true;
+		}
+
+		std::cerr << "WARNING: Unable to load compressed " << fileName << ". Loading uncompressed texture." << std::endl;
+	}
+
 	// Passing true to this function will cause it to output images the way OpenGL expects
 	stbi_set_flip_vertically_on_load(true);
 	
-	int width = 0, height = 0, nrChannels;
-	unsigned char* data = stbi_load(fileName.c_str(), &width, &height, &nrChannels, 0);
+	int nrChannels;
+	unsigned char* data = stbi_load(fileName.c_str(), &this->width, &this->height, &nrChannels, 0);
 
 	// Check bitmap parameters to determine is a valid image was loaded
 	if (data == nullptr || width == 0 || height == 0) {
@@ -26,10 +197,10 @@ bool Texture::load(const std::string& fileName)
 
 	if (VERBOSE) cout << fileName.c_str() << " number of channels " << nrChannels << endl;
 
-	glGenTextures(1, &this->textureID);
+	this->textureID = GpuTexture::create(GL_TEXTURE_2D);
 
 	// Assign texture to ID
-	glBindTexture(GL_TEXTURE_2D, this->textureID);
+	glBindTexture(GL_TEXTURE_2D, this->textureID.get());
 
 	if (nrChannels == 3) {
 
@@ -50,38 +221,71 @@ bool Texture::load(const std::string& fileName)
 
 	glGenerateMipmap(GL_TEXTURE_2D);
 
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	setSamplingParameters();
 
 	glBindTexture(GL_TEXTURE_2D, 0);
 
 	stbi_image_free(data);
 
+	// Account for the memory used by the full mip chain
+	this->internalFormat = GL_RGBA8;
+	this->mipLevels = 0;
+	this->sizeInBytes = 0;
+
+	for (int w = width, h = height; ; w = std::max(1, w / 2), h = std::max(1, h / 2)) {
+
+		mipLevels++;
+		sizeInBytes += static_cast<size_t>(w) * h * 4;
+
+		if (w == 1 && h == 1) break;
+	}
+
+	stats.residentBytes += sizeInBytes;
+	stats.peakResidentBytes = std::max(stats.peakResidentBytes, stats.residentBytes);
+
 	return true;
 
 } // end load
 
 
+void Texture::setSamplingParameters()
+{
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+} // end setSamplingParameters
+
+
 void Texture::unload()
 {
-	// Remove the Texture object from the Map
-	loadedTextures.erase(fileName);
+	if (!textureID) {
+		return;
+	}
 
 	// Delete the texture object
-	glDeleteTextures(1, &textureID);
+	textureID.reset();
+
+	if (firstResidentLevel > 0) {
+		texturesWithDroppedLevels--;
+	}
+
+	stats.residentBytes -= sizeInBytes;
+	stats.residentTextures--;
+	sizeInBytes = 0;
 
 } // end unload
 
 
-Texture* Texture::GetTexture(const std::string& fileName)
+std::shared_ptr<Texture> Texture::GetTexture(const std::string& fileName, TEXTURE_USAGE usage)
 {
 	// Pointer to the texture to be loaded or retrieved.
-	Texture* texturePtr = nullptr;
+	std::shared_ptr<Texture> texturePtr;
 
-	// Search for the texture among those that were previously loaded
-	auto iter = loadedTextures.find(fileName);
+	// Search for the texture among those that were previously loaded. A file
+	// loaded for another usage is loaded again in the format of this usage.
+	auto iter = loadedTextures.find(std::make_pair(fileName, usage));
 
 	// Check if the texture was previously loaded
 	if (iter != loadedTextures.end()) {
@@ -92,22 +296,30 @@ Texture* Texture::GetTexture(const std::string& fileName)
 	else {
 
 		if (VERBOSE) std::cout << "Loading texture: " << fileName << std::endl;
-		texturePtr = new Texture();
+
+		// The constructor is protected so make_shared can not be used
+		texturePtr = std::shared_ptr<Texture>(new Texture());
 
 		texturePtr->fileName = fileName;
+		texturePtr->usage = usage;
 
 		// Load the texture
-		if (texturePtr->load(fileName)) {
+		if (texturePtr->load(fileName, usage)) {
 
 			// Add the loaded texture to those that were previously loaded
-			loadedTextures.emplace(fileName, texturePtr);
+			loadedTextures.emplace(std::make_pair(fileName, usage), texturePtr);
+			stats.residentTextures++;
 		}
 		else {
-			delete texturePtr;
 			texturePtr = nullptr;
 		}
 	}
 
+	// A texture that was just loaded or retrieved counts as recently used
+	if (texturePtr != nullptr) {
+		texturePtr->touch();
+	}
+
 	return texturePtr;
 
 } // end GetTexture
@@ -115,10 +327,101 @@ Texture* Texture::GetTexture(const std::string& fileName)
 
 void Texture::unloadTextures()
 {
-	// Destroy textures
-	for (auto i : loadedTextures) {
+	// Delete all of the texture objects before clearing the map. Textures that
+	// are still referenced by materials are destroyed when the last reference is.
+	for (auto& i : loadedTextures) {
 		i.second->unload();
 	}
 	loadedTextures.clear();
 
 } // end unloadTextures
+
+
+void Texture::updateResidency()
+{
+	currentFrame++;
+
+	if (stats.residentBytes > memoryBudget) {
+
+		// Order the textures from least to most recently used
+		std::vector<decltype(loadedTextures)::iterator> leastRecentlyUsed;
+
+		for (auto iter = loadedTextures.begin(); iter != loadedTextures.end(); iter++) {
+			leastRecentlyUsed.push_back(iter);
+		}
+
+		std::sort(leastRecentlyUsed.begin(), leastRecentlyUsed.end(),
+			[](const auto& a, const auto& b) { return a->second->lastUsedFrame < b->second->lastUsedFrame; });
+
+		// Evict textures that are only referenced by the map
+		for (auto& iter : leastRecentlyUsed) {
+
+			if (stats.residentBytes <= memoryBudget) {
+				break;
+			}
+
+			if (iter->second.use_count() == 1) {
+
+				if (VERBOSE) cout << "Evicting texture: " << iter->first.first << endl;
+
+				iter->second->unload();
+
+				// Erasing does not invalidate iterators to the other elements
+				loadedTextures.erase(iter);
+				iter = loadedTextures.end();
+				stats.evictions++;
+			}
+		}
+
+		// Drop the largest mip level of textures that are still in use, one
+		// level per texture per pass, until the textures fit in the budget.
+		bool levelDropped = true;
+
+		while (stats.residentBytes > memoryBudget && levelDropped) {
+
+			levelDropped = false;
+
+			for (auto& iter : leastRecentlyUsed) {
+
+				if (stats.residentBytes <= memoryBudget) {
+					break;
+				}
+
+				if (iter != loadedTextures.end() && iter->second->canDropMipLevel() &&
+					iter->second->setFirstResidentLevel(iter->second->firstResidentLevel + 1)) {
+
+					stats.mipLevelsDropped++;
+					levelDropped = true;
+				}
+			}
+		}
+	}
+	else if (texturesWithDroppedLevels > 0) {
+
+		// Restore one level per frame of the most recently used texture that
+		// has dropped levels to spread the cost of uploads over several frames.
+		Texture* mostRecentlyUsed = nullptr;
+
+		for (auto& i : loadedTextures) {
+
+			if (i.second->firstResidentLevel > 0 &&
+				(mostRecentlyUsed == nullptr || i.second->lastUsedFrame > mostRecentlyUsed->lastUsedFrame)) {
+
+				mostRecentlyUsed = i.second.get();
+			}
+		}
+
+		if (mostRecentlyUsed != nullptr) {
+
+			// Restoring a level roughly quadruples the memory used by a texture
+			size_t restoredBytes = mostRecentlyUsed->sizeInBytes * 4;
+
+			if (stats.residentBytes - mostRecentlyUsed->sizeInBytes + restoredBytes <= memoryBudget * RESTORE_BUDGET_FRACTION &&
+				mostRecentlyUsed->setFirstResidentLevel(mostRecentlyUsed->firstResidentLevel - 1)) {
+
+				stats.mipLevelsRestored++;
+			}
+		}
+	}
+
+} // end updateResidency
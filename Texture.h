@@ -1,25 +1,90 @@
 #pragma once
 
-#include <unordered_map>
+#include <map>
 
 #include "MathLibsConstsFuncs.h"
+#include "GpuResource.h"
+#include "TextureCompression.h"
 
 using namespace constants_and_types;
 
+// Default limit on the memory used by all loaded textures (512 MB)
+static const size_t DEFAULT_TEXTURE_MEMORY_BUDGET = 512 * 1024 * 1024;
+
+// Mip levels are not dropped once the largest dimension of a texture reaches this size
+static const int MIN_STREAMED_TEXTURE_SIZE = 64;
+
+/**
+ * @struct	TextureStats
+ *
+ * @brief	Statistics on the memory used by textures and the work done by the
+ * 			residency manager to stay within the memory budget.
+ */
+struct TextureStats {
+
+	/** @brief	Memory used by all resident mip levels of all loaded textures */
+	size_t residentBytes = 0;
+
+	/** @brief	Highest value of residentBytes */
+	size_t peakResidentBytes = 0;
+
+	/** @brief	Number of loaded textures */
+	int residentTextures = 0;
+
+	/** @brief	Number of unreferenced textures that were unloaded */
+	int evictions = 0;
+
+	/** @brief	Number of mip levels dropped/restored to stay within the budget */
+	int mipLevelsDropped = 0;
+	int mipLevelsRestored = 0;
+
+}; // end TextureStats
+
 class Texture
 {
 public:
 
 	/**
-	 * @fn	static Texture* Texture::GetTexture(const std::string& fileName);
+	 * @fn	static std::shared_ptr<Texture> Texture::GetTexture(const std::string& fileName, TEXTURE_USAGE usage = COLOR_TEXTURE);
+	 *
+	 * @brief	Load a texture or retrieves it if it was loaded previously. When
+	 * 			compression is enabled the texture is loaded from the cooked asset
+	 * 			cache. It is cooked first if the cooked copy is missing or older than
+	 * 			the source image.
 	 *
-	 * @brief	Load a texture or retrieves it if it was loaded previously
+	 * 			The returned pointer is a reference to the texture. Textures that are
+	 * 			not referenced outside of the cache can be unloaded at any time to stay
+	 * 			within the memory budget, so the pointer must be kept (normally by a
+	 * 			Material) for as long as the texture object is used.
 	 *
 	 * @param	fileName	Contains the relative path and the name of the file.
+	 * @param	usage   	How the texture is used. Selects the compressed format.
 	 *
 	 * @returns	Null if it fails, else a pointer to the texture.
 	 */
-	static Texture* GetTexture(const std::string& fileName);
+	static std::shared_ptr<Texture> GetTexture(const std::string& fileName, TEXTURE_USAGE usage = COLOR_TEXTURE);
+
+	/**
+	 * @fn	static void Texture::setCompressionEnabled(bool enabled)
+	 *
+	 * @brief	Enables or disables loading of block compressed textures from the
+	 * 			cooked asset cache. Only affects textures that have not been loaded.
+	 *
+	 * @param	enabled	True to use cooked textures, false to upload source images.
+	 */
+	static void setCompressionEnabled(bool enabled) { compressionEnabled = enabled; }
+
+	/**
+	 * @fn	static std::string Texture::getCookedFileName(const std::string& fileName, TEXTURE_USAGE usage);
+	 *
+	 * @brief	Gets the name of the cooked file for a source image.
+	 *
+	 * @param	fileName	Contains the relative path and the name of the source image.
+	 * @param	usage   	How the texture is used.
+	 *
+	 * @returns	The relative path and name of the cooked file.
+	 */
+	static std::string getCookedFileName(const std::string& fileName, TEXTURE_USAGE usage);
 
 	/**
 	 * @fn	static void Texture::unloadTextures();
@@ -28,6 +93,46 @@ public:
 	 */
 	static void unloadTextures();
 
+	/**
+	 * @fn	static void Texture::setMemoryBudget(size_t bytes)
+	 *
+	 * @brief	Sets the amount of memory that loaded textures should use. The budget
+	 * 			is enforced by updateResidency.
+	 *
+	 * @param	bytes	The budget in bytes.
+	 */
+	static void setMemoryBudget(size_t bytes) { memoryBudget = bytes; }
+
+	/**
+	 * @fn	static size_t Texture::getMemoryBudget()
+	 *
+	 * @brief	Gets the amount of memory that loaded textures should use.
+	 *
+	 * @returns	The budget in bytes.
+	 */
+	static size_t getMemoryBudget() { return memoryBudget; }
+
+	/**
+	 * @fn	static void Texture::updateResidency();
+	 *
+	 * @brief	Should be called once per frame. If the resident textures are over
+	 * 			the memory budget, textures that are no longer referenced are unloaded
+	 * 			in least recently used order. If that is not enough, the largest mip
+	 * 			levels of the least recently used cooked textures are dropped. Dropped
+	 * 			levels are restored one at a time, most recently used texture first,
+	 * 			once there is room in the budget.
+	 */
+	static void updateResidency();
+
+	/**
+	 * @fn	static const TextureStats& Texture::getStats()
+	 *
+	 * @brief	Gets the texture memory statistics.
+	 *
+	 * @returns	The statistics.
+	 */
+	static const TextureStats& getStats() { return stats; }
+
 	/**
 	 * @fn	int Texture::getWidth() const
 	 *
@@ -50,19 +155,64 @@ public:
 	 * @fn	unsigned int Texture::getTextureObject( ) const
 	 *
 	 * @brief	Gets unsigned integer identifier of the OpenGL texture object.
+	 * 			The identifier does not change when mip levels are dropped or
+	 * 			restored.
 	 *
 	 * @returns	The texture object.
 	 */
-	GLuint getTextureObject() const { return textureID; }
+	GLuint getTextureObject() const { return textureID.get(); }
+
+	/**
+	 * @fn	GLenum Texture::getInternalFormat() const
+	 *
+	 * @brief	Gets the OpenGL internal format the texels are stored in.
+	 *
+	 * @returns	The internal format.
+	 */
+	GLenum getInternalFormat() const { return internalFormat; }
+
+	/**
+	 * @fn	int Texture::getMipLevels() const
+	 *
+	 * @brief	Gets the number of mip levels of the texture.
+	 *
+	 * @returns	The number of mip levels.
+	 */
+	int getMipLevels() const { return mipLevels; }
+
+	/**
+	 * @fn	int Texture::getFirstResidentLevel() const
+	 *
+	 * @brief	Gets the number of the largest mip levels that have been dropped to
+	 * 			stay within the memory budget.
+	 *
+	 * @returns	Zero if the full mip chain is resident.
+	 */
+	int getFirstResidentLevel() const { return firstResidentLevel; }
+
+	/**
+	 * @fn	size_t Texture::getSizeInBytes() const
+	 *
+	 * @brief	Gets the amount of memory used by the resident mip levels of the texture.
+	 *
+	 * @returns	The size in bytes.
+	 */
+	size_t getSizeInBytes() const { return sizeInBytes; }
+
+	/**
+	 * @fn	void Texture::touch()
+	 *
+	 * @brief	Marks the texture as used during the current frame. Called whenever
+	 * 			the texture is bound for rendering.
+	 */
+	void touch() { lastUsedFrame = currentFrame; }
 
 	/**
 	 * @fn	void Texture::unload();
 	 *
-	 * @brief	Deletes the texture object associated with this
-	 * 			texture. CURRENT IMPLEMENTATION DOES NOT ACCOUNT
-	 * 			MULTIPLE USES OF THE SAME TEXTURE BY DIFFERENT
-	 * 			SUB MESHES. UNLOADING IT HERE WILL REMOVE IT
-	 * 			FOR ALL SUBMESHES.
+	 * @brief	Deletes the texture object associated with this texture. The
+	 * 			texture remains in the map of loaded textures. Use unloadTextures
+	 * 			to remove all textures.
 	 */
 	void unload();
 
@@ -71,39 +221,130 @@ protected:
 	/**
 	 * @fn	Texture::Texture()
 	 *
-	 * @brief	Default constructor. Protected so that is not possible to 
+	 * @brief	Default constructor. Protected so that is not possible to
 	 * 			create Texture objects without them being added to an unordered
 	 * 			map containing all textures that have been loaded
 	 */
 	Texture() {}
 
 	/**
-	 * @fn	bool Texture::Load(const std::string& fileName);
+	 * @fn	bool Texture::Load(const std::string& fileName, TEXTURE_USAGE usage);
 	 *
 	 * @brief	Loads a texture image from the specified file name and
 	 * 			creates an associated texture object.
 	 *
 	 * @param	fileName	The name of the file containing the texture image.
+	 * @param	usage   	How the texture is used.
 	 *
 	 * @returns	True if it succeeds, false if it fails.
 	 */
-	bool load(const std::string& fileName);
+	bool load(const std::string& fileName, TEXTURE_USAGE usage);
 
+	/**
+	 * @fn	bool Texture::loadCompressed(const std::string& fileName, TEXTURE_USAGE usage);
+	 *
+	 * @brief	Uploads the pre-built mip chain of a cooked texture, cooking the
+	 * 			source image first if necessary.
+	 *
+	 * @param	fileName	The name of the file containing the source image.
+	 * @param	usage   	How the texture is used.
+	 *
+	 * @returns	True if it succeeds, false if the texture could not be cooked or
+	 * 			its format is not supported.
+	 */
+	bool loadCompressed(const std::string& fileName, TEXTURE_USAGE usage);
 
-	/** @brief	OpenGL ID of this texture */
-	unsigned int textureID = 0;
+	/**
+	 * @fn	void Texture::uploadCookedLevels(const class CookedTexture& cooked, int firstLevel);
+	 *
+	 * @brief	(Re)specifies the mip levels of the bound texture object from a cooked
+	 * 			texture, starting with firstLevel as level zero.
+	 *
+	 * @param	cooked	  	The opened cooked texture.
+	 * @param	firstLevel	The first level of the cooked texture that is resident.
+	 */
+	void uploadCookedLevels(const class CookedTexture& cooked, int firstLevel);
+
+	/**
+	 * @fn	bool Texture::setFirstResidentLevel(int level);
+	 *
+	 * @brief	Drops or restores the largest mip levels of a cooked texture.
+	 *
+	 * @param	level	The first level of the full mip chain that should be resident.
+	 *
+	 * @returns	True if it succeeds, false if the cooked file could not be opened.
+	 */
+	bool setFirstResidentLevel(int level);
+
+	/**
+	 * @fn	bool Texture::canDropMipLevel() const;
+	 *
+	 * @brief	Determines if the largest resident mip level can be dropped.
+	 *
+	 * @returns	True if the texture was cooked and is larger than MIN_STREAMED_TEXTURE_SIZE.
+	 */
+	bool canDropMipLevel() const;
+
+	/**
+	 * @fn	void Texture::setSamplingParameters();
+	 *
+	 * @brief	Sets the wrap and filter parameters of the bound texture.
+	 */
+	void setSamplingParameters();
+
+
+	/** @brief	OpenGL texture object. Deleted when the texture is unloaded or destroyed. */
+	GpuTexture textureID;
 
 	/** @brief	Filename and relative path of the texture file */
 	std::string  fileName;
 
+	/** @brief	How the texture is used in the shaders */
+	TEXTURE_USAGE usage = COLOR_TEXTURE;
+
 	/** @brief	Width/height of the texture */
 	int width = 0;
 	int height = 0;
 
-	/** @brief	Map of ALL textures that have been loaded. textures loaded */
-	static std::unordered_map<std::string, class Texture*> loadedTextures;
+	/** @brief	OpenGL internal format of the texels */
+	GLenum internalFormat = GL_RGBA8;
 
-};
+	/** @brief	Number of mip levels in the full mip chain */
+	int mipLevels = 0;
+
+	/** @brief	Level of the full mip chain that is resident as level zero */
+	int firstResidentLevel = 0;
+
+	/** @brief	Indicates the texture was loaded from the cooked asset cache and its
+	 * 			mip levels can be dropped and restored */
+	bool streamable = false;
+
+	/** @brief	Memory used by the resident mip levels */
+	size_t sizeInBytes = 0;
+
+	/** @brief	Frame in which the texture was last bound for rendering */
+	unsigned long long lastUsedFrame = 0;
+
+	/** @brief	Map of ALL textures that have been loaded, keyed by file and usage
+	 * 			since the usage selects the format. The map holds one reference to
+	 * 			each texture. */
+	static std::map<std::pair<std::string, TEXTURE_USAGE>, std::shared_ptr<Texture>> loadedTextures;
 
+	/** @brief	Indicates textures are loaded from the cooked asset cache */
+	static bool compressionEnabled;
+
+	/** @brief	Memory budget for all loaded textures */
+	static size_t memoryBudget;
+
+	/** @brief	Texture memory statistics */
+	static TextureStats stats;
+
+	/** @brief	Number of times updateResidency has been called */
+	static unsigned long long currentFrame;
+
+	/** @brief	Number of textures that have dropped mip levels */
+	static int texturesWithDroppedLevels;
+
+};
 
 
@@ -0,0 +1,683 @@
+#include "TextureCompression.h"
+
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <cstring>
+
+static const bool VERBOSE = false;
+
+// Number of power iterations used to find the principal axis of the
+// texel colors in a block
+static const int POWER_ITERATIONS = 8;
+
+// Interpolation weights for 4 bit BC7 indices
+static const int BC7_WEIGHTS[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+
+//********************* Block encoding helpers *****************************************
+
+// Finds the mean and the direction of greatest variance of a set of points
+// with dims (3 or 4) components. The axis is left as the zero vector if all
+// of the points are the same.
+static void findPrincipalAxis(const float points[][4], int count, int dims, float mean[4], float axis[4])
+{
+	for (int c = 0; c < 4; c++) {
+		mean[c] = 0.0f;
+		axis[c] = 0.0f;
+	}
+
+	for (int i = 0; i < count; i++) {
+		for (int c = 0; c < dims; c++) {
+			mean[c] += points[i][c];
+		}
+	}
+
+	for (int c = 0; c < dims; c++) {
+		mean[c] /= count;
+	}
+
+	float covariance[4][4] = {};
+
+	for (int i = 0; i < count; i++) {
+		for (int r = 0; r < dims; r++) {
+			for (int c = 0; c < dims; c++) {
+				covariance[r][c] += (points[i][r] - mean[r]) * (points[i][c] - mean[c]);
+			}
+		}
+	}
+
+	// Start the power iteration with the column of the channel that varies the most
+	int largest = 0;
+	for (int c = 1; c < dims; c++) {
+		if (covariance[c][c] > covariance[largest][largest]) {
+			largest = c;
+		}
+	}
+
+	for (int c = 0; c < dims; c++) {
+		axis[c] = covariance[c][largest];
+	}
+
+	for (int iteration = 0; iteration < POWER_ITERATIONS; iteration++) {
+
+		float next[4] = {};
+		float largestComponent = 0.0f;
+
+		for (int r = 0; r < dims; r++) {
+			for (int c = 0; c < dims; c++) {
+				next[r] += covariance[r][c] * axis[c];
+			}
+			largestComponent = std::max(largestComponent, std::fabs(next[r]));
+		}
+
+		if (largestComponent < 1e-6f) {
+			break;
+		}
+
+		for (int c = 0; c < dims; c++) {
+			axis[c] = next[c] / largestComponent;
+		}
+	}
+
+	float length = 0.0f;
+	for (int c = 0; c < dims; c++) {
+		length += axis[c] * axis[c];
+	}
+	length = std::sqrt(length);
+
+	for (int c = 0; c < dims; c++) {
+		axis[c] = length > 1e-6f ? axis[c] / length : 0.0f;
+	}
+
+} // end findPrincipalAxis
+
+// Projects the points onto a line through the mean to find the extent of the points
+static void findProjectionRange(const float points[][4], int count, int dims, const float mean[4],
+								const float axis[4], float& minProjection, float& maxProjection)
+{
+	minProjection = POS_INFINITY;
+	maxProjection = NEG_INFINITY;
+
+	for (int i = 0; i < count; i++) {
+
+		float projection = 0.0f;
+		for (int c = 0; c < dims; c++) {
+			projection += (points[i][c] - mean[c]) * axis[c];
+		}
+
+		minProjection = std::min(minProjection, projection);
+		maxProjection = std::max(maxProjection, projection);
+	}
+
+} // end findProjectionRange
+
+static unsigned short packRGB565(const float rgb[3])
+{
+	int r = glm::clamp(static_cast<int>(rgb[0] * 31.0f / 255.0f + 0.5f), 0, 31);
+	int g = glm::clamp(static_cast<int>(rgb[1] * 63.0f / 255.0f + 0.5f), 0, 63);
+	int b = glm::clamp(static_cast<int>(rgb[2] * 31.0f / 255.0f + 0.5f), 0, 31);
+
+	return static_cast<unsigned short>((r << 11) | (g << 5) | b);
+
+} // end packRGB565
+
+static void unpackRGB565(unsigned short color, int rgb[3])
+{
+	int r = (color >> 11) & 31;
+	int g = (color >> 5) & 63;
+	int b = color & 31;
+
+	// Replicate the high bits into the low bits to expand to eight bits
+	rgb[0] = (r << 3) | (r >> 2);
+	rgb[1] = (g << 2) | (g >> 4);
+	rgb[2] = (b << 3) | (b >> 2);
+
+} // end unpackRGB565
+
+// Writes bit fields into a block starting with the least significant
+// bit of the first byte (the bit order used by BC7).
+struct BlockBitWriter {
+
+	unsigned char* block;
+	int position = 0;
+
+	BlockBitWriter(unsigned char* block) : block(block) {}
+
+	void write(unsigned int value, int bitCount)
+	{
+		for (int b = 0; b < bitCount; b++) {
+
+			if ((value >> b) & 1) {
+				block[position >> 3] |= static_cast<unsigned char>(1 << (position & 7));
+			}
+			position++;
+		}
+	}
+};
+
+// Quantizes an RGBA endpoint to 7 bits per channel plus a shared p-bit,
+// choosing the p-bit that produces the smallest error.
+static void quantizeBC7Endpoint(const float endpoint[4], int quantized[4], int& pBit)
+{
+	int bestError = INT_MAX;
+
+	for (int p = 0; p < 2; p++) {
+
+		int candidate[4];
+		int error = 0;
+
+		for (int c = 0; c < 4; c++) {
+
+			int value = glm::clamp(static_cast<int>(endpoint[c] + 0.5f), 0, 255);
+			candidate[c] = glm::clamp((value - p + 1) / 2, 0, 127);
+
+			int difference = ((candidate[c] << 1) | p) - value;
+			error += difference * difference;
+		}
+
+		if (error < bestError) {
+
+			bestError = error;
+			pBit = p;
+			memcpy(quantized, candidate, sizeof(candidate));
+		}
+	}
+
+} // end quantizeBC7Endpoint
+
+
+//********************* Block encoders *****************************************
+
+void TextureCompression::encodeBC1Block(const unsigned char* texels, unsigned char* block)
+{
+	float points[16][4];
+
+	for (int i = 0; i < 16; i++) {
+		for (int c = 0; c < 3; c++) {
+			points[i][c] = texels[i * 4 + c];
+		}
+		points[i][3] = 0.0f;
+	}
+
+	float mean[4], axis[4];
+	findPrincipalAxis(points, 16, 3, mean, axis);
+
+	float minProjection, maxProjection;
+	findProjectionRange(points, 16, 3, mean, axis, minProjection, maxProjection);
+
+	// Inset the endpoints slightly. Reduces the average error because the
+	// extreme colors are rarely exactly on the line.
+	float inset = (maxProjection - minProjection) / 16.0f;
+	minProjection += inset;
+	maxProjection -= inset;
+
+	float endpoint0[3], endpoint1[3];
+	for (int c = 0; c < 3; c++) {
+		endpoint0[c] = mean[c] + axis[c] * maxProjection;
+		endpoint1[c] = mean[c] + axis[c] * minProjection;
+	}
+
+	unsigned short color0 = packRGB565(endpoint0);
+	unsigned short color1 = packRGB565(endpoint1);
+
+	// color0 > color1 selects the four color (opaque) mode
+	if (color0 < color1) {
+		std::swap(color0, color1);
+	}
+
+	unsigned int indices = 0;
+
+	if (color0 != color1) {
+
+		int palette[4][3];
+		unpackRGB565(color0, palette[0]);
+		unpackRGB565(color1, palette[1]);
+
+		for (int c = 0; c < 3; c++) {
+			palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+			palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+		}
+
+		for (int i = 0; i < 16; i++) {
+
+			int bestIndex = 0;
+			int bestError = INT_MAX;
+
+			for (int p = 0; p < 4; p++) {
+
+				int error = 0;
+				for (int c = 0; c < 3; c++) {
+					int difference = texels[i * 4 + c] - palette[p][c];
+					error += difference * difference;
+				}
+
+				if (error < bestError) {
+					bestError = error;
+					bestIndex = p;
+				}
+			}
+
+			indices |= static_cast<unsigned int>(bestIndex) << (2 * i);
+		}
+	}
+
+	block[0] = static_cast<unsigned char>(color0 & 0xFF);
+	block[1] = static_cast<unsigned char>(color0 >> 8);
+	block[2] = static_cast<unsigned char>(color1 & 0xFF);
+	block[3] = static_cast<unsigned char>(color1 >> 8);
+
+	for (int b = 0; b < 4; b++) {
+		block[4 + b] = static_cast<unsigned char>((indices >> (8 * b)) & 0xFF);
+	}
+
+} // end encodeBC1Block
+
+
+void TextureCompression::encodeBC4Block(const unsigned char* texels, int channel, unsigned char* block)
+{
+	int minValue = 255;
+	int maxValue = 0;
+
+	for (int i = 0; i < 16; i++) {
+		minValue = std::min(minValue, static_cast<int>(texels[i * 4 + channel]));
+		maxValue = std::max(maxValue, static_cast<int>(texels[i * 4 + channel]));
+	}
+
+	// value0 > value1 selects the eight value interpolation mode
+	block[0] = static_cast<unsigned char>(maxValue);
+	block[1] = static_cast<unsigned char>(minValue);
+
+	unsigned long long indices = 0;
+
+	if (maxValue != minValue) {
+
+		int palette[8];
+		palette[0] = maxValue;
+		palette[1] = minValue;
+
+		for (int k = 1; k < 7; k++) {
+			palette[k + 1] = ((7 - k) * maxValue + k * minValue + 3) / 7;
+		}
+
+		for (int i = 0; i < 16; i++) {
+
+			int value = texels[i * 4 + channel];
+			int bestIndex = 0;
+			int bestError = INT_MAX;
+
+			for (int p = 0; p < 8; p++) {
+
+				int error = abs(value - palette[p]);
+
+				if (error < bestError) {
+					bestError = error;
+					bestIndex = p;
+				}
+			}
+
+			indices |= static_cast<unsigned long long>(bestIndex) << (3 * i);
+		}
+	}
+
+	for (int b = 0; b < 6; b++) {
+		block[2 + b] = static_cast<unsigned char>((indices >> (8 * b)) & 0xFF);
+	}
+
+} // end encodeBC4Block
+
+
+void TextureCompression::encodeBC3Block(const unsigned char* texels, unsigned char* block)
+{
+	// Alpha is stored in a BC4 block followed by a BC1 color block
+	encodeBC4Block(texels, 3, block);
+	encodeBC1Block(texels, block + 8);
+
+} // end encodeBC3Block
+
+
+void TextureCompression::encodeBC5Block(const unsigned char* texels, unsigned char* block)
+{
+	// Two independent BC4 blocks for the red and green channels
+	encodeBC4Block(texels, 0, block);
+	encodeBC4Block(texels, 1, block + 8);
+
+} // end encodeBC5Block
+
+
+void TextureCompression::encodeBC7Block(const unsigned char* texels, unsigned char* block)
+{
+	// Mode 6: a single subset with RGBA endpoints (7 bits per channel plus a
+	// p-bit per endpoint) and 4 bit indices. Handles both opaque and
+	// transparent blocks.
+	float points[16][4];
+
+	for (int i = 0; i < 16; i++) {
+		for (int c = 0; c < 4; c++) {
+			points[i][c] = texels[i * 4 + c];
+		}
+	}
+
+	float mean[4], axis[4];
+	findPrincipalAxis(points, 16, 4, mean, axis);
+
+	float minProjection, maxProjection;
+	findProjectionRange(points, 16, 4, mean, axis, minProjection, maxProjection);
+
+	float inset = (maxProjection - minProjection) / 32.0f;
+	minProjection += inset;
+	maxProjection -= inset;
+
+	float endpoint0[4], endpoint1[4];
+	for (int c = 0; c < 4; c++) {
+		endpoint0[c] = mean[c] + axis[c] * minProjection;
+		endpoint1[c] = mean[c] + axis[c] * maxProjection;
+	}
+
+	int quantized0[4], quantized1[4];
+	int pBit0 = 0, pBit1 = 0;
+	quantizeBC7Endpoint(endpoint0, quantized0, pBit0);
+	quantizeBC7Endpoint(endpoint1, quantized1, pBit1);
+
+	int palette[16][4];
+	for (int c = 0; c < 4; c++) {
+
+		int e0 = (quantized0[c] << 1) | pBit0;
+		int e1 = (quantized1[c] << 1) | pBit1;
+
+		for (int p = 0; p < 16; p++) {
+			palette[p][c] = ((64 - BC7_WEIGHTS[p]) * e0 + BC7_WEIGHTS[p] * e1 + 32) >> 6;
+		}
+	}
+
+	int indices[16];
+	for (int i = 0; i < 16; i++) {
+
+		int bestError = INT_MAX;
+		indices[i] = 0;
+
+		for (int p = 0; p < 16; p++) {
+
+			int error = 0;
+			for (int c = 0; c < 4; c++) {
+				int difference = texels[i * 4 + c] - palette[p][c];
+				error += difference * difference;
+			}
+
+			if (error < bestError) {
+				bestError = error;
+				indices[i] = p;
+			}
+		}
+	}
+
+	// The most significant bit of the first (anchor) index is implicitly zero.
+	// Swap the endpoints if necessary to make that true.
+	if (indices[0] & 8) {
+
+		for (int c = 0; c < 4; c++) {
+			std::swap(quantized0[c], quantized1[c]);
+		}
+		std::swap(pBit0, pBit1);
+
+		for (int i = 0; i < 16; i++) {
+			indices[i] = 15 - indices[i];
+		}
+	}
+
+	memset(block, 0, 16);
+	BlockBitWriter writer(block);
+
+	// Mode 6 is signaled by six zero bits followed by a one
+	writer.write(1 << 6, 7);
+
+	for (int c = 0; c < 4; c++) {
+		writer.write(quantized0[c], 7);
+		writer.write(quantized1[c], 7);
+	}
+
+	writer.write(pBit0, 1);
+	writer.write(pBit1, 1);
+
+	writer.write(indices[0], 3);
+	for (int i = 1; i < 16; i++) {
+		writer.write(indices[i], 4);
+	}
+
+} // end encodeBC7Block
+
+
+//********************* Public interface *****************************************
+
+TEXTURE_FORMAT TextureCompression::chooseFormat(TEXTURE_USAGE usage, bool hasAlpha)
+{
+	switch (usage) {
+
+	case NORMAL_MAP_TEXTURE:
+		return FORMAT_BC5;
+
+	case SINGLE_CHANNEL_TEXTURE:
+		return FORMAT_BC4;
+
+	default:
+
+		if (hasAlpha == false) {
+
+			if (isSupported(FORMAT_BC1)) return FORMAT_BC1;
+			if (isSupported(FORMAT_BC7)) return FORMAT_BC7;
+		}
+		else {
+
+			if (isSupported(FORMAT_BC7)) return FORMAT_BC7;
+			if (isSupported(FORMAT_BC3)) return FORMAT_BC3;
+		}
+	}
+
+	return FORMAT_RGBA8;
+
+} // end chooseFormat
+
+
+bool TextureCompression::isSupported(TEXTURE_FORMAT format)
+{
+	// RGTC (BC4 and BC5) is core since OpenGL 3.0. S3TC (BC1 and BC3) and
+	// BPTC (BC7) are checked because they are not available on all drivers.
+	switch (format) {
+
+	case FORMAT_BC1:
+	case FORMAT_BC3:
+		return GLEW_EXT_texture_compression_s3tc == GL_TRUE;
+
+	case FORMAT_BC7:
+		return GLEW_ARB_texture_compression_bptc == GL_TRUE;
+
+	default:
+		return true;
+	}
+
+} // end isSupported
+
+
+GLenum TextureCompression::getInternalFormat(TEXTURE_FORMAT format)
+{
+	switch (format) {
+
+	case FORMAT_BC1: return GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+	case FORMAT_BC3: return GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+	case FORMAT_BC4: return GL_COMPRESSED_RED_RGTC1;
+	case FORMAT_BC5: return GL_COMPRESSED_RG_RGTC2;
+	case FORMAT_BC7: return GL_COMPRESSED_RGBA_BPTC_UNORM;
+	default: return GL_RGBA8;
+	}
+
+} // end getInternalFormat
+
+
+int TextureCompression::getBlockSize(TEXTURE_FORMAT format)
+{
+	switch (format) {
+
+	case FORMAT_BC1:
+	case FORMAT_BC4:
+		return 8;
+
+	case FORMAT_BC3:
+	case FORMAT_BC5:
+	case FORMAT_BC7:
+		return 16;
+
+	default:
+		return 0;
+	}
+
+} // end getBlockSize
+
+
+size_t TextureCompression::getLevelSize(TEXTURE_FORMAT format, int width, int height)
+{
+	int blockSize = getBlockSize(format);
+
+	if (blockSize == 0) {
+
+		return static_cast<size_t>(width) * height * 4;
+	}
+
+	return static_cast<size_t>((width + 3) / 4) * ((height + 3) / 4) * blockSize;
+
+} // end getLevelSize
+
+
+bool TextureCompression::hasAlpha(const unsigned char* rgba, int width, int height)
+{
+	size_t texelCount = static_cast<size_t>(width) * height;
+
+	for (size_t i = 0; i < texelCount; i++) {
+
+		if (rgba[i * 4 + 3] != 255) {
+			return true;
+		}
+	}
+
+	return false;
+
+} // end hasAlpha
+
+
+std::vector<MipLevel> TextureCompression::buildMipChain(const unsigned char* rgba, int width, int height, TEXTURE_USAGE usage)
+{
+	std::vector<MipLevel> levels;
+
+	MipLevel base;
+	base.width = width;
+	base.height = height;
+	base.data.assign(rgba, rgba + static_cast<size_t>(width) * height * 4);
+	levels.push_back(std::move(base));
+
+	while (levels.back().width > 1 || levels.back().height > 1) {
+
+		const MipLevel& source = levels.back();
+
+		MipLevel next;
+		next.width = std::max(1, source.width / 2);
+		next.height = std::max(1, source.height / 2);
+		next.data.resize(static_cast<size_t>(next.width) * next.height * 4);
+
+		for (int y = 0; y < next.height; y++) {
+
+			int y0 = std::min(2 * y, source.height - 1);
+			int y1 = std::min(2 * y + 1, source.height - 1);
+
+			for (int x = 0; x < next.width; x++) {
+
+				int x0 = std::min(2 * x, source.width - 1);
+				int x1 = std::min(2 * x + 1, source.width - 1);
+
+				const unsigned char* t[4] = {
+					&source.data[(static_cast<size_t>(y0) * source.width + x0) * 4],
+					&source.data[(static_cast<size_t>(y0) * source.width + x1) * 4],
+					&source.data[(static_cast<size_t>(y1) * source.width + x0) * 4],
+					&source.data[(static_cast<size_t>(y1) * source.width + x1) * 4] };
+
+				unsigned char* destination = &next.data[(static_cast<size_t>(y) * next.width + x) * 4];
+
+				if (usage == NORMAL_MAP_TEXTURE) {
+
+					// Average the normal vectors and renormalize
+					vec3 normal(0.0f);
+					for (int i = 0; i < 4; i++) {
+						normal += vec3(t[i][0], t[i][1], t[i][2]) / 127.5f - vec3(1.0f);
+					}
+
+					normal = glm::length(normal) > 0.0f ? glm::normalize(normal) : UNIT_Z_V3;
+
+					for (int c = 0; c < 3; c++) {
+						destination[c] = static_cast<unsigned char>(glm::clamp((normal[c] + 1.0f) * 127.5f + 0.5f, 0.0f, 255.0f));
+					}
+					destination[3] = static_cast<unsigned char>((t[0][3] + t[1][3] + t[2][3] + t[3][3] + 2) / 4);
+				}
+				else {
+
+					for (int c = 0; c < 4; c++) {
+						destination[c] = static_cast<unsigned char>((t[0][c] + t[1][c] + t[2][c] + t[3][c] + 2) / 4);
+					}
+				}
+			}
+		}
+
+		levels.push_back(std::move(next));
+	}
+
+	if (VERBOSE) cout << "Built " << levels.size() << " mip levels for " << width << "x" << height << " image" << endl;
+
+	return levels;
+
+} // end buildMipChain
+
+
+std::vector<unsigned char> TextureCompression::compress(const MipLevel& level, TEXTURE_FORMAT format)
+{
+	int blockSize = getBlockSize(format);
+
+	if (blockSize == 0) {
+		return level.data;
+	}
+
+	int blocksWide = (level.width + 3) / 4;
+	int blocksHigh = (level.height + 3) / 4;
+
+	std::vector<unsigned char> blocks(static_cast<size_t>(blocksWide) * blocksHigh * blockSize);
+
+	unsigned char texels[64];
+
+	for (int by = 0; by < blocksHigh; by++) {
+		for (int bx = 0; bx < blocksWide; bx++) {
+
+			// Gather the 4x4 block. Texels beyond the edge repeat the edge texels.
+			for (int y = 0; y < 4; y++) {
+
+				int sy = std::min(by * 4 + y, level.height - 1);
+
+				for (int x = 0; x < 4; x++) {
+
+					int sx = std::min(bx * 4 + x, level.width - 1);
+					memcpy(&texels[(y * 4 + x) * 4], &level.data[(static_cast<size_t>(sy) * level.width + sx) * 4], 4);
+				}
+			}
+
+			unsigned char* block = &blocks[(static_cast<size_t>(by) * blocksWide + bx) * blockSize];
+
+			switch (format) {
+
+			case FORMAT_BC1: encodeBC1Block(texels, block); break;
+			case FORMAT_BC3: encodeBC3Block(texels, block); break;
+			case FORMAT_BC4: encodeBC4Block(texels, 0, block); break;
+			case FORMAT_BC5: encodeBC5Block(texels, block); break;
+			case FORMAT_BC7: encodeBC7Block(texels, block); break;
+			default: break;
+			}
+		}
+	}
+
+	return blocks;
+
+} // end compress
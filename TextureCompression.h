@@ -0,0 +1,164 @@
+#pragma once
+
+#include <vector>
+
+#include "MathLibsConstsFuncs.h"
+
+using namespace constants_and_types;
+
+/**
+ * @enum	TEXTURE_USAGE
+ *
+ * @brief	How the texels of a texture will be interpreted in the shaders. Determines
+ * 			which block compressed format is selected and how mip levels are filtered.
+ */
+enum TEXTURE_USAGE { COLOR_TEXTURE = 0, NORMAL_MAP_TEXTURE, SINGLE_CHANNEL_TEXTURE };
+
+/**
+ * @enum	TEXTURE_FORMAT
+ *
+ * @brief	Storage formats for cooked textures. All formats other than FORMAT_RGBA8
+ * 			are block compressed formats that store 4x4 blocks of texels in either
+ * 			8 bytes (BC1, BC4) or 16 bytes (BC3, BC5, BC7).
+ */
+enum TEXTURE_FORMAT { FORMAT_RGBA8 = 0, FORMAT_BC1, FORMAT_BC3, FORMAT_BC4, FORMAT_BC5, FORMAT_BC7 };
+
+/**
+ * @struct	MipLevel
+ *
+ * @brief	One level of a mip chain. Texels are stored in rows from bottom to top
+ * 			(the order OpenGL expects).
+ */
+struct MipLevel {
+
+	int width = 0;
+
+	int height = 0;
+
+	std::vector<unsigned char> data;
+
+}; // end MipLevel
+
+/**
+ * @class	TextureCompression
+ *
+ * @brief	Static class containing the CPU encoders that are run when textures are
+ * 			cooked. Builds complete mip chains and compresses each level into one of
+ * 			the GPU block compressed formats so that textures can be uploaded with
+ * 			glCompressedTexImage2D without any processing at load time.
+ */
+class TextureCompression
+{
+public:
+
+	/**
+	 * @fn	static TEXTURE_FORMAT TextureCompression::chooseFormat(TEXTURE_USAGE usage, bool hasAlpha);
+	 *
+	 * @brief	Selects the best compressed format that is supported by the OpenGL
+	 * 			context. Opaque color textures use BC1, color textures with alpha use
+	 * 			BC7 (BC3 if BPTC is not supported), normal maps use BC5 (RGTC2) and
+	 * 			single channel textures use BC4 (RGTC1).
+	 *
+	 * @param	usage   	How the texture is used.
+	 * @param	hasAlpha	True if any texel is not fully opaque.
+	 *
+	 * @returns	The format. FORMAT_RGBA8 if no suitable compressed format is supported.
+	 */
+	static TEXTURE_FORMAT chooseFormat(TEXTURE_USAGE usage, bool hasAlpha);
+
+	/**
+	 * @fn	static bool TextureCompression::isSupported(TEXTURE_FORMAT format);
+	 *
+	 * @brief	Determines if the OpenGL context can sample textures stored in a format.
+	 * 			Textures cooked on another machine may use a format that is not supported.
+	 *
+	 * @param	format	The texture format.
+	 *
+	 * @returns	True if the format is supported.
+	 */
+	static bool isSupported(TEXTURE_FORMAT format);
+
+	/**
+	 * @fn	static GLenum TextureCompression::getInternalFormat(TEXTURE_FORMAT format);
+	 *
+	 * @brief	Gets the OpenGL internal format that corresponds to a texture format.
+	 *
+	 * @param	format	The texture format.
+	 *
+	 * @returns	The internal format.
+	 */
+	static GLenum getInternalFormat(TEXTURE_FORMAT format);
+
+	/**
+	 * @fn	static int TextureCompression::getBlockSize(TEXTURE_FORMAT format);
+	 *
+	 * @brief	Gets the size in bytes of a 4x4 block of texels.
+	 *
+	 * @param	format	The texture format.
+	 *
+	 * @returns	The block size in bytes. Zero for uncompressed formats.
+	 */
+	static int getBlockSize(TEXTURE_FORMAT format);
+
+	/**
+	 * @fn	static size_t TextureCompression::getLevelSize(TEXTURE_FORMAT format, int width, int height);
+	 *
+	 * @brief	Gets the size in bytes of a single mip level.
+	 *
+	 * @param	format	The texture format.
+	 * @param	width 	The width of the level in texels.
+	 * @param	height	The height of the level in texels.
+	 *
+	 * @returns	The size in bytes.
+	 */
+	static size_t getLevelSize(TEXTURE_FORMAT format, int width, int height);
+
+	/**
+	 * @fn	static std::vector<MipLevel> TextureCompression::buildMipChain(const unsigned char* rgba, int width, int height, TEXTURE_USAGE usage);
+	 *
+	 * @brief	Builds a complete mip chain (down to 1x1) from an RGBA8 image using a
+	 * 			box filter. Normal map levels are renormalized after filtering.
+	 *
+	 * @param	rgba  	Four bytes per texel image data.
+	 * @param	width 	The width of the image in texels.
+	 * @param	height	The height of the image in texels.
+	 * @param	usage 	How the texture is used.
+	 *
+	 * @returns	The mip levels. Level zero is a copy of the image.
+	 */
+	static std::vector<MipLevel> buildMipChain(const unsigned char* rgba, int width, int height, TEXTURE_USAGE usage);
+
+	/**
+	 * @fn	static std::vector<unsigned char> TextureCompression::compress(const MipLevel& level, TEXTURE_FORMAT format);
+	 *
+	 * @brief	Compresses an RGBA8 mip level. Levels whose dimensions are not
+	 * 			multiples of four are padded by repeating edge texels.
+	 *
+	 * @param	level 	The RGBA8 mip level.
+	 * @param	format	The compressed format.
+	 *
+	 * @returns	The compressed blocks in row major order.
+	 */
+	static std::vector<unsigned char> compress(const MipLevel& level, TEXTURE_FORMAT format);
+
+	/**
+	 * @fn	static bool TextureCompression::hasAlpha(const unsigned char* rgba, int width, int height);
+	 *
+	 * @brief	Determines if any texel of an RGBA8 image is not fully opaque.
+	 *
+	 * @returns	True if the alpha channel is used.
+	 */
+	static bool hasAlpha(const unsigned char* rgba, int width, int height);
+
+protected:
+
+	// Block encoders. Each takes the 16 texels of a 4x4 block in RGBA8
+	// (row major) and writes a single compressed block.
+	static void encodeBC1Block(const unsigned char* texels, unsigned char* block);
+	static void encodeBC3Block(const unsigned char* texels, unsigned char* block);
+	static void encodeBC4Block(const unsigned char* texels, int channel, unsigned char* block);
+	static void encodeBC5Block(const unsigned char* texels, unsigned char* block);
+	static void encodeBC7Block(const unsigned char* texels, unsigned char* block);
+
+}; // end TextureCompression
+
@@ -0,0 +1,175 @@
+#include "ThreadPool.h"
+
+#include <algorithm>
+
+static const bool VERBOSE = false;
+
+// Static variable definitions (Static variables must be defined outside the declaration)
+std::vector<std::thread> ThreadPool::workers;
+std::deque<std::function<void()>> ThreadPool::tasks;
+std::mutex ThreadPool::taskMutex;
+std::condition_variable ThreadPool::taskAvailable;
+bool ThreadPool::stopping = false;
+
+
+void ThreadPool::initialize()
+{
+	// The main thread runs tasks while it waits for them, so it counts as one
+	unsigned int hardwareThreads = std::max(std::thread::hardware_concurrency(), 1u);
+
+	stopping = false;
+
+	for (unsigned int i = 1; i < hardwareThreads; i++) {
+		workers.emplace_back(workerLoop);
+	}
+
+	if (VERBOSE) cout << "Thread pool started " << workers.size() << " workers" << endl;
+
+} // end initialize
+
+
+void ThreadPool::workerLoop()
+{
+	while (true) {
+
+		std::function<void()> task;
+
+		{
+			std::unique_lock<std::mutex> lock(taskMutex);
+
+			taskAvailable.wait(lock, [] { return stopping || !tasks.empty(); });
+
+			if (tasks.empty()) {
+				return; // Stopping and no work left
+			}
+
+			task = std::move(tasks.front());
+			tasks.pop_front();
+		}
+
+		task();
+	}
+
+} // end workerLoop
+
+
+bool ThreadPool::runQueuedTask()
+{
+	std::function<void()> task;
+
+	{
+		std::lock_guard<std::mutex> lock(taskMutex);
+
+		if (tasks.empty()) {
+			return false;
+		}
+
+		task = std::move(tasks.front());
+		tasks.pop_front();
+	}
+
+	task();
+
+	return true;
+
+} // end runQueuedTask
+
+
+void ThreadPool::submit(std::function<void()> task)
+{
+	if (workers.empty() && std::thread::hardware_concurrency() > 1) {
+		initialize();
+	}
+
+	// Without workers the task is run by the calling thread
+	if (workers.empty()) {
+
+		task();
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(taskMutex);
+		tasks.push_back(std::move(task));
+	}
+
+	taskAvailable.notify_one();
+
+} // end submit
+
+
+void ThreadPool::waitUntil(const std::function<bool()>& done)
+{
+	while (!done()) {
+
+		// Help with the queued work rather than block a thread the tasks may need
+		if (!runQueuedTask()) {
+			std::this_thread::yield();
+		}
+	}
+
+} // end waitUntil
+
+
+void ThreadPool::parallelFor(size_t count, size_t minimumPerTask, const std::function<void(size_t begin, size_t end)>& body)
+{
+	if (count == 0) {
+		return;
+	}
+
+	size_t taskCount = std::min(static_cast<size_t>(getThreadCount()), count / std::max(minimumPerTask, static_cast<size_t>(1)));
+
+	if (taskCount <= 1) {
+
+		body(0, count);
+		return;
+	}
+
+	// Ranges differ in size by at most one item
+	auto rangeStart = [count, taskCount](size_t task) { return count * task / taskCount; };
+
+	std::atomic<size_t> remaining(taskCount - 1);
+
+	for (size_t task = 1; task < taskCount; task++) {
+
+		submit([&body, &remaining, &rangeStart, task] {
+
+			body(rangeStart(task), rangeStart(task + 1));
+			remaining--;
+		});
+	}
+
+	body(0, rangeStart(1));
+
+	waitUntil([&remaining] { return remaining == 0; });
+
+} // end parallelFor
+
+
+unsigned int ThreadPool::getThreadCount()
+{
+	if (workers.empty() && std::thread::hardware_concurrency() > 1) {
+		initialize();
+	}
+
+	return static_cast<unsigned int>(workers.size()) + 1;
+
+} // end getThreadCount
+
+
+void ThreadPool::unload()
+{
+	{
+		std::lock_guard<std::mutex> lock(taskMutex);
+		stopping = true;
+	}
+
+	taskAvailable.notify_all();
+
+	for (std::thread& worker : workers) {
+		worker.join();
+	}
+
+	workers.clear();
+
+} // end unload
@@ -0,0 +1,110 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+#include "MathLibsConstsFuncs.h"
+
+using namespace constants_and_types;
+
+/**
+ * @class	ThreadPool
+ *
+ * @brief	Worker threads shared by all systems that split CPU work into tasks
+ * 			(mesh tessellation, physics). The workers are started the first time
+ * 			work is submitted, one per hardware thread less the main thread.
+ *
+ * 			Tasks must not make OpenGL calls; the context is only current on the
+ * 			main thread. Threads that wait for tasks run queued tasks while they
+ * 			wait, so tasks may themselves split work with parallelFor.
+ */
+class ThreadPool
+{
+public:
+
+	/**
+	 * @fn	static void ThreadPool::parallelFor(size_t count, size_t minimumPerTask, const std::function<void(size_t begin, size_t end)>& body);
+	 *
+	 * @brief	Calls body for consecutive ranges that together cover [0, count) and
+	 * 			returns when all calls have finished. The calling thread runs one of
+	 * 			the ranges. Runs body once on the calling thread if the work is too
+	 * 			small to split.
+	 *
+	 * @param	count		  	Number of items.
+	 * @param	minimumPerTask	Fewest items worth a task of their own.
+	 * @param	body		  	Processes the items from begin up to, but not including, end.
+	 */
+	static void parallelFor(size_t count, size_t minimumPerTask, const std::function<void(size_t begin, size_t end)>& body);
+
+	/**
+	 * @fn	static void ThreadPool::submit(std::function<void()> task);
+	 *
+	 * @brief	Queues a task to be run by a worker thread. The task is run right away
+	 * 			on the calling thread if there are no workers.
+	 */
+	static void submit(std::function<void()> task);
+
+	/**
+	 * @fn	static void ThreadPool::waitUntil(const std::function<bool()>& done);
+	 *
+	 * @brief	Runs queued tasks on the calling thread until done returns true.
+	 */
+	static void waitUntil(const std::function<bool()>& done);
+
+	/**
+	 * @fn	static unsigned int ThreadPool::getThreadCount();
+	 *
+	 * @brief	Gets the number of threads that run tasks, including the main thread.
+	 */
+	static unsigned int getThreadCount();
+
+	/**
+	 * @fn	static void ThreadPool::unload();
+	 *
+	 * @brief	Finishes the queued tasks and joins the worker threads.
+	 */
+	static void unload();
+
+protected:
+
+	/**
+	 * @fn	static void ThreadPool::initialize();
+	 *
+	 * @brief	Starts the worker threads.
+	 */
+	static void initialize();
+
+	/**
+	 * @fn	static bool ThreadPool::runQueuedTask();
+	 *
+	 * @brief	Runs the oldest queued task on the calling thread.
+	 *
+	 * @returns	False if the queue was empty.
+	 */
+	static bool runQueuedTask();
+
+	/**
+	 * @fn	static void ThreadPool::workerLoop();
+	 *
+	 * @brief	Body of the worker threads.
+	 */
+	static void workerLoop();
+
+	/** @brief	Worker threads */
+	static std::vector<std::thread> workers;
+
+	/** @brief	Tasks waiting for a thread */
+	static std::deque<std::function<void()>> tasks;
+
+	/** @brief	Guards the tasks and wakes the workers when tasks are queued */
+	static std::mutex taskMutex;
+	static std::condition_variable taskAvailable;
+
+	/** @brief	Set to stop the workers */
+	static bool stopping;
+
+}; // end ThreadPool
@@ -0,0 +1,50 @@
+#include "TorusMeshComponent.h"
+
+#include "ProceduralGeometry.h"
+
+// Most capsules used for the collision shape of a torus
+static const int MAX_TORUS_COLLISION_SEGMENTS = 16;
+
+
+TorusMeshComponent::TorusMeshComponent(GLuint shaderProgram, Material mat, float majorRadius, float minorRadius, int rings, int sides, int updateOrder)
+	: ProceduralMeshComponent(shaderProgram, mat, updateOrder), majorRadius(majorRadius), minorRadius(minorRadius), rings(rings), sides(sides)
+{
+}
+
+
+size_t TorusMeshComponent::getGeometryKey() const
+{
+	return hashGeometry("Torus", { majorRadius, minorRadius, static_cast<float>(rings), static_cast<float>(sides) });
+}
+
+
+void TorusMeshComponent::generateGeometry(int subMeshIndex, std::vector<pntVertexData>& vertexData, std::vector<unsigned int>& indices) const
+{
+	ProceduralGeometry::torus(majorRadius, minorRadius, rings, sides, vertexData, indices);
+}
+
+
+std::shared_ptr<btCollisionShape> TorusMeshComponent::createCollisionShape() const
+{
+	std::shared_ptr<btCompoundShape> torusShape = makeCompoundShape();
+
+	int segments = glm::clamp(rings, 3, MAX_TORUS_COLLISION_SEGMENTS);
+	float segmentAngle = (2.0f * PI) / segments;
+
+	// Each capsule spans the chord between two points on the middle of the tube
+	float chord = 2.0f * majorRadius * glm::sin(segmentAngle / 2.0f);
+
+	for (int i = 0; i < segments; i++) {
+
+		float angle = (i + 0.5f) * segmentAngle;
+		btVector3 radial(glm::sin(angle), 0.0f, glm::cos(angle));
+
+		// Capsules are aligned with Y. Turning them about the radial direction
+		// lays them along the ring.
+		btTransform transform(btQuaternion(radial, PI_OVER_2), radial * majorRadius * glm::cos(segmentAngle / 2.0f));
+
+		torusShape->addChildShape(transform, new btCapsuleShape(minorRadius, chord));
+	}
+
+	return torusShape;
+}
@@ -0,0 +1,36 @@
+#pragma once
+#include "ProceduralMeshComponent.h"
+
+/**
+ * @class	TorusMeshComponent
+ *
+ * @brief	Ring shaped tube centered on the origin that lies in the XZ plane.
+ */
+class TorusMeshComponent : public ProceduralMeshComponent
+{
+public:
+	TorusMeshComponent(GLuint shaderProgram, Material mat, float majorRadius = 1.0f, float minorRadius = 0.25f,
+					   int rings = 32, int sides = 12, int updateOrder = 100);
+
+protected:
+
+	virtual size_t getGeometryKey() const override;
+
+	virtual void generateGeometry(int subMeshIndex, std::vector<pntVertexData>& vertexData, std::vector<unsigned int>& indices) const override;
+
+	/**
+	 * @fn	virtual std::shared_ptr<btCollisionShape> TorusMeshComponent::createCollisionShape() const override;
+	 *
+	 * @brief	Approximates the tube with a ring of capsules, one for each ring of the
+	 * 			mesh up to MAX_TORUS_COLLISION_SEGMENTS. Objects can pass through the
+	 * 			hole of the torus.
+	 */
+	virtual std::shared_ptr<btCollisionShape> createCollisionShape() const override;
+
+	// Major radius is the distance from the center to the middle of the tube
+	float majorRadius, minorRadius;
+
+	// Rings are divisions around the Y axis and sides are divisions around the tube
+	int rings, sides;
+
+}; // end TorusMeshComponent
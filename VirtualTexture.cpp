@@ -0,0 +1,775 @@
+#include "VirtualTexture.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <unordered_set>
+
+#include "stb_image.h"
+#include "BuildShaderProgram.h"
+#include "ShaderHotReload.h"
+#include "MeshComponent.h"
+#include "SharedMaterials.h"
+#include "SharedTransformations.h"
+
+static const bool VERBOSE = false;
+
+// "GEVT" and version of the cooked file format
+static const uint32_t VT_FILE_MAGIC = 0x54564547;
+static const uint32_t VT_FILE_VERSION = 1;
+
+// Value of every channel of a feedback pixel that did not request a page
+static const GLuint VT_NO_REQUEST = 255;
+
+struct VirtualTextureHeader {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t format;
+	uint32_t pagesWide;
+	uint32_t pagesHigh;
+	uint32_t levelCount;
+	uint32_t pageSize;
+	uint32_t pageBorder;
+};
+
+// Static variables must be defined outside the declaration
+std::unordered_map<std::string, std::shared_ptr<VirtualTexture>> VirtualTexture::loadedVirtualTextures;
+std::vector<VirtualTexture*> VirtualTexture::virtualTexturesByID;
+GLuint VirtualTexture::feedbackProgram = 0;
+GLuint VirtualTexture::feedbackFramebuffer = 0;
+GLuint VirtualTexture::feedbackColorBuffer = 0;
+GLuint VirtualTexture::feedbackDepthBuffer = 0;
+glm::ivec2 VirtualTexture::feedbackSize(0, 0);
+GLuint VirtualTexture::feedbackPixelBuffers[2] = { 0, 0 };
+GLsync VirtualTexture::feedbackFences[2] = { nullptr, nullptr };
+int VirtualTexture::feedbackIndex = 0;
+unsigned long long VirtualTexture::currentFrame = 0;
+
+
+//********************* Cooking *****************************************
+
+static int nextPowerOfTwo(int value)
+{
+	int power = 1;
+	while (power < value) {
+		power *= 2;
+	}
+	return power;
+
+} // end nextPowerOfTwo
+
+// Bilinear resampling of an RGBA8 image
+static MipLevel resampleImage(const unsigned char* rgba, int width, int height, int newWidth, int newHeight)
+{
+	MipLevel resampled;
+	resampled.width = newWidth;
+	resampled.height = newHeight;
+	resampled.data.resize(static_cast<size_t>(newWidth) * newHeight * 4);
+
+	for (int y = 0; y < newHeight; y++) {
+
+		float sy = glm::clamp((y + 0.5f) * height / newHeight - 0.5f, 0.0f, height - 1.0f);
+		int y0 = static_cast<int>(sy);
+		int y1 = std::min(y0 + 1, height - 1);
+		float fy = sy - y0;
+
+		for (int x = 0; x < newWidth; x++) {
+
+			float sx = glm::clamp((x + 0.5f) * width / newWidth - 0.5f, 0.0f, width - 1.0f);
+			int x0 = static_cast<int>(sx);
+			int x1 = std::min(x0 + 1, width - 1);
+			float fx = sx - x0;
+
+			for (int c = 0; c < 4; c++) {
+
+				float top = rgba[(static_cast<size_t>(y0) * width + x0) * 4 + c] * (1.0f - fx) + rgba[(static_cast<size_t>(y0) * width + x1) * 4 + c] * fx;
+				float bottom = rgba[(static_cast<size_t>(y1) * width + x0) * 4 + c] * (1.0f - fx) + rgba[(static_cast<size_t>(y1) * width + x1) * 4 + c] * fx;
+
+				resampled.data[(static_cast<size_t>(y) * newWidth + x) * 4 + c] = static_cast<unsigned char>(top * (1.0f - fy) + bottom * fy + 0.5f);
+			}
+		}
+	}
+
+	return resampled;
+
+} // end resampleImage
+
+// Box filters a level to half size along the axes that are halved
+static MipLevel downsampleLevel(const MipLevel& source, bool halveWidth, bool halveHeight)
+{
+	MipLevel next;
+	next.width = halveWidth ? source.width / 2 : source.width;
+	next.height = halveHeight ? source.height / 2 : source.height;
+	next.data.resize(static_cast<size_t>(next.width) * next.height * 4);
+
+	int stepX = halveWidth ? 1 : 0;
+	int stepY = halveHeight ? 1 : 0;
+
+	for (int y = 0; y < next.height; y++) {
+
+		int y0 = y << stepY;
+		int y1 = y0 + stepY;
+
+		for (int x = 0; x < next.width; x++) {
+
+			int x0 = x << stepX;
+			int x1 = x0 + stepX;
+
+			for (int c = 0; c < 4; c++) {
+
+				int sum = source.data[(static_cast<size_t>(y0) * source.width + x0) * 4 + c] +
+						  source.data[(static_cast<size_t>(y0) * source.width + x1) * 4 + c] +
+						  source.data[(static_cast<size_t>(y1) * source.width + x0) * 4 + c] +
+						  source.data[(static_cast<size_t>(y1) * source.width + x1) * 4 + c];
+
+				next.data[(static_cast<size_t>(y) * next.width + x) * 4 + c] = static_cast<unsigned char>((sum + 2) / 4);
+			}
+		}
+	}
+
+	return next;
+
+} // end downsampleLevel
+
+
+bool VirtualTexture::cook(const std::string& sourceFile, const std::string& cookedFile)
+{
+	// Store rows the way OpenGL expects
+	stbi_set_flip_vertically_on_load(true);
+
+	int width = 0, height = 0, nrChannels;
+	unsigned char* image = stbi_load(sourceFile.c_str(), &width, &height, &nrChannels, 4);
+
+	if (image == nullptr || width == 0 || height == 0) {
+		std::cerr << "ERROR: Unable to cook " << sourceFile << "!" << std::endl;
+		return false;
+	}
+
+	// Round the number of pages up to powers of two so that every mip
+	// level is a whole number of pages
+	int pagesWide = std::min(nextPowerOfTwo((width + VT_PAGE_SIZE - 1) / VT_PAGE_SIZE), VT_MAX_PAGES);
+	int pagesHigh = std::min(nextPowerOfTwo((height + VT_PAGE_SIZE - 1) / VT_PAGE_SIZE), VT_MAX_PAGES);
+
+	TEXTURE_FORMAT format = TextureCompression::chooseFormat(COLOR_TEXTURE, TextureCompression::hasAlpha(image, width, height));
+
+	MipLevel level = resampleImage(image, width, height, pagesWide * VT_PAGE_SIZE, pagesHigh * VT_PAGE_SIZE);
+
+	stbi_image_free(image);
+
+	int levelCount = 1;
+	while ((pagesWide >> levelCount) > 0 || (pagesHigh >> levelCount) > 0) {
+		levelCount++;
+	}
+
+	VirtualTextureHeader header = {};
+	header.magic = VT_FILE_MAGIC;
+	header.version = VT_FILE_VERSION;
+	header.format = static_cast<uint32_t>(format);
+	header.pagesWide = static_cast<uint32_t>(pagesWide);
+	header.pagesHigh = static_cast<uint32_t>(pagesHigh);
+	header.levelCount = static_cast<uint32_t>(levelCount);
+	header.pageSize = VT_PAGE_SIZE;
+	header.pageBorder = VT_PAGE_BORDER;
+
+	FILE* file = nullptr;
+	fopen_s(&file, cookedFile.c_str(), "wb");
+
+	if (file == nullptr) {
+		std::cerr << "ERROR: Unable to write " << cookedFile << "!" << std::endl;
+		return false;
+	}
+
+	bool written = fwrite(&header, sizeof(header), 1, file) == 1;
+
+	MipLevel page;
+	page.width = VT_PHYSICAL_PAGE_SIZE;
+	page.height = VT_PHYSICAL_PAGE_SIZE;
+	page.data.resize(static_cast<size_t>(VT_PHYSICAL_PAGE_SIZE) * VT_PHYSICAL_PAGE_SIZE * 4);
+
+	for (int l = 0; l < levelCount && written; l++) {
+
+		int levelPagesWide = std::max(1, pagesWide >> l);
+		int levelPagesHigh = std::max(1, pagesHigh >> l);
+
+		for (int py = 0; py < levelPagesHigh; py++) {
+			for (int px = 0; px < levelPagesWide; px++) {
+
+				// Copy the page and its border. The border wraps around the
+				// edges of the level to match GL_REPEAT addressing.
+				for (int y = 0; y < VT_PHYSICAL_PAGE_SIZE; y++) {
+
+					int sy = (py * VT_PAGE_SIZE + y - VT_PAGE_BORDER + level.height) % level.height;
+
+					for (int x = 0; x < VT_PHYSICAL_PAGE_SIZE; x++) {
+
+						int sx = (px * VT_PAGE_SIZE + x - VT_PAGE_BORDER + level.width) % level.width;
+
+						memcpy(&page.data[(static_cast<size_t>(y) * VT_PHYSICAL_PAGE_SIZE + x) * 4],
+							   &level.data[(static_cast<size_t>(sy) * level.width + sx) * 4], 4);
+					}
+				}
+
+				std::vector<unsigned char> blocks = TextureCompression::compress(page, format);
+				written = written && fwrite(blocks.data(), 1, blocks.size(), file) == blocks.size();
+			}
+		}
+
+		if (l + 1 < levelCount) {
+			level = downsampleLevel(level, levelPagesWide > 1, levelPagesHigh > 1);
+		}
+	}
+
+	fclose(file);
+
+	if (!written) {
+		std::cerr << "ERROR: Unable to write " << cookedFile << "!" << std::endl;
+		std::remove(cookedFile.c_str());
+		return false;
+	}
+
+	if (VERBOSE) cout << "Cooked " << sourceFile << " into " << pagesWide << "x" << pagesHigh << " pages with " << levelCount << " levels" << endl;
+
+	return true;
+
+} // end cook
+
+
+//********************* Loading *****************************************
+
+std::shared_ptr<VirtualTexture> VirtualTexture::GetVirtualTexture(const std::string& fileName, int cachePages)
+{
+	auto iter = loadedVirtualTextures.find(fileName);
+
+	if (iter != loadedVirtualTextures.end()) {
+
+		return iter->second;
+	}
+
+	if (virtualTexturesByID.size() >= VT_MAX_VIRTUAL_TEXTURES) {
+
+		std::cerr << "ERROR: Unable to load " << fileName << ". Too many virtual textures." << std::endl;
+		return nullptr;
+	}
+
+	// The constructor is protected so make_shared can not be used
+	std::shared_ptr<VirtualTexture> virtualTexture(new VirtualTexture());
+
+	virtualTexture->fileName = fileName;
+	virtualTexture->id = static_cast<int>(virtualTexturesByID.size());
+
+	if (!virtualTexture->load(fileName, cachePages)) {
+
+		std::cerr << "ERROR: Unable to load virtual texture " << fileName << "!" << std::endl;
+		return nullptr;
+	}
+
+	loadedVirtualTextures.emplace(fileName, virtualTexture);
+	virtualTexturesByID.push_back(virtualTexture.get());
+
+	return virtualTexture;
+
+} // end GetVirtualTexture
+
+
+bool VirtualTexture::load(const std::string& fileName, int cachePages)
+{
+	std::string cookedFile = AssetCache::getCookedPath(fileName, "VirtualTextures", ".vt");
+
+	if (!AssetCache::isCookedFileCurrent(fileName, cookedFile) && !cook(fileName, cookedFile)) {
+		return false;
+	}
+
+	VirtualTextureHeader header = {};
+
+	for (int attempt = 0; attempt < 2; attempt++) {
+
+		if (file.open(cookedFile) && file.getSize() >= sizeof(header)) {
+
+			memcpy(&header, file.getData(), sizeof(header));
+
+			if (header.magic == VT_FILE_MAGIC && header.version == VT_FILE_VERSION &&
+				header.pageSize == VT_PAGE_SIZE && header.pageBorder == VT_PAGE_BORDER) {
+				break;
+			}
+		}
+
+		// Written by an older version of the engine. Cook it again.
+		file.close();
+
+		if (attempt > 0 || !cook(fileName, cookedFile)) {
+			return false;
+		}
+	}
+
+	this->format = static_cast<TEXTURE_FORMAT>(header.format);
+	this->pagesWide = static_cast<int>(header.pagesWide);
+	this->pagesHigh = static_cast<int>(header.pagesHigh);
+	this->levelCount = static_cast<int>(header.levelCount);
+	this->pageBytes = TextureCompression::getLevelSize(format, VT_PHYSICAL_PAGE_SIZE, VT_PHYSICAL_PAGE_SIZE);
+	this->cachePages = cachePages;
+
+	if (!TextureCompression::isSupported(format)) {
+		return false;
+	}
+
+	// Locate the first page of each level
+	size_t offset = sizeof(header);
+
+	for (int level = 0; level < levelCount; level++) {
+
+		levelOffsets.push_back(offset);
+		offset += static_cast<size_t>(getPagesWide(level)) * getPagesHigh(level) * pageBytes;
+	}
+
+	if (offset > file.getSize()) {
+		return false;
+	}
+
+	// Physical page cache. Sampled without mipmaps because each page holds a
+	// single level. Filtering across pages is prevented by the borders.
+	glGenTextures(1, &pageCacheTexture);
+	glBindTexture(GL_TEXTURE_2D, pageCacheTexture);
+	glTexStorage2D(GL_TEXTURE_2D, 1, TextureCompression::getInternalFormat(format),
+				   cachePages * VT_PHYSICAL_PAGE_SIZE, cachePages * VT_PHYSICAL_PAGE_SIZE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+	// Page table. One texel per page holding the location of the page in the
+	// cache (x, y) and the level of the page that is actually resident (z).
+	glGenTextures(1, &pageTableTexture);
+	glBindTexture(GL_TEXTURE_2D, pageTableTexture);
+	glTexStorage2D(GL_TEXTURE_2D, levelCount, GL_RGBA8UI, pagesWide, pagesHigh);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	slots.resize(static_cast<size_t>(cachePages) * cachePages);
+
+	// The coarsest page covers the whole texture and is always resident
+	long long coarsestPage = getPageKey(levelCount - 1, 0, 0);
+	uploadPage(coarsestPage);
+	slots[residentPages[coarsestPage]].pinned = true;
+
+	updatePageTable();
+
+	if (VERBOSE) cout << "Loaded virtual texture " << fileName << " " << pagesWide * VT_PAGE_SIZE << "x" << pagesHigh * VT_PAGE_SIZE
+					  << " texels with a " << getPageCacheBytes() << " byte page cache" << endl;
+
+	return true;
+
+} // end load
+
+
+size_t VirtualTexture::getPageCacheBytes() const
+{
+	return slots.size() * pageBytes;
+
+} // end getPageCacheBytes
+
+
+void VirtualTexture::unloadVirtualTextures()
+{
+	for (auto& i : loadedVirtualTextures) {
+
+		glDeleteTextures(1, &i.second->pageCacheTexture);
+		glDeleteTextures(1, &i.second->pageTableTexture);
+		i.second->pageCacheTexture = 0;
+		i.second->pageTableTexture = 0;
+		i.second->file.close();
+	}
+
+	loadedVirtualTextures.clear();
+	virtualTexturesByID.clear();
+
+	for (int i = 0; i < 2; i++) {
+
+		if (feedbackFences[i] != nullptr) {
+			glDeleteSync(feedbackFences[i]);
+			feedbackFences[i] = nullptr;
+		}
+	}
+
+	glDeleteBuffers(2, feedbackPixelBuffers);
+	glDeleteRenderbuffers(1, &feedbackColorBuffer);
+	glDeleteRenderbuffers(1, &feedbackDepthBuffer);
+	glDeleteFramebuffers(1, &feedbackFramebuffer);
+
+	feedbackPixelBuffers[0] = feedbackPixelBuffers[1] = 0;
+	feedbackColorBuffer = feedbackDepthBuffer = feedbackFramebuffer = 0;
+	feedbackSize = glm::ivec2(0, 0);
+
+	// The shader program is deleted by deleteAllShaderPrograms
+	feedbackProgram = 0;
+
+} // end unloadVirtualTextures
+
+
+//********************* Feedback *****************************************
+
+void VirtualTexture::initializeFeedback()
+{
+	ShaderInfo shaders[] = {
+		{ GL_VERTEX_SHADER, "Shaders/vertexShader.glsl" },
+		{ GL_FRAGMENT_SHADER, "Shaders/vtFeedbackShader.glsl" },
+		{ GL_NONE, NULL } // signals that there are no more shaders
+	};
+
+	feedbackProgram = BuildShaderProgram(shaders);
+
+	// Follow the feedback program when it is rebuilt after a source change
+	ShaderHotReload::addSwapCallback([](GLuint oldProgram, GLuint newProgram) {
+
+		if (feedbackProgram == oldProgram) {
+			feedbackProgram = newProgram;
+			glProgramUniform1f(feedbackProgram, vtFeedbackMipBiasLocation, -log2(static_cast<float>(VT_FEEDBACK_DIVISOR)));
+		}
+	});
+
+	SharedMaterials::setUniformBlockForShader(feedbackProgram);
+	SharedTransformations::setUniformBlockForShader(feedbackProgram);
+
+	// Compensate for the derivatives being larger in the smaller buffer
+	glProgramUniform1f(feedbackProgram, vtFeedbackMipBiasLocation, -log2(static_cast<float>(VT_FEEDBACK_DIVISOR)));
+
+	glGenBuffers(2, feedbackPixelBuffers);
+
+} // end initializeFeedback
+
+
+void VirtualTexture::resizeFeedbackBuffer(glm::ivec2 size)
+{
+	feedbackSize = size;
+
+	if (feedbackFramebuffer == 0) {
+
+		glGenFramebuffers(1, &feedbackFramebuffer);
+		glGenRenderbuffers(1, &feedbackColorBuffer);
+		glGenRenderbuffers(1, &feedbackDepthBuffer);
+	}
+
+	// Integer color buffer. Blending is never applied to integer buffers so
+	// transparent materials do not corrupt the page identifiers.
+	glBindRenderbuffer(GL_RENDERBUFFER, feedbackColorBuffer);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8UI, size.x, size.y);
+
+	glBindRenderbuffer(GL_RENDERBUFFER, feedbackDepthBuffer);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, size.x, size.y);
+
+	glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+	glBindFramebuffer(GL_FRAMEBUFFER, feedbackFramebuffer);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, feedbackColorBuffer);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, feedbackDepthBuffer);
+
+	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+		std::cerr << "ERROR: Virtual texture feedback framebuffer is not complete." << std::endl;
+	}
+
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+	// Reads that are in progress are for the old size
+	for (int i = 0; i < 2; i++) {
+
+		if (feedbackFences[i] != nullptr) {
+			glDeleteSync(feedbackFences[i]);
+			feedbackFences[i] = nullptr;
+		}
+
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, feedbackPixelBuffers[i]);
+		glBufferData(GL_PIXEL_PACK_BUFFER, static_cast<GLsizeiptr>(size.x) * size.y * 4, nullptr, GL_STREAM_READ);
+	}
+
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+} // end resizeFeedbackBuffer
+
+
+void VirtualTexture::renderFeedback(glm::ivec2 windowDimensions)
+{
+	if (virtualTexturesByID.empty()) {
+		return;
+	}
+
+	if (feedbackProgram == 0) {
+		initializeFeedback();
+	}
+
+	glm::ivec2 size = glm::max(windowDimensions / VT_FEEDBACK_DIVISOR, glm::ivec2(1, 1));
+
+	if (size != feedbackSize) {
+		resizeFeedbackBuffer(size);
+	}
+
+	GLint viewport[4];
+	glGetIntegerv(GL_VIEWPORT, viewport);
+
+	glBindFramebuffer(GL_FRAMEBUFFER, feedbackFramebuffer);
+	glViewport(0, 0, size.x, size.y);
+
+	// Pixels that are not covered by a virtual texture do not request pages
+	const GLuint noRequest[4] = { VT_NO_REQUEST, VT_NO_REQUEST, VT_NO_REQUEST, VT_NO_REQUEST };
+	const GLfloat farDepth = 1.0f;
+	glClearBufferuiv(GL_COLOR, 0, noRequest);
+	glClearBufferfv(GL_DEPTH, 0, &farDepth);
+
+	for (auto& mesh : MeshComponent::GetMeshComponents()) {
+
+		mesh->drawWithShaderProgram(feedbackProgram);
+	}
+
+	// Copy the feedback into a pixel buffer. The copy completes asynchronously
+	// and is read by updatePageCaches during the next frame.
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, feedbackPixelBuffers[feedbackIndex]);
+	glReadPixels(0, 0, size.x, size.y, GL_RGBA_INTEGER, GL_UNSIGNED_BYTE, nullptr);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+	if (feedbackFences[feedbackIndex] != nullptr) {
+		glDeleteSync(feedbackFences[feedbackIndex]);
+	}
+	feedbackFences[feedbackIndex] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+	feedbackIndex = 1 - feedbackIndex;
+
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+
+} // end renderFeedback
+
+
+//********************* Streaming *****************************************
+
+void VirtualTexture::updatePageCaches()
+{
+	currentFrame++;
+
+	// The buffer that is written next is the one that was written a frame ago
+	GLsync fence = feedbackFences[feedbackIndex];
+
+	if (fence != nullptr) {
+
+		GLenum status = glClientWaitSync(fence, 0, 0);
+
+		// Do not wait. The feedback is used during a later frame if the copy
+		// has not finished.
+		if (status == GL_ALREADY_SIGNALED || status == GL_CONDITION_SATISFIED) {
+
+			glDeleteSync(fence);
+			feedbackFences[feedbackIndex] = nullptr;
+
+			size_t pixelCount = static_cast<size_t>(feedbackSize.x) * feedbackSize.y;
+
+			glBindBuffer(GL_PIXEL_PACK_BUFFER, feedbackPixelBuffers[feedbackIndex]);
+			const uint32_t* pixels = static_cast<const uint32_t*>(
+				glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, pixelCount * 4, GL_MAP_READ_BIT));
+
+			if (pixels != nullptr) {
+
+				// Many pixels request the same page. Process each request once.
+				std::unordered_set<uint32_t> requests;
+
+				for (size_t i = 0; i < pixelCount; i++) {
+					requests.insert(pixels[i]);
+				}
+
+				glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+
+				for (uint32_t request : requests) {
+
+					int x = request & 0xFF;
+					int y = (request >> 8) & 0xFF;
+					int level = (request >> 16) & 0xFF;
+					int textureID = (request >> 24) & 0xFF;
+
+					if (textureID < static_cast<int>(virtualTexturesByID.size())) {
+						virtualTexturesByID[textureID]->requestPage(level, x, y);
+					}
+				}
+			}
+
+			glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+		}
+	}
+
+	int uploads = 0;
+
+	for (VirtualTexture* virtualTexture : virtualTexturesByID) {
+
+		std::vector<long long>& pending = virtualTexture->pendingPages;
+
+		// Coarse levels first so that the fallback for the most pixels
+		// improves before the detail is loaded
+		std::sort(pending.begin(), pending.end(), std::greater<long long>());
+		pending.erase(std::unique(pending.begin(), pending.end()), pending.end());
+
+		for (long long pageKey : pending) {
+
+			if (uploads >= VT_MAX_PAGE_UPLOADS_PER_FRAME || !virtualTexture->uploadPage(pageKey)) {
+				break;
+			}
+
+			uploads++;
+		}
+
+		// Pages that were not uploaded are requested again by later feedback
+		pending.clear();
+
+		if (virtualTexture->pageTableDirty) {
+			virtualTexture->updatePageTable();
+		}
+	}
+
+} // end updatePageCaches
+
+
+void VirtualTexture::requestPage(int level, int x, int y)
+{
+	if (level >= levelCount || x >= getPagesWide(level) || y >= getPagesHigh(level)) {
+		return;
+	}
+
+	// Request the page and every coarser page that covers it so that the
+	// fallback used while the page is loading is as close as possible
+	for (; level < levelCount; level++) {
+
+		long long pageKey = getPageKey(level, x, y);
+
+		auto iter = residentPages.find(pageKey);
+
+		if (iter != residentPages.end()) {
+
+			slots[iter->second].lastUsedFrame = currentFrame;
+		}
+		else {
+
+			pendingPages.push_back(pageKey);
+		}
+
+		if (level + 1 < levelCount) {
+			x = x * getPagesWide(level + 1) / getPagesWide(level);
+			y = y * getPagesHigh(level + 1) / getPagesHigh(level);
+		}
+	}
+
+} // end requestPage
+
+
+bool VirtualTexture::uploadPage(long long pageKey)
+{
+	if (residentPages.find(pageKey) != residentPages.end()) {
+		return true;
+	}
+
+	// Find an empty slot or the least recently used page that was not
+	// requested during this frame
+	int slotIndex = -1;
+
+	for (int i = 0; i < static_cast<int>(slots.size()); i++) {
+
+		if (slots[i].pageKey < 0) {
+			slotIndex = i;
+			break;
+		}
+
+		if (!slots[i].pinned && slots[i].lastUsedFrame < currentFrame &&
+			(slotIndex < 0 || slots[i].lastUsedFrame < slots[slotIndex].lastUsedFrame)) {
+			slotIndex = i;
+		}
+	}
+
+	if (slotIndex < 0) {
+		return false;
+	}
+
+	PageSlot& slot = slots[slotIndex];
+
+	if (slot.pageKey >= 0) {
+		residentPages.erase(slot.pageKey);
+	}
+
+	int level = static_cast<int>(pageKey >> 32);
+	int y = static_cast<int>((pageKey >> 16) & 0xFFFF);
+	int x = static_cast<int>(pageKey & 0xFFFF);
+
+	const unsigned char* pageData = file.getData() + levelOffsets[level] +
+		(static_cast<size_t>(y) * getPagesWide(level) + x) * pageBytes;
+
+	int cacheX = (slotIndex % cachePages) * VT_PHYSICAL_PAGE_SIZE;
+	int cacheY = (slotIndex / cachePages) * VT_PHYSICAL_PAGE_SIZE;
+
+	glBindTexture(GL_TEXTURE_2D, pageCacheTexture);
+
+	// Copy directly from the mapped file
+	if (format == FORMAT_RGBA8) {
+
+		glTexSubImage2D(GL_TEXTURE_2D, 0, cacheX, cacheY, VT_PHYSICAL_PAGE_SIZE, VT_PHYSICAL_PAGE_SIZE,
+						GL_RGBA, GL_UNSIGNED_BYTE, pageData);
+	}
+	else {
+
+		glCompressedTexSubImage2D(GL_TEXTURE_2D, 0, cacheX, cacheY, VT_PHYSICAL_PAGE_SIZE, VT_PHYSICAL_PAGE_SIZE,
+								  TextureCompression::getInternalFormat(format), static_cast<GLsizei>(pageBytes), pageData);
+	}
+
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	slot.pageKey = pageKey;
+	slot.lastUsedFrame = currentFrame;
+	residentPages[pageKey] = slotIndex;
+	pageTableDirty = true;
+
+	return true;
+
+} // end uploadPage
+
+
+void VirtualTexture::updatePageTable()
+{
+	std::vector<std::vector<unsigned char>> entries(levelCount);
+
+	glBindTexture(GL_TEXTURE_2D, pageTableTexture);
+
+	// Coarsest level first so that pages that are not resident can use the
+	// entry of the page that covers them in the next coarser level
+	for (int level = levelCount - 1; level >= 0; level--) {
+
+		int levelPagesWide = getPagesWide(level);
+		int levelPagesHigh = getPagesHigh(level);
+
+		entries[level].resize(static_cast<size_t>(levelPagesWide) * levelPagesHigh * 4);
+
+		for (int y = 0; y < levelPagesHigh; y++) {
+			for (int x = 0; x < levelPagesWide; x++) {
+
+				unsigned char* entry = &entries[level][(static_cast<size_t>(y) * levelPagesWide + x) * 4];
+
+				auto iter = residentPages.find(getPageKey(level, x, y));
+
+				if (iter != residentPages.end()) {
+
+					entry[0] = static_cast<unsigned char>(iter->second % cachePages);
+					entry[1] = static_cast<unsigned char>(iter->second / cachePages);
+					entry[2] = static_cast<unsigned char>(level);
+					entry[3] = 255;
+				}
+				else if (level + 1 < levelCount) {
+
+					int parentX = x * getPagesWide(level + 1) / levelPagesWide;
+					int parentY = y * getPagesHigh(level + 1) / levelPagesHigh;
+
+					memcpy(entry, &entries[level + 1][(static_cast<size_t>(parentY) * getPagesWide(level + 1) + parentX) * 4], 4);
+				}
+			}
+		}
+
+		glTexSubImage2D(GL_TEXTURE_2D, level, 0, 0, levelPagesWide, levelPagesHigh,
+						GL_RGBA_INTEGER, GL_UNSIGNED_BYTE, entries[level].data());
+	}
+
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	pageTableDirty = false;
+
+} // end updatePageTable
@@ -0,0 +1,332 @@
+#pragma once
+
+#include <algorithm>
+#include <unordered_map>
+
+#include "MathLibsConstsFuncs.h"
+#include "AssetCache.h"
+#include "TextureCompression.h"
+
+using namespace constants_and_types;
+
+// Width and height in texels of the part of a page that covers the virtual texture
+static const int VT_PAGE_SIZE = 128;
+
+// Texels copied from neighboring pages on each side of a page so that bilinear
+// filtering does not sample the wrong page in the physical page cache.
+// Four texels keeps pages aligned to compressed blocks.
+static const int VT_PAGE_BORDER = 4;
+
+// Width and height in texels of a page in the physical page cache
+static const int VT_PHYSICAL_PAGE_SIZE = VT_PAGE_SIZE + 2 * VT_PAGE_BORDER;
+
+// Largest number of pages across the virtual texture. Page coordinates are
+// written to eight bit channels during the feedback pass.
+static const int VT_MAX_PAGES = 256;
+
+// Number of virtual textures that can be identified in the feedback buffer.
+// 255 is used to indicate that no virtual texture was rendered.
+static const int VT_MAX_VIRTUAL_TEXTURES = 255;
+
+// Default width and height, in pages, of the physical page cache
+static const int VT_DEFAULT_CACHE_PAGES = 8;
+
+// The feedback pass is rendered at this fraction of the window size
+static const int VT_FEEDBACK_DIVISOR = 8;
+
+// Largest number of pages that are copied into page caches each frame
+static const int VT_MAX_PAGE_UPLOADS_PER_FRAME = 8;
+
+// Uniform location of the mip level bias in the feedback shader
+static const GLuint vtFeedbackMipBiasLocation = 110;
+
+/**
+ * @class	VirtualTexture
+ *
+ * @brief	A very large texture of which only the parts that are visible are kept
+ * 			in memory.
+ *
+ * 			At cook time the source image is resampled to a power of two number of
+ * 			pages, a mip chain is built, and each level is cut into pages of
+ * 			VT_PAGE_SIZE texels with borders. Each page is block compressed and
+ * 			stored in a cooked file that is memory mapped at run time.
+ *
+ * 			Each frame a feedback pass renders the scene into a small buffer,
+ * 			writing the page and mip level that every pixel needs. Pages that were
+ * 			requested are copied from the mapped file into a physical page cache (a
+ * 			single texture that holds a fixed number of pages). Pages that are not
+ * 			requested are replaced in least recently used order. An indirection
+ * 			texture (the page table) with one texel per virtual page and one mip
+ * 			level per virtual mip level gives the location of each page in the
+ * 			physical cache. Pages that are not resident point to the closest
+ * 			coarser page that is. The coarsest page is always resident.
+ *
+ * 			Memory use depends on the size of the page cache and not on the size
+ * 			of the virtual texture.
+ */
+class VirtualTexture
+{
+public:
+
+	/**
+	 * @fn	static std::shared_ptr<VirtualTexture> VirtualTexture::GetVirtualTexture(const std::string& fileName, int cachePages = VT_DEFAULT_CACHE_PAGES);
+	 *
+	 * @brief	Loads a virtual texture or retrieves it if it was loaded previously.
+	 * 			The source image is cooked if the cooked copy is missing or out of date.
+	 *
+	 * @param	fileName  	Contains the relative path and the name of the source image.
+	 * @param	cachePages	(Optional) Width and height of the physical page cache in pages.
+	 *
+	 * @returns	Null if it fails, else a pointer to the virtual texture.
+	 */
+	static std::shared_ptr<VirtualTexture> GetVirtualTexture(const std::string& fileName, int cachePages = VT_DEFAULT_CACHE_PAGES);
+
+	/**
+	 * @fn	static bool VirtualTexture::cook(const std::string& sourceFile, const std::string& cookedFile);
+	 *
+	 * @brief	Cuts a source image into pages and writes them to a cooked file.
+	 *
+	 * @param	sourceFile	Relative path and name of the source image.
+	 * @param	cookedFile	Relative path and name of the cooked file to write.
+	 *
+	 * @returns	True if it succeeds, false if it fails.
+	 */
+	static bool cook(const std::string& sourceFile, const std::string& cookedFile);
+
+	/**
+	 * @fn	static void VirtualTexture::renderFeedback(glm::ivec2 windowDimensions);
+	 *
+	 * @brief	Renders all mesh components into the feedback buffer and starts an
+	 * 			asynchronous read back of the buffer. Does nothing if no virtual
+	 * 			textures are loaded. Should be called once per frame before the scene
+	 * 			is rendered.
+	 *
+	 * @param	windowDimensions	Size of the framebuffer in pixels.
+	 */
+	static void renderFeedback(glm::ivec2 windowDimensions);
+
+	/**
+	 * @fn	static void VirtualTexture::updatePageCaches();
+	 *
+	 * @brief	Processes the most recent feedback that has finished reading back,
+	 * 			uploads requested pages to the page caches and updates the page tables.
+	 */
+	static void updatePageCaches();
+
+	/**
+	 * @fn	static void VirtualTexture::unloadVirtualTextures();
+	 *
+	 * @brief	Deletes all page caches, page tables and the feedback buffer.
+	 */
+	static void unloadVirtualTextures();
+
+	/**
+	 * @fn	int VirtualTexture::getID() const
+	 *
+	 * @brief	Gets the identifier written to the feedback buffer for this texture.
+	 *
+	 * @returns	The identifier.
+	 */
+	int getID() const { return id; }
+
+	/**
+	 * @fn	GLuint VirtualTexture::getPageTableObject() const
+	 *
+	 * @brief	Gets the texture object of the page table.
+	 *
+	 * @returns	The texture object.
+	 */
+	GLuint getPageTableObject() const { return pageTableTexture; }
+
+	/**
+	 * @fn	GLuint VirtualTexture::getPageCacheObject() const
+	 *
+	 * @brief	Gets the texture object of the physical page cache.
+	 *
+	 * @returns	The texture object.
+	 */
+	GLuint getPageCacheObject() const { return pageCacheTexture; }
+
+	/**
+	 * @fn	int VirtualTexture::getResidentPageCount() const
+	 *
+	 * @brief	Gets the number of pages in the physical page cache.
+	 *
+	 * @returns	The number of resident pages.
+	 */
+	int getResidentPageCount() const { return static_cast<int>(residentPages.size()); }
+
+	/**
+	 * @fn	size_t VirtualTexture::getPageCacheBytes() const
+	 *
+	 * @brief	Gets the memory used by the physical page cache.
+	 *
+	 * @returns	The size in bytes.
+	 */
+	size_t getPageCacheBytes() const;
+
+protected:
+
+	/**
+	 * @struct	PageSlot
+	 *
+	 * @brief	A page sized region of the physical page cache.
+	 */
+	struct PageSlot {
+
+		/** @brief	Key of the page held in the slot. -1 if the slot is empty */
+		long long pageKey = -1;
+
+		/** @brief	Frame in which the page was last requested */
+		unsigned long long lastUsedFrame = 0;
+
+		/** @brief	Pinned pages (the coarsest level) are never replaced */
+		bool pinned = false;
+	};
+
+	/**
+	 * @fn	VirtualTexture::VirtualTexture()
+	 *
+	 * @brief	Default constructor. Protected so that virtual textures can only be
+	 * 			created by GetVirtualTexture.
+	 */
+	VirtualTexture() {}
+
+	/**
+	 * @fn	bool VirtualTexture::load(const std::string& fileName, int cachePages);
+	 *
+	 * @brief	Maps the cooked file and creates the page cache and page table textures.
+	 *
+	 * @returns	True if it succeeds, false if it fails.
+	 */
+	bool load(const std::string& fileName, int cachePages);
+
+	/**
+	 * @fn	void VirtualTexture::requestPage(int level, int x, int y);
+	 *
+	 * @brief	Marks a page as needed during the current frame. Pages that are not
+	 * 			resident are added to the list of pages to upload.
+	 */
+	void requestPage(int level, int x, int y);
+
+	/**
+	 * @fn	bool VirtualTexture::uploadPage(long long pageKey);
+	 *
+	 * @brief	Copies a page from the mapped file into a free or least recently
+	 * 			used slot of the page cache.
+	 *
+	 * @returns	True if the page was uploaded, false if no slot could be replaced.
+	 */
+	bool uploadPage(long long pageKey);
+
+	/**
+	 * @fn	void VirtualTexture::updatePageTable();
+	 *
+	 * @brief	Rebuilds the page table from the resident pages and uploads it.
+	 */
+	void updatePageTable();
+
+	/**
+	 * @fn	long long VirtualTexture::getPageKey(int level, int x, int y) const
+	 *
+	 * @brief	Combines the level and page coordinates into a single key.
+	 */
+	long long getPageKey(int level, int x, int y) const { return (static_cast<long long>(level) << 32) | (y << 16) | x; }
+
+	/**
+	 * @fn	int VirtualTexture::getPagesWide(int level) const
+	 *
+	 * @brief	Gets the number of pages across a mip level.
+	 */
+	int getPagesWide(int level) const { return std::max(1, pagesWide >> level); }
+
+	/**
+	 * @fn	int VirtualTexture::getPagesHigh(int level) const
+	 *
+	 * @brief	Gets the number of pages down a mip level.
+	 */
+	int getPagesHigh(int level) const { return std::max(1, pagesHigh >> level); }
+
+	/**
+	 * @fn	static void VirtualTexture::initializeFeedback();
+	 *
+	 * @brief	Builds the feedback shader program and pixel buffers.
+	 */
+	static void initializeFeedback();
+
+	/**
+	 * @fn	static void VirtualTexture::resizeFeedbackBuffer(glm::ivec2 size);
+	 *
+	 * @brief	(Re)creates the feedback framebuffer and the pixel buffers it is read into.
+	 */
+	static void resizeFeedbackBuffer(glm::ivec2 size);
+
+
+	/** @brief	Identifier written to the feedback buffer */
+	int id = 0;
+
+	/** @brief	Relative path and name of the source image */
+	std::string fileName;
+
+	/** @brief	Mapping of the cooked file */
+	MappedFile file;
+
+	/** @brief	Format of the pages */
+	TEXTURE_FORMAT format = FORMAT_RGBA8;
+
+	/** @brief	Size of the finest mip level in pages. Both are powers of two. */
+	int pagesWide = 0;
+	int pagesHigh = 0;
+
+	/** @brief	Number of mip levels */
+	int levelCount = 0;
+
+	/** @brief	Size in bytes of one page in the cooked file */
+	size_t pageBytes = 0;
+
+	/** @brief	Byte offset of the first page of each level in the cooked file */
+	std::vector<size_t> levelOffsets;
+
+	/** @brief	Width and height of the page cache in pages */
+	int cachePages = 0;
+
+	/** @brief	OpenGL texture objects of the page cache and page table */
+	GLuint pageCacheTexture = 0;
+	GLuint pageTableTexture = 0;
+
+	/** @brief	Slots of the page cache */
+	std::vector<PageSlot> slots;
+
+	/** @brief	Slot of each resident page */
+	std::unordered_map<long long, int> residentPages;
+
+	/** @brief	Pages requested by the feedback that are not resident */
+	std::vector<long long> pendingPages;
+
+	/** @brief	Indicates the page table must be rebuilt */
+	bool pageTableDirty = true;
+
+	/** @brief	All virtual textures that have been loaded, indexed by file name */
+	static std::unordered_map<std::string, std::shared_ptr<VirtualTexture>> loadedVirtualTextures;
+
+	/** @brief	Virtual textures indexed by identifier */
+	static std::vector<VirtualTexture*> virtualTexturesByID;
+
+	/** @brief	Feedback shader program, framebuffer and attachments */
+	static GLuint feedbackProgram;
+	static GLuint feedbackFramebuffer;
+	static GLuint feedbackColorBuffer;
+	static GLuint feedbackDepthBuffer;
+	static glm::ivec2 feedbackSize;
+
+	/** @brief	Pixel buffers the feedback is read into. Alternate between frames
+	 * 			so that the read back does not stall the pipeline. */
+	static GLuint feedbackPixelBuffers[2];
+	static GLsync feedbackFences[2];
+	static int feedbackIndex;
+
+	/** @brief	Number of times updatePageCaches has been called */
+	static unsigned long long currentFrame;
+
+}; // end VirtualTexture
+
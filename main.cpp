@@ -1,6 +1,7 @@
 #include "Scene1.h"
 #include "Scene2.h"
 #include "Scene3.h"
+#include "Scene4.h"
 
 int main( )
 {
@@ -8,6 +9,7 @@ int main( )
 	//Scene1 game;
 	//Scene2 game;
 	Scene3 game;
+	//Scene4 game;
 
 	// Run the game
 	game.runGame();